@@ -137,9 +137,9 @@ static void pdf14_debug_mask_stack_state(pdf14_ctx *ctx);
 #endif
 
 /* Buffer stack	data structure */
-gs_private_st_ptrs7(st_pdf14_buf, pdf14_buf, "pdf14_buf",
+gs_private_st_ptrs8(st_pdf14_buf, pdf14_buf, "pdf14_buf",
                     pdf14_buf_enum_ptrs, pdf14_buf_reloc_ptrs,
-                    saved, data, backdrop, transfer_fn, mask_stack,
+                    saved, data, bands, backdrop, transfer_fn, mask_stack,
                     matte, group_color_info);
 
 gs_private_st_ptrs3(st_pdf14_ctx, pdf14_ctx, "pdf14_ctx",
@@ -1105,6 +1105,7 @@ pdf14_buf_new(gs_int_rect *rect, bool has_tags, bool has_alpha_g,
         return result;
 
     result->memory = memory;
+    result->bands = NULL;
     result->backdrop = NULL;
     result->saved = NULL;
     result->isolated = false;
@@ -1165,6 +1166,28 @@ pdf14_buf_new(gs_int_rect *rect, bool has_tags, bool has_alpha_g,
     return result;
 }
 
+/* Make a newly allocated buffer sparse (see PDF14_SPARSE_BAND_HEIGHT) if
+ * it is big enough to be worth it. The caller must not rely on the data
+ * having been cleared, and must clear it itself if this fails to make the
+ * buffer sparse. */
+static	void
+pdf14_buf_make_sparse(pdf14_buf *buf)
+{
+    int num_bands;
+
+    if (buf->data == NULL)
+        return;
+    num_bands = (buf->rect.q.y - buf->rect.p.y + PDF14_SPARSE_BAND_HEIGHT - 1) /
+                PDF14_SPARSE_BAND_HEIGHT;
+    if (num_bands < PDF14_SPARSE_MIN_BANDS)
+        return;
+    /* No band map just means a dense buffer, so an allocation failure
+       is not an error. */
+    buf->bands = gs_alloc_bytes(buf->memory, num_bands, "pdf14_buf_make_sparse");
+    if (buf->bands != NULL)
+        memset(buf->bands, 0, num_bands);
+}
+
 static	void
 pdf14_buf_free(pdf14_buf *buf)
 {
@@ -1178,6 +1201,7 @@ pdf14_buf_free(pdf14_buf *buf)
     gs_free_object(memory, buf->transfer_fn, "pdf14_buf_free");
     gs_free_object(memory, buf->matte, "pdf14_buf_free");
     gs_free_object(memory, buf->data, "pdf14_buf_free");
+    gs_free_object(memory, buf->bands, "pdf14_buf_free");
 
     while (group_color_info) {
        if (group_color_info->icc_profile != NULL) {
@@ -1507,12 +1531,18 @@ pdf14_push_transparency_group(pdf14_ctx	*ctx, gs_int_rect *rect, bool isolated,
 
     /* Initializes buf->data with the backdrop or as opaque */
     if (pdf14_backdrop == NULL || (is_backdrop && pdf14_backdrop->backdrop == NULL)) {
+        /* A large buffer is left uncleared and made sparse, unless we
+           are about to take a copy of the whole of it as the knockout
+           backdrop below. */
+        if (!(buf->knockout && pdf14_backdrop != NULL))
+            pdf14_buf_make_sparse(buf);
         /* Note, don't clear out tags set by pdf14_buf_new == GS_UNKNOWN_TAG */
         /* Memsetting by 0, so this copes with the deep case too */
-        memset(buf->data, 0, (size_t)buf->planestride *
-                                          (buf->n_chan +
-                                           (buf->has_shape ? 1 : 0) +
-                                           (buf->has_alpha_g ? 1 : 0)));
+        if (buf->bands == NULL)
+            memset(buf->data, 0, (size_t)buf->planestride *
+                                              (buf->n_chan +
+                                               (buf->has_shape ? 1 : 0) +
+                                               (buf->has_alpha_g ? 1 : 0)));
     } else {
         if (!cm_back_drop) {
             pdf14_preserve_backdrop(buf, pdf14_backdrop, is_backdrop
@@ -1711,6 +1741,7 @@ pdf14_pop_transparency_group(gs_gstate *pgs, pdf14_ctx *ctx,
             pdf14_buf *result;
             bool did_alloc; /* We don't care here */
 
+            pdf14_buf_materialize(tos);
             if (has_matte) {
                 result = pdf14_transform_color_buffer_with_matte(pgs, ctx, dev,
                     tos, tos->data, curr_icc_profile, nos->group_color_info->icc_profile,
@@ -2276,6 +2307,8 @@ pdf14_get_buffer_information(const gx_device * dev,
     pdf14_debug_mask_stack_state(pdev->ctx);
 #endif
     buf = pdev->ctx->stack;
+    /* The pattern code reads and marks the buffer directly. */
+    pdf14_buf_materialize(buf);
     rect = buf->rect;
     transbuff->buf = (free_device ? NULL : buf);
     x1 = min(pdev->width, rect.q.x);
@@ -2539,6 +2572,7 @@ pdf14_put_image(gx_device * dev, gs_gstate * pgs, gx_device * target)
     y1 = min(pdev->height, rect.q.y);
     width = x1 - rect.p.x;
     height = y1 - rect.p.y;
+    pdf14_buf_materialize(buf);
 #ifdef DUMP_TO_PNG
     dump_planar_rgba(pdev->memory, buf);
 #endif
@@ -3582,6 +3616,7 @@ pdf14_cmykspot_put_image(gx_device *dev, gs_gstate *pgs, gx_device *target)
     y1 = min(pdev->height, rect.q.y);
     width = x1 - rect.p.x;
     height = y1 - rect.p.y;
+    pdf14_buf_materialize(buf);
     if (width <= 0 || height <= 0 || buf->data == NULL)
         return 0;
 
@@ -3654,6 +3689,7 @@ pdf14_custom_put_image(gx_device * dev, gs_gstate * pgs, gx_device * target)
     y1 = min(pdev->height, rect.q.y);
     width = x1 - rect.p.x;
     height = y1 - rect.p.y;
+    pdf14_buf_materialize(buf);
     if (width <= 0 || height <= 0 || buf->data == NULL)
         return 0;
     buf_ptr = buf->data + (rect.p.y - buf->rect.p.y) * buf->rowstride + ((rect.p.x - buf->rect.p.x)<<deep);
@@ -3757,6 +3793,7 @@ pdf14_discard_trans_layer(gx_device *dev, gs_gstate * pgs)
             gs_free_object(ctx->memory, buf->transfer_fn, "pdf14_discard_trans_layer");
             gs_free_object(ctx->memory, buf->matte, "pdf14_discard_trans_layer");
             gs_free_object(ctx->memory, buf->data, "pdf14_discard_trans_layer");
+            gs_free_object(ctx->memory, buf->bands, "pdf14_discard_trans_layer");
             gs_free_object(ctx->memory, buf->backdrop, "pdf14_discard_trans_layer");
             /* During the soft mask push, the mask_stack was copied (not moved) from
                the ctx to the tos mask_stack. We are done with this now so it is safe
@@ -4570,6 +4607,7 @@ do_pdf14_copy_alpha_color(gx_device * dev, const byte * data, int data_x,
     if (y < buf->dirty.p.y) buf->dirty.p.y = y;
     if (x + w > buf->dirty.q.x) buf->dirty.q.x = x + w;
     if (y + h > buf->dirty.q.y) buf->dirty.q.y = y + h;
+    pdf14_buf_touch(buf, y, y + h);
     line = buf->data + (x - buf->rect.p.x) + (y - buf->rect.p.y) * rowstride;
 
     for (j = 0; j < h; ++j, aa_row += aa_raster) {
@@ -4757,6 +4795,7 @@ do_pdf14_copy_alpha_color_16(gx_device * dev, const byte * data, int data_x,
     if (y < buf->dirty.p.y) buf->dirty.p.y = y;
     if (x + w > buf->dirty.q.x) buf->dirty.q.x = x + w;
     if (y + h > buf->dirty.q.y) buf->dirty.q.y = y + h;
+    pdf14_buf_touch(buf, y, y + h);
     line = buf->data + (x - buf->rect.p.x)*2 + (y - buf->rect.p.y) * rowstride;
 
     planestride >>= 1;
@@ -6606,6 +6645,7 @@ pdf14_copy_planes(gx_device * dev, const byte * data, int data_x, int raster,
     fake_tos.blend_mode = pdev->blend_mode;
     fake_tos.color_space = buf->color_space;
     fake_tos.data = (byte *)data + ((data_x - (x - xo))<<deep) - (y - yo) * raster; /* Nasty, cast away of const */
+    fake_tos.bands = NULL;
     fake_tos.dirty.p.x = x;
     fake_tos.dirty.p.y = y;
     fake_tos.dirty.q.x = x + w;
@@ -7766,6 +7806,7 @@ do_mark_fill_rectangle_ko_simple(gx_device *dev, int x, int y, int w, int h,
     if (y < buf->dirty.p.y) buf->dirty.p.y = y;
     if (x + w > buf->dirty.q.x) buf->dirty.q.x = x + w;
     if (y + h > buf->dirty.q.y) buf->dirty.q.y = y + h;
+    pdf14_buf_touch(buf, y, y + h);
 
     /* composite with backdrop only. */
     if (has_backdrop)
@@ -7983,6 +8024,7 @@ do_mark_fill_rectangle_ko_simple16(gx_device *dev, int x, int y, int w, int h,
     if (y < buf->dirty.p.y) buf->dirty.p.y = y;
     if (x + w > buf->dirty.q.x) buf->dirty.q.x = x + w;
     if (y + h > buf->dirty.q.y) buf->dirty.q.y = y + h;
+    pdf14_buf_touch(buf, y, y + h);
 
 
     /* composite with backdrop only. */
@@ -126,6 +126,15 @@ struct pdf14_group_color_s {
     pdf14_group_color_t *previous;
 };
 
+/* Large group buffers that start out fully transparent are not cleared
+ * when they are pushed. Instead they are treated as a stack of bands of
+ * PDF14_SPARSE_BAND_HEIGHT rows, each of which is cleared the first time
+ * something marks it (see pdf14_buf_touch). Bands that are never marked
+ * cost neither the clearing nor (typically) any real memory, and are
+ * skipped when the group is composited. */
+#define PDF14_SPARSE_BAND_HEIGHT 64
+#define PDF14_SPARSE_MIN_BANDS 4
+
 typedef struct pdf14_ctx_s pdf14_ctx;
 
 struct pdf14_buf_s {
@@ -157,6 +166,8 @@ struct pdf14_buf_s {
     int n_chan;   /* number of pixel planes including alpha */
     int n_planes; /* total number of planes including alpha, shape, alpha_g */
     byte *data;
+    byte *bands;  /* Sparse buffers only: one flag per band, set once the
+                     band has been cleared. NULL if all of data is valid. */
     byte *transfer_fn;
     bool is_ident;
     int matte_num_comps;
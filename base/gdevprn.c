@@ -109,51 +109,103 @@ gdev_prn_open(gx_device * pdev)
     return code;
 }
 
-/* This is called various places to wait for any pending bg print thread and */
-/* perform its cleanup                                                       */
+/* Pages that are written to a file each (OutputFile with a page number */
+/* format) can be rendered concurrently, others must be written in turn. */
+static bool
+prn_bg_print_in_order(gx_device_printer *ppdev)
+{
+    gs_parsed_file_name_t parsed;
+    const char *fmt;
+    int code = gx_parse_output_file_name(&parsed, &fmt, ppdev->fname,
+                                         strlen(ppdev->fname), ppdev->memory);
+
+    return !(code >= 0 && fmt);
+}
+
+/* Wait for the oldest page printing in the background and clean up after it */
+static void
+prn_finish_bg_print_page(gx_device_printer *ppdev)
+{
+    bg_print_queue_t *queue = ppdev->bg_print;
+    bg_print_t *bg_print = &queue->pages[queue->first];
+    gx_device_printer *bgppdev = (gx_device_printer *)bg_print->device;
+    gp_file *save_file = ppdev->file;
+    int closecode;
+
+    /* wait for its semaphore (it may already have been signalled, but that's	*/
+    /* OK.) then close and unlink the files and free the device and its		*/
+    /* private allocator							*/
+    gx_semaphore_wait(bg_print->sema);
+    /* If numcopies > 1, then the bg_print->device will have closed and reopened
+     * the output file, so the pointer in the original device is now stale,
+     * so copy it back.
+     * If numcopies == 1, this is pointless, but benign.
+     */
+    ppdev->file = bgppdev->file;
+    closecode = gdev_prn_close_printer((gx_device *)ppdev);
+    /* A page with a file of its own leaves the foreground's file alone. */
+    if (!bg_print->in_order)
+        ppdev->file = save_file;
+    if (bg_print->return_code == 0)
+        bg_print->return_code = closecode;	/* return code here iff there wasn't another error */
+    teardown_device_and_mem_for_thread(bg_print->device,
+                                       bg_print->thread_id, true);
+    bg_print->device = NULL;
+    if (bg_print->ocfile) {
+        closecode = bg_print->oio_procs->fclose(bg_print->ocfile, bg_print->ocfname, true);
+        if (bg_print->return_code == 0)
+           bg_print->return_code = closecode;
+    }
+    if (bg_print->ocfname) {
+        gs_free_object(ppdev->memory->non_gc_memory, bg_print->ocfname, "prn_finish_bg_print(ocfname)");
+    }
+    if (bg_print->obfile) {
+        closecode = bg_print->oio_procs->fclose(bg_print->obfile, bg_print->obfname, true);
+        if (bg_print->return_code == 0)
+           bg_print->return_code = closecode;
+    }
+    if (bg_print->obfname) {
+        gs_free_object(ppdev->memory->non_gc_memory, bg_print->obfname, "prn_finish_bg_print(obfname)");
+    }
+    bg_print->ocfile = bg_print->obfile =
+      bg_print->ocfname = bg_print->obfname = NULL;
+    if (queue->return_code == 0)
+        queue->return_code = bg_print->return_code;
+    queue->first = (queue->first + 1) % BG_PRINT_MAX_PAGES;
+    if (--queue->count == 0)
+        queue->turn = queue->next_seq;
+}
+
+/* This is called various places to wait for any pending bg print threads and */
+/* perform their cleanup                                                      */
 static void
 prn_finish_bg_print(gx_device_printer *ppdev)
 {
-    /* if we have a a bg printing device that was created, then wait for its	*/
-    /* semaphore (it may already have been signalled, but that's OK.) then	*/
-    /* close and unlink the files and free the device and its private allocator	*/
-    if (ppdev->bg_print && (ppdev->bg_print->device != NULL)) {
-        int closecode;
-        gx_device_printer *bgppdev = (gx_device_printer *)ppdev->bg_print->device;
-
-        gx_semaphore_wait(ppdev->bg_print->sema);
-        /* If numcopies > 1, then the bg_print->device will have closed and reopened
-         * the output file, so the pointer in the original device is now stale,
-         * so copy it back.
-         * If numcopies == 1, this is pointless, but benign.
-         */
-        ppdev->file = bgppdev->file;
-        closecode = gdev_prn_close_printer((gx_device *)ppdev);
-        if (ppdev->bg_print->return_code == 0)
-            ppdev->bg_print->return_code = closecode;	/* return code here iff there wasn't another error */
-        teardown_device_and_mem_for_thread(ppdev->bg_print->device,
-                                           ppdev->bg_print->thread_id, true);
-        ppdev->bg_print->device = NULL;
-        if (ppdev->bg_print->ocfile) {
-            closecode = ppdev->bg_print->oio_procs->fclose(ppdev->bg_print->ocfile, ppdev->bg_print->ocfname, true);
-            if (ppdev->bg_print->return_code == 0)
-               ppdev->bg_print->return_code = closecode;
-        }
-        if (ppdev->bg_print->ocfname) {
-            gs_free_object(ppdev->memory->non_gc_memory, ppdev->bg_print->ocfname, "prn_finish_bg_print(ocfname)");
-        }
-        if (ppdev->bg_print->obfile) {
-            closecode = ppdev->bg_print->oio_procs->fclose(ppdev->bg_print->obfile, ppdev->bg_print->obfname, true);
-            if (ppdev->bg_print->return_code == 0)
-               ppdev->bg_print->return_code = closecode;
-        }
-        if (ppdev->bg_print->obfname) {
-            gs_free_object(ppdev->memory->non_gc_memory, ppdev->bg_print->obfname, "prn_finish_bg_print(obfname)");
-        }
-        ppdev->bg_print->ocfile = ppdev->bg_print->obfile =
-          ppdev->bg_print->ocfname = ppdev->bg_print->obfname = NULL;
+    while (ppdev->bg_print && ppdev->bg_print->count > 0)
+        prn_finish_bg_print_page(ppdev);
+}
+
+/* Free the background printing queue and its synchronization objects */
+static void
+prn_free_bg_print(gx_device_printer *ppdev)
+{
+    bg_print_queue_t *queue = ppdev->bg_print;
+    int i;
+
+    if (queue == NULL)
+        return;
+    for (i = 0; i < BG_PRINT_MAX_PAGES; i++) {
+        if (queue->pages[i].sema != NULL)
+            gx_semaphore_free(queue->pages[i].sema);
+        if (queue->pages[i].sema_turn != NULL)
+            gx_semaphore_free(queue->pages[i].sema_turn);
     }
+    if (queue->lock != NULL)
+        gx_monitor_free(queue->lock);
+    gs_free_object(ppdev->memory->non_gc_memory, queue, "prn_free_bg_print");
+    ppdev->bg_print = NULL;
 }
+
 /* Generic closing for the printer device. */
 /* Specific devices may wish to extend this. */
 int
@@ -163,10 +215,6 @@ gdev_prn_close(gx_device * pdev)
     int code = 0;
 
     prn_finish_bg_print(ppdev);
-    if (ppdev->bg_print != NULL && ppdev->bg_print->sema != NULL) {
-        gx_semaphore_free(ppdev->bg_print->sema);
-        ppdev->bg_print->sema = NULL;		/* prevent double free */
-    }
     gdev_prn_free_memory(pdev);
     if (ppdev->file != NULL) {
         code = gx_device_close_output_file(pdev, ppdev->fname, ppdev->file);
@@ -290,12 +338,21 @@ gdev_prn_allocate(gx_device *pdev, gdev_space_params *new_space_params,
 
 
     /* bg_print allocation is not fatal, we just continue (as far as possible) without BGPrint */
-    if (ppdev->bg_print == NULL)
-        ppdev->bg_print = (bg_print_t *)gs_alloc_bytes(pdev->memory->non_gc_memory, sizeof(bg_print_t), "prn bg_print");
     if (ppdev->bg_print == NULL) {
-        emprintf(pdev->memory, "Failed to allocate memory for BGPrint, attempting to continue without BGPrint\n");
+        ppdev->bg_print = (bg_print_queue_t *)gs_alloc_bytes(pdev->memory->non_gc_memory, sizeof(bg_print_queue_t), "prn bg_print");
+        if (ppdev->bg_print == NULL) {
+            emprintf(pdev->memory, "Failed to allocate memory for BGPrint, attempting to continue without BGPrint\n");
+        } else {
+            int i;
+
+            memset(ppdev->bg_print, 0, sizeof(bg_print_queue_t));
+            for (i = 0; i < BG_PRINT_MAX_PAGES; i++)
+                ppdev->bg_print->pages[i].queue = ppdev->bg_print;
+        }
     } else {
-        memset(ppdev->bg_print, 0, sizeof(bg_print_t));
+        /* Keep the synchronization objects, any pages in flight were */
+        /* finished when the device was torn down.                    */
+        ppdev->bg_print->return_code = 0;
     }
 
     /* Re/allocate memory */
@@ -416,10 +473,6 @@ gdev_prn_allocate(gx_device *pdev, gdev_space_params *new_space_params,
                 ecode = gs_note_error(gs_error_VMerror);
                 continue;
             }
-            if (ppdev->bg_print) {
-                ppdev->bg_print->ocfname = ppdev->bg_print->obfname =
-                    ppdev->bg_print->obfile = ppdev->bg_print->ocfile = NULL;
-            }
 
             code = clist_mutate_to_clist((gx_device_clist_mutatable *)pdev,
                                          buffer_memory,
@@ -530,8 +583,7 @@ gdev_prn_free_memory(gx_device *pdev)
          ppdev->buffer_memory);
 
     gdev_prn_tear_down(pdev, &the_memory);
-    gs_free_object(pdev->memory->non_gc_memory, ppdev->bg_print, "gdev_prn_free_memory");
-    ppdev->bg_print = NULL;
+    prn_free_bg_print(ppdev);
     gs_free_object(buffer_memory, the_memory, "gdev_prn_free_memory");
     return 0;
 }
@@ -575,6 +627,9 @@ gdev_prn_get_param(gx_device *dev, char *Param, void *list)
     if (strcmp(Param, "BGPrint") == 0) {
         return param_write_bool(plist, "BGPrint", &ppdev->bg_print_requested);
     }
+    if (strcmp(Param, "BGPrintPages") == 0) {
+        return param_write_int(plist, "BGPrintPages", &ppdev->bg_print_pages);
+    }
     if (strcmp(Param, "ReopenPerPage") == 0) {
         return param_write_bool(plist, "ReopenPerPage", &ppdev->ReopenPerPage);
     }
@@ -640,6 +695,7 @@ gdev_prn_get_params(gx_device * pdev, gs_param_list * plist)
         (code = param_write_int(plist, "NumRenderingThreads", &ppdev->num_render_threads_requested)) < 0 ||
         (code = param_write_bool(plist, "OpenOutputFile", &ppdev->OpenOutputFile)) < 0 ||
         (code = param_write_bool(plist, "BGPrint", &ppdev->bg_print_requested)) < 0 ||
+        (code = param_write_int(plist, "BGPrintPages", &ppdev->bg_print_pages)) < 0 ||
         (code = param_write_bool(plist, "ReopenPerPage", &ppdev->ReopenPerPage)) < 0 ||
         (code = param_write_bool(plist, "pageneutralcolor", &pageneutralcolor)) < 0
         )
@@ -698,6 +754,7 @@ gdev_prn_put_params(gx_device * pdev, gs_param_list * plist)
     bool rpp = ppdev->ReopenPerPage;
     bool old_page_uses_transparency = ppdev->page_uses_transparency;
     bool bg_print_requested = ppdev->bg_print_requested;
+    int bg_print_pages = ppdev->bg_print_pages;
     bool duplex;
     int duplex_set = -1;
     int width = pdev->width;
@@ -820,6 +877,18 @@ gdev_prn_put_params(gx_device * pdev, gs_param_list * plist)
         case 1:
             break;
     }
+    switch (code = param_read_int(plist, (param_name = "BGPrintPages"),
+                                                        &bg_print_pages)) {
+        case 0:
+            if (bg_print_pages >= 1 && bg_print_pages <= BG_PRINT_MAX_PAGES)
+                break;
+            code = gs_note_error(gs_error_rangecheck);
+        default:
+            ecode = code;
+            param_signal_error(plist, param_name, ecode);
+        case 1:
+            break;
+    }
 
     switch (code = param_read_string(plist, (param_name = "saved-pages"),
                                                         &saved_pages)) {
@@ -859,6 +928,7 @@ gdev_prn_put_params(gx_device * pdev, gs_param_list * plist)
     }
 
     ppdev->bg_print_requested = bg_print_requested;
+    ppdev->bg_print_pages = bg_print_pages;
     if (duplex_set >= 0) {
         ppdev->Duplex = duplex;
         ppdev->Duplex_set = duplex_set;
@@ -881,6 +951,9 @@ gdev_prn_put_params(gx_device * pdev, gs_param_list * plist)
         bytes_compare(ofs.data, ofs.size,
                       (const byte *)ppdev->fname, strlen(ppdev->fname))
         ) {
+        /* Pages printing in the background may still be writing */
+        /* to the old file.                                      */
+        prn_finish_bg_print(ppdev);
         /* Close the file if it's open. */
         if (ppdev->file != NULL) {
             gx_device_close_output_file(pdev, ppdev->fname, ppdev->file);
@@ -932,8 +1005,19 @@ gdev_prn_output_page_aux(gx_device * pdev, int num_copies, int flush, bool seeka
     gs_devn_params *pdevn_params;
     int outcode = 0, errcode = 0, endcode, closecode = 0;
     int code;
+    bool in_order = prn_bg_print_in_order(ppdev);
+    int bg_pages = 0;
 
-    prn_finish_bg_print(ppdev);		/* finish any previous background printing */
+    if (bg_print_ok && ppdev->bg_print_requested && ppdev->bg_print &&
+        PRINTER_IS_CLIST(ppdev) && num_copies > 0 && ppdev->saved_pages_list == NULL) {
+        /* A file that is reopened for each page can't be shared by pages in flight */
+        bg_pages = (in_order && ppdev->ReopenPerPage ? 1 : ppdev->bg_print_pages);
+    }
+    /* Finish as much of any previous background printing as needed to make */
+    /* room for this page.                                                  */
+    while (ppdev->bg_print && ppdev->bg_print->count > 0 &&
+           (ppdev->bg_print->count >= bg_pages || ppdev->bg_print->in_order != in_order))
+        prn_finish_bg_print_page(ppdev);
 
     if (num_copies > 0 && ppdev->saved_pages_list != NULL) {
         /* We are putting pages on a list */
@@ -947,25 +1031,28 @@ gdev_prn_output_page_aux(gx_device * pdev, int num_copies, int flush, bool seeka
         if (num_copies > 0) {
             int threads_enabled = 0;
             int print_foreground = 1;		/* default to foreground printing */
+            bg_print_queue_t *queue = ppdev->bg_print;
+            bg_print_t *bg_print = NULL;	/* the entry for this page */
+            gx_device_clist_reader *crdev = (gx_device_clist_reader *)ppdev;
 
-            if (bg_print_ok && PRINTER_IS_CLIST(ppdev) && ppdev->bg_print &&
+            if (bg_print_ok && PRINTER_IS_CLIST(ppdev) && queue &&
                 (ppdev->bg_print_requested || ppdev->num_render_threads_requested > 0)) {
                 threads_enabled = clist_enable_multi_thread_render(pdev);
             }
-            /* NB: we leave the semaphore allocated until foreground printing or close */
+            /* NB: we leave the semaphores allocated until close */
             /* If there was an error, abort on this page -- no good way to handle this */
             /* but it means that the error will be reported AFTER another page was     */
             /* interpreted and written to clist files. FIXME: ???                      */
-            if (ppdev->bg_print && (ppdev->bg_print->return_code < 0)) {
-                outcode = ppdev->bg_print->return_code;
+            if (queue && (queue->return_code < 0)) {
+                outcode = queue->return_code;
                 threads_enabled = 0;	/* and allow current page to try foreground */
             }
             /* Use 'while' instead of 'if' to avoid nesting */
-            while (ppdev->bg_print_requested && ppdev->bg_print && threads_enabled) {
+            while (bg_pages > 0 && threads_enabled) {
                 gx_device *ndev;
                 gx_device_printer *npdev;
-                gx_device_clist_reader *crdev = (gx_device_clist_reader *)ppdev;
 
+                bg_print = &queue->pages[(queue->first + queue->count) % BG_PRINT_MAX_PAGES];
                 if ((code = clist_close_writer_and_init_reader((gx_device_clist *)ppdev)) < 0)
                     /* should not happen -- do foreground print */
                     break;
@@ -973,39 +1060,70 @@ gdev_prn_output_page_aux(gx_device * pdev, int num_copies, int flush, bool seeka
                 /* We need to hang onto references to these files, so we can ensure the main file data
                  * gets freed with the correct allocator.
                  */
-                ppdev->bg_print->ocfname =
+                bg_print->ocfname =
                      (char *)gs_alloc_bytes(ppdev->memory->non_gc_memory,
                            strnlen(crdev->page_info.cfname, gp_file_name_sizeof - 1) + 1, "gdev_prn_output_page_aux(ocfname)");
-                ppdev->bg_print->obfname =
+                bg_print->obfname =
                      (char *)gs_alloc_bytes(ppdev->memory->non_gc_memory,
                            strnlen(crdev->page_info.bfname, gp_file_name_sizeof - 1) + 1,"gdev_prn_output_page_aux(ocfname)");
 
-                if (!ppdev->bg_print->ocfname || !ppdev->bg_print->obfname)
+                if (!bg_print->ocfname || !bg_print->obfname)
                     break;
 
-                strncpy(ppdev->bg_print->ocfname, crdev->page_info.cfname, strnlen(crdev->page_info.cfname, gp_file_name_sizeof - 1) + 1);
-                strncpy(ppdev->bg_print->obfname, crdev->page_info.bfname, strnlen(crdev->page_info.bfname, gp_file_name_sizeof - 1) + 1);
-                ppdev->bg_print->obfile = crdev->page_info.bfile;
-                ppdev->bg_print->ocfile = crdev->page_info.cfile;
-                ppdev->bg_print->oio_procs = crdev->page_info.io_procs;
+                strncpy(bg_print->ocfname, crdev->page_info.cfname, strnlen(crdev->page_info.cfname, gp_file_name_sizeof - 1) + 1);
+                strncpy(bg_print->obfname, crdev->page_info.bfname, strnlen(crdev->page_info.bfname, gp_file_name_sizeof - 1) + 1);
+                bg_print->obfile = crdev->page_info.bfile;
+                bg_print->ocfile = crdev->page_info.cfile;
+                bg_print->oio_procs = crdev->page_info.io_procs;
                 crdev->page_info.cfile = crdev->page_info.bfile = NULL;
 
-                if (ppdev->bg_print->sema == NULL)
+                if (bg_print->sema == NULL)
                 {
-                    ppdev->bg_print->sema = gx_semaphore_label(gx_semaphore_alloc(ppdev->memory->non_gc_memory), "BGPrint");
-                    if (ppdev->bg_print->sema == NULL)
+                    bg_print->sema = gx_semaphore_label(gx_semaphore_alloc(ppdev->memory->non_gc_memory), "BGPrint");
+                    if (bg_print->sema == NULL)
                         break;			/* couldn't create the semaphore */
                 }
+                if (in_order) {
+                    if (queue->lock == NULL) {
+                        queue->lock = gx_monitor_label(gx_monitor_alloc(ppdev->memory->non_gc_memory), "BGPrint queue");
+                        if (queue->lock == NULL)
+                            break;
+                    }
+                    if (bg_print->sema_turn == NULL) {
+                        bg_print->sema_turn = gx_semaphore_label(gx_semaphore_alloc(ppdev->memory->non_gc_memory), "BGPrint turn");
+                        if (bg_print->sema_turn == NULL)
+                            break;
+                    }
+                }
 
                 ndev = setup_device_and_mem_for_thread(pdev->memory->thread_safe_memory, pdev, true, NULL);
+                /* If memory is short, let the pages in flight free theirs and try again */
+                while (ndev == NULL && queue->count > 0) {
+                    prn_finish_bg_print_page(ppdev);
+                    ndev = setup_device_and_mem_for_thread(pdev->memory->thread_safe_memory, pdev, true, NULL);
+                }
                 if (ndev == NULL) {
                     break;
                 }
-                ppdev->bg_print->device = ndev;
-                ppdev->bg_print->num_copies = num_copies;
+                bg_print->device = ndev;
+                bg_print->num_copies = num_copies;
+                bg_print->return_code = 0;
+                bg_print->in_order = in_order;
+                if (in_order) {
+                    /* The page ahead may be looking at this entry to pass the turn on */
+                    gx_monitor_enter(queue->lock);
+                    bg_print->seq = queue->next_seq;
+                    bg_print->waiting = false;
+                    gx_monitor_leave(queue->lock);
+                }
                 npdev = (gx_device_printer *)ndev;
                 npdev->bg_print_requested = 0;
                 npdev->num_render_threads_requested = ppdev->num_render_threads_requested;
+                /* Pages rendered side by side share out the rendering threads, */
+                /* but each keeps at least one if threads were asked for.        */
+                if (!in_order && npdev->num_render_threads_requested > 0)
+                    npdev->num_render_threads_requested =
+                        max(npdev->num_render_threads_requested / bg_pages, 1);
                 /* The bgprint's device was created with normal procs, so multi-threaded */
                 /* rendering was turned off. Re-enable it now if it is needed.           */
                 if (npdev->num_render_threads_requested > 0) {
@@ -1015,35 +1133,51 @@ gdev_prn_output_page_aux(gx_device * pdev, int num_copies, int flush, bool seeka
 
                 /* Now start the thread to print the page */
                 if ((code = gp_thread_start(prn_print_page_in_background,
-                                            (void *)(ppdev->bg_print),
-                                            &(ppdev->bg_print->thread_id))) < 0) {
+                                            (void *)bg_print,
+                                            &(bg_print->thread_id))) < 0) {
                     /* Did not start cleanly - clean up is in print_foreground block below */
                     break;
                 }
-                gp_thread_label(ppdev->bg_print->thread_id, "BG print thread");
+                gp_thread_label(bg_print->thread_id, "BG print thread");
                 /* Page was succesfully started in bg_print mode */
                 print_foreground = 0;
+                queue->next_seq++;
+                queue->count++;
+                queue->in_order = in_order;
+                /* A page with a file of its own keeps it, the next page opens another */
+                if (!in_order)
+                    ppdev->file = NULL;
                 /* Now we need to set up the next page so it will use new clist files */
-                if ((code = clist_open(pdev)) < 0) 	/* this should do it */
+                while ((code = clist_open(pdev)) == gs_error_VMerror && queue->count > 0)
+                    prn_finish_bg_print_page(ppdev);	/* free up memory and retry */
+                if (code < 0)
                     /* OOPS! can't proceed with the next page */
                     return code;	/* probably ioerror */
                 break;				/* exit the while loop */
             }
             if (print_foreground) {
-                if (ppdev->bg_print) {
-                     gs_free_object(ppdev->memory->non_gc_memory, ppdev->bg_print->ocfname, "gdev_prn_output_page_aux(ocfname)");
-                     gs_free_object(ppdev->memory->non_gc_memory, ppdev->bg_print->obfname, "gdev_prn_output_page_aux(obfname)");
-                     ppdev->bg_print->ocfname = ppdev->bg_print->obfname = NULL;
+                if (bg_print) {
+                    gs_free_object(ppdev->memory->non_gc_memory, bg_print->ocfname, "gdev_prn_output_page_aux(ocfname)");
+                    gs_free_object(ppdev->memory->non_gc_memory, bg_print->obfname, "gdev_prn_output_page_aux(obfname)");
+                    bg_print->ocfname = bg_print->obfname = NULL;
+                    /* Give the clist files back to the foreground */
+                    if (bg_print->ocfile != NULL) {
+                        crdev->page_info.cfile = bg_print->ocfile;
+                        crdev->page_info.bfile = bg_print->obfile;
+                        bg_print->ocfile = bg_print->obfile = NULL;
+                    }
 
-                    /* either bg_print was not requested or was not able to start */
-                    if (ppdev->bg_print->sema != NULL && ppdev->bg_print->device != NULL) {
+                    /* bg_print was not able to start */
+                    if (bg_print->sema != NULL && bg_print->device != NULL) {
                         /* There was a problem. Teardown the device and its allocator, but */
                         /* leave the semaphore for possible later use.                     */
-                        teardown_device_and_mem_for_thread(ppdev->bg_print->device,
-                                                           ppdev->bg_print->thread_id, true);
-                        ppdev->bg_print->device = NULL;
+                        teardown_device_and_mem_for_thread(bg_print->device,
+                                                           bg_print->thread_id, true);
+                        bg_print->device = NULL;
                     }
                 }
+                /* The pages still printing in the background come first */
+                prn_finish_bg_print(ppdev);
                 /* Here's where we actually let the device's print_page_copies work */
                 /* Print the accumulated page description. */
                 outcode = (*ppdev->printer_procs.print_page_copies)(ppdev, ppdev->file,
@@ -1156,10 +1290,21 @@ static void
 prn_print_page_in_background(void *data)
 {
     bg_print_t *bg_print = (bg_print_t *)data;
+    bg_print_queue_t *queue = bg_print->queue;
     int code, errcode = 0;
     int num_copies = bg_print->num_copies;
     gx_device_printer *ppdev = (gx_device_printer *)bg_print->device;
 
+    if (bg_print->in_order) {
+        /* Wait until the pages before this one have been written */
+        gx_monitor_enter(queue->lock);
+        if (queue->turn != bg_print->seq) {
+            bg_print->waiting = true;
+            gx_monitor_leave(queue->lock);
+            gx_semaphore_wait(bg_print->sema_turn);
+        } else
+            gx_monitor_leave(queue->lock);
+    }
     code = (*ppdev->printer_procs.print_page_copies)(ppdev, ppdev->file,
                                                           num_copies);
     gp_fflush(ppdev->file);
@@ -1167,6 +1312,19 @@ prn_print_page_in_background(void *data)
     errcode = (gp_ferror(ppdev->file) ? gs_note_error(gs_error_ioerror) : 0);
     bg_print->return_code = code < 0 ? code : errcode;
 
+    if (bg_print->in_order) {
+        /* Pass the turn to the next page, waking it if it is already waiting */
+        bg_print_t *next = &queue->pages[(bg_print - queue->pages + 1) % BG_PRINT_MAX_PAGES];
+
+        gx_monitor_enter(queue->lock);
+        queue->turn = bg_print->seq + 1;
+        if (next->waiting && next->seq == queue->turn) {
+            next->waiting = false;
+            gx_semaphore_signal(next->sema_turn);
+        }
+        gx_monitor_leave(queue->lock);
+    }
+
     /* Finally, release the foreground that may be waiting */
     gx_semaphore_signal(bg_print->sema);
 }
@@ -124,8 +124,33 @@ typedef struct bg_print_s {
     char *obfname;	                /* block file name */
     clist_file_ptr obfile;	/* block file, normally 0 */
     const clist_io_procs_t *oio_procs;
+    struct bg_print_queue_s *queue;	/* the queue this page belongs to */
+    bool in_order;			/* output file is shared with the other pages */
+    int seq;				/* position in the output file, if in_order */
+    bool waiting;			/* waiting on sema_turn, protected by queue->lock */
+    gx_semaphore_t *sema_turn;		/* signalled when the page may be written */
 } bg_print_t;
 
+/*
+ * BGPrintPages pages may be printing in the background at once. The pages
+ * in flight occupy entries first .. first + count - 1 (modulo
+ * BG_PRINT_MAX_PAGES) of the queue, oldest first. Pages that share an
+ * output file are written in turn, pages with a file each are rendered
+ * concurrently.
+ */
+#define BG_PRINT_MAX_PAGES 16
+
+typedef struct bg_print_queue_s {
+    gx_monitor_t *lock;			/* protects turn and the waiting flags */
+    int turn;				/* seq of the page to be written next */
+    int next_seq;			/* seq for the next page started */
+    int first;				/* oldest page in flight */
+    int count;				/* number of pages in flight */
+    bool in_order;			/* of the pages in flight */
+    int return_code;			/* first error from a background page */
+    bg_print_t pages[BG_PRINT_MAX_PAGES];
+} bg_print_queue_t;
+
 #define gx_prn_device_common\
         gx_device_clist_mutatable_common;\
         gx_printer_device_procs printer_procs;\
@@ -141,7 +166,8 @@ typedef struct bg_print_s {
         bool file_is_new;		/* true iff file just opened */\
         gp_file *file;  		/* output file */\
         bool bg_print_requested;	/* request background printing of page from clist */\
-        bg_print_t *bg_print;           /* background printing data shared with thread */\
+        bg_print_queue_t *bg_print;     /* background printing data shared with threads */\
+        int bg_print_pages;		/* max pages printing in the background */\
         int num_render_threads_requested;	/* for multiple band rendering threads */\
         gx_saved_pages_list *saved_pages_list;	/* list when we are saving pages instead of printing */\
         gx_device_procs save_procs_while_delaying_erasepage	/* save device procs while delaying erasepage. */
@@ -221,6 +247,7 @@ prn_dev_proc_get_space_params(gx_default_get_space_params);
         0,	        /* *file */\
         0/*false*/,	/* bg_print_requested */\
         0,              /* *bg_print */\
+        1,              /* bg_print_pages */\
         0, 		/* num_render_threads_requested */\
         0,              /* saved_pages_list */\
         { 0 }           /* save_procs_while_delaying_erasepage */
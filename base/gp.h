@@ -344,6 +344,14 @@ int gp_fprintf(gp_file *f, const char *fmt, ...)
 #endif
     ;
 
+/* Map the first size bytes of a file read-only into memory, for files
+ * that are backed by a FILE. Returns NULL if the file can't be mapped,
+ * in which case the caller should read it with gp_fpread instead. */
+void *gp_fmap(gp_file *f, gs_offset_t size);
+
+/* Release a mapping made by gp_fmap */
+void gp_funmap(void *addr, gs_offset_t size);
+
 /* ------ Reading from stdin, unbuffered if possible ------ */
 
 /* Read bytes from stdin, using unbuffered if possible.
@@ -639,6 +647,12 @@ int gp_pread_impl(char *buf, size_t count, gs_offset_t offset, FILE *f);
 
 int gp_pwrite_impl(const char *buf, size_t count, gs_offset_t offset, FILE *f);
 
+/* Map the first size bytes of a FILE read-only into memory. Returns NULL
+ * if the platform (or the file) doesn't support this. */
+void *gp_fmap_impl(FILE *f, gs_offset_t size);
+
+void gp_funmap_impl(void *addr, gs_offset_t size);
+
 gs_offset_t gp_ftell_impl(FILE *f);
 
 int gp_fseek_impl(FILE *strm, gs_offset_t offset, int origin);
@@ -153,6 +153,32 @@ int gp_pwrite_impl(const char *buf, size_t count, gs_offset_t offset, FILE *f)
     return ret;
 }
 
+/* Map the start of a FILE into memory, read only */
+void *gp_fmap_impl(FILE *f, gs_offset_t size)
+{
+    HANDLE hnd = (HANDLE)_get_osfhandle(fileno(f));
+    HANDLE mapping;
+    void *addr;
+
+    if (hnd == INVALID_HANDLE_VALUE || size <= 0 || (gs_offset_t)(SIZE_T)size != size)
+        return NULL;
+
+    mapping = CreateFileMapping(hnd, NULL, PAGE_READONLY,
+                                (DWORD)(size >> 32), (DWORD)size, NULL);
+    if (mapping == NULL)
+        return NULL;
+    addr = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, (SIZE_T)size);
+    /* The view keeps the mapping object alive until it is unmapped */
+    CloseHandle(mapping);
+
+    return addr;
+}
+
+void gp_funmap_impl(void *addr, gs_offset_t size)
+{
+    UnmapViewOfFile(addr);
+}
+
 /* --------- 64 bit file access ----------- */
 /* MSVC versions before 8 doen't provide big files.
    MSVC 8 doesn't distinguish big and small files,
@@ -487,6 +487,22 @@ mid:
     } while (n >= f->buffer_size);
     return (f->ops.write)(f, 1, n, f->buffer);
 }
+
+void *gp_fmap(gp_file *f, gs_offset_t size)
+{
+    FILE *file = gp_get_file(f);
+
+    if (file == NULL)
+        return NULL;
+    return gp_fmap_impl(file, size);
+}
+
+void gp_funmap(void *addr, gs_offset_t size)
+{
+    if (addr != NULL)
+        gp_funmap_impl(addr, size);
+}
+
 typedef struct {
     gp_file base;
     FILE *file;
@@ -439,6 +439,26 @@ typedef struct gsicc_hashlink_s {
     int64_t rend_hash;
 } gsicc_hashlink_t;
 
+/* The recent single color conversions of a link (see
+ * gsicc_transform_color_memo). Slots are picked by a hash of the input
+ * color and the last color to land in a slot replaces any before it. The
+ * hit and miss counts are added to those of the link cache from time to
+ * time. All of it is only changed under the lock of the link.
+ */
+#define ICC_COLOR_MEMO_SIZE 64	/* a power of 2 */
+
+typedef struct gsicc_color_memo_entry_s {
+    unsigned short input[ICC_MAX_CHANNELS];
+    unsigned short output[ICC_MAX_CHANNELS];
+    bool valid;
+} gsicc_color_memo_entry_t;
+
+typedef struct gsicc_color_memo_s {
+    gsicc_color_memo_entry_t entries[ICC_COLOR_MEMO_SIZE];
+    int hits;			/* not yet added to the cache counts */
+    int misses;
+} gsicc_color_memo_t;
+
 struct gsicc_link_s {
     void *link_handle;		/* the CMS decides what this is */
     gs_memory_t *memory;
@@ -457,21 +477,38 @@ struct gsicc_link_s {
     gsicc_colorbuffer_t data_cs; /* needed for begin_monitor after end_monitor */
     int num_input;  /* Need so we can monitor properly */
     int num_output; /* Need so we can monitor properly */
+    size_t size;    /* estimated memory used, counted against the cache */
+    gsicc_color_memo_t color_memo;
 };
 
-/* ICC Cache. The size of the cache is limited by max_memory_size.
- * Links are added if there is sufficient memory and if the number
- * of links does not exceed a (soft) limit.
+/* ICC Cache. The links are spread over ICC_CACHE_SHARDS shards by their
+ * hash, each with its own lock and list in most recently used order, so
+ * that threads looking up different links don't contend for one lock.
+ * The size of each shard is limited to a share of a byte budget (see
+ * gsicc_setlinkcachesize), using an estimate of the memory each link
+ * uses in the CMS. Links no longer in use are evicted, least recently
+ * used first, to make room for new ones. A shard may go over its share
+ * if all of its links are in use.
  */
 
-typedef struct gsicc_link_cache_s {
+#define ICC_CACHE_SHARDS 8
+#define ICC_CACHE_DEFAULT_SIZE (32*1024*1024)
+
+typedef struct gsicc_link_cache_stats_s gsicc_link_cache_stats_t;
+
+typedef struct gsicc_link_cache_shard_s {
     gsicc_link_t *head;
     int num_links;
+    size_t size;		/* estimated memory used by the links */
+    gx_monitor_t *lock;		/* handle for the monitor */
+} gsicc_link_cache_shard_t;
+
+typedef struct gsicc_link_cache_s {
+    gsicc_link_cache_shard_t shards[ICC_CACHE_SHARDS];
     rc_header rc;
     gs_memory_t *memory;
-    gx_monitor_t *lock;		/* handle for the monitor */
-    bool cache_full;		/* flag that some thread needs a cache slot */
-    gx_semaphore_t *full_wait;	/* semaphore for waiting when the cache is full */
+    gx_monitor_t *lock;		/* for rc changes by the clist render threads */
+    gsicc_link_cache_stats_t *stats;	/* hit/miss counts, not in gc memory */
 } gsicc_link_cache_t;
 
 /* A linked list structure to keep DeviceN ICC profiles
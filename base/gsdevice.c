@@ -1428,6 +1428,10 @@ gdev_space_params_cmp(const gdev_space_params sp1,
     return(1);
   if (sp1.band.tile_cache_size != sp2.band.tile_cache_size)
     return(1);
+  if (sp1.band.BandProfile != sp2.band.BandProfile)
+    return(1);
+  if (sp1.band.DuplicatePageCache != sp2.band.DuplicatePageCache)
+    return(1);
   if (sp1.params_are_read_only != sp2.params_are_read_only)
     return(1);
   if (sp1.banding_type != sp2.banding_type)
@@ -25,6 +25,9 @@
 #include "gxdevsop.h"
 #include "gxfixed.h"
 #include "gsicc_manage.h"
+#include "gsicc_cache.h"		/* for the link cache parameters */
+#include "gxfcache.h"		/* for the glyph cache parameters */
+#include "gsutil.h"		/* for bytes_compare */
 #include "gdevnup.h"		/* to install N-up subclass device */
 extern gx_device_nup gs_nup_device;
 
@@ -246,9 +249,15 @@ int gx_default_get_param(gx_device *dev, char *Param, void *list)
     if (strcmp(Param, "BandWidth") == 0) {
         return param_write_int(plist, "BandWidth", &dev->space_params.band.BandWidth);
     }
+    if (strcmp(Param, "BandProfile") == 0) {
+        return param_write_int(plist, "BandProfile", &dev->space_params.band.BandProfile);
+    }
     if (strcmp(Param, "BufferSpace") == 0) {
         return param_write_size_t(plist, "BufferSpace", &dev->space_params.BufferSpace);
     }
+    if (strcmp(Param, "DuplicatePageCache") == 0) {
+        return param_write_size_t(plist, "DuplicatePageCache", &dev->space_params.band.DuplicatePageCache);
+    }
     if (strcmp(Param, "InterpolateControl") == 0) {
         int interpolate_control = dev->interpolate_control;
         return param_write_int(plist, "InterpolateControl", &interpolate_control);
@@ -437,6 +446,58 @@ int gx_default_get_param(gx_device *dev, char *Param, void *list)
     if (strcmp(Param, "ColorAccuracy") == 0) {
         return param_write_int(plist, "ColorAccuracy", (const int *)(&(color_accuracy)));
     }
+    if (strcmp(Param, "ICCLinkCacheSize") == 0) {
+        size_t link_cache_size = gsicc_currentlinkcachesize(dev->memory);
+
+        return param_write_size_t(plist, "ICCLinkCacheSize", &link_cache_size);
+    }
+    if (strcmp(Param, "ICCLinkCacheDir") == 0) {
+        const char *link_cache_dir = gsicc_currentlinkcachedir(dev->memory);
+        gs_param_string dir;
+
+        dir.data = (const byte *)(link_cache_dir != NULL ? link_cache_dir : "");
+        dir.size = strlen((const char *)dir.data);
+        dir.persistent = false;
+        return param_write_string(plist, "ICCLinkCacheDir", &dir);
+    }
+    if (strcmp(Param, "ICCLinkCacheHits") == 0 ||
+        strcmp(Param, "ICCLinkCacheMisses") == 0 ||
+        strcmp(Param, "ICCLinkCacheEvictions") == 0 ||
+        strcmp(Param, "ICCColorCacheHits") == 0 ||
+        strcmp(Param, "ICCColorCacheMisses") == 0) {
+        int64_t link_cache_stats[5];
+
+        gsicc_link_cache_stats(dev->memory, &link_cache_stats[0],
+                               &link_cache_stats[1], &link_cache_stats[2],
+                               &link_cache_stats[3], &link_cache_stats[4]);
+        if (strcmp(Param, "ICCLinkCacheHits") == 0)
+            return param_write_i64(plist, Param, &link_cache_stats[0]);
+        if (strcmp(Param, "ICCLinkCacheMisses") == 0)
+            return param_write_i64(plist, Param, &link_cache_stats[1]);
+        if (strcmp(Param, "ICCLinkCacheEvictions") == 0)
+            return param_write_i64(plist, Param, &link_cache_stats[2]);
+        if (strcmp(Param, "ICCColorCacheHits") == 0)
+            return param_write_i64(plist, Param, &link_cache_stats[3]);
+        return param_write_i64(plist, Param, &link_cache_stats[4]);
+    }
+    if (strcmp(Param, "GlyphCacheSize") == 0) {
+        size_t glyph_cache_size = gx_char_cache_share_size(dev->memory);
+
+        return param_write_size_t(plist, "GlyphCacheSize", &glyph_cache_size);
+    }
+    if (strcmp(Param, "GlyphCacheHits") == 0 ||
+        strcmp(Param, "GlyphCacheMisses") == 0 ||
+        strcmp(Param, "GlyphCacheEvictions") == 0) {
+        int64_t glyph_cache_stats[3];
+
+        gx_char_cache_share_stats(dev->memory, &glyph_cache_stats[0],
+                                  &glyph_cache_stats[1], &glyph_cache_stats[2]);
+        if (strcmp(Param, "GlyphCacheHits") == 0)
+            return param_write_i64(plist, Param, &glyph_cache_stats[0]);
+        if (strcmp(Param, "GlyphCacheMisses") == 0)
+            return param_write_i64(plist, Param, &glyph_cache_stats[1]);
+        return param_write_i64(plist, Param, &glyph_cache_stats[2]);
+    }
     if (strcmp(Param, "RenderIntent") == 0) {
         return param_write_int(plist,"RenderIntent", (const int *) (&(profile_intents[0])));
     }
@@ -544,6 +605,12 @@ gx_default_get_params(gx_device * dev, gs_param_list * plist)
     bool prebandthreshold = true, temp_bool;
     int k;
     int color_accuracy = MAX_COLOR_ACCURACY;
+    size_t link_cache_size = gsicc_currentlinkcachesize(dev->memory);
+    const char *link_cache_dir = gsicc_currentlinkcachedir(dev->memory);
+    int64_t link_cache_stats[5];
+    gs_param_string link_cache_dir_str;
+    size_t glyph_cache_size = gx_char_cache_share_size(dev->memory);
+    int64_t glyph_cache_stats[3];
     gs_param_float_array msa, ibba, hwra, ma;
     gs_param_string_array scna;
     char null_str[1]={'\0'};
@@ -685,6 +752,15 @@ gx_default_get_params(gx_device * dev, gs_param_list * plist)
         param_string_from_string(postren_profile, null_str);
         param_string_from_string(blend_profile, null_str);
     }
+    gsicc_link_cache_stats(dev->memory, &link_cache_stats[0],
+                           &link_cache_stats[1], &link_cache_stats[2],
+                           &link_cache_stats[3], &link_cache_stats[4]);
+    gx_char_cache_share_stats(dev->memory, &glyph_cache_stats[0],
+                              &glyph_cache_stats[1], &glyph_cache_stats[2]);
+    /* The directory may change, so it must be copied */
+    link_cache_dir_str.data = (const byte *)(link_cache_dir != NULL ? link_cache_dir : null_str);
+    link_cache_dir_str.size = strlen((const char *)link_cache_dir_str.data);
+    link_cache_dir_str.persistent = false;
     /* Transmit the values. */
     /* Standard parameters */
     if (
@@ -727,6 +803,17 @@ gx_default_get_params(gx_device * dev, gs_param_list * plist)
         (code = param_write_string(plist,"ICCOutputColors", &(icc_colorants))) < 0 ||
         (code = param_write_int(plist, "RenderIntent", (const int *)(&(profile_intents[0])))) < 0 ||
         (code = param_write_int(plist, "ColorAccuracy", (const int *)(&(color_accuracy)))) < 0 ||
+        (code = param_write_size_t(plist, "ICCLinkCacheSize", &link_cache_size)) < 0 ||
+        (code = param_write_string(plist, "ICCLinkCacheDir", &link_cache_dir_str)) < 0 ||
+        (code = param_write_i64(plist, "ICCLinkCacheHits", &link_cache_stats[0])) < 0 ||
+        (code = param_write_i64(plist, "ICCLinkCacheMisses", &link_cache_stats[1])) < 0 ||
+        (code = param_write_i64(plist, "ICCLinkCacheEvictions", &link_cache_stats[2])) < 0 ||
+        (code = param_write_i64(plist, "ICCColorCacheHits", &link_cache_stats[3])) < 0 ||
+        (code = param_write_i64(plist, "ICCColorCacheMisses", &link_cache_stats[4])) < 0 ||
+        (code = param_write_size_t(plist, "GlyphCacheSize", &glyph_cache_size)) < 0 ||
+        (code = param_write_i64(plist, "GlyphCacheHits", &glyph_cache_stats[0])) < 0 ||
+        (code = param_write_i64(plist, "GlyphCacheMisses", &glyph_cache_stats[1])) < 0 ||
+        (code = param_write_i64(plist, "GlyphCacheEvictions", &glyph_cache_stats[2])) < 0 ||
         (code = param_write_int(plist,"VectorIntent", (const int *) &(profile_intents[1]))) < 0 ||
         (code = param_write_int(plist,"ImageIntent", (const int *) &(profile_intents[2]))) < 0 ||
         (code = param_write_int(plist,"TextIntent", (const int *) &(profile_intents[3]))) < 0 ||
@@ -761,7 +848,9 @@ gx_default_get_params(gx_device * dev, gs_param_list * plist)
         (code = param_write_size_t(plist, "BandBufferSpace", &dev->space_params.band.BandBufferSpace)) < 0 ||
         (code = param_write_int(plist, "BandHeight", &dev->space_params.band.BandHeight)) < 0 ||
         (code = param_write_int(plist, "BandWidth", &dev->space_params.band.BandWidth)) < 0 ||
+        (code = param_write_int(plist, "BandProfile", &dev->space_params.band.BandProfile)) < 0 ||
         (code = param_write_size_t(plist, "BufferSpace", &dev->space_params.BufferSpace)) < 0 ||
+        (code = param_write_size_t(plist, "DuplicatePageCache", &dev->space_params.band.DuplicatePageCache)) < 0 ||
         (code = param_write_int(plist, "InterpolateControl", &dev->interpolate_control)) < 0
         )
         return code;
@@ -1511,6 +1600,9 @@ gx_default_put_params(gx_device * dev, gs_param_list * plist)
     int leadingedge = dev->LeadingEdge;
     int k;
     int color_accuracy;
+    size_t link_cache_size;
+    gs_param_string link_cache_dir;
+    size_t glyph_cache_size;
     bool devicegraytok = true;
     bool graydetection = false;
     bool usefastcolor = false;
@@ -1525,6 +1617,8 @@ gx_default_put_params(gx_device * dev, gs_param_list * plist)
                                                gsTEXTPROFILE};
 
     color_accuracy = gsicc_currentcoloraccuracy(dev->memory);
+    link_cache_size = gsicc_currentlinkcachesize(dev->memory);
+    glyph_cache_size = gx_char_cache_share_size(dev->memory);
     if (dev->icc_struct != NULL) {
         for (k = 0; k < NUM_DEVICE_PROFILES; k++) {
             rend_intent[k] = dev->icc_struct->rendercond[k].rendering_intent;
@@ -1830,6 +1924,65 @@ nce:
         ecode = code;
         param_signal_error(plist, param_name, ecode);
     }
+    if ((code = param_read_size_t(plist, (param_name = "ICCLinkCacheSize"),
+                                                        &link_cache_size)) < 0) {
+        ecode = code;
+        param_signal_error(plist, param_name, ecode);
+    }
+    /* The glyph cache outlives the job, and is shared with the other
+       interpreters of the instance, so it is locked like the link cache
+       directory below. */
+    switch (code = param_read_size_t(plist, (param_name = "GlyphCacheSize"),
+                                     &glyph_cache_size)) {
+        case 0:
+            if (glyph_cache_size == gx_char_cache_share_size(dev->memory))
+                break;
+            if (dev->LockSafetyParams)
+                code = gs_note_error(gs_error_invalidaccess);
+            else
+                break;
+            /* fall through */
+        default:
+            ecode = code;
+            param_signal_error(plist, param_name, ecode);
+            /* fall through */
+        case 1:
+            glyph_cache_size = gx_char_cache_share_size(dev->memory);
+            break;
+    }
+    /* Like OutputFile, the link cache directory can't be changed once the
+       safety params are locked, and one whose files the path control
+       doesn't already let us read and write is refused. */
+    switch (code = param_read_string(plist, (param_name = "ICCLinkCacheDir"),
+                                     &link_cache_dir)) {
+        case 0:
+            {
+                const char *current = gsicc_currentlinkcachedir(dev->memory);
+
+                if (current == NULL)
+                    current = "";
+                if (!bytes_compare(link_cache_dir.data, link_cache_dir.size,
+                                   (const byte *)current, strlen(current)))
+                    break;
+                if (dev->LockSafetyParams)
+                    code = gs_note_error(gs_error_invalidaccess);
+                else {
+                    code = gsicc_checklinkcachedir(dev->memory,
+                                                   (const char *)link_cache_dir.data,
+                                                   link_cache_dir.size);
+                    if (code >= 0)
+                        break;
+                }
+            }
+            /* fall through */
+        default:
+            ecode = code;
+            param_signal_error(plist, param_name, ecode);
+            /* fall through */
+        case 1:
+            link_cache_dir.data = 0;
+            break;
+    }
     if ((code = param_read_bool(plist, (param_name = "DeviceGrayToK"),
                                                         &devicegraytok)) < 0) {
         ecode = code;
@@ -1919,6 +2072,15 @@ label:\
         CHECK_PARAM_CASES(band.BandBufferSpace, 0, bbse);
     }
 
+    switch (code = param_read_int(plist, (param_name = "BandProfile"), &sp.band.BandProfile)) {
+        CHECK_PARAM_CASES(band.BandProfile, sp.band.BandProfile < 0 ||
+                          sp.band.BandProfile > BandProfileJSON, bpe);
+    }
+
+    switch (code = param_read_size_t(plist, (param_name = "DuplicatePageCache"), &sp.band.DuplicatePageCache)) {
+        CHECK_PARAM_CASES(band.DuplicatePageCache, 0, dpce);
+    }
+
 
     switch (code = param_read_bool(plist, (param_name = ".LockSafetyParams"), &locksafe)) {
         case 0:
@@ -1998,6 +2160,24 @@ label:\
     /* with saved-pages, PageCount can't be checked. No harm in letting it change */
     IGNORE_INT_PARAM("PageCount")
 
+    /* The ICC link and glyph cache counts only change as the caches are used */
+    {
+        static const char *const cache_counts[] = {
+            "ICCLinkCacheHits", "ICCLinkCacheMisses", "ICCLinkCacheEvictions",
+            "ICCColorCacheHits", "ICCColorCacheMisses",
+            "GlyphCacheHits", "GlyphCacheMisses", "GlyphCacheEvictions"
+        };
+        int64_t count;
+
+        for (k = 0; k < countof(cache_counts); k++) {
+            if ((code = param_read_i64(plist, (param_name = cache_counts[k]),
+                                       &count)) < 0) {
+                ecode = code;
+                param_signal_error(plist, param_name, ecode);
+            }
+        }
+    }
+
     if ((code = param_check_int(plist, "RedValues", RGBValues, true)) < 0)
         ecode = code;
     if ((code = param_check_int(plist, "GreenValues", RGBValues, true)) < 0)
@@ -2287,6 +2467,16 @@ label:\
         }
     }
     gsicc_setcoloraccuracy(dev->memory, color_accuracy);
+    gsicc_setlinkcachesize(dev->memory, link_cache_size);
+    if (link_cache_dir.data != 0) {
+        code = gsicc_setlinkcachedir(dev->memory, (const char *)link_cache_dir.data,
+                                     link_cache_dir.size);
+        if (code < 0)
+            return code;
+    }
+    code = gx_char_cache_share_set_size(dev->memory, glyph_cache_size);
+    if (code < 0)
+        return code;
     code = gx_default_put_graytok(devicegraytok, dev);
     if (code < 0)
         return code;
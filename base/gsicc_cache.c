@@ -35,18 +35,76 @@
 #include "gxsync.h"
 #include "gzstate.h"
 #include "stdint_.h"
+#include "gslibctx.h"
+#include "gscdefs.h"	/* for gs_revision */
+#include "gp.h"
+#include "gssprintf.h"
+#include "gsutil.h"		/* for bytes_compare */
         /*
          *  Note that the the external memory used to maintain
          *  links in the CMS is generally not visible to GS.
          *  For most CMS's the  links are 33x33x33x33x4 bytes at worst
          *  for a CMYK to CMYK MLUT which is about 4.5Mb per link.
          *  If the link were matrix based it would be much much smaller.
-         *  We will likely want to do at least have an estimate of the
-         *  memory used based upon how the CMS is configured.
-         *  This will be done later.  For now, just limit the number
-         *  of links.
+         *  We estimate the size of a link from its numbers of inputs and
+         *  outputs (see gsicc_link_size), and count ICC_LINK_OVERHEAD
+         *  for a link that is being built or that the CMS isn't used for.
          */
-#define ICC_CACHE_MAXLINKS (MAX_THREADS*2)	/* allow up to two active links per thread */
+#define ICC_LINK_OVERHEAD 4096
+
+/* The hit, miss and eviction counts of a link cache, one set per shard so
+   that each is only ever updated under the lock of its shard. They are
+   kept out of gc memory, on a list in the library context, so that the
+   counts of all the caches can be totalled (see gsicc_link_cache_stats). */
+typedef struct gsicc_link_cache_counts_s {
+    int64_t hits;
+    int64_t misses;
+    int64_t evictions;
+    int64_t color_hits;		/* see gsicc_transform_color_memo */
+    int64_t color_misses;
+} gsicc_link_cache_counts_t;
+
+struct gsicc_link_cache_stats_s {
+    gsicc_link_cache_counts_t shards[ICC_CACHE_SHARDS];
+    gs_memory_t *memory;
+    gsicc_link_cache_stats_t *next;
+    gsicc_link_cache_stats_t *prev;
+};
+
+/* The on-disk link cache. When ICCLinkCacheDir is set, the links we build
+   are also written to files in that directory so that later runs, and
+   other processes, can read them back instead of building them again. A
+   file is named from the MD5 of a key made of everything that went into
+   the link, and holds a header followed by the link as a device link
+   profile (see gscms_get_link_data). The header repeats the key and has
+   the MD5 of the data, so a clash of names or a damaged file just means
+   the link is built as usual. Files are written under a scratch name and
+   renamed into place, so a file that is being read is always complete. */
+typedef struct gsicc_linkfile_key_s {
+    int64_t revision;		/* a new release may make different links */
+    int64_t revisiondate;
+    int64_t link_hash;
+    int64_t proof_hash;
+    int64_t devlink_hash;
+    int32_t rendering_intent;
+    int32_t black_point_comp;
+    int32_t preserve_black;
+    int32_t cms_flags;
+    int32_t color_accuracy;
+    int32_t graytok;
+    int32_t src_dev_link;
+    int32_t unused;
+} gsicc_linkfile_key_t;
+
+#define ICC_LINKFILE_MAGIC "GSICCLNK"
+
+typedef struct gsicc_linkfile_header_s {
+    byte magic[8];
+    gsicc_linkfile_key_t key;
+    byte digest[16];		/* MD5 of the data */
+    uint32_t size;		/* size of the data that follows */
+    uint32_t unused;
+} gsicc_linkfile_header_t;
 
 /* Static prototypes */
 
@@ -63,10 +121,27 @@ static int gsicc_compute_linkhash(gsicc_manager_t *icc_manager, gx_device *dev,
 
 static void gsicc_remove_link(gsicc_link_t *link, const gs_memory_t *memory);
 
+static int gsicc_transform_color_memo(gx_device *dev, gsicc_link_t *icclink,
+                                      void *inputcolor, void *outputcolor,
+                                      int num_bytes);
+
 static void gsicc_get_buff_hash(unsigned char *data, int64_t *hash, unsigned int num_bytes);
 
 static void rc_gsicc_link_cache_free(gs_memory_t * mem, void *ptr_in, client_name_t cname);
 
+static void gsicc_linkfile_key(gsicc_linkfile_key_t *key, gs_memory_t *memory,
+                               const gsicc_hashlink_t *hash,
+                               cmm_profile_t *proof_profile,
+                               cmm_profile_t *devlink_profile,
+                               const gsicc_rendering_param_t *rendering_params,
+                               int cms_flags, bool graytok, bool src_dev_link);
+
+static gcmmhlink_t gsicc_linkfile_read(const gsicc_linkfile_key_t *key,
+                                       gs_memory_t *memory);
+
+static void gsicc_linkfile_write(const gsicc_linkfile_key_t *key,
+                                 gcmmhlink_t *link_handle, gs_memory_t *memory);
+
 /* Structure pointer information */
 
 struct_proc_finalize(icc_link_finalize);
@@ -75,11 +150,34 @@ gs_private_st_ptrs3_final(st_icc_link, gsicc_link_t, "gsiccmanage_link",
                     icc_link_enum_ptrs, icc_link_reloc_ptrs, icc_link_finalize,
                     icc_link_cache, next, lock);
 
-struct_proc_finalize(icc_linkcache_finalize);
+static struct_proc_finalize(icc_linkcache_finalize);
+
+static
+ENUM_PTRS_WITH(icc_linkcache_enum_ptrs, gsicc_link_cache_t *cache)
+    if (index < ICC_CACHE_SHARDS * 2) {
+        const gsicc_link_cache_shard_t *shard = &cache->shards[index >> 1];
+
+        return ENUM_OBJ((index & 1) ? (void *)shard->lock : (void *)shard->head);
+    }
+    return 0;
+    case ICC_CACHE_SHARDS * 2: ENUM_RETURN(cache->lock);
+ENUM_PTRS_END
+
+static
+RELOC_PTRS_WITH(icc_linkcache_reloc_ptrs, gsicc_link_cache_t *cache)
+{
+    int k;
+
+    for (k = 0; k < ICC_CACHE_SHARDS; k++) {
+        RELOC_VAR(cache->shards[k].head);
+        RELOC_VAR(cache->shards[k].lock);
+    }
+    RELOC_VAR(cache->lock);
+} RELOC_PTRS_END
 
-gs_private_st_ptrs3_final(st_icc_linkcache, gsicc_link_cache_t, "gsiccmanage_linkcache",
-                    icc_linkcache_enum_ptrs, icc_linkcache_reloc_ptrs, icc_linkcache_finalize,
-                    head, lock, full_wait);
+gs_private_st_composite_final(st_icc_linkcache, gsicc_link_cache_t,
+                    "gsiccmanage_linkcache", icc_linkcache_enum_ptrs,
+                    icc_linkcache_reloc_ptrs, icc_linkcache_finalize);
 
 /* These are used to construct a hash for the ICC link based upon the
    render parameters */
@@ -88,6 +186,81 @@ gs_private_st_ptrs3_final(st_icc_linkcache, gsicc_link_cache_t, "gsiccmanage_lin
 #define REND_SHIFT 8
 #define PRESERVE_SHIFT 16
 
+/* Free the locks of a cache, any of which may not have been allocated */
+static void
+gsicc_cache_free_locks(gsicc_link_cache_t *link_cache)
+{
+    int k;
+
+    for (k = 0; k < ICC_CACHE_SHARDS; k++) {
+        if (link_cache->shards[k].lock != NULL)
+            gx_monitor_free(link_cache->shards[k].lock);
+        link_cache->shards[k].lock = NULL;
+    }
+    if (link_cache->lock != NULL)
+        gx_monitor_free(link_cache->lock);
+    link_cache->lock = NULL;
+}
+
+/* Add the statistics of a new cache to the list in the library context */
+static void
+gsicc_cache_add_stats(gsicc_link_cache_t *link_cache, gs_memory_t *memory)
+{
+    gs_lib_ctx_t *ctx = gs_lib_ctx_get_interp_instance(memory);
+    gs_memory_t *stats_mem = memory->non_gc_memory;
+    gsicc_link_cache_stats_t *stats;
+
+    /* Without statistics the cache works just the same */
+    if (ctx == NULL || ctx->core == NULL || ctx->core->monitor == NULL)
+        return;
+    stats = (gsicc_link_cache_stats_t *)gs_alloc_bytes(stats_mem,
+                                        sizeof(gsicc_link_cache_stats_t),
+                                        "gsicc_cache_add_stats");
+    if (stats == NULL)
+        return;
+    memset(stats->shards, 0, sizeof(stats->shards));
+    stats->memory = stats_mem;
+    stats->prev = NULL;
+    gx_monitor_enter((gx_monitor_t *)ctx->core->monitor);
+    stats->next = ctx->icc_link_cache_stats;
+    if (stats->next != NULL)
+        stats->next->prev = stats;
+    ctx->icc_link_cache_stats = stats;
+    gx_monitor_leave((gx_monitor_t *)ctx->core->monitor);
+    link_cache->stats = stats;
+}
+
+/* Take the statistics of a cache being freed off the list, adding them to
+   the totals of the freed caches */
+static void
+gsicc_cache_remove_stats(gsicc_link_cache_t *link_cache)
+{
+    gsicc_link_cache_stats_t *stats = link_cache->stats;
+    gs_lib_ctx_t *ctx;
+    int k;
+
+    if (stats == NULL)
+        return;
+    ctx = gs_lib_ctx_get_interp_instance(stats->memory);
+    gx_monitor_enter((gx_monitor_t *)ctx->core->monitor);
+    if (stats->prev != NULL)
+        stats->prev->next = stats->next;
+    else
+        ctx->icc_link_cache_stats = stats->next;
+    if (stats->next != NULL)
+        stats->next->prev = stats->prev;
+    for (k = 0; k < ICC_CACHE_SHARDS; k++) {
+        ctx->icc_link_cache_hits += stats->shards[k].hits;
+        ctx->icc_link_cache_misses += stats->shards[k].misses;
+        ctx->icc_link_cache_evictions += stats->shards[k].evictions;
+        ctx->icc_color_cache_hits += stats->shards[k].color_hits;
+        ctx->icc_color_cache_misses += stats->shards[k].color_misses;
+    }
+    gx_monitor_leave((gx_monitor_t *)ctx->core->monitor);
+    gs_free_object(stats->memory, stats, "gsicc_cache_remove_stats");
+    link_cache->stats = NULL;
+}
+
 /**
  * gsicc_cache_new: Allocate a new ICC cache manager
  * Return value: Pointer to allocated manager, or NULL on failure.
@@ -97,6 +270,7 @@ gsicc_link_cache_t *
 gsicc_cache_new(gs_memory_t *memory)
 {
     gsicc_link_cache_t *result;
+    int k;
 
     /* We want this to be maintained in stable_memory.  It should be be effected by the
        save and restores */
@@ -104,23 +278,28 @@ gsicc_cache_new(gs_memory_t *memory)
                              "gsicc_cache_new");
     if ( result == NULL )
         return(NULL);
-    result->head = NULL;
-    result->num_links = 0;
-    result->cache_full = false;
+    for (k = 0; k < ICC_CACHE_SHARDS; k++) {
+        result->shards[k].head = NULL;
+        result->shards[k].num_links = 0;
+        result->shards[k].size = 0;
+        result->shards[k].lock = NULL;
+    }
     result->memory = memory->stable_memory;
+    result->stats = NULL;
     result->lock = gx_monitor_label(gx_monitor_alloc(memory->stable_memory),
                                     "gsicc_cache_new");
-    if (result->lock == NULL) {
-        gs_free_object(memory->stable_memory, result, "gsicc_cache_new");
-        return(NULL);
+    for (k = 0; k < ICC_CACHE_SHARDS && result->lock != NULL; k++) {
+        result->shards[k].lock = gx_monitor_label(gx_monitor_alloc(memory->stable_memory),
+                                                  "gsicc_cache_new");
+        if (result->shards[k].lock == NULL)
+            break;
     }
-    result->full_wait = gx_semaphore_label(gx_semaphore_alloc(memory->stable_memory),
-                                    "gsicc_cache_new");
-    if (result->full_wait == NULL) {
-        gx_monitor_free(result->lock);
+    if (k < ICC_CACHE_SHARDS) {
+        gsicc_cache_free_locks(result);
         gs_free_object(memory->stable_memory, result, "gsicc_cache_new");
         return(NULL);
     }
+    gsicc_cache_add_stats(result, memory);
     rc_init_free(result, memory->stable_memory, 1, rc_gsicc_link_cache_free);
     if_debug2m(gs_debug_flag_icc, memory,
                "[icc] Allocating link cache = "PRI_INTPTR" memory = "PRI_INTPTR"\n",
@@ -141,31 +320,33 @@ rc_gsicc_link_cache_free(gs_memory_t * mem, void *ptr_in, client_name_t cname)
     gs_free_object(mem->stable_memory, link_cache, "rc_gsicc_link_cache_free");
 }
 
-/* release the monitor of the link_cache when it is freed */
-void
+/* release the monitors of the link_cache when it is freed */
+static void
 icc_linkcache_finalize(const gs_memory_t *mem, void *ptr)
 {
     gsicc_link_cache_t *link_cache = (gsicc_link_cache_t * ) ptr;
+    int k;
+
+    for (k = 0; k < ICC_CACHE_SHARDS; k++) {
+        gsicc_link_cache_shard_t *shard = &link_cache->shards[k];
 
-    while (link_cache->head != NULL) {
-        if (link_cache->head->ref_count != 0) {
-            emprintf2(mem, "link at "PRI_INTPTR" being removed, but has ref_count = %d\n",
-                      (intptr_t)link_cache->head, link_cache->head->ref_count);
-            link_cache->head->ref_count = 0;	/* force removal */
+        while (shard->head != NULL) {
+            if (shard->head->ref_count != 0) {
+                emprintf2(mem, "link at "PRI_INTPTR" being removed, but has ref_count = %d\n",
+                          (intptr_t)shard->head, shard->head->ref_count);
+                shard->head->ref_count = 0;	/* force removal */
+            }
+            gsicc_remove_link(shard->head, mem);
         }
-        gsicc_remove_link(link_cache->head, mem);
-    }
 #ifdef DEBUG
-    if (link_cache->num_links != 0) {
-        emprintf1(mem, "num_links is %d, should be 0.\n", link_cache->num_links);
-    }
+        if (shard->num_links != 0) {
+            emprintf1(mem, "num_links is %d, should be 0.\n", shard->num_links);
+        }
 #endif
-    if (link_cache->rc.ref_count == 0) {
-        gx_monitor_free(link_cache->lock);
-        link_cache->lock = NULL;
-        gx_semaphore_free(link_cache->full_wait);
-        link_cache->full_wait = 0;
     }
+    gsicc_cache_remove_stats(link_cache);
+    if (link_cache->rc.ref_count == 0)
+        gsicc_cache_free_locks(link_cache);
 }
 
 /* This is a special allocation for a link that is used by devices for
@@ -213,6 +394,7 @@ gsicc_alloc_link_dev(gs_memory_t *memory, cmm_profile_t *src_profile,
     result->is_identity = false;
     result->valid = true;
     result->memory = memory->stable_memory;
+    result->size = 0;
 
     if_debug1m('^', result->memory, "[^]icclink "PRI_INTPTR" init = 1\n",
                (intptr_t)result);
@@ -283,7 +465,7 @@ gsicc_alloc_link(gs_memory_t *memory, gsicc_hashlink_t hashcode)
     result->next = NULL;
     result->link_handle = NULL;
     result->procs.map_buffer = gscms_transform_color_buffer;
-    result->procs.map_color = gscms_transform_color;
+    result->procs.map_color = gsicc_transform_color_memo;
     result->procs.free_link = gscms_release_link;
     result->hashcode.link_hashcode = hashcode.link_hashcode;
     result->hashcode.des_hash = 0;
@@ -295,6 +477,8 @@ gsicc_alloc_link(gs_memory_t *memory, gsicc_hashlink_t hashcode)
     result->is_identity = false;
     result->valid = false;		/* not yet complete */
     result->memory = memory->stable_memory;
+    result->size = ICC_LINK_OVERHEAD;
+    memset(&result->color_memo, 0, sizeof(result->color_memo));
 
     result->lock = gx_monitor_label(gx_monitor_alloc(memory->stable_memory),
                                     "gsicc_link_new");
@@ -309,13 +493,130 @@ gsicc_alloc_link(gs_memory_t *memory, gsicc_hashlink_t hashcode)
     return result;
 }
 
+/* The shard of the cache that holds the links with this hash */
+static gsicc_link_cache_shard_t *
+gsicc_cache_shard(gsicc_link_cache_t *icc_link_cache, int64_t hashcode)
+{
+    uint64_t h = (uint64_t)hashcode;
+
+    h ^= h >> 32;
+    h ^= h >> 16;
+    return &icc_link_cache->shards[h % ICC_CACHE_SHARDS];
+}
+
+/* Estimate the memory used by a link in the CMS. We assume a 16 bit table
+   with the default grid of lcms for the number of inputs: 33 points for up
+   to 3 inputs, 17 for 4 and 7 for more. */
+static size_t
+gsicc_link_size(const gsicc_link_t *icc_link, size_t max_size)
+{
+    int grid = icc_link->num_input > 4 ? 7 : icc_link->num_input == 4 ? 17 : 33;
+    size_t size = (size_t)icc_link->num_output * 2;
+    int k;
+
+    for (k = 0; k < icc_link->num_input; k++) {
+        /* Anything bigger than the whole cache is as good as infinite */
+        if (size > max_size / grid)
+            return max_size + ICC_LINK_OVERHEAD;
+        size *= grid;
+    }
+    return size + ICC_LINK_OVERHEAD;
+}
+
+/* Add the single color hits and misses of a link to the counts of its
+   shard. The lock of the shard must be held. */
+static void
+gsicc_cache_add_color_counts(gsicc_link_cache_t *icc_link_cache,
+                             gsicc_link_cache_shard_t *shard, int hits, int misses)
+{
+    gsicc_link_cache_counts_t *counts;
+
+    if (icc_link_cache == NULL || icc_link_cache->stats == NULL)
+        return;
+    counts = &icc_link_cache->stats->shards[shard - icc_link_cache->shards];
+    counts->color_hits += hits;
+    counts->color_misses += misses;
+}
+
+/* The counts of a link are added to the cache once there are this many */
+#define ICC_COLOR_MEMO_FLUSH 1024
+
+/* Convert a single color with a link, remembering the result so that the
+   CMS isn't needed when the same color is converted again, as it is for
+   each fill of a vector heavy page. The result is exactly what the CMS
+   gives. Only 16 bit colors, which nearly all callers use, are remembered. */
+static int
+gsicc_transform_color_memo(gx_device *dev, gsicc_link_t *icclink,
+                           void *inputcolor, void *outputcolor, int num_bytes)
+{
+    gsicc_color_memo_t *memo = &icclink->color_memo;
+    gsicc_color_memo_entry_t *entry;
+    unsigned short input[ICC_MAX_CHANNELS];
+    int num_in = icclink->num_input;
+    int num_out = icclink->num_output;
+    uint hash = 0;
+    int hits = 0, misses = 0;
+    bool found;
+    int k, code;
+
+    if (num_bytes != 2 || num_in <= 0 || num_in > ICC_MAX_CHANNELS ||
+        num_out <= 0 || num_out > ICC_MAX_CHANNELS)
+        return gscms_transform_color(dev, icclink, inputcolor, outputcolor,
+                                     num_bytes);
+    /* Take a copy, the output may overwrite the input */
+    memcpy(input, inputcolor, num_in * sizeof(unsigned short));
+    for (k = 0; k < num_in; k++)
+        hash = (hash ^ input[k]) * 0x9e3779b1;
+    entry = &memo->entries[(hash >> 16) & (ICC_COLOR_MEMO_SIZE - 1)];
+
+    gx_monitor_enter(icclink->lock);
+    found = entry->valid &&
+            memcmp(entry->input, input, num_in * sizeof(unsigned short)) == 0;
+    if (found) {
+        memcpy(outputcolor, entry->output, num_out * sizeof(unsigned short));
+        memo->hits++;
+    } else
+        memo->misses++;
+    if (memo->hits + memo->misses >= ICC_COLOR_MEMO_FLUSH) {
+        hits = memo->hits;
+        misses = memo->misses;
+        memo->hits = memo->misses = 0;
+    }
+    gx_monitor_leave(icclink->lock);
+
+    if (hits + misses > 0 && icclink->icc_link_cache != NULL) {
+        gsicc_link_cache_shard_t *shard =
+            gsicc_cache_shard(icclink->icc_link_cache,
+                              icclink->hashcode.link_hashcode);
+
+        gx_monitor_enter(shard->lock);
+        gsicc_cache_add_color_counts(icclink->icc_link_cache, shard, hits, misses);
+        gx_monitor_leave(shard->lock);
+    }
+    if (found)
+        return 0;
+
+    code = gscms_transform_color(dev, icclink, inputcolor, outputcolor, num_bytes);
+    if (code >= 0) {
+        gx_monitor_enter(icclink->lock);
+        memcpy(entry->input, input, num_in * sizeof(unsigned short));
+        memcpy(entry->output, outputcolor, num_out * sizeof(unsigned short));
+        entry->valid = true;
+        gx_monitor_leave(icclink->lock);
+    }
+    return code;
+}
+
 static void
 gsicc_set_link_data(gsicc_link_t *icc_link, void *link_handle,
-                    gsicc_hashlink_t hashcode, gx_monitor_t *lock,
+                    gsicc_hashlink_t hashcode, gsicc_link_cache_t *icc_link_cache,
                     bool includes_softproof, bool includes_devlink,
                     bool pageneutralcolor, gsicc_colorbuffer_t data_cs)
 {
-    gx_monitor_enter(lock);		/* lock the cache while changing data */
+    gsicc_link_cache_shard_t *shard =
+        gsicc_cache_shard(icc_link_cache, hashcode.link_hashcode);
+
+    gx_monitor_enter(shard->lock);	/* lock the cache while changing data */
     icc_link->link_handle = link_handle;
     gscms_get_link_dim(link_handle, &(icc_link->num_input), &(icc_link->num_output),
         icc_link->memory);
@@ -331,6 +632,12 @@ gsicc_set_link_data(gsicc_link_t *icc_link, void *link_handle,
     } else {
         icc_link->is_identity = false;
     }
+    /* Now we know how big the link is, count it against the cache. Any
+       room needed is made when the next link is added. */
+    shard->size -= icc_link->size;
+    icc_link->size = gsicc_link_size(icc_link,
+                                     gsicc_currentlinkcachesize(icc_link_cache->memory));
+    shard->size += icc_link->size;
     /* Set up for monitoring */
     icc_link->data_cs = data_cs;
     if (pageneutralcolor)
@@ -339,7 +646,7 @@ gsicc_set_link_data(gsicc_link_t *icc_link, void *link_handle,
     /* release the lock of the link so it can now be used */
     icc_link->valid = true;
     gx_monitor_leave(icc_link->lock);
-    gx_monitor_leave(lock);	/* done with updating, let everyone run */
+    gx_monitor_leave(shard->lock);	/* done with updating, let everyone run */
 }
 
 static void
@@ -521,19 +828,18 @@ gsicc_get_cspace_hash(gsicc_manager_t *icc_manager, gx_device *dev,
     return 0;
 }
 
-gsicc_link_t*
-gsicc_findcachelink(gsicc_hashlink_t hash, gsicc_link_cache_t *icc_link_cache,
-                    bool includes_proof, bool includes_devlink)
+/* Look for a link in a shard, whose lock the caller holds. If the link is
+   found, it is moved to the front of the list and its ref_count bumped, and
+   if it is still being built we wait for that, briefly releasing the lock. */
+static gsicc_link_t *
+gsicc_findcachelink_locked(gsicc_link_cache_shard_t *shard, int64_t hashcode,
+                           bool includes_proof, bool includes_devlink)
 {
     gsicc_link_t *curr, *prev;
-    int64_t hashcode = hash.link_hashcode;
-
-    /* Look through the cache for the hashcode */
-    gx_monitor_enter(icc_link_cache->lock);
 
     /* List scanning is fast, so we scan the entire list, this includes   */
     /* links that are currently unused, but still in the cache (zero_ref) */
-    curr = icc_link_cache->head;
+    curr = shard->head;
     prev = NULL;
 
     while (curr != NULL ) {
@@ -545,15 +851,15 @@ gsicc_findcachelink(gsicc_hashlink_t hash, gsicc_link_cache_t *icc_link_cache,
             if (prev != NULL) {
                 /* if prev == NULL, curr is already the head */
                 prev->next = curr->next;
-                curr->next = icc_link_cache->head;
-                icc_link_cache->head = curr;
+                curr->next = shard->head;
+                shard->head = curr;
             }
             /* bump the ref_count since we will be using this one */
             curr->ref_count++;
             if_debug3m('^', curr->memory, "[^]%s "PRI_INTPTR" ++ => %d\n",
                        "icclink", (intptr_t)curr, curr->ref_count);
             while (curr->valid == false) {
-                gx_monitor_leave(icc_link_cache->lock); /* exit to let other threads run briefly */
+                gx_monitor_leave(shard->lock); /* exit to let other threads run briefly */
                 gx_monitor_enter(curr->lock);			/* wait until we can acquire the lock */
                 gx_monitor_leave(curr->lock);			/* it _should be valid now */
                 /* If it is still not valid, but we were able to lock, it means that the thread	*/
@@ -562,62 +868,84 @@ gsicc_findcachelink(gsicc_hashlink_t hash, gsicc_link_cache_t *icc_link_cache,
                 if (curr->valid == false) {
 		  emprintf1(curr->memory, "link "PRI_INTPTR" lock released, but still not valid.\n", (intptr_t)curr);	/* Breakpoint here */
                 }
-                gx_monitor_enter(icc_link_cache->lock);	/* re-enter to loop and check */
+                gx_monitor_enter(shard->lock);	/* re-enter to loop and check */
             }
-            gx_monitor_leave(icc_link_cache->lock);
             return(curr);	/* success */
         }
         prev = curr;
         curr = curr->next;
     }
-    gx_monitor_leave(icc_link_cache->lock);
     return NULL;
 }
 
+gsicc_link_t*
+gsicc_findcachelink(gsicc_hashlink_t hash, gsicc_link_cache_t *icc_link_cache,
+                    bool includes_proof, bool includes_devlink)
+{
+    gsicc_link_cache_shard_t *shard =
+        gsicc_cache_shard(icc_link_cache, hash.link_hashcode);
+    gsicc_link_t *link;
+
+    /* Look through the cache for the hashcode */
+    gx_monitor_enter(shard->lock);
+    link = gsicc_findcachelink_locked(shard, hash.link_hashcode,
+                                      includes_proof, includes_devlink);
+    /* A miss is counted when the link is added, in case another thread
+       adds it in the meantime. */
+    if (link != NULL && icc_link_cache->stats != NULL)
+        icc_link_cache->stats->shards[shard - icc_link_cache->shards].hits++;
+    gx_monitor_leave(shard->lock);
+    return link;
+}
+
+/* Take a link off the list of a shard, whose lock the caller holds */
+static void
+gsicc_unlink_locked(gsicc_link_cache_shard_t *shard, gsicc_link_t *link)
+{
+    gsicc_link_t *curr = shard->head, *prev = NULL;
+
+    while (curr != NULL && curr != link) {
+        prev = curr;
+        curr = curr->next;
+    }
+    if (curr == NULL)
+        return;
+    if (prev == NULL)
+        shard->head = curr->next;
+    else
+        prev->next = curr->next;
+    shard->num_links--;
+    shard->size -= link->size;
+}
+
 /* Remove link from cache.  Notify CMS and free */
 static void
 gsicc_remove_link(gsicc_link_t *link, const gs_memory_t *memory)
 {
-    gsicc_link_t *curr, *prev;
+    gsicc_link_t *curr;
     gsicc_link_cache_t *icc_link_cache = link->icc_link_cache;
+    gsicc_link_cache_shard_t *shard =
+        gsicc_cache_shard(icc_link_cache, link->hashcode.link_hashcode);
 
     if_debug2m(gs_debug_flag_icc, memory,
                "[icc] Removing link = "PRI_INTPTR" memory = "PRI_INTPTR"\n",
                (intptr_t)link, (intptr_t)memory->stable_memory);
     /* NOTE: link->ref_count must be 0: assert ? */
-    gx_monitor_enter(icc_link_cache->lock);
+    gx_monitor_enter(shard->lock);
     if (link->ref_count != 0) {
       emprintf2(memory, "link at "PRI_INTPTR" being removed, but has ref_count = %d\n", (intptr_t)link, link->ref_count);
     }
-    curr = icc_link_cache->head;
-    prev = NULL;
-
-    while (curr != NULL ) {
-        /* don't get rid of it if another thread has decided to use it */
-        if (curr == link && link->ref_count == 0) {
-            /* remove this one from the list */
-            if (prev == NULL)
-                icc_link_cache->head = curr->next;
-            else
-                prev->next = curr->next;
-            break;
-        }
-        prev = curr;
-        curr = curr->next;
-    }
+    for (curr = shard->head; curr != NULL && curr != link; curr = curr->next)
+        ;
     /* if curr != link we didn't find it or another thread may have decided to */
     /* use it (ref_count > 0). Skip freeing it if so.                          */
     if (curr == link && link->ref_count == 0) {
-        icc_link_cache->num_links--;	/* no longer in the cache */
-        if (icc_link_cache->cache_full) {
-            icc_link_cache->cache_full = false;
-            gx_semaphore_signal(icc_link_cache->full_wait);	/* let a waiting thread run */
-        }
-        gx_monitor_leave(icc_link_cache->lock);
+        gsicc_unlink_locked(shard, link);	/* no longer in the cache */
+        gx_monitor_leave(shard->lock);
         gsicc_link_free(link, memory);	/* outside link cache now. */
     } else {
         /* even if we didn't find the link to remove, unlock the cache */
-        gx_monitor_leave(icc_link_cache->lock);
+        gx_monitor_leave(shard->lock);
     }
 }
 
@@ -869,57 +1197,45 @@ gsicc_alloc_link_entry(gsicc_link_cache_t *icc_link_cache,
                        bool include_softproof, bool include_devlink)
 {
     gs_memory_t *cache_mem = icc_link_cache->memory;
-    gsicc_link_t *link;
-    int retries = 0;
-
-    *ret_link = NULL;
-    /* First see if we can add a link */
-    /* TODO: this should be based on memory usage, not just num_links */
-    gx_monitor_enter(icc_link_cache->lock);
-    while (icc_link_cache->num_links >= ICC_CACHE_MAXLINKS) {
-        /* Look through the cache for first zero ref count to re-use that entry.
-           When ref counts go to zero, the icc_link will have been moved to
-           the end of the list, so the first we find is the 'oldest'.
-           If we get to the last entry we release the lock, set the cache_full
-           flag and wait on full_wait for some other thread to let this thread
-           run again after releasing a cache slot. Release the cache lock to
-           let other threads run and finish with (release) a cache entry.
-        */
-        link = icc_link_cache->head;
-        while (link != NULL ) {
-            if (link->ref_count == 0) {
-                /* we will use this one */
-                if_debug3m('^', cache_mem, "[^]%s "PRI_INTPTR" ++ => %d\n",
-                           "icclink", (intptr_t)link, link->ref_count);
-                break;
-            }
-            link = link->next;
-        }
-        if (link == NULL) {
-            icc_link_cache->cache_full = true;
-            /* unlock while waiting for a link to come available */
-            gx_monitor_leave(icc_link_cache->lock);
-            gx_semaphore_wait(icc_link_cache->full_wait);
-            /* repeat the findcachelink to see if some other thread has	*/
-            /* already started building the link we need		*/
-            *ret_link = gsicc_findcachelink(hash, icc_link_cache,
-                                            include_softproof, include_devlink);
-            /* Got a hit, return link. ref_count for the link was already bumped */
-            if (*ret_link != NULL)
-                return true;
-
-            gx_monitor_enter(icc_link_cache->lock);	    /* restore the lock */
-            /* we will re-test the num_links above while locked to insure */
-            /* that some other thread didn't grab the slot and max us out */
-            if (retries++ > 10)
-                return false;
-        } else {
-            /* Remove the zero ref_count link profile we found.		*/
-            /* Even if we remove this link, we may still be maxed out so*/
-            /* the outermost 'while' will check to make sure some other	*/
-            /* thread did not grab the one we remove.			*/
-            gsicc_remove_link(link, cache_mem);
+    gsicc_link_cache_shard_t *shard =
+        gsicc_cache_shard(icc_link_cache, hash.link_hashcode);
+    gsicc_link_cache_counts_t *counts = NULL;
+    gsicc_link_t *link, *victim, *evicted = NULL;
+    size_t max_shard_size = gsicc_currentlinkcachesize(cache_mem) / ICC_CACHE_SHARDS;
+
+    if (icc_link_cache->stats != NULL)
+        counts = &icc_link_cache->stats->shards[shard - icc_link_cache->shards];
+    gx_monitor_enter(shard->lock);
+    /* Some other thread may have added the link since we looked for it */
+    *ret_link = gsicc_findcachelink_locked(shard, hash.link_hashcode,
+                                           include_softproof, include_devlink);
+    if (*ret_link != NULL) {
+        if (counts != NULL)
+            counts->hits++;
+        gx_monitor_leave(shard->lock);
+        return true;
+    }
+    /* Make room for the new link by evicting links that are not in use,
+       least recently used first. When their ref counts go to zero, links
+       are moved after all those in use, in front of the other unused ones,
+       so the last unused link on the list is the oldest. If all the links
+       are in use we go over budget rather than wait for one. */
+    while (shard->size + ICC_LINK_OVERHEAD > max_shard_size) {
+        victim = NULL;
+        for (link = shard->head; link != NULL; link = link->next) {
+            if (link->ref_count == 0)
+                victim = link;
         }
+        if (victim == NULL)
+            break;
+        if_debug2m(gs_debug_flag_icc, cache_mem,
+                   "[icc] Evicting link = "PRI_INTPTR", size = %"PRIdSIZE"\n",
+                   (intptr_t)victim, victim->size);
+        gsicc_unlink_locked(shard, victim);
+        victim->next = evicted;
+        evicted = victim;
+        if (counts != NULL)
+            counts->evictions++;
     }
     /* insert an empty link that we will reserve so we can unlock while	*/
     /* building the link contents. If successful, the entry will set	*/
@@ -929,12 +1245,21 @@ gsicc_alloc_link_entry(gsicc_link_cache_t *icc_link_cache,
     /* the lock will be released when the link becomes valid.           */
     if (*ret_link) {
         (*ret_link)->icc_link_cache = icc_link_cache;
-        (*ret_link)->next = icc_link_cache->head;
-        icc_link_cache->head = *ret_link;
-        icc_link_cache->num_links++;
+        (*ret_link)->next = shard->head;
+        shard->head = *ret_link;
+        shard->num_links++;
+        shard->size += (*ret_link)->size;
+        if (counts != NULL)
+            counts->misses++;
     }
     /* unlock before returning */
-    gx_monitor_leave(icc_link_cache->lock);
+    gx_monitor_leave(shard->lock);
+    /* The evicted links are no longer reachable, so free them unlocked */
+    while (evicted != NULL) {
+        link = evicted->next;
+        gsicc_link_free(evicted, cache_mem);
+        evicted = link;
+    }
     return false;	/* we didn't find it, but return a link to be filled */
 }
 
@@ -970,6 +1295,9 @@ gsicc_get_link_profile(const gs_gstate *pgs, gx_device *dev,
     cmm_profile_t *devlink_profile = NULL;
     bool src_dev_link = gs_input_profile->isdevlink;
     bool pageneutralcolor = false;
+    bool graytok = false;
+    bool use_linkfile = gsicc_currentlinkcachedir(cache_mem) != NULL;
+    gsicc_linkfile_key_t linkfile_key;
     int cms_flags = 0;
 
     /* Determine if we are using a soft proof or device link profile */
@@ -1218,16 +1546,28 @@ gsicc_get_link_profile(const gs_gstate *pgs, gx_device *dev,
         /* Turn off bp compensation in this case as there is a bug in lcms */
         rendering_params->black_point_comp = false;
         cms_flags = 0;  /* Turn off any flag setting */
+        graytok = true;
+    }
+    /* See if an earlier run left the link in the on-disk cache */
+    if (use_linkfile) {
+        gsicc_linkfile_key(&linkfile_key, cache_mem->non_gc_memory, &hash,
+                           include_softproof ? proof_profile : NULL,
+                           include_devicelink ? devlink_profile : NULL,
+                           rendering_params, cms_flags, graytok, src_dev_link);
+        link_handle = gsicc_linkfile_read(&linkfile_key, cache_mem->non_gc_memory);
+        if (link_handle != NULL)
+            use_linkfile = false;	/* no need to write it back */
     }
     /* Get the link with the proof and or device link profile */
     if (include_softproof || include_devicelink || src_dev_link) {
-        link_handle = gscms_get_link_proof_devlink(cms_input_profile,
-                                                   cms_proof_profile,
-                                                   cms_output_profile,
-                                                   cms_devlink_profile,
-                                                   rendering_params,
-                                                   src_dev_link, cms_flags,
-                                                   cache_mem->non_gc_memory);
+        if (link_handle == NULL)
+            link_handle = gscms_get_link_proof_devlink(cms_input_profile,
+                                                       cms_proof_profile,
+                                                       cms_output_profile,
+                                                       cms_devlink_profile,
+                                                       rendering_params,
+                                                       src_dev_link, cms_flags,
+                                                       cache_mem->non_gc_memory);
     if (!gscms_is_threadsafe()) {
         if (include_softproof) {
             gx_monitor_leave(proof_profile->lock);
@@ -1236,7 +1576,7 @@ gsicc_get_link_profile(const gs_gstate *pgs, gx_device *dev,
             gx_monitor_leave(devlink_profile->lock);
         }
     }
-    } else {
+    } else if (link_handle == NULL) {
         link_handle = gscms_get_link(cms_input_profile, cms_output_profile,
                                      rendering_params, cms_flags,
                                      cache_mem->non_gc_memory);
@@ -1247,11 +1587,13 @@ gsicc_get_link_profile(const gs_gstate *pgs, gx_device *dev,
         }
         gx_monitor_leave(gs_input_profile->lock);
     }
+    if (link_handle != NULL && use_linkfile)
+        gsicc_linkfile_write(&linkfile_key, &link_handle, cache_mem->non_gc_memory);
     if (link_handle != NULL) {
         if (gs_input_profile->data_cs == gsGRAY)
             pageneutralcolor = false;
 
-        gsicc_set_link_data(link, link_handle, hash, icc_link_cache->lock,
+        gsicc_set_link_data(link, link_handle, hash, icc_link_cache,
                             include_softproof, include_devicelink, pageneutralcolor,
                             gs_input_profile->data_cs);
         if_debug2m(gs_debug_flag_icc, cache_mem,
@@ -1273,10 +1615,6 @@ gsicc_get_link_profile(const gs_gstate *pgs, gx_device *dev,
         if_debug2m('^', link->memory, "[^]icclink "PRI_INTPTR" -- => %d\n",
                    (intptr_t)link, link->ref_count);
 
-        if (icc_link_cache->cache_full) {
-            icc_link_cache->cache_full = false;
-            gx_semaphore_signal(icc_link_cache->full_wait);	/* let a waiting thread run */
-        }
         gx_monitor_leave(link->lock);
         gsicc_remove_link(link, cache_mem);
         return NULL;
@@ -1763,18 +2101,18 @@ gsicc_transform_named_color(const float tint_values[],
 }
 
 /* Used by gs to notify the ICC manager that we are done with this link for now */
-/* This may release elements waiting on an icc_link_cache slot */
 void
 gsicc_release_link(gsicc_link_t *icclink)
 {
-    gsicc_link_cache_t *icc_link_cache;
+    gsicc_link_cache_shard_t *shard;
 
     if (icclink == NULL)
         return;
 
-    icc_link_cache = icclink->icc_link_cache;
+    shard = gsicc_cache_shard(icclink->icc_link_cache,
+                              icclink->hashcode.link_hashcode);
 
-    gx_monitor_enter(icc_link_cache->lock);
+    gx_monitor_enter(shard->lock);
     if_debug2m('^', icclink->memory, "[^]icclink "PRI_INTPTR" -- => %d\n",
                (intptr_t)icclink, icclink->ref_count - 1);
     /* Decrement the reference count */
@@ -1782,9 +2120,16 @@ gsicc_release_link(gsicc_link_t *icclink)
 
         gsicc_link_t *curr, *prev;
 
+        /* No one else has the link, so its color counts can be taken
+           without its lock */
+        gsicc_cache_add_color_counts(icclink->icc_link_cache, shard,
+                                     icclink->color_memo.hits,
+                                     icclink->color_memo.misses);
+        icclink->color_memo.hits = icclink->color_memo.misses = 0;
+
         /* Find link in cache, and move it to the end of the list.  */
         /* This way zero ref_count links are found LRU first	*/
-        curr = icc_link_cache->head;
+        curr = shard->head;
         prev = NULL;
         while (curr != icclink) {
             prev = curr;
@@ -1792,12 +2137,12 @@ gsicc_release_link(gsicc_link_t *icclink)
         };
         if (prev == NULL) {
             /* this link was the head */
-            icc_link_cache->head = curr->next;
+            shard->head = curr->next;
         } else {
             prev->next = curr->next;		/* de-link this one */
         }
         /* Find the first zero-ref entry on the list */
-        curr = icc_link_cache->head;
+        curr = shard->head;
         prev = NULL;
         while (curr != NULL && curr->ref_count > 0) {
             prev = curr;
@@ -1805,20 +2150,304 @@ gsicc_release_link(gsicc_link_t *icclink)
         }
         /* Found where to link this one into the tail of the list */
         if (prev == NULL) {
-            icc_link_cache->head = icclink;
-            icclink->next = icc_link_cache->head->next;
+            shard->head = icclink;
+            icclink->next = curr;
         } else {
             /* link this one in here */
             prev->next = icclink;
             icclink->next = curr;
         }
-        /* Finally, if some thread was waiting because the cache was full, let it run */
-        if (icc_link_cache->cache_full) {
-            icc_link_cache->cache_full = false;
-            gx_semaphore_signal(icc_link_cache->full_wait);	/* let a waiting thread run */
+    }
+    gx_monitor_leave(shard->lock);
+}
+
+/* Get the name of the file for a link in the on-disk cache */
+static bool
+gsicc_linkfile_name(const gs_memory_t *memory, const gsicc_linkfile_key_t *key,
+                    char fname[gp_file_name_sizeof])
+{
+    gs_lib_ctx_t *ctx = gs_lib_ctx_get_interp_instance(memory);
+    const char *sep = gp_file_name_directory_separator();
+    const char *dir;
+    size_t dir_len, sep_len = strlen(sep);
+    int64_t hash;
+
+    if (ctx == NULL || ctx->icc_link_cache_dir == NULL)
+        return false;
+    dir = ctx->icc_link_cache_dir;
+    dir_len = strlen(dir);
+    if (dir_len >= sep_len && strcmp(dir + dir_len - sep_len, sep) == 0)
+        sep = "";
+    /* Room for the separator, 16 hex digits and the extension */
+    if (dir_len + sep_len + 16 + 4 >= gp_file_name_sizeof)
+        return false;
+    gsicc_get_buff_hash((unsigned char *)key, &hash, sizeof(*key));
+    gs_snprintf(fname, gp_file_name_sizeof, "%s%s%08x%08x.icl", dir, sep,
+                (unsigned int)((uint64_t)hash >> 32), (unsigned int)hash);
+    return true;
+}
+
+/* Make the key for a link in the on-disk cache */
+static void
+gsicc_linkfile_key(gsicc_linkfile_key_t *key, gs_memory_t *memory,
+                   const gsicc_hashlink_t *hash, cmm_profile_t *proof_profile,
+                   cmm_profile_t *devlink_profile,
+                   const gsicc_rendering_param_t *rendering_params,
+                   int cms_flags, bool graytok, bool src_dev_link)
+{
+    /* Clear it all, as the whole structure is hashed and compared */
+    memset(key, 0, sizeof(*key));
+    key->revision = gs_revision;
+    key->revisiondate = gs_revisiondate;
+    key->link_hash = hash->link_hashcode;
+    if (proof_profile != NULL)
+        key->proof_hash = gsicc_get_hash(proof_profile);
+    if (devlink_profile != NULL)
+        key->devlink_hash = gsicc_get_hash(devlink_profile);
+    key->rendering_intent = rendering_params->rendering_intent;
+    key->black_point_comp = rendering_params->black_point_comp;
+    key->preserve_black = rendering_params->preserve_black;
+    key->cms_flags = cms_flags;
+    key->color_accuracy = gsicc_currentcoloraccuracy(memory);
+    key->graytok = graytok;
+    key->src_dev_link = src_dev_link;
+}
+
+/* Get a link from the on-disk cache, or NULL if it isn't there. The file
+   is mapped into memory if we can, or else read. */
+static gcmmhlink_t
+gsicc_linkfile_read(const gsicc_linkfile_key_t *key, gs_memory_t *memory)
+{
+    char fname[gp_file_name_sizeof];
+    gsicc_linkfile_header_t header;
+    gp_file *f;
+    gs_offset_t length = -1;
+    byte *mapped = NULL, *buffer = NULL;
+    gs_md5_state_t md5;
+    byte digest[16];
+    gcmmhlink_t link_handle = NULL;
+
+    if (!gsicc_linkfile_name(memory, key, fname))
+        return NULL;
+    f = gp_fopen(memory, fname, "rb");
+    if (f == NULL)
+        return NULL;
+    if (gp_fseek(f, 0, SEEK_END) == 0)
+        length = gp_ftell(f);
+    if (length < (gs_offset_t)sizeof(header) ||
+        length - sizeof(header) > max_uint)
+        goto out;
+    mapped = gp_fmap(f, length);
+    if (mapped != NULL) {
+        buffer = mapped;
+    } else {
+        buffer = gs_alloc_bytes(memory, (size_t)length, "gsicc_linkfile_read");
+        if (buffer == NULL || gp_fseek(f, 0, SEEK_SET) != 0 ||
+            gp_fread(buffer, 1, (size_t)length, f) != (size_t)length)
+            goto out;
+    }
+    memcpy(&header, buffer, sizeof(header));
+    if (memcmp(header.magic, ICC_LINKFILE_MAGIC, sizeof(header.magic)) != 0 ||
+        memcmp(&header.key, key, sizeof(*key)) != 0 ||
+        header.size != length - sizeof(header))
+        goto out;
+    gs_md5_init(&md5);
+    gs_md5_append(&md5, buffer + sizeof(header), header.size);
+    gs_md5_finish(&md5, digest);
+    if (memcmp(header.digest, digest, sizeof(digest)) != 0)
+        goto out;
+    link_handle = gscms_get_link_from_data(buffer + sizeof(header),
+                                           header.size, memory);
+    if_debug2m(gs_debug_flag_icc, memory, "[icc] Read link %s %s\n",
+               fname, link_handle != NULL ? "ok" : "failed");
+out:
+    if (mapped != NULL)
+        gp_funmap(mapped, length);
+    else
+        gs_free_object(memory, buffer, "gsicc_linkfile_read");
+    gp_fclose(f);
+    return link_handle;
+}
+
+/* Save a link in the on-disk cache. Failing to save it isn't an error, the
+   link will just be built again next time. The link is then replaced by
+   the one read back from the data, as later runs will read it, so that
+   every run gives the same colors whether or not it created the file. */
+static void
+gsicc_linkfile_write(const gsicc_linkfile_key_t *key, gcmmhlink_t *link_handle,
+                     gs_memory_t *memory)
+{
+    char fname[gp_file_name_sizeof];
+    char tmpname[gp_file_name_sizeof];
+    gsicc_linkfile_header_t header;
+    gs_md5_state_t md5;
+    byte *data;
+    uint size;
+    gp_file *f;
+    bool ok;
+    gcmmhlink_t reloaded;
+
+    if (!gsicc_linkfile_name(memory, key, fname))
+        return;
+    if (gscms_get_link_data(*link_handle, &data, &size, memory) < 0)
+        return;
+    reloaded = gscms_get_link_from_data(data, size, memory);
+    if (reloaded == NULL) {
+        /* A file we couldn't read back is no use to anyone */
+        gs_free_object(memory, data, "gsicc_linkfile_write");
+        return;
+    }
+    {
+        gsicc_link_t built;
+
+        /* Only the handle and memory of a link are used to release it */
+        memset(&built, 0, sizeof(built));
+        built.memory = memory;
+        built.link_handle = *link_handle;
+        gscms_release_link(&built);
+        *link_handle = reloaded;
+    }
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, ICC_LINKFILE_MAGIC, sizeof(header.magic));
+    header.key = *key;
+    header.size = size;
+    gs_md5_init(&md5);
+    gs_md5_append(&md5, data, size);
+    gs_md5_finish(&md5, header.digest);
+    /* The scratch file is made next to the final one, so that it can be
+       renamed; if another process got there first the rename may fail,
+       which is fine, as it wrote the same link. */
+    f = gp_open_scratch_file(memory, fname, tmpname, "wb");
+    if (f != NULL) {
+        ok = gp_fwrite(&header, 1, sizeof(header), f) == sizeof(header) &&
+             gp_fwrite(data, 1, size, f) == size;
+        if (gp_fclose(f) != 0)
+            ok = false;
+        if (!ok || gp_rename(memory, tmpname, fname) != 0)
+            gp_unlink(memory, tmpname);
+        if_debug2m(gs_debug_flag_icc, memory, "[icc] Wrote link %s %s\n",
+                   fname, ok ? "ok" : "failed");
+    }
+    gs_free_object(memory, data, "gsicc_linkfile_write");
+}
+
+/* Check that the files in a link cache directory may already be read,
+   written, and renamed into place. Setting the directory doesn't grant
+   any access, so with -dSAFER it has to be permitted on the command line
+   (--permit-file-all) or by the application. */
+int
+gsicc_checklinkcachedir(const gs_memory_t *mem, const char *dir, uint len)
+{
+    char path[gp_file_name_sizeof];
+    const char *sep = gp_file_name_directory_separator();
+    size_t sep_len = strlen(sep);
+
+    if (len == 0)
+        return 0;
+    /* Room for the separator and a file name such as gsicc_linkfile_name makes */
+    if (len + sep_len + 16 + 4 >= gp_file_name_sizeof)
+        return_error(gs_error_rangecheck);
+    if (len >= sep_len && memcmp(dir + len - sep_len, sep, sep_len) == 0)
+        sep = "";
+    gs_snprintf(path, sizeof(path), "%.*s%s0000000000000000.icl", (int)len, dir, sep);
+    if (gp_validate_path(mem, path, "r") != 0 ||
+        gp_validate_path(mem, path, "w") != 0 ||
+        gp_validate_path(mem, path, "t") != 0)
+        return_error(gs_error_invalidfileaccess);
+    return 0;
+}
+
+/* Set the directory of the on-disk link cache. An empty name turns it off. */
+int
+gsicc_setlinkcachedir(gs_memory_t *mem, const char *dir, uint len)
+{
+    gs_lib_ctx_t *ctx = gs_lib_ctx_get_interp_instance(mem);
+    char *result;
+    int code;
+
+    if (ctx->icc_link_cache_dir != NULL &&
+        bytes_compare((const byte *)dir, len,
+                      (const byte *)ctx->icc_link_cache_dir,
+                      strlen(ctx->icc_link_cache_dir)) == 0)
+        return 0;
+    if (len == 0) {
+        gs_free_object(ctx->memory, ctx->icc_link_cache_dir,
+                       "gsicc_setlinkcachedir");
+        ctx->icc_link_cache_dir = NULL;
+        return 0;
+    }
+    code = gsicc_checklinkcachedir(mem, dir, len);
+    if (code < 0)
+        return code;
+    result = (char *)gs_alloc_bytes(ctx->memory, len + 1,
+                                    "gsicc_setlinkcachedir");
+    if (result == NULL)
+        return_error(gs_error_VMerror);
+    memcpy(result, dir, len);
+    result[len] = 0;
+    gs_free_object(ctx->memory, ctx->icc_link_cache_dir,
+                   "gsicc_setlinkcachedir");
+    ctx->icc_link_cache_dir = result;
+    return 0;
+}
+
+const char *
+gsicc_currentlinkcachedir(gs_memory_t *mem)
+{
+    gs_lib_ctx_t *ctx = gs_lib_ctx_get_interp_instance(mem);
+
+    return ctx != NULL ? ctx->icc_link_cache_dir : NULL;
+}
+
+/* The budget for the link caches, shared equally between their shards */
+void
+gsicc_setlinkcachesize(gs_memory_t *mem, size_t size)
+{
+    gs_lib_ctx_t *ctx = gs_lib_ctx_get_interp_instance(mem);
+
+    ctx->icc_link_cache_size = size;
+}
+
+size_t
+gsicc_currentlinkcachesize(gs_memory_t *mem)
+{
+    gs_lib_ctx_t *ctx = gs_lib_ctx_get_interp_instance(mem);
+
+    return ctx != NULL ? ctx->icc_link_cache_size : ICC_CACHE_DEFAULT_SIZE;
+}
+
+/* Total the hits, misses and evictions of all the link caches so far, and
+   the hits and misses of the single color conversions of their links. The
+   counts of the caches in use are read without their locks, so may be a
+   little behind. */
+void
+gsicc_link_cache_stats(gs_memory_t *mem, int64_t *hits, int64_t *misses,
+                       int64_t *evictions, int64_t *color_hits,
+                       int64_t *color_misses)
+{
+    gs_lib_ctx_t *ctx = gs_lib_ctx_get_interp_instance(mem);
+    gsicc_link_cache_stats_t *stats;
+    int k;
+
+    *hits = *misses = *evictions = *color_hits = *color_misses = 0;
+    if (ctx == NULL || ctx->core == NULL || ctx->core->monitor == NULL)
+        return;
+    gx_monitor_enter((gx_monitor_t *)ctx->core->monitor);
+    *hits = ctx->icc_link_cache_hits;
+    *misses = ctx->icc_link_cache_misses;
+    *evictions = ctx->icc_link_cache_evictions;
+    *color_hits = ctx->icc_color_cache_hits;
+    *color_misses = ctx->icc_color_cache_misses;
+    for (stats = ctx->icc_link_cache_stats; stats != NULL; stats = stats->next) {
+        for (k = 0; k < ICC_CACHE_SHARDS; k++) {
+            *hits += stats->shards[k].hits;
+            *misses += stats->shards[k].misses;
+            *evictions += stats->shards[k].evictions;
+            *color_hits += stats->shards[k].color_hits;
+            *color_misses += stats->shards[k].color_misses;
         }
     }
-    gx_monitor_leave(icc_link_cache->lock);
+    gx_monitor_leave((gx_monitor_t *)ctx->core->monitor);
 }
 
 /* Used to initialize the buffer description prior to color conversion */
@@ -67,4 +67,12 @@ int  gsicc_get_device_profile_comps(const cmm_dev_profile_t *dev_profile);
 gsicc_link_t * gsicc_alloc_link_dev(gs_memory_t *memory, cmm_profile_t *src_profile,
     cmm_profile_t *des_profile, gsicc_rendering_param_t *rendering_params);
 void gsicc_free_link_dev(gs_memory_t *memory, gsicc_link_t *link);
+int gsicc_setlinkcachedir(gs_memory_t *mem, const char *dir, uint len);
+int gsicc_checklinkcachedir(const gs_memory_t *mem, const char *dir, uint len);
+const char *gsicc_currentlinkcachedir(gs_memory_t *mem);
+void gsicc_setlinkcachesize(gs_memory_t *mem, size_t size);
+size_t gsicc_currentlinkcachesize(gs_memory_t *mem);
+void gsicc_link_cache_stats(gs_memory_t *mem, int64_t *hits, int64_t *misses,
+                            int64_t *evictions, int64_t *color_hits,
+                            int64_t *color_misses);
 #endif
@@ -730,6 +730,75 @@ gscms_get_link_proof_devlink(gcmmhprofile_t lcms_srchandle,
     }
 }
 
+/* Write a link out as a device link profile, so that a later run can get
+   the link back with gscms_get_link_from_data instead of building it from
+   the profiles again. The data is allocated in memory and the caller
+   frees it. */
+int
+gscms_get_link_data(gcmmhlink_t link, byte **data, uint *size,
+                    gs_memory_t *memory)
+{
+    cmsHPROFILE devlink;
+    cmsUInt32Number num_bytes = 0;
+    byte *buffer = NULL;
+
+    *data = NULL;
+    *size = 0;
+    devlink = cmsTransform2DeviceLink(link, 4.3, cmsFLAGS_HIGHRESPRECALC);
+    if (devlink == NULL)
+        return_error(gs_error_unknownerror);
+    if (cmsSaveProfileToMem(devlink, NULL, &num_bytes) && num_bytes > 0) {
+        buffer = gs_alloc_bytes(memory, num_bytes, "gscms_get_link_data");
+        if (buffer != NULL && !cmsSaveProfileToMem(devlink, buffer, &num_bytes)) {
+            gs_free_object(memory, buffer, "gscms_get_link_data");
+            buffer = NULL;
+        }
+    }
+    cmsCloseProfile(devlink);
+    if (buffer == NULL)
+        return_error(gs_error_unknownerror);
+    *data = buffer;
+    *size = num_bytes;
+    return 0;
+}
+
+/* Get a link from device link profile data written by gscms_get_link_data */
+gcmmhlink_t
+gscms_get_link_from_data(const byte *data, uint size, gs_memory_t *memory)
+{
+    cmsUInt32Number src_data_type, des_data_type;
+    cmsColorSpaceSignature src_color_space, des_color_space;
+    int lcms_src_color_space, lcms_des_color_space;
+    cmsContext ctx = gs_lib_ctx_get_cms_context(memory);
+    cmsHPROFILE devlink;
+    cmsHTRANSFORM hTransform;
+
+    devlink = cmsOpenProfileFromMemTHR(ctx, data, size);
+    if (devlink == NULL)
+        return NULL;
+    if (cmsGetDeviceClass(devlink) != cmsSigLinkClass) {
+        cmsCloseProfile(devlink);
+        return NULL;
+    }
+    src_color_space = cmsGetColorSpace(devlink);
+    lcms_src_color_space = _cmsLCMScolorSpace(src_color_space);
+    if (lcms_src_color_space < 0) lcms_src_color_space = 0;
+    src_data_type = (COLORSPACE_SH(lcms_src_color_space)|
+                        CHANNELS_SH(cmsChannelsOf(src_color_space))|BYTES_SH(2));
+    des_color_space = cmsGetPCS(devlink);
+    lcms_des_color_space = _cmsLCMScolorSpace(des_color_space);
+    if (lcms_des_color_space < 0) lcms_des_color_space = 0;
+    des_data_type = (COLORSPACE_SH(lcms_des_color_space)|
+                        CHANNELS_SH(cmsChannelsOf(des_color_space))|BYTES_SH(2));
+    /* Any white point fix up is already in the table */
+    hTransform = cmsCreateTransformTHR(ctx, devlink, src_data_type,
+                                       NULL, des_data_type, INTENT_PERCEPTUAL,
+                                       cmsFLAGS_HIGHRESPRECALC |
+                                       cmsFLAGS_NOWHITEONWHITEFIXUP);
+    cmsCloseProfile(devlink);
+    return hTransform;
+}
+
 /* Do any initialization if needed to the CMS */
 int
 gscms_create(gs_memory_t *memory)
@@ -29,6 +29,14 @@
 #include "cal.h"
 #endif
 
+#if defined(HAVE_SSE2) && defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__)) && \
+    (defined(__clang__) || __GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))
+/* Only the functions marked for it are built for SSE4.1 or AVX2, and they */
+/* are only used if the CPU we are running on has it.                     */
+#define LCMS2MT_SIMD
+#include <immintrin.h>
+#endif
+
 #define USE_LCMS2_LOCKING
 
 #ifdef USE_LCMS2_LOCKING
@@ -876,6 +884,292 @@ gscms_get_link_proof_devlink(gcmmhprofile_t lcms_srchandle,
     return link_handle;
 }
 
+/* Write a link out as a device link profile, so that a later run can get
+   the link back with gscms_get_link_from_data instead of building it from
+   the profiles again. The link is already optimized into curves and a
+   table, which the device link keeps as they are. The data is allocated
+   in memory and the caller frees it. */
+int
+gscms_get_link_data(gcmmhlink_t link, byte **data, uint *size,
+                    gs_memory_t *memory)
+{
+    cmsContext ctx = gs_lib_ctx_get_cms_context(memory);
+    gsicc_lcms2mt_link_list_t *link_handle = (gsicc_lcms2mt_link_list_t *)(link);
+    cmsHPROFILE devlink;
+    cmsUInt32Number num_bytes = 0;
+    byte *buffer = NULL;
+
+    *data = NULL;
+    *size = 0;
+    devlink = cmsTransform2DeviceLink(ctx, link_handle->hTransform, 4.3,
+                                      gscms_get_accuracy(memory));
+    if (devlink == NULL)
+        return_error(gs_error_unknownerror);
+    if (cmsSaveProfileToMem(ctx, devlink, NULL, &num_bytes) && num_bytes > 0) {
+        buffer = gs_alloc_bytes(memory, num_bytes, "gscms_get_link_data");
+        if (buffer != NULL &&
+            !cmsSaveProfileToMem(ctx, devlink, buffer, &num_bytes)) {
+            gs_free_object(memory, buffer, "gscms_get_link_data");
+            buffer = NULL;
+        }
+    }
+    cmsCloseProfile(ctx, devlink);
+    if (buffer == NULL)
+        return_error(gs_error_unknownerror);
+    *data = buffer;
+    *size = num_bytes;
+    return 0;
+}
+
+/* Get a link from device link profile data written by gscms_get_link_data.
+   The table is sampled again at the same grid points, so the new link
+   gives the same results as the one that was written. */
+gcmmhlink_t
+gscms_get_link_from_data(const byte *data, uint size, gs_memory_t *memory)
+{
+    cmsUInt32Number src_data_type, des_data_type;
+    cmsColorSpaceSignature src_color_space, des_color_space;
+    int lcms_src_color_space, lcms_des_color_space;
+    cmsContext ctx = gs_lib_ctx_get_cms_context(memory);
+    cmsHPROFILE devlink;
+    gsicc_lcms2mt_link_list_t *link_handle;
+
+    devlink = cmsOpenProfileFromMem(ctx, data, size);
+    if (devlink == NULL)
+        return NULL;
+    if (cmsGetDeviceClass(ctx, devlink) != cmsSigLinkClass) {
+        cmsCloseProfile(ctx, devlink);
+        return NULL;
+    }
+    src_color_space = cmsGetColorSpace(ctx, devlink);
+    lcms_src_color_space = _cmsLCMScolorSpace(ctx, src_color_space);
+    if (lcms_src_color_space < 0)
+        lcms_src_color_space = 0;
+    src_data_type = (COLORSPACE_SH(lcms_src_color_space)|
+                        CHANNELS_SH(cmsChannelsOf(ctx, src_color_space))|BYTES_SH(2));
+    des_color_space = cmsGetPCS(ctx, devlink);
+    lcms_des_color_space = _cmsLCMScolorSpace(ctx, des_color_space);
+    if (lcms_des_color_space < 0)
+        lcms_des_color_space = 0;
+    des_data_type = (COLORSPACE_SH(lcms_des_color_space)|
+                        CHANNELS_SH(cmsChannelsOf(ctx, des_color_space))|BYTES_SH(2));
+
+    link_handle = (gsicc_lcms2mt_link_list_t *)gs_alloc_bytes(memory->non_gc_memory,
+                                                         sizeof(gsicc_lcms2mt_link_list_t),
+                                                         "gscms_get_link_from_data");
+    if (link_handle == NULL) {
+        cmsCloseProfile(ctx, devlink);
+        return NULL;
+    }
+    /* Any white point fix up is already in the table */
+    link_handle->hTransform = cmsCreateTransform(ctx, devlink, src_data_type,
+                                                 NULL, des_data_type,
+                                                 INTENT_PERCEPTUAL,
+                                                 gscms_get_accuracy(memory) |
+                                                 cmsFLAGS_NOWHITEONWHITEFIXUP);
+    cmsCloseProfile(ctx, devlink);
+    if (link_handle->hTransform == NULL) {
+        gs_free_object(memory->non_gc_memory, link_handle, "gscms_get_link_from_data");
+        return NULL;
+    }
+    link_handle->next = NULL;
+    link_handle->flags = gsicc_link_flags(0, 0, 0, 0, 0,    /* no alpha, not planar, no endian swap */
+                                          sizeof(gx_color_value), sizeof(gx_color_value));
+    return link_handle;
+}
+
+#ifdef LCMS2MT_SIMD
+/* Vector versions of the 16 bit interpolations lcms uses for tables with 3
+   inputs (TetrahedralInterp16) and 4 inputs (Eval4Inputs) and 3 or 4
+   outputs, which are what RGB and CMYK links come down to. The outputs of
+   a table entry go in the lanes of a register, and the two 3D lookups of
+   the 4 input case are done side by side with AVX2. The integer arithmetic
+   is the same as that in lcms2mt/src/cmsintrp.c, so the results are
+   exactly the same too. They are registered as an interpolation plugin,
+   for whichever the CPU we are running on can do. */
+#define SSE41_TARGET __attribute__((target("sse4.1")))
+#define AVX2_TARGET __attribute__((target("avx2")))
+
+/* As _cmsToFixedDomain */
+static inline int
+icc_simd_fixed_domain(int a)
+{
+    return a + ((a + 0x7fff) / 0xffff);
+}
+
+/* The outputs of a table entry, zero extended to 32 bits */
+static inline SSE41_TARGET __m128i
+icc_simd_load(const cmsUInt16Number *p, int n)
+{
+    if (n == 4)
+        return _mm_cvtepu16_epi32(_mm_loadl_epi64((const __m128i *)p));
+    return _mm_setr_epi32(p[0], p[1], p[2], 0);
+}
+
+/* Store the low 16 bits of each of the first n lanes */
+static inline SSE41_TARGET void
+icc_simd_store(cmsUInt16Number *p, __m128i v, int n)
+{
+    v = _mm_shuffle_epi8(v, _mm_setr_epi8(0, 1, 4, 5, 8, 9, 12, 13,
+                                          -1, -1, -1, -1, -1, -1, -1, -1));
+    if (n == 4) {
+        _mm_storel_epi64((__m128i *)p, v);
+    } else {
+        p[0] = (cmsUInt16Number)_mm_extract_epi16(v, 0);
+        p[1] = (cmsUInt16Number)_mm_extract_epi16(v, 1);
+        p[2] = (cmsUInt16Number)_mm_extract_epi16(v, 2);
+    }
+}
+
+/* Find the tetrahedron a point is in. The corners after the first are at
+   offsets o1, o2 and x1 + y1 + z1, and their weights are r1, r2 and r3.
+   lcms sums the same products in a different order, which makes no
+   difference in integer arithmetic, even if it overflows. */
+static inline void
+icc_simd_tetrahedron(int rx, int ry, int rz, int x1, int y1, int z1,
+                     int *o1, int *o2, int *r1, int *r2, int *r3)
+{
+    if (rx >= ry) {
+        if (ry >= rz) {
+            *o1 = x1; *o2 = x1 + y1; *r1 = rx; *r2 = ry; *r3 = rz;
+        } else if (rx >= rz) {
+            *o1 = x1; *o2 = x1 + z1; *r1 = rx; *r2 = rz; *r3 = ry;
+        } else {
+            *o1 = z1; *o2 = z1 + x1; *r1 = rz; *r2 = rx; *r3 = ry;
+        }
+    } else {
+        if (rx >= rz) {
+            *o1 = y1; *o2 = y1 + x1; *r1 = ry; *r2 = rx; *r3 = rz;
+        } else if (ry >= rz) {
+            *o1 = y1; *o2 = y1 + z1; *r1 = ry; *r2 = rz; *r3 = rx;
+        } else {
+            *o1 = z1; *o2 = z1 + y1; *r1 = rz; *r2 = ry; *r3 = rx;
+        }
+    }
+}
+
+static SSE41_TARGET void
+icc_simd_interp3_sse41(cmsContext ContextID, const cmsUInt16Number Input[],
+                       cmsUInt16Number Output[], const cmsInterpParams *p)
+{
+    const cmsUInt16Number *LutTable = (const cmsUInt16Number *)p->Table;
+    int n = p->nOutputs;
+    int fx = icc_simd_fixed_domain((int)Input[0] * p->Domain[0]);
+    int fy = icc_simd_fixed_domain((int)Input[1] * p->Domain[1]);
+    int fz = icc_simd_fixed_domain((int)Input[2] * p->Domain[2]);
+    int x1 = (Input[0] == 0xFFFFU ? 0 : p->opta[2]);
+    int y1 = (Input[1] == 0xFFFFU ? 0 : p->opta[1]);
+    int z1 = (Input[2] == 0xFFFFU ? 0 : p->opta[0]);
+    int o1, o2, r1, r2, r3;
+    __m128i v0, v1, v2, v3, rest;
+
+    LutTable += p->opta[2] * (fx >> 16) + p->opta[1] * (fy >> 16) +
+                p->opta[0] * (fz >> 16);
+    icc_simd_tetrahedron(fx & 0xFFFF, fy & 0xFFFF, fz & 0xFFFF, x1, y1, z1,
+                         &o1, &o2, &r1, &r2, &r3);
+    v0 = icc_simd_load(LutTable, n);
+    v1 = icc_simd_load(LutTable + o1, n);
+    v2 = icc_simd_load(LutTable + o2, n);
+    v3 = icc_simd_load(LutTable + x1 + y1 + z1, n);
+
+    rest = _mm_add_epi32(
+               _mm_add_epi32(_mm_mullo_epi32(_mm_sub_epi32(v1, v0), _mm_set1_epi32(r1)),
+                             _mm_mullo_epi32(_mm_sub_epi32(v2, v1), _mm_set1_epi32(r2))),
+               _mm_mullo_epi32(_mm_sub_epi32(v3, v2), _mm_set1_epi32(r3)));
+    /* c0 + ((Rest + 0x8001) + ((Rest + 0x8001) >> 16)) >> 16 */
+    rest = _mm_add_epi32(rest, _mm_set1_epi32(0x8001));
+    rest = _mm_srai_epi32(_mm_add_epi32(rest, _mm_srai_epi32(rest, 16)), 16);
+    icc_simd_store(Output, _mm_add_epi32(v0, rest), n);
+}
+
+static AVX2_TARGET void
+icc_simd_interp4_avx2(cmsContext ContextID, const cmsUInt16Number Input[],
+                      cmsUInt16Number Output[], const cmsInterpParams *p)
+{
+    const cmsUInt16Number *LutTable = (const cmsUInt16Number *)p->Table;
+    int n = p->nOutputs;
+    int fk = icc_simd_fixed_domain((int)Input[0] * p->Domain[0]);
+    int fx = icc_simd_fixed_domain((int)Input[1] * p->Domain[1]);
+    int fy = icc_simd_fixed_domain((int)Input[2] * p->Domain[2]);
+    int fz = icc_simd_fixed_domain((int)Input[3] * p->Domain[3]);
+    int k1 = (Input[0] == 0xFFFFU ? 0 : p->opta[3]);
+    int x1 = (Input[1] == 0xFFFFU ? 0 : p->opta[2]);
+    int y1 = (Input[2] == 0xFFFFU ? 0 : p->opta[1]);
+    int z1 = (Input[3] == 0xFFFFU ? 0 : p->opta[0]);
+    int o1, o2, r1, r2, r3;
+    __m256i v0, v1, v2, v3, rest, q, sign;
+    __m128i lo, hi, dif;
+
+    LutTable += p->opta[3] * (fk >> 16) + p->opta[2] * (fx >> 16) +
+                p->opta[1] * (fy >> 16) + p->opta[0] * (fz >> 16);
+    icc_simd_tetrahedron(fx & 0xFFFF, fy & 0xFFFF, fz & 0xFFFF, x1, y1, z1,
+                         &o1, &o2, &r1, &r2, &r3);
+    /* The lookup at the lower K in the low half, the upper K in the high */
+#define LOAD2(off)\
+    _mm256_inserti128_si256(_mm256_castsi128_si256(icc_simd_load(LutTable + (off), n)),\
+                            icc_simd_load(LutTable + k1 + (off), n), 1)
+    v0 = LOAD2(0);
+    v1 = LOAD2(o1);
+    v2 = LOAD2(o2);
+    v3 = LOAD2(x1 + y1 + z1);
+#undef LOAD2
+
+    rest = _mm256_add_epi32(
+               _mm256_add_epi32(_mm256_mullo_epi32(_mm256_sub_epi32(v1, v0), _mm256_set1_epi32(r1)),
+                                _mm256_mullo_epi32(_mm256_sub_epi32(v2, v1), _mm256_set1_epi32(r2))),
+               _mm256_mullo_epi32(_mm256_sub_epi32(v3, v2), _mm256_set1_epi32(r3)));
+    /* q = (Rest + 0x7fff) / 0xffff, rounding towards 0. For 0 <= m <= 2^31,
+       m / 0xffff is (m + (m >> 16) + 1) >> 16, so divide the magnitude. */
+    q = _mm256_add_epi32(rest, _mm256_set1_epi32(0x7fff));
+    sign = _mm256_srai_epi32(q, 31);
+    q = _mm256_sub_epi32(_mm256_xor_si256(q, sign), sign);
+    q = _mm256_srli_epi32(_mm256_add_epi32(_mm256_add_epi32(q, _mm256_srli_epi32(q, 16)),
+                                           _mm256_set1_epi32(1)), 16);
+    q = _mm256_sub_epi32(_mm256_xor_si256(q, sign), sign);
+    /* (cmsUInt16Number)(c0 + ROUND_FIXED_TO_INT(Rest + q)) */
+    rest = _mm256_add_epi32(_mm256_add_epi32(rest, q), _mm256_set1_epi32(0x8000));
+    rest = _mm256_add_epi32(v0, _mm256_srai_epi32(rest, 16));
+    rest = _mm256_and_si256(rest, _mm256_set1_epi32(0xFFFF));
+
+    /* LinearInterp between the two, by the fraction of K */
+    lo = _mm256_castsi256_si128(rest);
+    hi = _mm256_extracti128_si256(rest, 1);
+    dif = _mm_add_epi32(_mm_mullo_epi32(_mm_sub_epi32(hi, lo), _mm_set1_epi32(fk & 0xFFFF)),
+                        _mm_set1_epi32(0x8000));
+    dif = _mm_add_epi32(_mm_srli_epi32(dif, 16), lo);
+    icc_simd_store(Output, dif, n);
+}
+
+static cmsInterpFunction
+icc_simd_interpolators(cmsContext ContextID, cmsUInt32Number nInputChannels,
+                       cmsUInt32Number nOutputChannels, cmsUInt32Number dwFlags)
+{
+    cmsInterpFunction interpolation;
+
+    /* A NULL function leaves it to lcms */
+    interpolation.Lerp16 = NULL;
+    if ((dwFlags & (CMS_LERP_FLAGS_FLOAT | CMS_LERP_FLAGS_TRILINEAR)) != 0 ||
+        (nOutputChannels != 3 && nOutputChannels != 4))
+        return interpolation;
+    if (nInputChannels == 3 && __builtin_cpu_supports("sse4.1"))
+        interpolation.Lerp16 = icc_simd_interp3_sse41;
+    else if (nInputChannels == 4 && __builtin_cpu_supports("avx2"))
+        interpolation.Lerp16 = icc_simd_interp4_avx2;
+    return interpolation;
+}
+
+static cmsPluginInterpolation gs_cms_interphandler =
+{
+    {
+        cmsPluginMagicNumber,
+        LCMS_VERSION,
+        cmsPluginInterpolationSig,
+        NULL
+    },
+    icc_simd_interpolators
+};
+#endif
+
 /* Do any initialization if needed to the CMS */
 int
 gscms_create(gs_memory_t *memory)
@@ -891,6 +1185,10 @@ gscms_create(gs_memory_t *memory)
     cmsPlugin(ctx, (void *)&gs_cms_mutexhandler);
 #endif
 
+#ifdef LCMS2MT_SIMD
+    cmsPlugin(ctx, (void *)&gs_cms_interphandler);
+#endif
+
 #ifdef WITH_CAL
     cmsPlugin(ctx, cal_cms_extensions());
     cmsPlugin(ctx, cal_cms_extensions2());
@@ -355,6 +355,8 @@ int gs_lib_ctx_init(gs_lib_ctx_t *ctx, gs_memory_t *mem)
     pio->profiledir = NULL;
     pio->profiledir_len = 0;
     pio->icc_color_accuracy = MAX_COLOR_ACCURACY;
+    pio->icc_link_cache_size = ICC_CACHE_DEFAULT_SIZE;
+    pio->icc_link_cache_dir = NULL;
     if (gs_lib_ctx_set_icc_directory(mem, DEFAULT_DIR_ICC, strlen(DEFAULT_DIR_ICC)) < 0)
       goto Failure;
 
@@ -420,6 +422,8 @@ void gs_lib_ctx_fin(gs_memory_t *mem)
     gscms_destroy(ctx_mem);
     gs_free_object(ctx_mem, ctx->profiledir,
         "gs_lib_ctx_fin");
+    gs_free_object(ctx_mem, ctx->icc_link_cache_dir,
+        "gs_lib_ctx_fin");
 
     gs_free_object(ctx_mem, ctx->default_device_list,
                 "gs_lib_ctx_fin");
@@ -459,6 +463,9 @@ void gs_lib_ctx_fin(gs_memory_t *mem)
             gs_free_object(ctx->core->memory, ctx->core->argv[i], "gs_lib_ctx_arg");
         gs_free_object(ctx->core->memory, ctx->core->argv, "gs_lib_ctx_args");
 
+        if (ctx->core->char_cache_share != NULL)
+            ctx->core->char_cache_share_free(ctx->core->char_cache_share);
+
         gs_free_object(ctx->core->memory, ctx->core, "gs_lib_ctx_fin");
     }
     remove_ctx_pointers(ctx_mem);
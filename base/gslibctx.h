@@ -141,6 +141,12 @@ typedef struct {
     char **argv;
 
     gs_globals *globals;
+
+    /* The character cache shared by all the font directories of this
+     * instance (see gxccman.c), and the procedure that frees it. This
+     * file can't call the graphics library itself. */
+    void *char_cache_share;
+    void (*char_cache_share_free)(void *share);
 } gs_lib_ctx_core_t;
 
 typedef struct gs_lib_ctx_s
@@ -168,6 +174,17 @@ typedef struct gs_lib_ctx_s
     uint screen_min_screen_levels;
     /* Accuracy vs. performance for ICC color */
     uint icc_color_accuracy;
+    /* Memory budget of each ICC link cache, and the statistics of the
+     * link caches: those still in use, and the totals of those freed. */
+    size_t icc_link_cache_size;
+    struct gsicc_link_cache_stats_s *icc_link_cache_stats;
+    int64_t icc_link_cache_hits;
+    int64_t icc_link_cache_misses;
+    int64_t icc_link_cache_evictions;
+    int64_t icc_color_cache_hits;
+    int64_t icc_color_cache_misses;
+    /* Directory of the on-disk link cache, or NULL if not in use */
+    char *icc_link_cache_dir;
     /* real time clock 'bias' value. Not strictly required, but some FTS
      * tests work better if realtime starts from 0 at boot time. */
     long real_time_0[2];
@@ -41,6 +41,9 @@ typedef struct gx_colors_usage_s {
                                 /* executed plane-by-plane on CMYK devices */
     gs_int_rect trans_bbox;	/* transparency bbox allows skipping the pdf14 compositor for some bands */
                                 /* coordinates are band relative, 0 <= p.y < page_band_height */
+    int64_t cmd_bytes;		/* size of the band's own command lists, and */
+    int high_cost_ops;		/* number of images and transparency compositor */
+                                /* ops: these let the reader estimate render cost */
 } gx_color_usage_t;
 
 /*
@@ -57,9 +60,11 @@ typedef struct gx_band_page_info_s {
     int64_t bfile_end_pos;		/* ftell at end of bfile */
     gx_band_params_t band_params;  /* parameters used when writing band list */
                                 /* (actual values, no 0s) */
+    bool signature_valid;       /* signature covers the whole band list */
+    byte signature[16];         /* MD5 of the band list (DuplicatePageCache) */
 } gx_band_page_info_t;
 #define PAGE_INFO_NULL_VALUES\
-  { 0 }, 0, { 0 }, NULL, 0, 0, 0, 0, { BAND_PARAMS_INITIAL_VALUES }
+  { 0 }, 0, { 0 }, NULL, 0, 0, 0, 0, { BAND_PARAMS_INITIAL_VALUES }, 0, { 0 }
 
 /*
  * By convention, the structure member containing the above is called
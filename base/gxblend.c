@@ -30,6 +30,14 @@
 #include "cal.h"
 #endif
 
+#if defined(HAVE_SSE2) && defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__)) && \
+    (defined(__clang__) || __GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))
+/* Only the functions marked for it are built for AVX2, and they are only */
+/* called if the CPU we are running on has it.                            */
+#define BLEND_AVX2
+#include <immintrin.h>
+#endif
+
 typedef int art_s32;
 
 #if RAW_DUMP
@@ -2865,6 +2873,474 @@ dump_raw_buffer_be(const gs_memory_t *mem, int num_rows, int width, int n_chan,
 }
 #endif
 
+static inline uint16_t
+interp16(const uint16_t *table, uint16_t idx)
+{
+    byte     top = idx>>8;
+    uint16_t a   = table[top];
+    int      b   = table[top+1]-a;
+
+    return a + ((0x80 + b*(idx & 0xff))>>8);
+}
+
+/* Vector versions of the Normal blend mode compositing below. These work
+ * across 8 pixels at a time, a plane at a time, and give exactly the same
+ * results as the scalar code (the integer divisions are done in floating
+ * point and then corrected). Each returns the number of columns it has
+ * dealt with (a multiple of 8, or 0 if the CPU can't run it), and the
+ * caller finishes off the rest with the scalar code. */
+
+/* Kinds of Normal group composition */
+enum {
+    COMPOSE_ISOLATED,        /* Isolated, with soft mask */
+    COMPOSE_ISOLATED_NOMASK, /* Isolated, no soft mask */
+    COMPOSE_NONISOLATED      /* Non-isolated */
+};
+
+#ifdef BLEND_AVX2
+#define AVX2_TARGET __attribute__((target("avx2")))
+
+static inline AVX2_TARGET __m256i
+avx2_load8(const byte *p)
+{
+    return _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)p));
+}
+
+static inline AVX2_TARGET void
+avx2_store8(byte *p, __m256i v)
+{
+    __m256i w = _mm256_packus_epi32(v, v);
+
+    w = _mm256_packus_epi16(w, w);
+    _mm_storel_epi64((__m128i *)p,
+                     _mm_unpacklo_epi32(_mm256_castsi256_si128(w),
+                                        _mm256_extracti128_si256(w, 1)));
+}
+
+static inline AVX2_TARGET __m256i
+avx2_load16(const uint16_t *p)
+{
+    return _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i *)p));
+}
+
+static inline AVX2_TARGET void
+avx2_store16(uint16_t *p, __m256i v)
+{
+    __m256i w = _mm256_permute4x64_epi64(_mm256_packus_epi32(v, v), 0x08);
+
+    _mm_storeu_si128((__m128i *)p, _mm256_castsi256_si128(w));
+}
+
+/* (a * b + 0x80) / 255, as the scalar code does it */
+static inline AVX2_TARGET __m256i
+avx2_mul8(__m256i a, __m256i b)
+{
+    __m256i t = _mm256_add_epi32(_mm256_mullo_epi32(a, b), _mm256_set1_epi32(0x80));
+
+    return _mm256_srli_epi32(_mm256_add_epi32(t, _mm256_srli_epi32(t, 8)), 8);
+}
+
+/* Integer num / den for num < 2^24 and den > 0. The float quotient is
+ * never low, and at most one too high. */
+static inline AVX2_TARGET __m256i
+avx2_div(__m256i num, __m256i den)
+{
+    __m256i q = _mm256_cvttps_epi32(_mm256_div_ps(_mm256_cvtepi32_ps(num),
+                                                  _mm256_cvtepi32_ps(den)));
+    __m256i r = _mm256_sub_epi32(num, _mm256_mullo_epi32(q, den));
+
+    return _mm256_add_epi32(q, _mm256_srai_epi32(r, 31));
+}
+
+/* Integer (hi * 65536 + lo) / den for 16 bit hi, lo and den > 0. The
+ * quotient is small enough that the double result needs no correction. */
+static inline AVX2_TARGET __m256i
+avx2_div16(__m256i hi, __m256i lo, __m256i den)
+{
+    const __m256d k = _mm256_set1_pd(65536.0);
+    __m256d n0 = _mm256_add_pd(_mm256_mul_pd(_mm256_cvtepi32_pd(_mm256_castsi256_si128(hi)), k),
+                               _mm256_cvtepi32_pd(_mm256_castsi256_si128(lo)));
+    __m256d n1 = _mm256_add_pd(_mm256_mul_pd(_mm256_cvtepi32_pd(_mm256_extracti128_si256(hi, 1)), k),
+                               _mm256_cvtepi32_pd(_mm256_extracti128_si256(lo, 1)));
+    __m128i q0 = _mm256_cvttpd_epi32(_mm256_div_pd(n0, _mm256_cvtepi32_pd(_mm256_castsi256_si128(den))));
+    __m128i q1 = _mm256_cvttpd_epi32(_mm256_div_pd(n1, _mm256_cvtepi32_pd(_mm256_extracti128_si256(den, 1))));
+
+    return _mm256_inserti128_si256(_mm256_castsi128_si256(q0), q1, 1);
+}
+
+static inline AVX2_TARGET int
+avx2_none(__m256i m)
+{
+    return _mm256_testz_si256(m, m);
+}
+
+/* The group alpha for each pixel of a row: inside [m0, m1) the soft mask
+ * scales alpha, elsewhere it is outside. */
+typedef struct {
+    const byte *mask;
+    const byte *tr_fn;
+    int m0, m1;
+    byte alpha;
+    byte outside;
+} compose_alpha_8_t;
+
+static inline AVX2_TARGET __m256i
+compose_pix_alpha_8(const compose_alpha_8_t *pa, int x)
+{
+    byte pix[8];
+    int k;
+
+    if (pa->mask == NULL || x >= pa->m1 || x + 8 <= pa->m0)
+        return _mm256_set1_epi32(pa->outside);
+    for (k = 0; k < 8; k++) {
+        if (x + k >= pa->m0 && x + k < pa->m1) {
+            int tmp = pa->alpha * pa->tr_fn[pa->mask[x + k]] + 0x80;
+            pix[k] = (tmp + (tmp >> 8)) >> 8;
+        } else
+            pix[k] = pa->outside;
+    }
+    return avx2_load8(pix);
+}
+
+static AVX2_TARGET int
+compose_row_normal_8_avx2(byte *gs_restrict tos_ptr, int tos_planestride,
+                          byte *gs_restrict nos_ptr, int nos_planestride,
+                          int n_chan, int width, const compose_alpha_8_t *pa,
+                          int kind)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i c255 = _mm256_set1_epi32(255);
+    int x, i;
+
+    for (x = 0; x + 8 <= width; x += 8) {
+        __m256i ta = avx2_load8(tos_ptr + n_chan * tos_planestride + x);
+        __m256i active = _mm256_cmpgt_epi32(ta, zero);
+        __m256i pix, na, sa, nb0, copy, comp, fill, mix, ar, out;
+        __m256i scale = zero, uscale = zero, uncomp = zero;
+
+        if (avx2_none(active))
+            continue;
+        pix = compose_pix_alpha_8(pa, x);
+        na = avx2_load8(nos_ptr + n_chan * nos_planestride + x);
+        sa = avx2_mul8(ta, pix);
+        nb0 = _mm256_cmpeq_epi32(na, zero);
+        if (kind == COMPOSE_NONISOLATED) {
+            /* With full alpha uncompositing and recompositing cancel out,
+             * and we just copy. Otherwise uncomposite the colour first. */
+            __m256i solid = _mm256_cmpeq_epi32(pix, c255);
+
+            copy = _mm256_and_si256(active, solid);
+            comp = _mm256_andnot_si256(solid, active);
+            uncomp = _mm256_andnot_si256(_mm256_or_si256(_mm256_cmpeq_epi32(ta, c255), nb0), comp);
+            comp = _mm256_andnot_si256(_mm256_cmpeq_epi32(sa, zero), comp);
+            if (!avx2_none(uncomp)) {
+                __m256i den = _mm256_max_epi32(_mm256_slli_epi32(ta, 1), _mm256_set1_epi32(1));
+
+                uscale = _mm256_sub_epi32(avx2_div(_mm256_add_epi32(_mm256_mullo_epi32(na, _mm256_set1_epi32(510)), ta), den), na);
+            }
+        } else {
+            copy = zero;
+            comp = active;
+            if (kind == COMPOSE_ISOLATED_NOMASK)
+                comp = _mm256_andnot_si256(_mm256_cmpeq_epi32(sa, zero), comp);
+        }
+        fill = _mm256_and_si256(comp, nb0);
+        mix = _mm256_andnot_si256(nb0, comp);
+
+        /* Result alpha is Union of backdrop and source alpha */
+        ar = _mm256_sub_epi32(c255, avx2_mul8(_mm256_sub_epi32(c255, na), _mm256_sub_epi32(c255, sa)));
+        if (!avx2_none(mix)) {
+            /* Compute src_alpha / a_r in 16.16 format */
+            scale = avx2_div(_mm256_add_epi32(_mm256_slli_epi32(sa, 16), _mm256_srli_epi32(ar, 1)),
+                             _mm256_max_epi32(ar, _mm256_set1_epi32(1)));
+        }
+        out = _mm256_blendv_epi8(na, ta, copy);
+        out = _mm256_blendv_epi8(out, sa, fill);
+        out = _mm256_blendv_epi8(out, ar, mix);
+        avx2_store8(nos_ptr + n_chan * nos_planestride + x, out);
+
+        for (i = 0; i < n_chan; i++) {
+            __m256i c_s = avx2_load8(tos_ptr + i * tos_planestride + x);
+            __m256i c_b = avx2_load8(nos_ptr + i * nos_planestride + x);
+            __m256i t;
+
+            if (!avx2_none(uncomp)) {
+                t = _mm256_add_epi32(_mm256_mullo_epi32(_mm256_sub_epi32(c_s, c_b), uscale),
+                                     _mm256_set1_epi32(0x80));
+                t = _mm256_add_epi32(c_s, _mm256_srai_epi32(_mm256_add_epi32(t, _mm256_srai_epi32(t, 8)), 8));
+                t = _mm256_min_epi32(_mm256_max_epi32(t, zero), c255);
+                c_s = _mm256_blendv_epi8(c_s, t, uncomp);
+            }
+            /* Do simple compositing of source over backdrop */
+            t = _mm256_add_epi32(_mm256_mullo_epi32(scale, _mm256_sub_epi32(c_s, c_b)),
+                                 _mm256_set1_epi32(0x8000));
+            t = _mm256_add_epi32(c_b, _mm256_srai_epi32(t, 16));
+            out = _mm256_blendv_epi8(c_b, c_s, _mm256_or_si256(copy, fill));
+            out = _mm256_blendv_epi8(out, t, mix);
+            avx2_store8(nos_ptr + i * nos_planestride + x, out);
+        }
+    }
+    return width & ~7;
+}
+
+typedef struct {
+    const uint16_t *mask;
+    const uint16_t *tr_fn;
+    int m0, m1;
+    uint16_t alpha;
+    uint16_t outside;
+} compose_alpha_16_t;
+
+static inline AVX2_TARGET __m256i
+compose_pix_alpha_16(const compose_alpha_16_t *pa, int x)
+{
+    uint16_t pix[8];
+    int k;
+
+    if (pa->mask == NULL || x >= pa->m1 || x + 8 <= pa->m0)
+        return _mm256_set1_epi32(pa->outside);
+    for (k = 0; k < 8; k++) {
+        if (x + k >= pa->m0 && x + k < pa->m1) {
+            unsigned int mask = interp16(pa->tr_fn, pa->mask[x + k]);
+            mask += mask>>15;
+            pix[k] = (pa->alpha * mask + 0x8000)>>16;
+        } else
+            pix[k] = pa->outside;
+    }
+    return avx2_load16(pix);
+}
+
+static AVX2_TARGET int
+compose_row_normal_16_avx2(uint16_t *gs_restrict tos_ptr, int tos_planestride,
+                           uint16_t *gs_restrict nos_ptr, int nos_planestride,
+                           int n_chan, int width, const compose_alpha_16_t *pa)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i cffff = _mm256_set1_epi32(0xffff);
+    const __m256i half = _mm256_set1_epi32(0x8000);
+    int x, i;
+
+    for (x = 0; x + 8 <= width; x += 8) {
+        __m256i ta = avx2_load16(tos_ptr + n_chan * tos_planestride + x);
+        __m256i active = _mm256_cmpgt_epi32(ta, zero);
+        __m256i pix, na, sa, nb0, fill, mix, ar, t, out;
+        __m256i scale = zero;
+
+        if (avx2_none(active))
+            continue;
+        pix = compose_pix_alpha_16(pa, x);
+        pix = _mm256_add_epi32(pix, _mm256_srli_epi32(pix, 15));
+        sa = _mm256_srli_epi32(_mm256_add_epi32(_mm256_mullo_epi32(ta, pix), half), 16);
+        na = avx2_load16(nos_ptr + n_chan * nos_planestride + x);
+        nb0 = _mm256_cmpeq_epi32(na, zero);
+        fill = _mm256_and_si256(active, nb0);
+        mix = _mm256_andnot_si256(nb0, active);
+
+        /* Result alpha is Union of backdrop and source alpha */
+        t = _mm256_add_epi32(_mm256_mullo_epi32(_mm256_sub_epi32(cffff, na), _mm256_sub_epi32(cffff, sa)), half);
+        t = _mm256_add_epi32(t, _mm256_srli_epi32(t, 16));
+        ar = _mm256_sub_epi32(cffff, _mm256_srli_epi32(t, 16));
+        if (!avx2_none(mix)) {
+            /* Compute src_alpha / a_r in 16.16 format, then lose a bit */
+            scale = avx2_div16(sa, _mm256_srli_epi32(ar, 1),
+                               _mm256_max_epi32(ar, _mm256_set1_epi32(1)));
+            scale = _mm256_srli_epi32(scale, 1);
+        }
+        out = _mm256_blendv_epi8(na, sa, fill);
+        out = _mm256_blendv_epi8(out, ar, mix);
+        avx2_store16(nos_ptr + n_chan * nos_planestride + x, out);
+
+        for (i = 0; i < n_chan; i++) {
+            __m256i c_s = avx2_load16(tos_ptr + i * tos_planestride + x);
+            __m256i c_b = avx2_load16(nos_ptr + i * nos_planestride + x);
+
+            t = _mm256_add_epi32(_mm256_mullo_epi32(scale, _mm256_sub_epi32(c_s, c_b)),
+                                 _mm256_set1_epi32(0x4000));
+            t = _mm256_add_epi32(c_b, _mm256_srai_epi32(t, 15));
+            out = _mm256_blendv_epi8(c_b, c_s, fill);
+            out = _mm256_blendv_epi8(out, t, mix);
+            avx2_store16(nos_ptr + i * nos_planestride + x, out);
+        }
+    }
+    return width & ~7;
+}
+
+/* Solid colour src (n_chan colours then alpha) over a rectangle. The
+ * complement flag is for subtractive buffers, where the colours in the
+ * buffer are stored inverted. */
+static AVX2_TARGET int
+mark_fill_rect_normal_8_avx2(int w, int h, byte *gs_restrict dst_ptr,
+                             const byte *gs_restrict src, int n_chan,
+                             byte src_alpha, int rowstride, int planestride,
+                             int alpha_g_off, bool complement)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i c255 = _mm256_set1_epi32(255);
+    const __m256i sa = _mm256_set1_epi32(src[n_chan]);
+    const __m256i g_scale = _mm256_set1_epi32(src_alpha);
+    const __m256i flip = complement ? c255 : zero;
+    int x, y, i;
+    int done = w & ~7;
+
+    for (y = 0; y < h; y++) {
+        for (x = 0; x < done; x += 8) {
+            byte *dp = dst_ptr + x;
+            __m256i na = avx2_load8(dp + n_chan * planestride);
+            __m256i fill, mix, ar, scale = zero;
+
+            if (src[n_chan] == 0xff)
+                fill = _mm256_cmpeq_epi32(zero, zero);
+            else
+                fill = _mm256_cmpeq_epi32(na, zero);
+            mix = src[n_chan] != 0 ? _mm256_andnot_si256(fill, _mm256_cmpeq_epi32(zero, zero)) : zero;
+
+            if (!avx2_none(_mm256_or_si256(fill, mix))) {
+                /* Result alpha is Union of backdrop and source alpha */
+                ar = _mm256_sub_epi32(c255, avx2_mul8(_mm256_sub_epi32(c255, na), _mm256_sub_epi32(c255, sa)));
+                if (!avx2_none(mix))
+                    scale = avx2_div(_mm256_add_epi32(_mm256_slli_epi32(sa, 16), _mm256_srli_epi32(ar, 1)),
+                                     _mm256_max_epi32(ar, _mm256_set1_epi32(1)));
+                avx2_store8(dp + n_chan * planestride,
+                            _mm256_blendv_epi8(_mm256_blendv_epi8(na, sa, fill), ar, mix));
+
+                for (i = 0; i < n_chan; i++) {
+                    __m256i c_s = _mm256_set1_epi32(src[i]);
+                    __m256i d = avx2_load8(dp + i * planestride);
+                    __m256i c_b = _mm256_abs_epi32(_mm256_sub_epi32(flip, d));
+                    __m256i t;
+
+                    /* Do simple compositing of source over backdrop */
+                    t = _mm256_add_epi32(_mm256_mullo_epi32(scale, _mm256_sub_epi32(c_s, c_b)),
+                                         _mm256_set1_epi32(0x8000));
+                    t = _mm256_add_epi32(c_b, _mm256_srai_epi32(t, 16));
+                    t = _mm256_blendv_epi8(_mm256_blendv_epi8(c_b, c_s, fill), t, mix);
+                    avx2_store8(dp + i * planestride,
+                                _mm256_blendv_epi8(_mm256_abs_epi32(_mm256_sub_epi32(flip, t)), d,
+                                                   _mm256_andnot_si256(_mm256_or_si256(fill, mix),
+                                                                       _mm256_cmpeq_epi32(zero, zero))));
+                }
+            }
+            if (alpha_g_off) {
+                __m256i g = avx2_load8(dp + alpha_g_off);
+
+                g = _mm256_sub_epi32(c255, avx2_mul8(_mm256_sub_epi32(c255, g), g_scale));
+                avx2_store8(dp + alpha_g_off, g);
+            }
+        }
+        dst_ptr += rowstride + w;
+    }
+    return done;
+}
+
+static int
+blend_use_avx2(void)
+{
+    return __builtin_cpu_supports("avx2");
+}
+#endif
+
+/* Vector Normal blend composition of the columns of an 8 bit group that
+ * the CPU allows; the return value says how many columns were done. */
+static int
+compose_group_normal_8(byte *tos_ptr, int tos_planestride, int tos_rowstride,
+                       byte *nos_ptr, int nos_planestride, int nos_rowstride,
+                       int n_chan, byte alpha, const byte *mask_row_ptr,
+                       int has_mask, const pdf14_buf *maskbuf,
+                       byte mask_bg_alpha, const byte *mask_tr_fn,
+                       int x0, int y0, int x1, int y1, int kind)
+{
+#ifdef BLEND_AVX2
+    compose_alpha_8_t pa;
+    int width = x1 - x0;
+    int y, done = 0;
+
+    if (width < 8 || !blend_use_avx2())
+        return 0;
+
+    pa.tr_fn = mask_tr_fn;
+    pa.alpha = alpha;
+    pa.outside = maskbuf != NULL ? mask_bg_alpha : alpha;
+    pa.m0 = pa.m1 = 0;
+    if (has_mask) {
+        pa.m0 = max(maskbuf->rect.p.x - x0, 0);
+        pa.m1 = min(maskbuf->rect.q.x - x0, width);
+    }
+    for (y = y0; y < y1; y++) {
+        pa.mask = NULL;
+        if (has_mask && y >= maskbuf->rect.p.y && y < maskbuf->rect.q.y)
+            pa.mask = mask_row_ptr;
+        done = compose_row_normal_8_avx2(tos_ptr, tos_planestride, nos_ptr, nos_planestride,
+                                         n_chan, width, &pa, kind);
+        tos_ptr += tos_rowstride;
+        nos_ptr += nos_rowstride;
+        if (mask_row_ptr != NULL)
+            mask_row_ptr += maskbuf->rowstride;
+    }
+    return done;
+#else
+    return 0;
+#endif
+}
+
+static int
+compose_group_normal_16(uint16_t *tos_ptr, int tos_planestride, int tos_rowstride,
+                        uint16_t *nos_ptr, int nos_planestride, int nos_rowstride,
+                        int n_chan, uint16_t alpha, const uint16_t *mask_row_ptr,
+                        int has_mask, const pdf14_buf *maskbuf,
+                        uint16_t mask_bg_alpha, const uint16_t *mask_tr_fn,
+                        int x0, int y0, int x1, int y1)
+{
+#ifdef BLEND_AVX2
+    compose_alpha_16_t pa;
+    int width = x1 - x0;
+    int y, done = 0;
+
+    if (width < 8 || !blend_use_avx2())
+        return 0;
+
+    pa.tr_fn = mask_tr_fn;
+    pa.alpha = alpha;
+    pa.outside = maskbuf != NULL ? mask_bg_alpha : alpha;
+    pa.m0 = pa.m1 = 0;
+    if (has_mask) {
+        pa.m0 = max(maskbuf->rect.p.x - x0, 0);
+        pa.m1 = min(maskbuf->rect.q.x - x0, width);
+    }
+    for (y = y0; y < y1; y++) {
+        pa.mask = NULL;
+        if (has_mask && y >= maskbuf->rect.p.y && y < maskbuf->rect.q.y)
+            pa.mask = mask_row_ptr;
+        done = compose_row_normal_16_avx2(tos_ptr, tos_planestride, nos_ptr, nos_planestride,
+                                          n_chan, width, &pa);
+        tos_ptr += tos_rowstride;
+        nos_ptr += nos_rowstride;
+        if (mask_row_ptr != NULL)
+            mask_row_ptr += maskbuf->rowstride>>1;
+    }
+    return done;
+#else
+    return 0;
+#endif
+}
+
+/* As above, for a Normal blend solid colour fill. rowstride is the step
+ * from the end of one row to the start of the next, as for the callers. */
+static int
+mark_fill_rect_normal_8(int w, int h, byte *dst_ptr, const byte *src,
+                        int n_chan, byte src_alpha, int rowstride,
+                        int planestride, int alpha_g_off, bool complement)
+{
+#ifdef BLEND_AVX2
+    if (w < 8 || !blend_use_avx2())
+        return 0;
+    return mark_fill_rect_normal_8_avx2(w, h, dst_ptr, src, n_chan, src_alpha,
+                                        rowstride, planestride, alpha_g_off,
+                                        complement);
+#else
+    return 0;
+#endif
+}
+
 typedef void (*art_pdf_compose_group_fn)(byte *tos_ptr, bool tos_isolated, int tos_planestride, int tos_rowstride,
                                          byte alpha, byte shape, gs_blend_mode_t blend_mode, bool tos_has_shape,
                                          int tos_shape_offset, int tos_alpha_g_offset, int tos_tag_offset, bool tos_has_tag,
@@ -3161,6 +3637,17 @@ compose_group_nonknockout_nonblend_isolated_allmask_common(byte *tos_ptr, bool t
     int width = x1 - x0;
     int x, y;
     int i;
+    int done;
+
+    done = compose_group_normal_8(tos_ptr, tos_planestride, tos_rowstride,
+                                  nos_ptr, nos_planestride, nos_rowstride,
+                                  n_chan, alpha, mask_row_ptr, has_mask, maskbuf,
+                                  mask_bg_alpha, mask_tr_fn, x0, y0, x1, y1,
+                                  COMPOSE_ISOLATED);
+    tos_ptr += done;
+    nos_ptr += done;
+    mask_row_ptr += done;
+    width -= done;
 
     for (y = y1 - y0; y > 0; --y) {
         byte *gs_restrict mask_curr_ptr = mask_row_ptr;
@@ -3230,6 +3717,19 @@ compose_group_nonknockout_nonblend_isolated_mask_common(byte *tos_ptr, bool tos_
     bool in_mask_rect_y;
     bool in_mask_rect;
     byte pix_alpha, src_alpha;
+    int done;
+
+    done = compose_group_normal_8(tos_ptr, tos_planestride, tos_rowstride,
+                                  nos_ptr, nos_planestride, nos_rowstride,
+                                  n_chan, alpha, mask_row_ptr, has_mask, maskbuf,
+                                  mask_bg_alpha, mask_tr_fn, x0, y0, x1, y1,
+                                  COMPOSE_ISOLATED);
+    tos_ptr += done;
+    nos_ptr += done;
+    if (mask_row_ptr != NULL)
+        mask_row_ptr += done;
+    x0 += done;
+    width -= done;
 
     for (y = y1 - y0; y > 0; --y) {
         mask_curr_ptr = mask_row_ptr;
@@ -3313,10 +3813,20 @@ compose_group_nonknockout_nonblend_isolated_nomask_common(byte *tos_ptr, bool to
               bool has_matte, int n_chan, bool additive, int num_spots, bool overprint, gx_color_index drawn_comps, int x0, int y0, int x1, int y1,
               const pdf14_nonseparable_blending_procs_t *pblend_procs, pdf14_device *pdev)
 {
+    int done = compose_group_normal_8(tos_ptr, tos_planestride, tos_rowstride,
+                                      nos_ptr, nos_planestride, nos_rowstride,
+                                      n_chan, alpha, NULL, 0, NULL, mask_bg_alpha,
+                                      mask_tr_fn, x0, y0, x1, y1, COMPOSE_ISOLATED_NOMASK);
+
+    if (done == x1 - x0)
+        return;
+    tos_ptr += done;
+    nos_ptr += done;
+    x0 += done;
     template_compose_group(tos_ptr, /*tos_isolated*/1, tos_planestride, tos_rowstride, alpha, shape, BLEND_MODE_Normal, /*tos_has_shape*/0,
         tos_shape_offset, tos_alpha_g_offset, tos_tag_offset, /*tos_has_tag*/0, /*tos_alpha_g_ptr*/0,
         nos_ptr, /*nos_isolated*/0, nos_planestride, nos_rowstride, /*nos_alpha_g_ptr*/0, /* nos_knockout = */0,
-        /*nos_shape_offset*/0, /*nos_tag_offset*/0, mask_row_ptr, /*has_mask*/0, /*maskbuf*/NULL, mask_bg_alpha, mask_tr_fn,
+        /*nos_shape_offset*/0, /*nos_tag_offset*/0, /*mask_row_ptr*/NULL, /*has_mask*/0, /*maskbuf*/NULL, mask_bg_alpha, mask_tr_fn,
         backdrop_ptr, /*has_matte*/0, n_chan, /*additive*/1, /*num_spots*/0, /*overprint*/0, /*drawn_comps*/0, x0, y0, x1, y1, pblend_procs, pdev, 1);
 }
 
@@ -3330,6 +3840,19 @@ compose_group_nonknockout_nonblend_nonisolated_mask_common(byte *tos_ptr, bool t
               bool has_matte, int n_chan, bool additive, int num_spots, bool overprint, gx_color_index drawn_comps, int x0, int y0, int x1, int y1,
               const pdf14_nonseparable_blending_procs_t *pblend_procs, pdf14_device *pdev)
 {
+    int done = compose_group_normal_8(tos_ptr, tos_planestride, tos_rowstride,
+                                      nos_ptr, nos_planestride, nos_rowstride,
+                                      n_chan, alpha, mask_row_ptr, has_mask, maskbuf,
+                                      mask_bg_alpha, mask_tr_fn, x0, y0, x1, y1,
+                                      COMPOSE_NONISOLATED);
+
+    if (done == x1 - x0)
+        return;
+    tos_ptr += done;
+    nos_ptr += done;
+    if (mask_row_ptr != NULL)
+        mask_row_ptr += done;
+    x0 += done;
     template_compose_group(tos_ptr, /*tos_isolated*/0, tos_planestride, tos_rowstride, alpha, shape, BLEND_MODE_Normal, /*tos_has_shape*/0,
         tos_shape_offset, tos_alpha_g_offset, tos_tag_offset, /*tos_has_tag*/0, /*tos_alpha_g_ptr*/0,
         nos_ptr, /*nos_isolated*/0, nos_planestride, nos_rowstride, /*nos_alpha_g_ptr*/0, /* nos_knockout = */0,
@@ -3347,10 +3870,20 @@ compose_group_nonknockout_nonblend_nonisolated_nomask_common(byte *tos_ptr, bool
               bool has_matte, int n_chan, bool additive, int num_spots, bool overprint, gx_color_index drawn_comps, int x0, int y0, int x1, int y1,
               const pdf14_nonseparable_blending_procs_t *pblend_procs, pdf14_device *pdev)
 {
+    int done = compose_group_normal_8(tos_ptr, tos_planestride, tos_rowstride,
+                                      nos_ptr, nos_planestride, nos_rowstride,
+                                      n_chan, alpha, NULL, 0, NULL, mask_bg_alpha,
+                                      mask_tr_fn, x0, y0, x1, y1, COMPOSE_NONISOLATED);
+
+    if (done == x1 - x0)
+        return;
+    tos_ptr += done;
+    nos_ptr += done;
+    x0 += done;
     template_compose_group(tos_ptr, /*tos_isolated*/0, tos_planestride, tos_rowstride, alpha, shape, BLEND_MODE_Normal, /*tos_has_shape*/0,
         tos_shape_offset, tos_alpha_g_offset, tos_tag_offset, /*tos_has_tag*/0, /*tos_alpha_g_ptr*/0,
         nos_ptr, /*nos_isolated*/0, nos_planestride, nos_rowstride, /*nos_alpha_g_ptr*/0, /* nos_knockout = */0,
-        /*nos_shape_offset*/0, /*nos_tag_offset*/0, mask_row_ptr, /*has_mask*/0, /*maskbuf*/NULL, mask_bg_alpha, mask_tr_fn,
+        /*nos_shape_offset*/0, /*nos_tag_offset*/0, /*mask_row_ptr*/NULL, /*has_mask*/0, /*maskbuf*/NULL, mask_bg_alpha, mask_tr_fn,
         backdrop_ptr, /*has_matte*/0, n_chan, /*additive*/1, /*num_spots*/0, /*overprint*/0, /*drawn_comps*/0, x0, y0, x1, y1, pblend_procs, pdev, 1);
 }
 
@@ -3607,16 +4140,6 @@ do_compose_group(pdf14_buf *tos, pdf14_buf *nos, pdf14_buf *maskbuf,
 #endif
 }
 
-static inline uint16_t
-interp16(const uint16_t *table, uint16_t idx)
-{
-    byte     top = idx>>8;
-    uint16_t a   = table[top];
-    int      b   = table[top+1]-a;
-
-    return a + ((0x80 + b*(idx & 0xff))>>8);
-}
-
 typedef void (*art_pdf_compose_group16_fn)(uint16_t *tos_ptr, bool tos_isolated, int tos_planestride, int tos_rowstride,
                                          uint16_t alpha, uint16_t shape, gs_blend_mode_t blend_mode, bool tos_has_shape,
                                          int tos_shape_offset, int tos_alpha_g_offset, int tos_tag_offset, bool tos_has_tag,
@@ -3926,6 +4449,16 @@ compose_group16_nonknockout_nonblend_isolated_allmask_common(uint16_t *tos_ptr,
     int width = x1 - x0;
     int x, y;
     int i;
+    int done;
+
+    done = compose_group_normal_16(tos_ptr, tos_planestride, tos_rowstride,
+                                   nos_ptr, nos_planestride, nos_rowstride,
+                                   n_chan, alpha, mask_row_ptr, has_mask, maskbuf,
+                                   mask_bg_alpha, mask_tr_fn, x0, y0, x1, y1);
+    tos_ptr += done;
+    nos_ptr += done;
+    mask_row_ptr += done;
+    width -= done;
 
     for (y = y1 - y0; y > 0; --y) {
         uint16_t *gs_restrict mask_curr_ptr = mask_row_ptr;
@@ -4000,6 +4533,18 @@ compose_group16_nonknockout_nonblend_isolated_mask_common(uint16_t *tos_ptr, boo
     bool in_mask_rect_y;
     bool in_mask_rect;
     uint16_t pix_alpha, src_alpha;
+    int done;
+
+    done = compose_group_normal_16(tos_ptr, tos_planestride, tos_rowstride,
+                                   nos_ptr, nos_planestride, nos_rowstride,
+                                   n_chan, alpha, mask_row_ptr, has_mask, maskbuf,
+                                   mask_bg_alpha, mask_tr_fn, x0, y0, x1, y1);
+    tos_ptr += done;
+    nos_ptr += done;
+    if (mask_row_ptr != NULL)
+        mask_row_ptr += done;
+    x0 += done;
+    width -= done;
 
     for (y = y1 - y0; y > 0; --y) {
         mask_curr_ptr = mask_row_ptr;
@@ -4383,14 +4928,39 @@ pdf14_compose_group(pdf14_buf *tos, pdf14_buf *nos, pdf14_buf *maskbuf,
               bool has_matte, bool overprint, gx_color_index drawn_comps,
               gs_memory_t *memory, gx_device *dev)
 {
-    if (tos->deep)
-        do_compose_group16(tos, nos, maskbuf, x0, x1, y0, y1, n_chan,
-                           additive, pblend_procs, has_matte, overprint,
-                           drawn_comps, memory, dev);
-    else
-        do_compose_group(tos, nos, maskbuf, x0, x1, y0, y1, n_chan,
-                         additive, pblend_procs, has_matte, overprint,
-                         drawn_comps, memory, dev);
+    int ya = y0, yb = y1;
+
+    /* Bands of a sparse tos that were never marked are fully transparent,
+       which leaves nos untouched unless nos is a knockout group. So we
+       compose the runs of marked bands only. */
+    if (tos->bands == NULL || nos->knockout)
+        pdf14_buf_touch(tos, y0, y1);
+    while (ya < yb) {
+        if (tos->bands != NULL && !nos->knockout) {
+            int b = (ya - tos->rect.p.y) / PDF14_SPARSE_BAND_HEIGHT;
+
+            while (ya < yb && !tos->bands[b]) {
+                ya = tos->rect.p.y + ++b * PDF14_SPARSE_BAND_HEIGHT;
+            }
+            if (ya >= yb)
+                break;
+            y0 = ya;
+            while (ya < yb && tos->bands[b]) {
+                ya = tos->rect.p.y + ++b * PDF14_SPARSE_BAND_HEIGHT;
+            }
+            y1 = min(ya, yb);
+        } else
+            ya = yb;
+        pdf14_buf_touch(nos, y0, y1);
+        if (tos->deep)
+            do_compose_group16(tos, nos, maskbuf, x0, x1, y0, y1, n_chan,
+                               additive, pblend_procs, has_matte, overprint,
+                               drawn_comps, memory, dev);
+        else
+            do_compose_group(tos, nos, maskbuf, x0, x1, y0, y1, n_chan,
+                             additive, pblend_procs, has_matte, overprint,
+                             drawn_comps, memory, dev);
+    }
 }
 
 static void
@@ -4672,6 +5242,8 @@ pdf14_compose_alphaless_group(pdf14_buf *tos, pdf14_buf *nos,
                               int x0, int x1, int y0, int y1,
                               gs_memory_t *memory, gx_device *dev)
 {
+    pdf14_buf_touch(tos, y0, y1);
+    pdf14_buf_touch(nos, y0, y1);
     if (tos->deep)
         do_compose_alphaless_group16(tos, nos, x0, x1, y0, y1, memory, dev);
     else
@@ -4851,6 +5423,16 @@ mark_fill_rect_sub4_fast(int w, int h, byte *gs_restrict dst_ptr, byte *gs_restr
                int alpha_g_off, int shape_off, byte shape)
 {
     int i, j, k;
+    int done;
+
+    done = mark_fill_rect_normal_8(w, h, dst_ptr, src, num_comp, src_alpha,
+                                   rowstride, planestride, 0, true);
+
+    if (done == w)
+        return;
+    dst_ptr += done;
+    rowstride += done;
+    w -= done;
 
     for (j = h; j > 0; --j) {
         for (i = w; i > 0; --i) {
@@ -4906,6 +5488,15 @@ mark_fill_rect_add_nospots_common(int w, int h, byte *gs_restrict dst_ptr, byte
                bool overprint, gx_color_index drawn_comps, int tag_off, gs_graphics_type_tag_t curr_tag,
                int alpha_g_off, int shape_off, byte shape)
 {
+    int done = mark_fill_rect_normal_8(w, h, dst_ptr, src, num_comp, src_alpha,
+                                       rowstride, planestride, alpha_g_off, false);
+
+    if (done == w)
+        return;
+    dst_ptr += done;
+    rowstride += done;
+    w -= done;
+
     template_mark_fill_rect(w, h, dst_ptr, src, num_comp, /*num_spots*/0, /*first_blend_spot*/0,
                src_alpha, rowstride, planestride, /*additive*/1, pdev, /*blend_mode*/BLEND_MODE_Normal,
                /*overprint*/0, /*drawn_comps*/0, /*tag_off*/0, curr_tag,
@@ -4918,6 +5509,15 @@ mark_fill_rect_add_nospots_common_no_alpha_g(int w, int h, byte *gs_restrict dst
                bool overprint, gx_color_index drawn_comps, int tag_off, gs_graphics_type_tag_t curr_tag,
                int alpha_g_off, int shape_off, byte shape)
 {
+    int done = mark_fill_rect_normal_8(w, h, dst_ptr, src, num_comp, src_alpha,
+                                       rowstride, planestride, 0, false);
+
+    if (done == w)
+        return;
+    dst_ptr += done;
+    rowstride += done;
+    w -= done;
+
     template_mark_fill_rect(w, h, dst_ptr, src, num_comp, /*num_spots*/0, /*first_blend_spot*/0,
                src_alpha, rowstride, planestride, /*additive*/1, pdev, /*blend_mode*/BLEND_MODE_Normal,
                /*overprint*/0, /*drawn_comps*/0, /*tag_off*/0, curr_tag,
@@ -4931,6 +5531,16 @@ mark_fill_rect_add3_common(int w, int h, byte *gs_restrict dst_ptr, byte *gs_res
                int alpha_g_off, int shape_off, byte shape)
 {
     int i, j, k;
+    int done;
+
+    done = mark_fill_rect_normal_8(w, h, dst_ptr, src, num_comp, src_alpha,
+                                   rowstride, planestride, 0, false);
+
+    if (done == w)
+        return;
+    dst_ptr += done;
+    rowstride += done;
+    w -= done;
 
     for (j = h; j > 0; --j) {
         for (i = w; i > 0; --i) {
@@ -5223,6 +5833,7 @@ do_mark_fill_rectangle(gx_device * dev, int x, int y, int w, int h,
     if (y < buf->dirty.p.y) buf->dirty.p.y = y;
     if (x + w > buf->dirty.q.x) buf->dirty.q.x = x + w;
     if (y + h > buf->dirty.q.y) buf->dirty.q.y = y + h;
+    pdf14_buf_touch(buf, y, y + h);
     dst_ptr = buf->data + (x - buf->rect.p.x) + (y - buf->rect.p.y) * rowstride;
     src_alpha = 255-src_alpha;
     shape = 255-shape;
@@ -5864,6 +6475,7 @@ do_mark_fill_rectangle16(gx_device * dev, int x, int y, int w, int h,
     if (y < buf->dirty.p.y) buf->dirty.p.y = y;
     if (x + w > buf->dirty.q.x) buf->dirty.q.x = x + w;
     if (y + h > buf->dirty.q.y) buf->dirty.q.y = y + h;
+    pdf14_buf_touch(buf, y, y + h);
     dst_ptr = (uint16_t *)(buf->data + (x - buf->rect.p.x) * 2 + (y - buf->rect.p.y) * rowstride);
     src_alpha = 65535-src_alpha;
     shape = 65535-shape;
@@ -350,6 +350,15 @@ int pdf14_preserve_backdrop_cm(pdf14_buf *buf, cmm_profile_t *group_profile,
                                gs_memory_t *memory, gs_gstate *pgs,
                                gx_device *dev, bool knockout_buff);
 
+/* Clear any not yet cleared bands of a sparse buffer covering rows
+ * y0 to y1, ready to be marked. Call pdf14_buf_touch before writing to
+ * a buffer directly, and pdf14_buf_materialize before handing the whole
+ * buffer to code that doesn't know about sparse buffers. */
+void pdf14_buf_touch_bands(pdf14_buf *buf, int y0, int y1);
+void pdf14_buf_materialize(pdf14_buf *buf);
+#define pdf14_buf_touch(buf, y0, y1)\
+    do { if ((buf)->bands != NULL) pdf14_buf_touch_bands(buf, y0, y1); } while (0)
+
 void pdf14_compose_group(pdf14_buf *tos, pdf14_buf *nos, pdf14_buf *maskbuf,
               int x0, int x1, int y0, int y1, int n_chan, bool additive,
               const pdf14_nonseparable_blending_procs_t * pblend_procs,
@@ -266,6 +266,7 @@ pdf14_preserve_backdrop_cm(pdf14_buf *buf, cmm_profile_t *group_profile,
                         (y0 - tos->rect.p.y) * (size_t)tos->rowstride;
                 memset(buf->backdrop, 0, buf->n_chan * ((size_t)buf->planestride)<<deep);
             } else {
+                pdf14_buf_touch(tos, y0, y1);
                 buf_plane = buf->data + ((x0 - buf->rect.p.x)<<deep) +
                         (y0 - buf->rect.p.y) * (size_t)buf->rowstride;
                 tos_plane = tos->data + ((x0 - tos->rect.p.x)<<deep) +
@@ -333,6 +334,8 @@ pdf14_preserve_backdrop(pdf14_buf *buf, pdf14_buf *tos, bool from_backdrop
         int i, n_planes;
         bool deep = buf->deep;
 
+        if (!from_backdrop)
+            pdf14_buf_touch(tos, y0, y1);
         buf_plane = buf->data;
         n_planes = buf->n_planes;
         if (from_backdrop) {
@@ -389,6 +392,48 @@ pdf14_preserve_backdrop(pdf14_buf *buf, pdf14_buf *tos, bool from_backdrop
 #endif
 }
 
+void
+pdf14_buf_touch_bands(pdf14_buf *buf, int y0, int y1)
+{
+    int b, b1;
+    int n_planes = buf->n_chan + (buf->has_shape ? 1 : 0) +
+                   (buf->has_alpha_g ? 1 : 0);
+
+    y0 = max(y0, buf->rect.p.y) - buf->rect.p.y;
+    y1 = min(y1, buf->rect.q.y) - buf->rect.p.y;
+    if (y0 >= y1)
+        return;
+    b1 = (y1 - 1) / PDF14_SPARSE_BAND_HEIGHT;
+    for (b = y0 / PDF14_SPARSE_BAND_HEIGHT; b <= b1; b++) {
+        int r0, r1, i;
+        byte *ptr;
+
+        if (buf->bands[b])
+            continue;
+        /* The tag plane was set up when the buffer was allocated, so
+           as for a dense buffer only the colour, alpha, shape and
+           alpha_g planes need clearing. */
+        r0 = b * PDF14_SPARSE_BAND_HEIGHT;
+        r1 = min(r0 + PDF14_SPARSE_BAND_HEIGHT, buf->rect.q.y - buf->rect.p.y);
+        ptr = buf->data + r0 * (size_t)buf->rowstride;
+        for (i = 0; i < n_planes; i++) {
+            memset(ptr, 0, (r1 - r0) * (size_t)buf->rowstride);
+            ptr += buf->planestride;
+        }
+        buf->bands[b] = 1;
+    }
+}
+
+void
+pdf14_buf_materialize(pdf14_buf *buf)
+{
+    if (buf->bands == NULL)
+        return;
+    pdf14_buf_touch_bands(buf, buf->rect.p.y, buf->rect.q.y);
+    gs_free_object(buf->memory, buf->bands, "pdf14_buf_materialize");
+    buf->bands = NULL;
+}
+
 /*
  * Encode a list of colorant values into a gx_color_index_value.
  */
@@ -35,6 +35,7 @@
 #include "gxttfb.h"
 #include "gxfont42.h"
 #include "gxobj.h"
+#include "gxsync.h"
 
 /* Define the descriptors for the cache structures. */
 private_st_cached_fm_pair();
@@ -64,6 +65,8 @@ static int alloc_char(gs_font_dir *, ulong, cached_char **);
 static int alloc_char_in_chunk(gs_font_dir *, ulong, cached_char **);
 static void hash_remove_cached_char(gs_font_dir *, uint);
 static void shorten_cached_char(gs_font_dir *, cached_char *, uint);
+static void add_shared_cached_char(gs_font_dir *, const cached_char *,
+                                   const cached_fm_pair *);
 
 /* ====== Initialization ====== */
 
@@ -647,7 +650,7 @@ int
 gx_add_cached_char(gs_font_dir * dir, gx_device_memory * dev,
 cached_char * cc, cached_fm_pair * pair, const gs_log2_scale_point * pscale)
 {
-    if_debug5m('k', dev->memory,
+    if_debug5m('k', dir->memory,
                "[k]chaining char "PRI_INTPTR": pair="PRI_INTPTR", glyph=0x%lx, wmode=%d, depth=%d\n",
                (intptr_t)cc, (intptr_t)pair, (ulong)cc->code,
                cc->wmode, cc_depth(cc));
@@ -687,6 +690,8 @@ cached_char * cc, cached_fm_pair * pair, const gs_log2_scale_point * pscale)
         cc_set_pair(cc, pair);
         pair->num_chars++;
     }
+    if (dev != NULL && cc_has_bits(cc))
+        add_shared_cached_char(dir, cc, pair);
     return 0;
 }
 
@@ -894,6 +899,415 @@ gs_purge_font_from_char_caches_completely(gs_font * font)
     return gs_purge_font_from_char_caches_forced(font, true);
 }
 
+/* ====== Shared character cache ====== */
+
+/*
+ * The font directories of one instance (the interpreters and the rendering
+ * threads cloned from them share a library context core) can also share
+ * the characters they render, through a cache kept in the core. Since the
+ * core lasts as long as the instance, so do the characters, from one job
+ * to the next.
+ *
+ * As for a (font, matrix) pair, only a UniqueID or XUID identifies a font
+ * outside its own directory, so only characters of fonts with one read
+ * from the font are shared. The interpreters make up UIDs for fonts which
+ * don't have one, from gs ids (pdfi, xps) or font handles (pcl); these are
+ * flagged as UID_is_local, since the same number may be the real UniqueID
+ * of another font. So are fonts whose program came from the job (fonts
+ * embedded in a PDF file, PostScript fonts in local VM): a job can give
+ * its font any UID, and another job must not see its characters in place
+ * of those of the real font. So is an XUID with the private organization number
+ * (1000000): pdfi makes these up for fonts of one document, and another
+ * document may use the same values for a different font.
+ *
+ * The key is everything the pair and the character cache look up by, with
+ * the glyph name in place of the glyph for named glyphs, since name indices
+ * are not the same in all the interpreters. The cache has a byte budget
+ * (0 disables it) and drops the least recently used characters first.
+ */
+
+#define CC_SHARE_TABLE_SIZE 4096	/* a power of 2 */
+#define CC_SHARE_MAX_KEY 512
+#define CC_SHARE_PRIVATE_XUID 1000000
+
+typedef struct cc_share_entry_s cc_share_entry;
+struct cc_share_entry_s {
+    cc_share_entry *hnext;	/* next entry in the hash chain */
+    cc_share_entry *prev, *next;	/* LRU list, most recently used first */
+    uint hash;
+    uint key_size;
+    size_t size;		/* bytes allocated for the entry */
+    ushort width, height;
+    uint raster;
+    gs_fixed_point wxy;
+    gs_fixed_point offset;
+    /* The key follows, then the bits. */
+};
+#define cc_share_key(e) ((byte *)((e) + 1))
+#define cc_share_bits(e) (cc_share_key(e) + (e)->key_size)
+
+typedef struct gx_char_cache_share_s {
+    gs_memory_t *memory;
+    gx_monitor_t *lock;
+    size_t max_size;
+    size_t size;
+    cc_share_entry *mru, *lru;
+    int64_t hits, misses, evictions;
+    cc_share_entry *table[CC_SHARE_TABLE_SIZE];
+} gx_char_cache_share;
+
+/* The fixed part of a key; XUID values and a glyph name follow it. */
+typedef struct cc_share_key_s {
+    long uid;			/* UniqueID, or -(size of XUID) */
+    gs_glyph glyph;		/* GS_NO_GLYPH for a named glyph */
+    float mxx, mxy, myx, myy;
+    gs_fixed_point subpix_origin;
+    int FontType;
+    int wmode, depth;
+    uint grid_fit_tt;
+    bool design_grid;
+    bool align_to_pixels;
+} cc_share_key;
+
+static void
+cc_share_unlink(gx_char_cache_share *share, cc_share_entry *e)
+{
+    if (e->prev != NULL)
+        e->prev->next = e->next;
+    else
+        share->mru = e->next;
+    if (e->next != NULL)
+        e->next->prev = e->prev;
+    else
+        share->lru = e->prev;
+}
+
+static void
+cc_share_link_mru(gx_char_cache_share *share, cc_share_entry *e)
+{
+    e->prev = NULL;
+    e->next = share->mru;
+    if (share->mru != NULL)
+        share->mru->prev = e;
+    else
+        share->lru = e;
+    share->mru = e;
+}
+
+/* Take least recently used entries out of the cache until it is within
+   size, and return them chained through hnext for freeing outside the
+   lock. */
+static cc_share_entry *
+cc_share_evict(gx_char_cache_share *share, size_t size)
+{
+    cc_share_entry *freed = NULL;
+
+    while (share->size > size && share->lru != NULL) {
+        cc_share_entry *e = share->lru;
+        cc_share_entry **pe = &share->table[e->hash & (CC_SHARE_TABLE_SIZE - 1)];
+
+        while (*pe != e)
+            pe = &(*pe)->hnext;
+        *pe = e->hnext;
+        cc_share_unlink(share, e);
+        share->size -= e->size;
+        share->evictions++;
+        e->hnext = freed;
+        freed = e;
+    }
+    return freed;
+}
+
+static void
+cc_share_free_entries(gx_char_cache_share *share, cc_share_entry *e)
+{
+    while (e != NULL) {
+        cc_share_entry *next = e->hnext;
+
+        gs_free_object(share->memory, e, "cc_share_free_entries");
+        e = next;
+    }
+}
+
+static void
+cc_share_free(void *vshare)
+{
+    gx_char_cache_share *share = (gx_char_cache_share *)vshare;
+
+    cc_share_free_entries(share, cc_share_evict(share, 0));
+    gx_monitor_free(share->lock);
+    gs_free_object(share->memory, share, "cc_share_free");
+}
+
+static gx_char_cache_share *
+cc_share_of(const gs_font_dir *dir)
+{
+    gx_char_cache_share *share =
+        (gx_char_cache_share *)dir->memory->gs_lib_ctx->core->char_cache_share;
+
+    return (share != NULL && share->max_size != 0 ? share : NULL);
+}
+
+/* Build the shared cache key of a character, and return its size, or 0 if
+   the character can't be shared. */
+static uint
+cc_share_make_key(const gs_font_dir *dir, gs_font *font,
+                  const cached_fm_pair *pair, gs_glyph glyph, int wmode,
+                  int depth, const gs_fixed_point *subpix_origin, byte *key)
+{
+    cc_share_key k;
+    uint size = sizeof(k);
+    gs_const_string gname;
+
+    if (!uid_is_valid(&pair->UID) || font == NULL || font->FontType == ft_composite ||
+        ((gs_font_base *)font)->UID_is_local)
+        return 0;
+    /* Zero the padding, since keys are compared as bytes. */
+    memset(&k, 0, sizeof(k));
+    k.uid = pair->UID.id;
+    if (uid_is_XUID(&pair->UID)) {
+        uint xsize = uid_XUID_size(&pair->UID) * sizeof(long);
+
+        if (uid_XUID_values(&pair->UID)[0] == CC_SHARE_PRIVATE_XUID ||
+            xsize > CC_SHARE_MAX_KEY - size)
+            return 0;
+        memcpy(key + size, uid_XUID_values(&pair->UID), xsize);
+        size += xsize;
+    }
+    if (glyph >= GS_MIN_CID_GLYPH)
+        k.glyph = glyph;
+    else {
+        k.glyph = GS_NO_GLYPH;
+        if (font->procs.glyph_name(font, glyph, &gname) < 0 ||
+            gname.size > CC_SHARE_MAX_KEY - size)
+            return 0;
+        memcpy(key + size, gname.data, gname.size);
+        size += gname.size;
+    }
+    k.mxx = pair->mxx, k.mxy = pair->mxy;
+    k.myx = pair->myx, k.myy = pair->myy;
+    k.subpix_origin = *subpix_origin;
+    k.FontType = pair->FontType;
+    k.wmode = wmode;
+    k.depth = depth;
+    k.grid_fit_tt = dir->grid_fit_tt;
+    k.design_grid = pair->design_grid;
+    k.align_to_pixels = dir->align_to_pixels;
+    memcpy(key, &k, sizeof(k));
+    return size;
+}
+
+static uint
+cc_share_hash(const byte *key, uint size)
+{
+    uint hash = 2166136261u;
+
+    while (size--)
+        hash = (hash ^ *key++) * 16777619u;
+    return hash;
+}
+
+static cc_share_entry *
+cc_share_find(gx_char_cache_share *share, const byte *key, uint key_size,
+              uint hash)
+{
+    cc_share_entry *e = share->table[hash & (CC_SHARE_TABLE_SIZE - 1)];
+
+    for (; e != NULL; e = e->hnext)
+        if (e->hash == hash && e->key_size == key_size &&
+            !memcmp(cc_share_key(e), key, key_size))
+            break;
+    return e;
+}
+
+/* Set the byte budget of the cache shared by the font directories of an
+   instance, creating the cache when it is first given a budget. */
+int
+gx_char_cache_share_set_size(gs_memory_t *mem, size_t size)
+{
+    gs_lib_ctx_core_t *core = mem->gs_lib_ctx->core;
+    gx_char_cache_share *share;
+    int code = 0;
+
+    gx_monitor_enter((gx_monitor_t *)core->monitor);
+    share = (gx_char_cache_share *)core->char_cache_share;
+    if (share == NULL && size != 0) {
+        share = (gx_char_cache_share *)
+            gs_alloc_bytes_immovable(core->memory, sizeof(*share),
+                                     "gx_char_cache_share_set_size");
+        if (share == NULL)
+            code = gs_note_error(gs_error_VMerror);
+        else {
+            memset(share, 0, sizeof(*share));
+            share->memory = core->memory;
+            share->lock = gx_monitor_label(gx_monitor_alloc(core->memory),
+                                           "char_cache_share");
+            if (share->lock == NULL) {
+                gs_free_object(core->memory, share, "gx_char_cache_share_set_size");
+                share = NULL;
+                code = gs_note_error(gs_error_VMerror);
+            } else {
+                core->char_cache_share = share;
+                core->char_cache_share_free = cc_share_free;
+            }
+        }
+    }
+    gx_monitor_leave((gx_monitor_t *)core->monitor);
+    if (share != NULL) {
+        cc_share_entry *freed;
+
+        gx_monitor_enter(share->lock);
+        share->max_size = size;
+        freed = cc_share_evict(share, size);
+        gx_monitor_leave(share->lock);
+        cc_share_free_entries(share, freed);
+    }
+    return code;
+}
+
+size_t
+gx_char_cache_share_size(gs_memory_t *mem)
+{
+    gx_char_cache_share *share =
+        (gx_char_cache_share *)mem->gs_lib_ctx->core->char_cache_share;
+
+    return (share != NULL ? share->max_size : 0);
+}
+
+void
+gx_char_cache_share_stats(gs_memory_t *mem, int64_t *hits, int64_t *misses,
+                          int64_t *evictions)
+{
+    gx_char_cache_share *share =
+        (gx_char_cache_share *)mem->gs_lib_ctx->core->char_cache_share;
+
+    *hits = *misses = *evictions = 0;
+    if (share != NULL) {
+        gx_monitor_enter(share->lock);
+        *hits = share->hits;
+        *misses = share->misses;
+        *evictions = share->evictions;
+        gx_monitor_leave(share->lock);
+    }
+}
+
+/* Look up a character that isn't in a directory's own cache in the shared
+   cache, and if it is there, copy it into the directory's cache. */
+/* Return the cached_char or 0. */
+cached_char *
+gx_lookup_shared_cached_char(gs_font *pfont, cached_fm_pair *pair,
+                             gs_glyph glyph, int wmode, int depth,
+                             const gs_fixed_point *subpix_origin)
+{
+    static const gs_log2_scale_point no_scale = {0, 0};
+    gs_font_dir *dir = pfont->dir;
+    gx_char_cache_share *share = cc_share_of(dir);
+    byte key[CC_SHARE_MAX_KEY];
+    uint key_size, hash;
+    cc_share_entry *e;
+    cached_char *cc = NULL;
+
+    if (share == NULL)
+        return 0;
+    key_size = cc_share_make_key(dir, pfont, pair, glyph, wmode, depth,
+                                 subpix_origin, key);
+    if (key_size == 0)
+        return 0;
+    hash = cc_share_hash(key, key_size);
+    gx_monitor_enter(share->lock);
+    e = cc_share_find(share, key, key_size, hash);
+    if (e == NULL) {
+        share->misses++;
+        gx_monitor_leave(share->lock);
+        return 0;
+    }
+    /* Respect this directory's own limit on the size of a character */
+    if (e->raster * e->height <= dir->ccache.upper &&
+        alloc_char(dir, sizeof_cached_char + e->raster * e->height, &cc) >= 0 &&
+        cc != NULL) {
+        cc_set_depth(cc, depth);
+        cc->xglyph = gx_no_xglyph;
+        cc->width = e->width;
+        cc->height = e->height;
+        cc->shift = 0;
+        cc_set_raster(cc, e->raster);
+        cc_set_pair_only(cc, 0);
+        cc->linked = false;
+        cc->code = glyph;
+        cc->wmode = wmode;
+        cc->subpix_origin = *subpix_origin;
+        cc->wxy = e->wxy;
+        cc->offset = e->offset;
+        memcpy(cc_bits(cc), cc_share_bits(e), e->raster * e->height);
+        cc_share_unlink(share, e);
+        cc_share_link_mru(share, e);
+        share->hits++;
+    }
+    gx_monitor_leave(share->lock);
+    if (cc == NULL)
+        return 0;
+    cc->id = gs_next_ids(dir->memory, 1);
+    if (gx_add_cached_char(dir, NULL, cc, pair, &no_scale) < 0) {
+        gx_free_cached_char(dir, cc);
+        return 0;
+    }
+    if_debug3m('K', dir->memory, "[K]shared "PRI_INTPTR" for glyph=0x%lx, wmode=%d\n",
+               (intptr_t)cc, (ulong)glyph, wmode);
+    return cc;
+}
+
+/* Copy a newly rendered character into the shared cache. */
+static void
+add_shared_cached_char(gs_font_dir *dir, const cached_char *cc,
+                       const cached_fm_pair *pair)
+{
+    gx_char_cache_share *share = cc_share_of(dir);
+    byte key[CC_SHARE_MAX_KEY];
+    uint key_size, bits_size = cc_raster(cc) * cc->height;
+    size_t size;
+    cc_share_entry *e, *freed;
+
+    if (share == NULL)
+        return;
+    key_size = cc_share_make_key(dir, pair->font, pair, cc->code, cc->wmode,
+                                 cc_depth(cc), &cc->subpix_origin, key);
+    if (key_size == 0)
+        return;
+    size = sizeof(*e) + key_size + bits_size;
+    if (size > share->max_size)
+        return;
+    e = (cc_share_entry *)gs_alloc_bytes(share->memory, size,
+                                         "add_shared_cached_char");
+    if (e == NULL)
+        return;
+    e->hash = cc_share_hash(key, key_size);
+    e->key_size = key_size;
+    e->size = size;
+    e->width = cc->width;
+    e->height = cc->height;
+    e->raster = cc_raster(cc);
+    e->wxy = cc->wxy;
+    e->offset = cc->offset;
+    memcpy(cc_share_key(e), key, key_size);
+    memcpy(cc_share_bits(e), cc_const_bits(cc), bits_size);
+    gx_monitor_enter(share->lock);
+    if (cc_share_find(share, key, key_size, e->hash) != NULL) {
+        /* Another directory got there first */
+        e->hnext = NULL;
+        freed = e;
+    } else {
+        cc_share_entry **pe = &share->table[e->hash & (CC_SHARE_TABLE_SIZE - 1)];
+
+        e->hnext = *pe;
+        *pe = e;
+        cc_share_link_mru(share, e);
+        share->size += size;
+        freed = cc_share_evict(share, share->max_size);
+    }
+    gx_monitor_leave(share->lock);
+    cc_share_free_entries(share, freed);
+}
+
 /* ------ Internal routines ------ */
 
 /* Allocate data space for a cached character, adding a new chunk if needed. */
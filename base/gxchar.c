@@ -1062,6 +1062,9 @@ show_proceed(gs_show_enum * penum)
                         }
                         cc = gx_lookup_cached_char(pfont, pair, glyph, wmode,
                                                    depth, &subpix_origin);
+                        if (cc == 0 && penum->can_cache > 0)
+                            cc = gx_lookup_shared_cached_char(pfont, pair, glyph, wmode,
+                                                              depth, &subpix_origin);
                     }
                     if (cc == 0) {
                         goto no_cache;
@@ -238,10 +238,8 @@ typedef enum {
   "disable_lop", "set_screen_phaseT", "set_screen_phaseS", "end_page",\
   "delta2_color0", "delta2_color1", "set_copy_color", "set_copy_alpha",
 
-#ifdef DEBUG
 extern const char *const cmd_op_names[16];
 extern const char *const *const cmd_sub_op_names[16];
-#endif
 
 /*
  * Define the size of the largest command, not counting any bitmap or
@@ -406,7 +404,9 @@ struct gx_clist_state_s {
         { 0, 0 }, /* cmd_list */\
         { 0, /* or */\
           0, /* slow rop */\
-          { { max_int, max_int }, /* p */ { min_int, min_int } /* q */ } /* trans_bbox */\
+          { { max_int, max_int }, /* p */ { min_int, min_int } /* q */ }, /* trans_bbox */\
+          0, /* cmd_bytes */\
+          0 /* high_cost_ops */\
         } /* color_usage */
 
 /* Define the size of the command buffer used for reading. */
@@ -846,6 +846,58 @@ int clist_playback_file_bands(clist_playback_action action,
                           gx_device_clist_reader *crdev,
                           gx_band_page_info_t *page_info, gx_device *target,
                           int band_first, int band_last, int x0, int y0);
+
+/*
+ * Playback profile, collected when the BandProfile device parameter is set.
+ * The main reader device and each rendering thread device have their own,
+ * and the threads' are merged into the main one when the threads are torn
+ * down.  Commands are indexed as for COLLECT_STATS_CLIST: the command byte,
+ * or 256 + the sub-opcode for cmd_opv_extend.  Times are in nanoseconds.
+ */
+#define CLIST_PROFILE_OPS 512
+#define CLIST_PROFILE_MAIN (-1)     /* band played back by the main device */
+#define CLIST_PROFILE_SEVERAL (-2)  /* band split between render threads */
+
+typedef struct clist_profile_totals_s {
+    int64_t time;
+    int64_t ops;
+    int bands;
+} clist_profile_totals_t;
+
+typedef struct clist_band_profile_s {
+    int64_t time;
+    int64_t ops;
+    int thread;                 /* render thread, or CLIST_PROFILE_MAIN/SEVERAL */
+} clist_band_profile_t;
+
+struct clist_playback_profile_s {
+    gs_memory_t *memory;
+    int thread;                 /* owner, render thread index or CLIST_PROFILE_MAIN */
+    int nbands;
+    int band;                   /* band being played back, -1 if none */
+    int op;                     /* command being timed, -1 if none */
+    long start[2];              /* when the current command started */
+    int64_t op_count[CLIST_PROFILE_OPS];
+    int64_t op_time[CLIST_PROFILE_OPS];
+    clist_band_profile_t *bands;        /* [nbands] */
+    clist_profile_totals_t totals;      /* for bands played back by the owner */
+    int num_threads;
+    clist_profile_totals_t *threads;    /* merged thread totals (main only) */
+};
+
+clist_playback_profile_t *clist_playback_profile_alloc(gs_memory_t *mem,
+                                                       int nbands, int thread);
+void clist_playback_profile_free(clist_playback_profile_t *prof);
+int clist_playback_profile_merge(clist_playback_profile_t *prof,
+                                 const clist_playback_profile_t *from);
+void clist_playback_profile_report(gx_device_clist_reader *crdev, int format);
+
+/* Rendered bands of recent pages, kept when DuplicatePageCache is set (gxclpage.c). */
+void clist_page_cache_free(clist_page_cache_t *cache);
+bool clist_page_cache_is_complete(gx_device_clist_reader *crdev);
+bool clist_page_cache_get_band(gx_device_clist_reader *crdev, int band, byte *mdata);
+void clist_page_cache_put_band(gx_device_clist_reader *crdev, int band, const byte *mdata);
+
 #ifdef DEBUG
 int64_t clist_file_offset(const stream_state *st, uint buffer_offset);
 void top_up_offset_map(stream_state * st, const byte *buf, const byte *ptr, const byte *end);
@@ -858,6 +910,20 @@ int clist_writer_pop_cropping(gx_device_clist_writer *cdev);
 int clist_writer_check_empty_cropping_stack(gx_device_clist_writer *cdev);
 int clist_read_icctable(gx_device_clist_reader *crdev);
 int clist_read_color_usage_array(gx_device_clist_reader *crdev);
+
+/* A band is rendered in sub-bands if its estimated cost is at least this */
+/* many times the page average, and at least CLIST_SPLIT_MIN_COST. Each   */
+/* part is at least CLIST_SPLIT_MIN_LINES lines high. The cost estimate   */
+/* is the size of the band's own commands plus a fixed amount for each    */
+/* image and transparency compositor op, as recorded by the writer.       */
+#define CLIST_SPLIT_COST_RATIO 2
+#define CLIST_SPLIT_MIN_COST (256 * 1024)
+#define CLIST_SPLIT_MIN_LINES 16
+#define CLIST_HIGH_COST_OP_BYTES 4096
+#define CLIST_MAX_BAND_PARTS 4
+#define CLIST_BAND_COST(u)\
+  ((u)->cmd_bytes + (int64_t)(u)->high_cost_ops * CLIST_HIGH_COST_OP_BYTES)
+int clist_band_parts(const gx_device_clist_reader *crdev, int band);
 int clist_read_op_equiv_cmyk_colors(gx_device_clist_reader *crdev,
     equivalent_cmyk_color_params *op_equiv);
 
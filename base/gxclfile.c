@@ -217,6 +217,17 @@ cl_cache_load_slot(CL_CACHE *cache, CL_CACHE_SLOT *slot, int64_t pos, byte *data
  * to be addressed via DELETE_ON_CLOSE under Windows, and immediate unlink
  * after opening under Linux. When running in this mode, we keep our own
  * record of position within the file for the sake of thread safety
+ *
+ * In this mode, once writing is done the file is mapped into memory when
+ * it is first read, and reads are served from the mapping rather than the
+ * cache. Each handle (including those cloned for the rendering threads)
+ * has its own mapping, but they all share the pages of the OS file cache,
+ * so there is no per-thread cache of the file and no read system calls.
+ * Reads still copy from the mapping into the caller's buffer: the band
+ * reading stream puts each band together from blocks spread through the
+ * file, so the commands can't be played back from the mapping in place.
+ * If the file can't be mapped (e.g. it doesn't fit in the address space)
+ * we fall back to the cache.
  */
 
 #define ENC_FILE_STR ("encoded_file_ptr_%p")
@@ -229,8 +240,30 @@ typedef struct
     int64_t pos;
     int64_t filesize;		/* filesize maintained by clist_fwrite */
     CL_CACHE *cache;
+    byte *map;			/* read-only mapping of the file, or NULL */
+    int64_t map_size;		/* size mapped, < 0 if mapping failed */
 } IFILE;
 
+/* Map the file for reading, if that hasn't already been tried */
+static void
+clist_map_file(IFILE *ifile)
+{
+    if (ifile->map != NULL || ifile->map_size < 0 || ifile->filesize == 0)
+        return;
+    ifile->map = gp_fmap(ifile->f, ifile->filesize);
+    ifile->map_size = (ifile->map != NULL ? ifile->filesize : -1);
+}
+
+/* Drop the mapping when the file is written or discarded */
+static void
+clist_unmap_file(IFILE *ifile)
+{
+    if (ifile->map != NULL)
+        gp_funmap(ifile->map, ifile->map_size);
+    ifile->map = NULL;
+    ifile->map_size = 0;
+}
+
 static void
 file_to_fake_path(clist_file_ptr file, char fname[gp_file_name_sizeof])
 {
@@ -262,6 +295,8 @@ static IFILE *wrap_file(gs_memory_t *mem, gp_file *f, const char *fmode)
     ifile->pos = 0;
     ifile->filesize = 0;
     ifile->cache = cl_cache_alloc(ifile->mem);
+    ifile->map = NULL;
+    ifile->map_size = 0;
     return ifile;
 }
 
@@ -269,6 +304,7 @@ static int clist_close_file(IFILE *ifile)
 {
     int res = 0;
     if (ifile) {
+        clist_unmap_file(ifile);
         if (ifile->f != NULL)
             res = gp_fclose(ifile->f);
         if (ifile->cache != NULL)
@@ -368,6 +404,7 @@ clist_fwrite_chars(const void *data, uint len, clist_file_ptr cf)
     if (res >= 0)
         icf->pos += len;
     icf->filesize = icf->pos;	/* write truncates file */
+    clist_unmap_file(icf);
     if (!CL_CACHE_NEEDS_INIT(icf->cache)) {
         /* writing invalidates the read cache */
         cl_cache_destroy(icf->cache);
@@ -387,6 +424,13 @@ clist_fread_chars(void *data, uint len, clist_file_ptr cf)
         IFILE *icf = (IFILE *)cf;
         byte *dp = data;
 
+        clist_map_file(icf);
+        if (icf->map != NULL && icf->pos < icf->map_size) {
+            nread = (int)min((int64_t)len, icf->map_size - icf->pos);
+            memcpy(data, icf->map + icf->pos, nread);
+            icf->pos += nread;
+            return nread;
+        }
         /* if we have a cache, check if it needs init, and do it */
         if (CL_CACHE_NEEDS_INIT(icf->cache)) {
             icf->cache = cl_cache_read_init(icf->cache, CL_CACHE_NSLOTS, 1<<CL_CACHE_SLOT_SIZE_LOG2, icf->filesize);
@@ -484,6 +528,7 @@ clist_rewind(clist_file_ptr cf, bool discard_data, const char *fname)
              * new scratch file. */
             char tfname[gp_file_name_sizeof] = {0};
             const gs_memory_t *mem = ocf->f->memory;
+            clist_unmap_file(ocf);
             gp_fclose(ocf->f);
             ocf->f = gp_open_scratch_file_rm(mem, gp_scratch_file_name_prefix, tfname, fmode);
             if (ocf->f == NULL)
@@ -509,6 +554,7 @@ clist_rewind(clist_file_ptr cf, bool discard_data, const char *fname)
              */
 
             /* Opening with "w" mode deletes the contents when closing. */
+            clist_unmap_file((IFILE *)cf);
             f = gp_freopen(fname, gp_fmode_wb, f);
             if (f == NULL) return_error(gs_error_ioerror);
             ((IFILE *)cf)->f = gp_freopen(fname, fmode, f);
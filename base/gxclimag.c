@@ -1196,6 +1196,7 @@ clist_image_plane_data(gx_image_enum_common_t * info,
 
             /* Mark band's begin_image as known */
             re.pcls->known |= begin_image_known;
+            re.pcls->color_usage.high_cost_ops++;
         }
 
         /*
@@ -1446,6 +1447,8 @@ clist_composite(gx_device * dev,
             }
             if (code < 0)
                 return code;
+            if (gs_is_pdf14trans_compositor(pcte))
+                re.pcls->color_usage.high_cost_ops++;
         } while ((re.y += re.height) < re.yend);
     }
     if (cropping_op == POPCROP) {
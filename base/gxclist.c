@@ -54,8 +54,8 @@ ENUM_PTRS_WITH(device_clist_enum_ptrs, gx_device_clist *cdev)
         return (ret ? ret : ENUM_OBJ(0));
     }
     index -= st_device_forward_max_ptrs;
-    /* RJW: We do not enumerate icc_cache_cl or icc_cache_list as they
-     * are allocated in non gc space */
+    /* RJW: We do not enumerate icc_cache_cl, icc_cache_list, render_pool,
+     * playback_profile or page_cache as they are allocated in non gc space */
     if (CLIST_IS_WRITER(cdev)) {
         switch (index) {
         case 0: return ENUM_OBJ((cdev->writer.image_enum_id != gs_no_id ?
@@ -610,6 +610,11 @@ static void
 clist_reset_page(gx_device_clist_writer *cwdev)
 {
     cwdev->page_bfile_end_pos = 0;
+    /* Only pages that start with empty band files can be identified */
+    /* by their commands, see clist_end_page. */
+    cwdev->page_hashing = cwdev->band_params.DuplicatePageCache != 0;
+    if (cwdev->page_hashing)
+        gs_md5_init(&cwdev->page_md5);
 }
 
 /* Open the device's bandfiles */
@@ -698,6 +703,10 @@ clist_open(gx_device *dev)
 
     cdev->icc_cache_list_len = 0;
     cdev->icc_cache_list = NULL;
+    cdev->render_pool = NULL;
+    cdev->playback_profile = NULL;
+    cdev->page_cache = NULL;
+    cdev->page_hashing = false;
     code = clist_open_output_file(dev);
     if ( code >= 0)
         code = clist_emit_page_header(dev);
@@ -725,6 +734,11 @@ clist_close(gx_device *dev)
      * in *2* places, once in gdev_prn_tear_down() for regular clists, and once in
      * gx_pattern_cache_free_entry() for pattern clists....
      */
+    clist_free_render_pool(dev);
+    clist_playback_profile_free(cdev->playback_profile);
+    cdev->playback_profile = NULL;
+    clist_page_cache_free(cdev->page_cache);
+    cdev->page_cache = NULL;
     for(i = 0; i < cdev->icc_cache_list_len; i++) {
         rc_decrement(cdev->icc_cache_list[i], "clist_close");
     }
@@ -775,6 +789,11 @@ clist_finish_page(gx_device *dev, bool flush)
         gx_device_clist_reader * const crdev =  &((gx_device_clist *)dev)->reader;
 
         clist_teardown_render_threads(dev);
+        if (crdev->playback_profile != NULL) {
+            clist_playback_profile_report(crdev, crdev->space_params.band.BandProfile);
+            clist_playback_profile_free(crdev->playback_profile);
+            crdev->playback_profile = NULL;
+        }
         gs_free_object(cdev->memory, crdev->color_usage_array, "clist_color_usage_array");
         crdev->color_usage_array = NULL;
 
@@ -802,6 +821,8 @@ clist_finish_page(gx_device *dev, bool flush)
             cdev->page_info.io_procs->fseek(cdev->page_cfile, 0L, SEEK_END, cdev->page_cfname);
         if (cdev->page_bfile != 0)
             cdev->page_info.io_procs->fseek(cdev->page_bfile, 0L, SEEK_END, cdev->page_bfname);
+        /* The next page shares the band files, so it has no signature. */
+        cdev->page_hashing = false;
     }
     code = clist_init(dev);             /* reinitialize */
     if (code >= 0)
@@ -812,6 +833,69 @@ clist_finish_page(gx_device *dev, bool flush)
 
 /* ------ Writing ------ */
 
+#define PAGE_MD5_APPEND(cldev, v)\
+    gs_md5_append(&(cldev)->page_md5, (const gs_md5_byte_t *)&(v), sizeof(v))
+
+/* Add the device settings the reader renders the band list with to the */
+/* page's DuplicatePageCache signature. Halftones and transfer functions */
+/* are in the band list itself. */
+static void
+clist_page_signature_params(gx_device_clist_writer *cldev)
+{
+    const gx_device_color_info *ci = &cldev->color_info;
+    cmm_dev_profile_t *dev_profile;
+    int64_t hash;
+    uint accuracy = gsicc_currentcoloraccuracy(cldev->memory);
+    int i;
+
+    PAGE_MD5_APPEND(cldev, cldev->HWResolution[0]);
+    PAGE_MD5_APPEND(cldev, cldev->HWResolution[1]);
+    PAGE_MD5_APPEND(cldev, ci->max_components);
+    PAGE_MD5_APPEND(cldev, ci->num_components);
+    PAGE_MD5_APPEND(cldev, ci->polarity);
+    PAGE_MD5_APPEND(cldev, ci->depth);
+    PAGE_MD5_APPEND(cldev, ci->gray_index);
+    PAGE_MD5_APPEND(cldev, ci->max_gray);
+    PAGE_MD5_APPEND(cldev, ci->max_color);
+    PAGE_MD5_APPEND(cldev, ci->dither_grays);
+    PAGE_MD5_APPEND(cldev, ci->dither_colors);
+    PAGE_MD5_APPEND(cldev, ci->use_antidropout_downscaler);
+    PAGE_MD5_APPEND(cldev, accuracy);
+    if (dev_proc(cldev, get_profile)((gx_device *)cldev, &dev_profile) < 0 ||
+        dev_profile == NULL)
+        return;
+    for (i = 0; i < NUM_DEVICE_PROFILES; i++) {
+        const gsicc_rendering_param_t *rc = &dev_profile->rendercond[i];
+
+        hash = dev_profile->device_profile[i] != NULL ?
+            gsicc_get_hash(dev_profile->device_profile[i]) : 0;
+        PAGE_MD5_APPEND(cldev, hash);
+        PAGE_MD5_APPEND(cldev, rc->rendering_intent);
+        PAGE_MD5_APPEND(cldev, rc->black_point_comp);
+        PAGE_MD5_APPEND(cldev, rc->preserve_black);
+        PAGE_MD5_APPEND(cldev, rc->graphics_type_tag);
+        PAGE_MD5_APPEND(cldev, rc->cmm);
+        PAGE_MD5_APPEND(cldev, rc->override_icc);
+    }
+    hash = dev_profile->proof_profile != NULL ? gsicc_get_hash(dev_profile->proof_profile) : 0;
+    PAGE_MD5_APPEND(cldev, hash);
+    hash = dev_profile->link_profile != NULL ? gsicc_get_hash(dev_profile->link_profile) : 0;
+    PAGE_MD5_APPEND(cldev, hash);
+    hash = dev_profile->oi_profile != NULL ? gsicc_get_hash(dev_profile->oi_profile) : 0;
+    PAGE_MD5_APPEND(cldev, hash);
+    hash = dev_profile->blend_profile != NULL ? gsicc_get_hash(dev_profile->blend_profile) : 0;
+    PAGE_MD5_APPEND(cldev, hash);
+    hash = dev_profile->postren_profile != NULL ? gsicc_get_hash(dev_profile->postren_profile) : 0;
+    PAGE_MD5_APPEND(cldev, hash);
+    PAGE_MD5_APPEND(cldev, dev_profile->devicegraytok);
+    PAGE_MD5_APPEND(cldev, dev_profile->graydetection);
+    PAGE_MD5_APPEND(cldev, dev_profile->usefastcolor);
+    PAGE_MD5_APPEND(cldev, dev_profile->blacktext);
+    PAGE_MD5_APPEND(cldev, dev_profile->supports_devn);
+    PAGE_MD5_APPEND(cldev, dev_profile->overprint_control);
+    PAGE_MD5_APPEND(cldev, dev_profile->prebandthreshold);
+}
+
 /* End a page by flushing the buffer and terminating the command list. */
 int     /* ret 0 all-ok, -ve error code, or +1 ok w/low-mem warning */
 clist_end_page(gx_device_clist_writer * cldev)
@@ -860,6 +944,16 @@ clist_end_page(gx_device_clist_writer * cldev)
     } else
         ecode = code;
 
+    /* Identify the page for the DuplicatePageCache by the MD5 of its commands, */
+    /* and the settings they are rendered with. */
+    cldev->page_info.signature_valid = false;
+    if (cldev->page_hashing && ecode >= 0) {
+        clist_page_signature_params(cldev);
+        gs_md5_finish(&cldev->page_md5, cldev->page_info.signature);
+        cldev->page_info.signature_valid = true;
+    }
+    cldev->page_hashing = false;
+
     /* Reset warning margin to 0 to release reserve memory if mem files */
     if (cldev->page_bfile != 0)
         cldev->page_info.io_procs->set_memory_warning(cldev->page_bfile, 0);
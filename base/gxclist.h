@@ -30,6 +30,7 @@
 #include "gxrplane.h"
 #include "gscms.h"
 #include "gxcomp.h"
+#include "gsmd5.h"
 
 /*
  * A command list is essentially a compressed list of driver calls.
@@ -170,6 +171,11 @@ typedef struct cmd_list_s {
  */
 typedef struct gx_clist_state_s gx_clist_state;
 
+typedef struct clist_render_pool_s clist_render_pool_t;
+typedef struct clist_playback_profile_s clist_playback_profile_t;
+typedef struct clist_page_cache_s clist_page_cache_t;
+typedef struct clist_cached_page_s clist_cached_page_t;
+
 #define gx_device_clist_common_members\
         gx_device_forward_common;	/* (see gxdevice.h) */\
                 /* Following must be set before writing or reading. */\
@@ -202,7 +208,12 @@ typedef struct gx_clist_state_s gx_clist_state;
                                            file location. */\
         gsicc_link_cache_t *icc_cache_cl; /* Link cache */\
         int icc_cache_list_len;         /* Length of list of caches, one per rendering thread */\
-        gsicc_link_cache_t **icc_cache_list  /* Link cache list */
+        gsicc_link_cache_t **icc_cache_list;  /* Link cache list */\
+        clist_render_pool_t *render_pool;  /* Persistent rendering threads */\
+        clist_playback_profile_t *playback_profile; /* Band playback timings, */\
+                                        /* NULL unless BandProfile is set */\
+        clist_page_cache_t *page_cache  /* Rendered bands of recent pages, */\
+                                        /* NULL unless DuplicatePageCache is set */
 
 /* Define a structure to hold where the ICC profiles are stored in the clist
    Profiles are added into psuedo bands of the clist, these are bands that exist beyond
@@ -368,6 +379,8 @@ struct gx_device_clist_writer_s {
                                            information */
     bool op_fill_active;   /* Needed so we know state during clist writing */
     bool op_stroke_active; /* Needed so we know state during clist writing  */
+    bool page_hashing;		/* accumulating page_md5 for DuplicatePageCache */
+    gs_md5_state_t page_md5;	/* MD5 of the band list written so far */
 
 };
 
@@ -381,6 +394,8 @@ struct gx_device_clist_writer_s {
 #define clist_disable_copy_alpha (1 << 6) /* target does not support copy_alpha */
 
 typedef struct clist_render_thread_control_s clist_render_thread_control_t;
+typedef struct clist_band_reorder_slot_s clist_band_reorder_slot_t;
+typedef struct clist_split_band_s clist_split_band_t;
 
 /* Define the state of a band list when reading. */
 /* For normal rasterizing, pages and num_pages are both 0. */
@@ -395,9 +410,19 @@ typedef struct gx_device_clist_reader_s {
     int num_render_threads;		/* number of threads being used */
     clist_render_thread_control_t *render_threads;	/* array of threads */
     byte *main_thread_data;		/* saved data pointer of main thread */
-    int curr_render_thread;		/* index into array */
     int thread_lookahead_direction;	/* +1 or -1 */
     int next_band;			/* may be < 0 or >= num bands when no more remain to render */
+    gx_monitor_t *band_queue_lock;	/* protects next_band, thread status and the reorder buffer */
+    gx_semaphore_t *sema_band_done;	/* signalled whenever a thread finishes a band */
+    int num_reorder_slots;
+    clist_band_reorder_slot_t *reorder_slots;	/* bands rendered ahead of need */
+    int64_t band_cost_average;		/* for clist_band_parts, set with the color_usage_array */
+    int next_part;			/* next sub-band of next_band, 0 unless part way through */
+    int num_split_bands;
+    clist_split_band_t *split_bands;	/* heavy bands being rendered in parts */
+    bool rendering_band_part;		/* a thread device rendering one part of a split band */
+    bool page_cache_checked;		/* page_cache has been searched for this page */
+    clist_cached_page_t *cached_page;	/* page_cache entry being reused or filled */
 
 } gx_device_clist_reader;
 
@@ -552,6 +577,10 @@ clist_enable_multi_thread_render(gx_device *dev);
 void
 clist_teardown_render_threads(gx_device *dev);
 
+/* Stop the persistent rendering threads kept by the device across pages */
+void
+clist_free_render_pool(gx_device *dev);
+
 /* Minimum BufferSpace needed when writing the clist */
 /* This is an exported function because it is used to set up render threads */
 /* and in clist_init_states to make sure the buffer is large enough */
@@ -19,6 +19,7 @@
 #include "gx.h"
 #include "gserrors.h"
 #include "gxclmem.h"
+#include "gxsync.h"
 #include "gssprintf.h"
 
 #include "valgrind.h"
@@ -68,6 +69,13 @@ COMPRESSION.
    used during subsequent compression when the last logical block of the
    file fills the physical block.
 
+   If threads are available (and the data allocator is thread safe), the
+   compression itself is done by a background thread, so the writer only
+   queues filled blocks and carries on with a new raw block. Blocks that
+   are queued but not yet compressed still have their raw physical block,
+   so anything that walks the physical chain must first wait for the queue
+   to drain (memfile_async_sync).
+
 DECOMPRESSION.
 
    During reading the clist, if the logical block points to an uncompressed
@@ -90,6 +98,10 @@ DECOMPRESSION.
    decompression buffer list in order to keep the tail of the list as the
    "least recently used".
 
+   When a background thread is available, the block following the one just
+   accessed is decompressed ahead of time into a spare raw buffer, which is
+   swapped into the cache when the reader gets to that block.
+
    There are some DEBUG global static variables used to count the number of
    cache hits "tot_cache_hits" and the number of times a logical block is
    decompressed "tot_cache_miss". Note that the actual number of cache miss
@@ -159,6 +171,11 @@ static const int64_t COMPRESSION_THRESHOLD =
 #define FREE(f, obj, cname)\
   do {gs_free_object((f)->data_memory, obj, cname);\
     (f)->total_space -= sizeof(*(obj));} while (0)
+/* FREE, for use when a compression thread may be allocating at the same time */
+#define FREE_LOCKED(f, obj, cname)\
+  do {if ((f)->async != NULL) gx_monitor_enter((f)->async->lock);\
+    FREE(f, obj, cname);\
+    if ((f)->async != NULL) gx_monitor_leave((f)->async->lock);} while (0)
 
 /* Structure descriptor for GC */
 private_st_MEMFILE();
@@ -169,6 +186,9 @@ static int memfile_init_empty(MEMFILE * f);
 static int memfile_set_memory_warning(clist_file_ptr cf, int bytes_left);
 static int memfile_fclose(clist_file_ptr cf, const char *fname, bool delete);
 static int memfile_get_pdata(MEMFILE * f);
+static int compress_log_blk(MEMFILE * f, LOG_MEMFILE_BLK * bp);
+static int memfile_decompress_blk(MEMFILE * f, stream_state * st,
+                                  LOG_MEMFILE_BLK * bp, char *dest);
 
 /************************************************/
 /*   #define DEBUG      /- force statistics -/  */
@@ -192,6 +212,42 @@ const byte *decomp_rd_ptr1, *decomp_rd_limit1;
 
 #endif
 
+/* ----------------------------- Background (de)compression ----------- */
+
+/*
+ * A background thread that compresses the blocks of a file being written,
+ * and decompresses ahead of a file being read.  The thread only allocates
+ * from data_memory when compressing (in which case data_memory must be
+ * thread safe), and all allocations on that allocator, along with the
+ * reserve chains and total_space, are then made with 'lock' held.
+ */
+
+/* Max number of blocks queued for compression before the writer waits. */
+#define MEMFILE_ASYNC_MAX_PENDING 16
+
+typedef struct MEMFILE_ASYNC_s {
+    MEMFILE *f;
+    gs_memory_t *memory;	/* thread safe allocator for this and its parts */
+    gx_monitor_t *lock;		/* protects everything below */
+    gx_semaphore_t *wake;	/* signalled when work is queued, or to quit */
+    gx_semaphore_t *done;	/* signalled when the thread finishes some work */
+    gp_thread_id thread;
+    bool quit;
+    bool waiting;		/* client is waiting on 'done' */
+    /* Compression (writer instances only) */
+    LOG_MEMFILE_BLK *compress_next;	/* next block to compress */
+    LOG_MEMFILE_BLK *compress_limit;	/* block being written, NULL if not compressing */
+    int pending;		/* # of blocks from compress_next to compress_limit */
+    int ecode;			/* -ve error, or accumulated low-memory warnings */
+    /* Decompression ahead of the reader */
+    bool prefetch_failed;	/* couldn't allocate the prefetch buffer */
+    bool prefetch_done;
+    int prefetch_code;
+    LOG_MEMFILE_BLK *prefetch_blk;	/* block being (or been) decompressed, or NULL */
+    RAW_BUFFER *prefetch_buf;	/* allocated on f->data_memory */
+    stream_state *decompress_state;
+} MEMFILE_ASYNC;
+
 /* ----------------------------- Memory Allocation --------------------- */
 static void *   /* allocated memory's address, 0 if failure */
 allocateWithReserve(
@@ -203,8 +259,11 @@ allocateWithReserve(
 )
 {
     int code = 0;       /* assume success */
-    void *block = MALLOC(f, sizeofBlock, allocName);
+    void *block;
 
+    if (f->async != NULL)
+        gx_monitor_enter(f->async->lock);
+    block = MALLOC(f, sizeofBlock, allocName);
     if (block == NULL) {
         /* Try to recover block from reserve */
         if (sizeofBlock == sizeof(LOG_MEMFILE_BLK)) {
@@ -229,10 +288,287 @@ allocateWithReserve(
         f->total_space += sizeofBlock;
     else
         code = gs_note_error(gs_error_VMerror);
+    if (f->async != NULL)
+        gx_monitor_leave(f->async->lock);
     *return_code = code;
     return block;
 }
 
+/* ---------------- Background thread ---------------- */
+
+/* Wait, with the lock held, until the thread next finishes some work. */
+static void
+memfile_async_wait(MEMFILE_ASYNC *a)
+{
+    a->waiting = true;
+    gx_monitor_leave(a->lock);
+    gx_semaphore_wait(a->done);
+    gx_monitor_enter(a->lock);
+}
+
+static void
+memfile_async_proc(void *data)
+{
+    MEMFILE_ASYNC *a = (MEMFILE_ASYNC *)data;
+    MEMFILE *f = a->f;
+    int code;
+
+    gx_monitor_enter(a->lock);
+    while (!a->quit) {
+        if (a->compress_next != a->compress_limit) {
+            LOG_MEMFILE_BLK *bp = a->compress_next;
+            PHYS_MEMFILE_BLK *oldphys = bp->phys_blk;
+
+            /* Once we've had an error, just let the queue drain. */
+            if (a->ecode >= 0) {
+                gx_monitor_leave(a->lock);
+                code = compress_log_blk(f, bp);
+                gx_monitor_enter(a->lock);
+                if (code >= 0) {
+                    FREE(f, oldphys, "memfile_async_proc(oldphys)");
+                    a->ecode |= code;   /* accumulate low-memory warnings */
+                } else
+                    a->ecode = code;
+            }
+            a->compress_next = bp->link;
+            a->pending--;
+        } else if (a->prefetch_blk != NULL && !a->prefetch_done) {
+            LOG_MEMFILE_BLK *bp = a->prefetch_blk;
+
+            gx_monitor_leave(a->lock);
+            code = memfile_decompress_blk(f, a->decompress_state, bp,
+                                          a->prefetch_buf->data);
+            gx_monitor_enter(a->lock);
+            a->prefetch_code = code;
+            a->prefetch_done = true;
+        } else {
+            /* Nothing to do. */
+            if (a->waiting) {
+                a->waiting = false;
+                gx_semaphore_signal(a->done);
+            }
+            gx_monitor_leave(a->lock);
+            gx_semaphore_wait(a->wake);
+            gx_monitor_enter(a->lock);
+            continue;
+        }
+        if (a->waiting) {
+            a->waiting = false;
+            gx_semaphore_signal(a->done);
+        }
+    }
+    gx_monitor_leave(a->lock);
+}
+
+/* Start the background thread for a file, if possible. */
+static bool     /* returns true if the thread is running */
+memfile_async_start(MEMFILE *f)
+{
+    gs_memory_t *mem = f->memory->thread_safe_memory;
+    MEMFILE_ASYNC *a;
+
+    if (f->async != NULL)
+        return true;
+    if (f->async_failed || mem == NULL)
+        return false;
+    a = (MEMFILE_ASYNC *)gs_alloc_bytes(mem, sizeof(*a), "memfile_async_start");
+    if (a == NULL)
+        goto fail;
+    memset(a, 0, sizeof(*a));
+    a->f = f;
+    a->memory = mem;
+    a->lock = gx_monitor_label(gx_monitor_alloc(mem), "memfile_async lock");
+    a->wake = gx_semaphore_label(gx_semaphore_alloc(mem), "memfile_async wake");
+    a->done = gx_semaphore_label(gx_semaphore_alloc(mem), "memfile_async done");
+    if (a->lock == NULL || a->wake == NULL || a->done == NULL ||
+        gp_thread_start(memfile_async_proc, a, &a->thread) < 0) {
+        if (a->done != NULL)
+            gx_semaphore_free(a->done);
+        if (a->wake != NULL)
+            gx_semaphore_free(a->wake);
+        if (a->lock != NULL)
+            gx_monitor_free(a->lock);
+        gs_free_object(mem, a, "memfile_async_start");
+        goto fail;
+    }
+    gp_thread_label(a->thread, "memfile compressor");
+    f->async = a;
+    return true;
+
+fail:
+    /* Not fatal, we just do the work synchronously. */
+    f->async_failed = true;
+    return false;
+}
+
+/* Stop the background thread. Any queued compression must be synced first. */
+static void
+memfile_async_stop(MEMFILE *f)
+{
+    MEMFILE_ASYNC *a = f->async;
+
+    if (a == NULL)
+        return;
+    gx_monitor_enter(a->lock);
+    a->quit = true;
+    gx_monitor_leave(a->lock);
+    gx_semaphore_signal(a->wake);
+    gp_thread_finish(a->thread);
+    f->async = NULL;
+
+    if (a->prefetch_buf != NULL)
+        FREE(f, a->prefetch_buf, "memfile_async_stop(prefetch_buf)");
+    if (a->decompress_state != NULL) {
+        if (a->decompress_state->templat->release != 0)
+            (*a->decompress_state->templat->release) (a->decompress_state);
+        gs_free_object(a->memory, a->decompress_state,
+                       "memfile_async_stop(decompress_state)");
+    }
+    gx_semaphore_free(a->done);
+    gx_semaphore_free(a->wake);
+    gx_monitor_free(a->lock);
+    gs_free_object(a->memory, a, "memfile_async_stop");
+}
+
+/*
+ * Queue blocks for compression: the blocks from 'first' (or from where the
+ * thread has got to, if 'first' is NULL) up to but not including 'limit'.
+ * Returns the status of the compression done so far.
+ */
+static int      /* ret 0 ok, -ve error, or +ve low-memory warning */
+memfile_async_queue(MEMFILE *f, LOG_MEMFILE_BLK *first, LOG_MEMFILE_BLK *limit,
+                    int count)
+{
+    MEMFILE_ASYNC *a = f->async;
+    int code;
+
+    gx_monitor_enter(a->lock);
+    if (first != NULL)
+        a->compress_next = first;
+    a->compress_limit = limit;
+    a->pending += count;
+    gx_semaphore_signal(a->wake);
+    /* Don't let the writer get too far ahead of the compressor. */
+    if (a->pending > MEMFILE_ASYNC_MAX_PENDING)
+        while (a->pending > MEMFILE_ASYNC_MAX_PENDING / 2)
+            memfile_async_wait(a);
+    code = a->ecode;
+    if (code > 0)
+        a->ecode = 0;       /* only report low-memory warnings once */
+    gx_monitor_leave(a->lock);
+    return code;
+}
+
+/* Wait until all the blocks queued for compression have been compressed. */
+static int      /* ret 0 ok, -ve error, or +ve low-memory warning */
+memfile_async_sync(MEMFILE *f)
+{
+    MEMFILE_ASYNC *a = f->async;
+    int code;
+
+    if (a == NULL || a->compress_limit == NULL)
+        return 0;
+    gx_monitor_enter(a->lock);
+    while (a->pending > 0)
+        memfile_async_wait(a);
+    code = a->ecode;
+    if (code > 0)
+        a->ecode = 0;
+    gx_monitor_leave(a->lock);
+    return code;
+}
+
+/* Start decompressing bp in the background, if the thread is idle. */
+static void
+memfile_async_prefetch(MEMFILE *f, LOG_MEMFILE_BLK *bp)
+{
+    MEMFILE_ASYNC *a = f->async;
+
+    if (bp == NULL || bp->phys_blk->data_limit == NULL ||
+        bp->raw_block != NULL || a->prefetch_failed)
+        return;
+    if (a->prefetch_buf == NULL) {
+        /* First time: allocate the buffer and the decompressor. */
+        const stream_template *decompress_template = clist_decompressor_template();
+        int code = 0;
+
+        a->prefetch_buf = MALLOC(f, sizeof(RAW_BUFFER), "memfile prefetch buffer");
+        a->decompress_state =
+            gs_alloc_struct(a->memory, stream_state, decompress_template->stype,
+                            "memfile_async_prefetch(decompress_state)");
+        if (a->prefetch_buf != NULL)
+            f->total_space += sizeof(RAW_BUFFER);
+        if (a->decompress_state != NULL) {
+            clist_decompressor_init(a->decompress_state);
+            a->decompress_state->memory = a->memory;
+            if (decompress_template->set_defaults)
+                (*decompress_template->set_defaults) (a->decompress_state);
+            if (decompress_template->init != 0)
+                code = (*decompress_template->init) (a->decompress_state);
+            if (code < 0) {
+                gs_free_object(a->memory, a->decompress_state,
+                               "memfile_async_prefetch(decompress_state)");
+                a->decompress_state = NULL;
+            }
+        }
+        if (a->prefetch_buf == NULL || a->decompress_state == NULL) {
+            a->prefetch_failed = true;
+            return;
+        }
+    }
+    gx_monitor_enter(a->lock);
+    if (a->prefetch_blk == NULL || a->prefetch_done) {
+        a->prefetch_blk = bp;
+        a->prefetch_done = false;
+        gx_semaphore_signal(a->wake);
+    }
+    gx_monitor_leave(a->lock);
+}
+
+/*
+ * If bp has been (or is being) decompressed in the background, put its
+ * data at the head of the raw buffer list, recycling the tail buffer as the
+ * next prefetch buffer.
+ */
+static bool
+memfile_async_take_prefetch(MEMFILE *f, LOG_MEMFILE_BLK *bp)
+{
+    MEMFILE_ASYNC *a = f->async;
+    RAW_BUFFER *buf;
+    bool ok;
+
+    gx_monitor_enter(a->lock);
+    if (a->prefetch_blk != bp) {
+        gx_monitor_leave(a->lock);
+        return false;
+    }
+    while (!a->prefetch_done)
+        memfile_async_wait(a);
+    a->prefetch_blk = NULL;
+    ok = a->prefetch_code >= 0;
+    gx_monitor_leave(a->lock);
+    if (!ok)
+        return false;
+
+    buf = a->prefetch_buf;
+    a->prefetch_buf = f->raw_tail;
+    if (f->raw_tail->log_blk != NULL)
+        f->raw_tail->log_blk->raw_block = NULL;         /* data no longer here */
+    if (f->raw_tail == f->raw_head)
+        f->raw_tail = buf;
+    else {
+        f->raw_tail = f->raw_tail->back;
+        f->raw_tail->fwd = NULL;
+        f->raw_head->back = buf;
+    }
+    buf->fwd = f->raw_tail == buf ? NULL : f->raw_head;
+    buf->back = NULL;
+    buf->log_blk = bp;
+    f->raw_head = buf;
+    bp->raw_block = buf;
+    return true;
+}
+
 /* ---------------- Open/close/unlink ---------------- */
 
 static int
@@ -256,6 +592,10 @@ memfile_fopen(char fname[gp_file_name_sizeof], const char *fmode,
             code = gs_note_error(gs_error_ioerror);
             goto finish;
         }
+        /* Make sure any background compression of the file is finished */
+        code = memfile_async_sync(base_f);
+        if (code < 0)
+            goto finish;
         /* Reopen an existing file for 'read' */
         if (base_f->is_open == false) {
             /* File is not is use, just re-use it. */
@@ -289,6 +629,8 @@ memfile_fopen(char fname[gp_file_name_sizeof], const char *fmode,
             f->log_curr_pos = 0;
             f->raw_head = NULL;
             f->error_code = 0;
+            f->async = NULL;
+            f->async_failed = false;
 
             if (f->log_head->phys_blk->data_limit != NULL) {
                 /* The file is compressed, so we need to copy the logical block */
@@ -348,6 +690,8 @@ memfile_fopen(char fname[gp_file_name_sizeof], const char *fmode,
     }
     f->memory = mem;
     f->data_memory = data_mem;
+    f->async = NULL;
+    f->async_failed = false;
     /* init an empty file, BEFORE allocating de/compress state */
     f->compress_state = 0;      /* make clean for GC, or alloc'n failure */
     f->decompress_state = 0;
@@ -453,23 +797,19 @@ memfile_fclose(clist_file_ptr cf, const char *fname, bool delete)
             /* NB: we don't delete 'base' instances until we delete */
             /* If the file is compressed, free the logical blocks, but not */
             /* the phys_blk info (that is still used by the base memfile   */
+            memfile_async_stop(f);
             if (f->log_head->phys_blk->data_limit != NULL) {
-                LOG_MEMFILE_BLK *tmpbp, *bp = f->log_head;
-
-                while (bp != NULL) {
-                    tmpbp = bp->link;
-                    FREE(f, bp, "memfile_free_mem(log_blk)");
-                    bp = tmpbp;
-                }
+                /* memfile_fopen allocated the logical blocks as one array */
+                gs_free_object(f->data_memory, f->log_head, "memfile_free_mem(log_blk)");
                 f->log_head = NULL;
 
-                /* Free any internal compressor state. */
-                if (f->compressor_initialized) {
+                /* Free the decompressor, readers don't have a compressor */
+                if (f->decompress_state != NULL) {
                     if (f->decompress_state->templat->release != 0)
                         (*f->decompress_state->templat->release) (f->decompress_state);
-                    if (f->compress_state->templat->release != 0)
-                        (*f->compress_state->templat->release) (f->compress_state);
-                    f->compressor_initialized = false;
+                    gs_free_object(f->memory, f->decompress_state,
+                                   "memfile_close_and_unlink(decompress_state)");
+                    f->decompress_state = NULL;
                 }
                 /* free the raw buffers                                           */
                 while (f->raw_head != NULL) {
@@ -559,8 +899,12 @@ memfile_set_memory_warning(clist_file_ptr cf, int bytes_left)
         ++physNeeded;
     if (f->raw_head == NULL)
         ++physNeeded;   /* have yet to allocate read buffers */
+    if (f->async != NULL && f->async->compress_limit != NULL)
+        physNeeded += logNeeded;    /* raw blocks aren't re-used when compressing in the background */
 
     /* Allocate or free memory depending on need */
+    if (f->async != NULL)
+        gx_monitor_enter(f->async->lock);
     while (logNeeded > f->reserveLogBlockCount) {
         LOG_MEMFILE_BLK *block =
             MALLOC( f, sizeof(LOG_MEMFILE_BLK), "memfile_set_block_size" );
@@ -603,6 +947,8 @@ memfile_set_memory_warning(clist_file_ptr cf, int bytes_left)
     }
     f->error_code = 0;  /* memfile_set_block_size is how user resets this */
 finish:
+    if (f->async != NULL)
+        gx_monitor_leave(f->async->lock);
     return code;
 }
 
@@ -682,9 +1028,41 @@ memfile_next_blk(MEMFILE * f)
     LOG_MEMFILE_BLK *bp = f->log_curr_blk;
     LOG_MEMFILE_BLK *newbp;
     PHYS_MEMFILE_BLK *newphys, *oldphys;
+    gs_memory_status_t mem_status;
     int ecode = 0;              /* accumulate low-memory warnings */
     int code;
 
+    if (f->async != NULL && f->async->compress_limit != NULL) {
+        /* File is being compressed in the background: queue this block  */
+        /* for the compression thread and start a new raw block.         */
+        newphys =
+            allocateWithReserve(f, sizeof(*newphys), &code, "memfile newphys",
+                        "memfile_next_blk: MALLOC 3 for 'newphys' failed\n");
+        if (code < 0)
+            return code;
+        ecode |= code;
+        newphys->link = NULL;
+        newphys->data_limit = NULL;     /* raw                          */
+
+        newbp =
+            allocateWithReserve(f, sizeof(*newbp), &code, "memfile newbp",
+                        "memfile_next_blk: MALLOC 3 for 'newbp' failed\n");
+        if (code < 0) {
+            FREE_LOCKED(f, newphys, "memfile newphys");
+            return code;
+        }
+        ecode |= code;
+        bp->link = newbp;
+        newbp->link = NULL;
+        newbp->raw_block = NULL;
+        newbp->phys_blk = newphys;
+        f->pdata = newphys->data;
+        f->pdata_end = f->pdata + MEMFILE_DATA_SIZE;
+        f->log_curr_blk = newbp;
+        if ((code = memfile_async_queue(f, NULL, newbp, 1)) < 0)
+            return code;
+        return ecode | code;
+    }
     if (f->phys_curr == NULL) { /* means NOT compressing                */
         /* allocate a new block                                           */
         newphys =
@@ -727,17 +1105,29 @@ memfile_next_blk(MEMFILE * f)
             f->phys_curr = newphys;
             f->wt.ptr = (byte *) (newphys->data) - 1;
             f->wt.limit = f->wt.ptr + MEMFILE_DATA_SIZE;
-            bp = f->log_head;
-            while (bp != newbp) {       /* don't compress last block    */
-                int code;
-
-                oldphys = bp->phys_blk;
-                if ((code = compress_log_blk(f, bp)) < 0)
+            gs_memory_status(f->data_memory, &mem_status);
+            if (mem_status.is_thread_safe && memfile_async_start(f)) {
+                /* Hand all but the last block to the compression thread */
+                int count = 0;
+
+                for (bp = f->log_head; bp != newbp; bp = bp->link)
+                    count++;
+                if ((code = memfile_async_queue(f, f->log_head, newbp, count)) < 0)
                     return code;
                 ecode |= code;
-                FREE(f, oldphys, "memfile_next_blk(oldphys)");
-                bp = bp->link;
-            }                   /* end while( ) compress loop                           */
+            } else {
+                bp = f->log_head;
+                while (bp != newbp) {   /* don't compress last block    */
+                    int code;
+
+                    oldphys = bp->phys_blk;
+                    if ((code = compress_log_blk(f, bp)) < 0)
+                        return code;
+                    ecode |= code;
+                    FREE(f, oldphys, "memfile_next_blk(oldphys)");
+                    bp = bp->link;
+                }               /* end while( ) compress loop                           */
+            }
             /* Allocate a physical block for this (last) logical block     */
             newphys =
                 allocateWithReserve(f, sizeof(*newphys), &code,
@@ -830,6 +1220,71 @@ memfile_fwrite_chars(const void *data, uint len, clist_file_ptr cf)
     return (len);
 }
 
+/*                                                                      */
+/*      Internal routine to decompress the logical block bp into dest,  */
+/*      using the decompressor st. This may be called by the reader or  */
+/*      by the background thread (with its own decompressor).           */
+/*                                                                      */
+
+static int
+memfile_decompress_blk(MEMFILE * f, stream_state * st, LOG_MEMFILE_BLK * bp,
+                       char *dest)
+{
+    stream_cursor_read rd;
+    stream_cursor_write wt;
+    int status;
+
+    /* Initialize the decompressor                                      */
+    if (st->templat->reinit != 0)
+        (*st->templat->reinit) (st);
+    /* Set pointers and call the decompress routine                     */
+    wt.ptr = (byte *) dest - 1;
+    wt.limit = wt.ptr + MEMFILE_DATA_SIZE;
+    rd.ptr = (const byte *)(bp->phys_pdata) - 1;
+    rd.limit = (const byte *)bp->phys_blk->data_limit;
+#ifdef DEBUG
+    decomp_wt_ptr0 = wt.ptr;
+    decomp_wt_limit0 = wt.limit;
+    decomp_rd_ptr0 = rd.ptr;
+    decomp_rd_limit0 = rd.limit;
+#endif
+    status = (*st->templat->process) (st, &rd, &wt, true);
+    if (status == 0) {  /* More input data needed */
+        /* switch to next block and continue decompress                 */
+        int back_up = 0;        /* adjust pointer backwards     */
+
+        if (rd.ptr != rd.limit) {
+            /* transfer remainder bytes from the previous block into the */
+            /* spare bytes just before the data of the next one          */
+            PHYS_MEMFILE_BLK *next = bp->phys_blk->link;
+
+            back_up = rd.limit - rd.ptr;
+            if (back_up > (int)sizeof(next->data_spare)) {
+                emprintf(f->memory,
+                         "Decompression left too many bytes at the end of a block!\n");
+                return_error(gs_error_Fatal);
+            }
+            memcpy(next->data_spare + sizeof(next->data_spare) - back_up,
+                   rd.ptr + 1, back_up);
+        }
+        rd.ptr = (const byte *)bp->phys_blk->link->data - back_up - 1;
+        rd.limit = (const byte *)bp->phys_blk->link->data_limit;
+#ifdef DEBUG
+        decomp_wt_ptr1 = wt.ptr;
+        decomp_wt_limit1 = wt.limit;
+        decomp_rd_ptr1 = rd.ptr;
+        decomp_rd_limit1 = rd.limit;
+#endif
+        status = (*st->templat->process) (st, &rd, &wt, true);
+        if (status == 0) {
+            emprintf(f->memory,
+                     "Decompression required more than one full block!\n");
+            return_error(gs_error_Fatal);
+        }
+    }
+    return 0;
+}
+
 /*                                                                      */
 /*      Internal routine to set the f->pdata and f->pdata_end pointers  */
 /*      for the current logical block f->log_curr_blk                   */
@@ -841,9 +1296,12 @@ memfile_fwrite_chars(const void *data, uint len, clist_file_ptr cf)
 static int
 memfile_get_pdata(MEMFILE * f)
 {
-    int code, i, num_raw_buffers, status;
+    int code, i, num_raw_buffers;
     LOG_MEMFILE_BLK *bp = f->log_curr_blk;
 
+    /* Any blocks still queued for compression have to be done first    */
+    if ((code = memfile_async_sync(f)) < 0)
+        return code;
     if (bp->phys_blk->data_limit == NULL) {
         /* Not compressed, return this data pointer                       */
         f->pdata = (bp->phys_blk)->data;
@@ -902,7 +1360,8 @@ memfile_get_pdata(MEMFILE * f)
                 return_error(gs_error_VMerror);
 
         }                       /* end allocating the raw buffer pool (first time only)           */
-        if (bp->raw_block == NULL) {
+        if (bp->raw_block == NULL &&
+            (f->async == NULL || !memfile_async_take_prefetch(f, bp))) {
 #ifdef DEBUG
             tot_cache_miss++;   /* count every decompress       */
 #endif
@@ -925,48 +1384,10 @@ memfile_get_pdata(MEMFILE * f)
             f->raw_head->log_blk = bp;
 
             /* Decompress the data into this raw block                     */
-            /* Initialize the decompressor                              */
-            if (f->decompress_state->templat->reinit != 0)
-                (*f->decompress_state->templat->reinit) (f->decompress_state);
-            /* Set pointers and call the decompress routine             */
-            f->wt.ptr = (byte *) (f->raw_head->data) - 1;
-            f->wt.limit = f->wt.ptr + MEMFILE_DATA_SIZE;
-            f->rd.ptr = (const byte *)(bp->phys_pdata) - 1;
-            f->rd.limit = (const byte *)bp->phys_blk->data_limit;
-#ifdef DEBUG
-            decomp_wt_ptr0 = f->wt.ptr;
-            decomp_wt_limit0 = f->wt.limit;
-            decomp_rd_ptr0 = f->rd.ptr;
-            decomp_rd_limit0 = f->rd.limit;
-#endif
-            status = (*f->decompress_state->templat->process)
-                (f->decompress_state, &(f->rd), &(f->wt), true);
-            if (status == 0) {  /* More input data needed */
-                /* switch to next block and continue decompress             */
-                int back_up = 0;        /* adjust pointer backwards     */
-
-                if (f->rd.ptr != f->rd.limit) {
-                    /* transfer remainder bytes from the previous block      */
-                    back_up = f->rd.limit - f->rd.ptr;
-                    for (i = 0; i < back_up; i++)
-                        *(bp->phys_blk->link->data - back_up + i) = *++f->rd.ptr;
-                }
-                f->rd.ptr = (const byte *)bp->phys_blk->link->data - back_up - 1;
-                f->rd.limit = (const byte *)bp->phys_blk->link->data_limit;
-#ifdef DEBUG
-                decomp_wt_ptr1 = f->wt.ptr;
-                decomp_wt_limit1 = f->wt.limit;
-                decomp_rd_ptr1 = f->rd.ptr;
-                decomp_rd_limit1 = f->rd.limit;
-#endif
-                status = (*f->decompress_state->templat->process)
-                    (f->decompress_state, &(f->rd), &(f->wt), true);
-                if (status == 0) {
-                    emprintf(f->memory,
-                             "Decompression required more than one full block!\n");
-                    return_error(gs_error_Fatal);
-                }
-            }
+            code = memfile_decompress_blk(f, f->decompress_state, bp,
+                                          f->raw_head->data);
+            if (code < 0)
+                return code;
             bp->raw_block = f->raw_head;        /* point to raw block           */
         }
         /* end if( raw_block == NULL ) meaning need to decompress data    */
@@ -995,6 +1416,10 @@ memfile_get_pdata(MEMFILE * f)
         f->pdata_end = f->pdata + MEMFILE_DATA_SIZE;
         /* NOTE: last block is never compressed, so a compressed block    */
         /*        is always full size.                                    */
+
+        /* Get the next block ready while this one is being read.         */
+        if (f->async != NULL || memfile_async_start(f))
+            memfile_async_prefetch(f, bp->link);
     }                           /* end else (when data was compressed)                             */
 
     return 0;
@@ -1150,6 +1575,10 @@ memfile_free_mem(MEMFILE * f)
     tot_swap_out = 0;
 #endif
 
+    /* Let the background thread finish with the data, then stop it    */
+    memfile_async_sync(f);
+    memfile_async_stop(f);
+
     /* Free up memory that was allocated for the memfile              */
     bp = f->log_head;
 
@@ -1185,14 +1614,15 @@ memfile_free_mem(MEMFILE * f)
 
     f->log_head = NULL;
 
-    /* Free any internal compressor state. */
+    /* Free any internal compressor state. The decompressor is only   */
+    /* initialized when the raw buffers are allocated.                */
     if (f->compressor_initialized) {
-        if (f->decompress_state->templat->release != 0)
-            (*f->decompress_state->templat->release) (f->decompress_state);
         if (f->compress_state->templat->release != 0)
             (*f->compress_state->templat->release) (f->compress_state);
         f->compressor_initialized = false;
     }
+    if (f->raw_head != NULL && f->decompress_state->templat->release != 0)
+        (*f->decompress_state->templat->release) (f->decompress_state);
     /* free the raw buffers                                           */
     while (f->raw_head != NULL) {
         RAW_BUFFER *tmpraw = f->raw_head->fwd;
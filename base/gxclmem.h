@@ -120,6 +120,15 @@ struct MEMFILE_s {
     bool compressor_initialized;
     stream_state *compress_state;
     stream_state *decompress_state;					/******* READER INSTANCE *******/
+        /*
+         * Background compression (for the writer) or decompression ahead
+         * (for a reader). Each instance, writer or reader, has its own
+         * thread, started on first need. A reader's is stopped when it is
+         * closed, the writer's when its data is freed, so the writer
+         * starts a new one for each page; reader instances start with none.
+         */
+    struct MEMFILE_ASYNC_s *async;	/* the thread and its queue, or NULL */
+    bool async_failed;		/* don't try to start it again */
 };
 typedef struct MEMFILE_s MEMFILE;
 
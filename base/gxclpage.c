@@ -956,3 +956,262 @@ gx_saved_pages_param_process(gx_device_printer *pdev, byte *param, int param_siz
     }
     return erasepage_needed;
 }
+
+/* ---------------- Duplicate page cache ---------------- */
+
+/*
+ * When the DuplicatePageCache band parameter is set, the writer computes
+ * an MD5 signature of each page's band list and of the device settings
+ * it is rendered with (see clist_page_signature_params), and the
+ * reader keeps the rendered bands of recent pages, RLE compressed, up to
+ * that many bytes. A page whose signature, geometry and band layout match
+ * a cached page copies its bands out of the cache instead of playing back
+ * the band list. Cached pages are discarded least recently used first.
+ *
+ * Only pages rendered a whole band at a time by the main device are
+ * cached: saved pages, plane extraction and BGPrint always play back.
+ */
+
+typedef struct clist_cached_band_s {
+    byte *data;                 /* RLE compressed band bits, NULL if none yet */
+    uint size;
+} clist_cached_band_t;
+
+struct clist_cached_page_s {
+    clist_cached_page_t *next;  /* in most recently used order */
+    byte signature[16];
+    int width, height, depth;
+    int band_height;
+    int nbands;
+    ulong band_size;            /* bytes of bits in a band buffer */
+    int bands_done;             /* bands captured, == nbands when complete */
+    size_t size;                /* bytes charged to the cache */
+    clist_cached_band_t *bands; /* [nbands] */
+};
+
+struct clist_page_cache_s {
+    gs_memory_t *memory;        /* thread safe, non gc */
+    size_t max_size;
+    size_t size;                /* of all entries, including filling */
+    clist_cached_page_t *pages; /* complete entries */
+    clist_cached_page_t *filling;       /* entry being captured, or NULL */
+    byte *scratch;              /* for compressing a band */
+    uint scratch_size;
+};
+
+static void
+clist_cached_page_free(clist_page_cache_t *cache, clist_cached_page_t *page)
+{
+    int i;
+
+    for (i = 0; i < page->nbands; i++)
+        gs_free_object(cache->memory, page->bands[i].data, "clist_cached_page_free");
+    cache->size -= page->size;
+    gs_free_object(cache->memory, page->bands, "clist_cached_page_free");
+    gs_free_object(cache->memory, page, "clist_cached_page_free");
+}
+
+void
+clist_page_cache_free(clist_page_cache_t *cache)
+{
+    if (cache == NULL)
+        return;
+    if (cache->filling != NULL)
+        clist_cached_page_free(cache, cache->filling);
+    while (cache->pages != NULL) {
+        clist_cached_page_t *page = cache->pages;
+
+        cache->pages = page->next;
+        clist_cached_page_free(cache, page);
+    }
+    gs_free_object(cache->memory, cache->scratch, "clist_page_cache_free");
+    gs_free_object(cache->memory, cache, "clist_page_cache_free");
+}
+
+/* Free the least recently used complete pages until 'size' more bytes fit. */
+static bool
+clist_page_cache_make_room(clist_page_cache_t *cache, size_t size)
+{
+    while (cache->size + size > cache->max_size && cache->pages != NULL) {
+        clist_cached_page_t **pprev = &cache->pages;
+
+        while ((*pprev)->next != NULL)
+            pprev = &(*pprev)->next;
+        clist_cached_page_free(cache, *pprev);
+        *pprev = NULL;
+    }
+    return cache->size + size <= cache->max_size;
+}
+
+/* Find the current page in the cache, or start capturing it. Done once */
+/* per page, on the first band rendered. */
+static clist_cached_page_t *
+clist_page_cache_lookup(gx_device_clist_reader *crdev)
+{
+    clist_page_cache_t *cache = crdev->page_cache;
+    clist_cached_page_t *page, **pprev;
+    gx_device *target = crdev->target;
+    size_t size;
+
+    if (crdev->page_cache_checked)
+        return crdev->cached_page;
+    crdev->page_cache_checked = true;
+    crdev->cached_page = NULL;
+    if (crdev->band_params.DuplicatePageCache == 0 ||
+        !crdev->page_info.signature_valid || crdev->pages != NULL ||
+        crdev->page_line_ptrs_offset == 0)
+        return NULL;
+    if (cache == NULL) {
+        gs_memory_t *mem = crdev->memory->thread_safe_memory;
+
+        cache = (clist_page_cache_t *)gs_alloc_bytes(mem, sizeof(clist_page_cache_t),
+                                                     "clist_page_cache_lookup");
+        if (cache == NULL)
+            return NULL;
+        memset(cache, 0, sizeof(clist_page_cache_t));
+        cache->memory = mem;
+        crdev->page_cache = cache;
+    }
+    cache->max_size = crdev->band_params.DuplicatePageCache;
+    /* A page that wasn't rendered completely can't be used. */
+    if (cache->filling != NULL) {
+        clist_cached_page_free(cache, cache->filling);
+        cache->filling = NULL;
+    }
+    for (pprev = &cache->pages; (page = *pprev) != NULL; pprev = &page->next) {
+        if (!memcmp(page->signature, crdev->page_info.signature, sizeof(page->signature)) &&
+            page->width == target->width && page->height == target->height &&
+            page->depth == target->color_info.depth &&
+            page->band_height == crdev->page_band_height &&
+            page->nbands == crdev->nbands &&
+            page->band_size == crdev->page_line_ptrs_offset) {
+            /* Move to the front. */
+            *pprev = page->next;
+            page->next = cache->pages;
+            cache->pages = page;
+            return (crdev->cached_page = page);
+        }
+    }
+
+    /* Not cached, so capture the bands as they are rendered. */
+    size = sizeof(clist_cached_page_t) + crdev->nbands * sizeof(clist_cached_band_t);
+    if (!clist_page_cache_make_room(cache, size))
+        return NULL;
+    page = (clist_cached_page_t *)gs_alloc_bytes(cache->memory, sizeof(clist_cached_page_t),
+                                                 "clist_page_cache_lookup");
+    if (page == NULL)
+        return NULL;
+    page->bands = (clist_cached_band_t *)gs_alloc_byte_array(cache->memory, crdev->nbands,
+                                                sizeof(clist_cached_band_t),
+                                                "clist_page_cache_lookup");
+    if (page->bands == NULL) {
+        gs_free_object(cache->memory, page, "clist_page_cache_lookup");
+        return NULL;
+    }
+    memset(page->bands, 0, crdev->nbands * sizeof(clist_cached_band_t));
+    memcpy(page->signature, crdev->page_info.signature, sizeof(page->signature));
+    page->next = NULL;
+    page->width = target->width;
+    page->height = target->height;
+    page->depth = target->color_info.depth;
+    page->band_height = crdev->page_band_height;
+    page->nbands = crdev->nbands;
+    page->band_size = crdev->page_line_ptrs_offset;
+    page->bands_done = 0;
+    page->size = size;
+    cache->size += size;
+    cache->filling = page;
+    return (crdev->cached_page = page);
+}
+
+/* Return true if every band of the current page can come from the cache. */
+bool
+clist_page_cache_is_complete(gx_device_clist_reader *crdev)
+{
+    clist_cached_page_t *page = clist_page_cache_lookup(crdev);
+
+    return page != NULL && page->bands_done == page->nbands;
+}
+
+/* Fill a band buffer from the cache. Returns true if it was filled. */
+bool
+clist_page_cache_get_band(gx_device_clist_reader *crdev, int band, byte *mdata)
+{
+    clist_cached_page_t *page = clist_page_cache_lookup(crdev);
+    clist_cached_band_t *cband;
+    stream_RLD_state sstate;
+    stream_cursor_read r;
+    stream_cursor_write w;
+
+    if (page == NULL || page->bands_done != page->nbands || band < 0 || band >= page->nbands)
+        return false;
+    cband = &page->bands[band];
+    r.ptr = cband->data - 1;
+    r.limit = r.ptr + cband->size;
+    w.ptr = mdata - 1;
+    w.limit = w.ptr + page->band_size;
+    clist_rld_init(&sstate);
+    (*s_RLD_template.process)((stream_state *)&sstate, &r, &w, true);
+    return w.ptr == w.limit;
+}
+
+/* Capture a freshly rendered band of the current page, if it is being */
+/* captured. Running out of room just abandons the capture. */
+void
+clist_page_cache_put_band(gx_device_clist_reader *crdev, int band, const byte *mdata)
+{
+    clist_cached_page_t *page = clist_page_cache_lookup(crdev);
+    clist_page_cache_t *cache = crdev->page_cache;
+    clist_cached_band_t *cband;
+    stream_RLE_state sstate;
+    stream_cursor_read r;
+    stream_cursor_write w;
+    uint size;
+    int status;
+
+    if (page == NULL || page != cache->filling || band < 0 || band >= page->nbands ||
+        page->bands[band].data != NULL)
+        return;
+    cband = &page->bands[band];
+    /* RLE output is at most 129/128 of the input, plus the EOD. */
+    size = page->band_size + (page->band_size >> 7) + 2;
+    if (cache->scratch_size < size) {
+        gs_free_object(cache->memory, cache->scratch, "clist_page_cache_put_band");
+        cache->scratch_size = 0;
+        cache->scratch = gs_alloc_bytes(cache->memory, size, "clist_page_cache_put_band");
+        if (cache->scratch == NULL)
+            goto abandon;
+        cache->scratch_size = size;
+    }
+    r.ptr = mdata - 1;
+    r.limit = r.ptr + page->band_size;
+    w.ptr = cache->scratch - 1;
+    w.limit = w.ptr + cache->scratch_size;
+    clist_rle_init(&sstate);
+    status = (*s_RLE_template.process)((stream_state *)&sstate, &r, &w, true);
+    if (status == 1 || r.ptr != r.limit)	/* EOFC is success */
+        goto abandon;
+    size = w.ptr + 1 - cache->scratch;
+    if (page->size + size > cache->max_size || !clist_page_cache_make_room(cache, size))
+        goto abandon;
+    cband->data = gs_alloc_bytes(cache->memory, size, "clist_page_cache_put_band");
+    if (cband->data == NULL)
+        goto abandon;
+    memcpy(cband->data, cache->scratch, size);
+    cband->size = size;
+    page->size += size;
+    cache->size += size;
+    if (++page->bands_done == page->nbands) {
+        /* Complete, so it can be used from the next page on. */
+        page->next = cache->pages;
+        cache->pages = page;
+        cache->filling = NULL;
+        crdev->cached_page = NULL;
+    }
+    return;
+
+abandon:
+    clist_cached_page_free(cache, page);
+    cache->filling = NULL;
+    crdev->cached_page = NULL;
+}
@@ -89,7 +89,6 @@ typedef enum {
     cmd_opv_ext_unset_color_is_devn  = 0x0a  /* Used for overload of copy_color_alpha */
 } gx_cmd_ext_op;
 
-#ifdef DEBUG
 #define cmd_extend_op_name_strings \
   "put_params",\
   "composite",\
@@ -104,7 +103,6 @@ typedef enum {
   "unset_color_is_devn"
 
 extern const char *cmd_extend_op_names[256];
-#endif
 
 #define cmd_segment_op_num_operands_values\
   2, 2, 1, 1, 4, 6, 6, 6, 4, 4, 4, 4, 2, 2, 0, 0
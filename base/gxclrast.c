@@ -482,6 +482,75 @@ read_set_misc_map(byte cb, command_buf_t *pcb, gs_gstate *pgs, gs_memory_t *mem)
     return 0;
 }
 
+/*
+ * Charge the time since the previous command started to that command and
+ * to the current band, then start timing op (-1 just stops the clock).
+ */
+static void
+clist_profile_op(clist_playback_profile_t *prof, int op)
+{
+    long now[2];
+
+    gp_get_realtime(now);
+    if (prof->op >= 0) {
+        int64_t elapsed = (int64_t)(now[0] - prof->start[0]) * 1000000000 +
+                          (now[1] - prof->start[1]);
+
+        prof->op_time[prof->op] += elapsed;
+        prof->totals.time += elapsed;
+        if (prof->band >= 0)
+            prof->bands[prof->band].time += elapsed;
+    }
+    prof->op = op;
+    prof->start[0] = now[0];
+    prof->start[1] = now[1];
+    if (op >= 0) {
+        prof->op_count[op]++;
+        prof->totals.ops++;
+        if (prof->band >= 0)
+            prof->bands[prof->band].ops++;
+    }
+}
+
+static void
+clist_profile_begin_band(clist_playback_profile_t *prof, int band)
+{
+    prof->op = -1;
+    if (band < 0 || band >= prof->nbands) {
+        prof->band = -1;
+        return;
+    }
+    prof->band = band;
+    /* Split bands are played back in parts, only count the band once. */
+    if (prof->bands[band].ops == 0)
+        prof->totals.bands++;
+}
+
+/*
+ * When a band is rendered in parts (see clist_band_parts), all of the
+ * band's commands are played back for each part. Filling or stroking a
+ * path that lies wholly outside the part can't mark it, so those are
+ * skipped rather than being flattened, stroked and clipped away for every
+ * part. The margins are those the writer uses to assign paths to bands.
+ */
+static bool
+path_outside_part(const gs_gstate *pgs, gx_path *ppath, bool stroke,
+                  const gs_fixed_rect *target_box)
+{
+    gs_fixed_rect bbox;
+    gs_fixed_point expansion;
+    fixed adjust = fixed_1;
+
+    if (gx_path_is_void(ppath) || gx_path_bbox(ppath, &bbox) < 0)
+        return false;
+    if (stroke) {
+        if (gx_stroke_path_expansion(pgs, ppath, &expansion) < 0)
+            return false;
+        adjust += expansion.y + fixed_1;
+    }
+    return bbox.q.y + adjust <= target_box->p.y || bbox.p.y - adjust >= target_box->q.y;
+}
+
 int
 clist_playback_band(clist_playback_action playback_action, /* lgtm [cpp/use-of-goto] */
                     gx_device_clist_reader *cdev, stream *s,
@@ -553,6 +622,10 @@ clist_playback_band(clist_playback_action playback_action, /* lgtm [cpp/use-of-g
     patch_fill_state_t pfs;
     int op = 0;
     int plane_height = 0;
+    clist_playback_profile_t *prof =
+        (playback_action == playback_action_setup ? NULL : cdev->playback_profile);
+    /* Only part of a band is being rendered, see clist_render_band. */
+    bool render_part = (playback_action != playback_action_setup && cdev->rendering_band_part);
 
 #ifdef DEBUG
     stream_state *st = s->state; /* Save because s_close resets s->state. */
@@ -582,6 +655,9 @@ clist_playback_band(clist_playback_action playback_action, /* lgtm [cpp/use-of-g
     memset(&state_slot, 0, sizeof(state_slot));
     ppos.x = ppos.y = 0;
 
+    if (prof != NULL)
+        clist_profile_begin_band(prof, y0 / cdev->page_band_height);
+
 in:                             /* Initialize for a new page. */
     tdev = target;
     set_colors = state.colors;
@@ -718,6 +794,8 @@ in:                             /* Initialize for a new page. */
             }
         }
         op = *cbp++;
+        if (prof != NULL)
+            clist_profile_op(prof, (op == cmd_opv_extend ? 256 + *cbp : op));
 #ifdef DEBUG
         if (gs_debug_c('L')) {
             const char *const *sub = cmd_sub_op_names[op >> 4];
@@ -2011,6 +2089,9 @@ idata:                  data_size = 0;
                         fill:
                             fill_params.adjust = gs_gstate.fill_adjust;
                             fill_params.flatness = gs_gstate.flatness;
+                            if (render_part && !in_clip &&
+                                path_outside_part(&gs_gstate, ppath, false, &target_box))
+                                break;
                             code = (*dev_proc(tdev, fill_path))(tdev, &gs_gstate, ppath,
                                                                 &fill_params, &fill_color, pcpath);
                             break;
@@ -2024,7 +2105,9 @@ idata:                  data_size = 0;
                             fill_params.flatness = gs_gstate.flatness;
                             stroke_params.flatness = gs_gstate.flatness;
                             stroke_params.traditional = false;
-                            code = (*dev_proc(tdev, fill_stroke_path))(tdev, &gs_gstate, ppath,
+                            if (!render_part || in_clip ||
+                                !path_outside_part(&gs_gstate, ppath, true, &target_box))
+                                code = (*dev_proc(tdev, fill_stroke_path))(tdev, &gs_gstate, ppath,
                                                                 &fill_params, &fill_color,
                                                                 &stroke_params, &stroke_color, pcpath);
                             /* if the color is a pattern, it may have had the "is_locked" flag set	*/
@@ -2051,6 +2134,9 @@ idata:                  data_size = 0;
                         case cmd_opv_stroke:
                             stroke_params.flatness = gs_gstate.flatness;
                             stroke_params.traditional = false;
+                            if (render_part && !in_clip &&
+                                path_outside_part(&gs_gstate, ppath, true, &target_box))
+                                break;
                             code = (*dev_proc(tdev, stroke_path))
                                                        (tdev, &gs_gstate,
                                                        ppath, &stroke_params,
@@ -2362,6 +2448,8 @@ idata:                  data_size = 0;
     }
     /* Clean up before we exit. */
   out:
+    if (prof != NULL)
+        clist_profile_op(prof, -1);
     if (ht_buff.pbuff != 0) {
         gs_free_object(mem, ht_buff.pbuff, "clist_playback_band(ht_buff)");
         ht_buff.pbuff = 0;
@@ -2439,6 +2527,8 @@ idata:                  data_size = 0;
         gx_cpath_free(pcpath, "clist_playback_band");
     return code;
 top_up_failed:
+    if (prof != NULL)
+        clist_profile_op(prof, -1);
     gx_cpath_free(&clip_path, "clist_playback_band");
     if (pcpath != &clip_path)
         gx_cpath_free(pcpath, "clist_playback_band");
@@ -3517,3 +3607,193 @@ clist_do_polyfill(gx_device *dev, gx_path *ppath,
     gx_path_new(ppath);
     return code;
 }
+
+/* ---------------- Playback profile ---------------- */
+
+clist_playback_profile_t *
+clist_playback_profile_alloc(gs_memory_t *mem, int nbands, int thread)
+{
+    clist_playback_profile_t *prof =
+        (clist_playback_profile_t *)gs_alloc_bytes(mem, sizeof(*prof),
+                                                   "clist_playback_profile_alloc");
+
+    if (prof == NULL)
+        return NULL;
+    memset(prof, 0, sizeof(*prof));
+    prof->bands = (clist_band_profile_t *)gs_alloc_bytes(mem,
+                                nbands * sizeof(clist_band_profile_t),
+                                "clist_playback_profile_alloc(bands)");
+    if (prof->bands == NULL) {
+        gs_free_object(mem, prof, "clist_playback_profile_alloc");
+        return NULL;
+    }
+    memset(prof->bands, 0, nbands * sizeof(clist_band_profile_t));
+    prof->memory = mem;
+    prof->thread = thread;
+    prof->nbands = nbands;
+    prof->band = -1;
+    prof->op = -1;
+    return prof;
+}
+
+void
+clist_playback_profile_free(clist_playback_profile_t *prof)
+{
+    if (prof == NULL)
+        return;
+    gs_free_object(prof->memory, prof->threads, "clist_playback_profile_free(threads)");
+    gs_free_object(prof->memory, prof->bands, "clist_playback_profile_free(bands)");
+    gs_free_object(prof->memory, prof, "clist_playback_profile_free");
+}
+
+/* Accumulate a rendering thread's profile into the main device's one. */
+int
+clist_playback_profile_merge(clist_playback_profile_t *prof,
+                             const clist_playback_profile_t *from)
+{
+    int i;
+
+    if (from->thread >= prof->num_threads) {
+        int num_threads = from->thread + 1;
+        clist_profile_totals_t *threads =
+            (clist_profile_totals_t *)gs_alloc_bytes(prof->memory,
+                                num_threads * sizeof(clist_profile_totals_t),
+                                "clist_playback_profile_merge");
+
+        if (threads == NULL)
+            return_error(gs_error_VMerror);
+        memset(threads, 0, num_threads * sizeof(clist_profile_totals_t));
+        if (prof->threads != NULL)
+            memcpy(threads, prof->threads,
+                   prof->num_threads * sizeof(clist_profile_totals_t));
+        gs_free_object(prof->memory, prof->threads, "clist_playback_profile_merge");
+        prof->threads = threads;
+        prof->num_threads = num_threads;
+    }
+    prof->threads[from->thread].time += from->totals.time;
+    prof->threads[from->thread].ops += from->totals.ops;
+    prof->threads[from->thread].bands += from->totals.bands;
+    for (i = 0; i < CLIST_PROFILE_OPS; i++) {
+        prof->op_count[i] += from->op_count[i];
+        prof->op_time[i] += from->op_time[i];
+    }
+    for (i = 0; i < prof->nbands && i < from->nbands; i++) {
+        clist_band_profile_t *band = &prof->bands[i];
+
+        if (from->bands[i].ops == 0)
+            continue;
+        if (band->ops == 0)
+            band->thread = from->thread;
+        else if (band->thread != from->thread)
+            band->thread = CLIST_PROFILE_SEVERAL;
+        band->time += from->bands[i].time;
+        band->ops += from->bands[i].ops;
+    }
+    return 0;
+}
+
+/*
+ * Commands whose low 4 bits are an operand rather than a sub-opcode are
+ * reported under the first command of their group.
+ */
+static const char *
+clist_profile_op_name(int op, char *buf, int size)
+{
+    const char *const *sub;
+
+    if (op >= 256) {
+        if (cmd_extend_op_names[op - 256] != NULL)
+            return cmd_extend_op_names[op - 256];
+        gs_snprintf(buf, size, "extend_0x%02x", op - 256);
+        return buf;
+    }
+    sub = cmd_sub_op_names[op >> 4];
+    return (sub != NULL ? sub[op & 0xf] : cmd_op_names[op >> 4]);
+}
+
+static void
+clist_profile_print_thread(const gs_memory_t *mem, int format, int thread,
+                           const clist_profile_totals_t *totals, bool first)
+{
+    if (format == BandProfileJSON)
+        dmprintf5(mem, "%s\n    {\"thread\": %d, \"bands\": %d, \"ops\": %"PRId64", \"time_us\": %.3f}",
+                  (first ? "" : ","), thread, totals->bands, totals->ops,
+                  totals->time / 1000.0);
+    else
+        dmprintf4(mem, "thread,%d,,,%d,%"PRId64",%.3f\n", thread, totals->bands,
+                  totals->ops, totals->time / 1000.0);
+}
+
+/*
+ * Print the profile of the page just rendered: time and count per command,
+ * per band (with the thread that rendered it) and per rendering thread.
+ * Thread -1 is the main device, and a band split between several threads
+ * is reported as thread -2.
+ */
+void
+clist_playback_profile_report(gx_device_clist_reader *crdev, int format)
+{
+    const clist_playback_profile_t *prof = crdev->playback_profile;
+    const gs_memory_t *mem = crdev->memory;
+    int64_t op_count[CLIST_PROFILE_OPS], op_time[CLIST_PROFILE_OPS];
+    char buf[16];
+    bool first = true;
+    int i;
+
+    /* Nothing is recorded for pages rendered by a BGPrint thread. */
+    if (prof == NULL || (prof->totals.ops == 0 && prof->num_threads == 0))
+        return;
+    memcpy(op_count, prof->op_count, sizeof(op_count));
+    memcpy(op_time, prof->op_time, sizeof(op_time));
+    for (i = 0; i < 256; i++) {
+        if (cmd_sub_op_names[i >> 4] == NULL && (i & 0xf) != 0) {
+            op_count[i & 0xf0] += op_count[i];
+            op_time[i & 0xf0] += op_time[i];
+            op_count[i] = 0;
+        }
+    }
+    if (format == BandProfileJSON)
+        dmprintf4(mem, "{\"page\": %ld, \"bands\": %d, \"band_height\": %d, \"threads\": %d,\n  \"ops\": [",
+                  crdev->PageCount + 1, crdev->nbands, crdev->page_band_height,
+                  prof->num_threads);
+    else
+        dmputs(mem, "record,index,name,thread,bands,ops,time_us\n");
+    for (i = 0; i < CLIST_PROFILE_OPS; i++) {
+        const char *name;
+
+        if (op_count[i] == 0)
+            continue;
+        name = clist_profile_op_name(i, buf, sizeof(buf));
+        if (format == BandProfileJSON)
+            dmprintf5(mem, "%s\n    {\"op\": %d, \"name\": \"%s\", \"count\": %"PRId64", \"time_us\": %.3f}",
+                      (first ? "" : ","), i, name, op_count[i], op_time[i] / 1000.0);
+        else
+            dmprintf4(mem, "op,%d,%s,,,%"PRId64",%.3f\n", i, name, op_count[i],
+                      op_time[i] / 1000.0);
+        first = false;
+    }
+    if (format == BandProfileJSON)
+        dmputs(mem, "],\n  \"band_times\": [");
+    first = true;
+    for (i = 0; i < prof->nbands; i++) {
+        const clist_band_profile_t *band = &prof->bands[i];
+
+        if (band->ops == 0)
+            continue;
+        if (format == BandProfileJSON)
+            dmprintf5(mem, "%s\n    {\"band\": %d, \"thread\": %d, \"ops\": %"PRId64", \"time_us\": %.3f}",
+                      (first ? "" : ","), i, band->thread, band->ops,
+                      band->time / 1000.0);
+        else
+            dmprintf4(mem, "band,%d,,%d,,%"PRId64",%.3f\n", i, band->thread,
+                      band->ops, band->time / 1000.0);
+        first = false;
+    }
+    if (format == BandProfileJSON)
+        dmputs(mem, "],\n  \"render_threads\": [");
+    clist_profile_print_thread(mem, format, CLIST_PROFILE_MAIN, &prof->totals, true);
+    for (i = 0; i < prof->num_threads; i++)
+        clist_profile_print_thread(mem, format, i, &prof->threads[i], false);
+    if (format == BandProfileJSON)
+        dmputs(mem, "]}\n");
+}
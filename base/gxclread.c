@@ -446,6 +446,8 @@ clist_close_writer_and_init_reader(gx_device_clist *cldev)
         code = clist_render_init(cldev);
         if (code < 0)
             return code;
+        /* Look the page up in the DuplicatePageCache when it is first rendered */
+        crdev->page_cache_checked = false;
         /* allocate and load the color_usage_array */
         code = clist_read_color_usage_array(crdev);
         if (code < 0)
@@ -465,6 +467,14 @@ clist_close_writer_and_init_reader(gx_device_clist *cldev)
         if (crdev->icc_cache_cl == NULL) {
             code = (crdev->icc_cache_cl = gsicc_cache_new(base_mem)) == NULL ? gs_error_VMerror : code;
         }
+        /* The playback profile is reported and freed by clist_finish_page */
+        if (crdev->space_params.band.BandProfile != BandProfileNone &&
+            crdev->playback_profile == NULL) {
+            crdev->playback_profile = clist_playback_profile_alloc(base_mem,
+                                            crdev->nbands, CLIST_PROFILE_MAIN);
+            if (crdev->playback_profile == NULL)
+                return_error(gs_error_VMerror);
+        }
     }
 
     check_device_compatible_encoding((gx_device *)cldev);
@@ -548,7 +558,7 @@ clist_read_chunk(gx_device_clist_reader *crdev, int64_t position, int size, unsi
 int
 clist_read_color_usage_array(gx_device_clist_reader *crdev)
 {
-    int code, size_data = crdev->nbands * sizeof(gx_color_usage_t );
+    int code, i, size_data = crdev->nbands * sizeof(gx_color_usage_t );
     cmd_block cb;
 
     if (crdev->color_usage_array != NULL)
@@ -564,9 +574,38 @@ clist_read_color_usage_array(gx_device_clist_reader *crdev)
         return code;
 
     code = clist_read_chunk(crdev, cb.pos, size_data, (unsigned char *)crdev->color_usage_array);
+    if (code < 0)
+        return code;
+
+    crdev->band_cost_average = 0;
+    for (i = 0; i < crdev->nbands; i++)
+        crdev->band_cost_average += CLIST_BAND_COST(&crdev->color_usage_array[i]);
+    crdev->band_cost_average /= crdev->nbands;
+    if (crdev->band_cost_average < 1)
+        crdev->band_cost_average = 1;
     return code;
 }
 
+/*
+ * Return the number of sub-bands that the rendering threads may split a
+ * band into, 1 if it isn't worth splitting. This depends only on the
+ * band list, so a page is split the same way whatever the number of
+ * threads. Without threads bands are never split.
+ */
+int
+clist_band_parts(const gx_device_clist_reader *crdev, int band)
+{
+    int max_parts = min(CLIST_MAX_BAND_PARTS, crdev->page_band_height / CLIST_SPLIT_MIN_LINES);
+    int64_t cost;
+
+    if (max_parts < 2 || crdev->color_usage_array == NULL)
+        return 1;
+    cost = CLIST_BAND_COST(&crdev->color_usage_array[band]);
+    if (cost < CLIST_SPLIT_MIN_COST || cost < CLIST_SPLIT_COST_RATIO * crdev->band_cost_average)
+        return 1;
+    return (int)min(cost / crdev->band_cost_average, max_parts);
+}
+
 /* read the cmyk equivalent spot colors */
 int
 clist_read_op_equiv_cmyk_colors(gx_device_clist_reader *crdev,
@@ -681,6 +720,11 @@ clist_render_init(gx_device_clist *dev)
     crdev->icc_table = NULL;
     crdev->color_usage_array = NULL;
     crdev->render_threads = NULL;
+    crdev->rendering_band_part = false;
+    /* Only the device that wrote the page uses the DuplicatePageCache, */
+    /* see clist_close_writer_and_init_reader. */
+    crdev->page_cache_checked = true;
+    crdev->cached_page = NULL;
 
     return 0;
 }
@@ -854,9 +898,16 @@ clist_rasterize_lines(gx_device *dev, int y, int line_count,
         band_rect.p.y = band_begin_line;
         band_rect.q.x = dev->width;
         band_rect.q.y = band_end_line;
-        if (code >= 0)
-            code = clist_render_rectangle(cldev, &band_rect, bdev, render_plane,
-                                          true);
+        if (code >= 0) {
+            if (plane_index < 0 && clist_page_cache_get_band(crdev, band, mdata))
+                crdev->yplane.index = -1;
+            else {
+                code = clist_render_rectangle(cldev, &band_rect, bdev, render_plane,
+                                              true);
+                if (code >= 0 && plane_index < 0)
+                    clist_page_cache_put_band(crdev, band, mdata);
+            }
+        }
         /* Reset the band boundaries now, so that we don't get */
         /* an infinite loop. */
         crdev->ymin = band_begin_line;
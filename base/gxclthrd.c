@@ -39,8 +39,10 @@
 #include "gzht.h"		/* for gx_ht_cache_default_bits_size */
 
 /* Forward reference prototypes */
-static int clist_start_render_thread(gx_device *dev, int thread_index, int band);
+static int clist_start_render_thread(gx_device *dev, int thread_index);
 static void clist_render_thread(void *param);
+static void clist_render_worker(void *param);
+static int clist_feed_render_threads(gx_device *dev);
 
 /* clone a device and set params and its chunk memory                   */
 /* The chunk_base_mem MUST be thread safe                               */
@@ -300,6 +302,192 @@ out_cleanup:
     return NULL;
 }
 
+/* Make sure the device's pool holds at least 'count' workers. The pool */
+/* lives until clist_close, so the OS threads it holds are reused for   */
+/* every band of every page. The threads themselves are only started    */
+/* when a worker is first handed a band.                                */
+static int
+clist_ensure_render_pool(gx_device *dev, int count)
+{
+    gx_device_clist_common *cdev = (gx_device_clist_common *)dev;
+    gs_memory_t *mem = cdev->bandlist_memory->thread_safe_memory;
+    clist_render_pool_t *pool = cdev->render_pool;
+    clist_render_worker_t **workers;
+    int i;
+
+    if (pool == NULL) {
+        pool = (clist_render_pool_t *)gs_alloc_bytes(mem, sizeof(clist_render_pool_t),
+                                                     "clist_ensure_render_pool");
+        if (pool == NULL)
+            return_error(gs_error_VMerror);
+        pool->memory = mem;
+        pool->num_workers = 0;
+        pool->workers = NULL;
+        cdev->render_pool = pool;
+    }
+    if (pool->num_workers >= count)
+        return 0;
+
+    /* The workers are allocated individually since idle threads hold */
+    /* a pointer to theirs, so only the array of pointers may move.   */
+    workers = (clist_render_worker_t **)gs_alloc_byte_array(pool->memory, count,
+                                    sizeof(clist_render_worker_t *), "clist_ensure_render_pool");
+    if (workers == NULL)
+        return_error(gs_error_VMerror);
+    if (pool->num_workers > 0)
+        memcpy(workers, pool->workers, pool->num_workers * sizeof(clist_render_worker_t *));
+    gs_free_object(pool->memory, pool->workers, "clist_ensure_render_pool");
+    pool->workers = workers;
+
+    for (i = pool->num_workers; i < count; i++) {
+        clist_render_worker_t *worker;
+
+        worker = (clist_render_worker_t *)gs_alloc_bytes(pool->memory, sizeof(clist_render_worker_t),
+                                                         "clist_ensure_render_pool");
+        if (worker == NULL)
+            return_error(gs_error_VMerror);
+        worker->thread = NULL;
+        worker->job = NULL;
+        worker->sema_start = gx_semaphore_label(gx_semaphore_alloc(pool->memory), "BandStart");
+        if (worker->sema_start == NULL) {
+            gs_free_object(pool->memory, worker, "clist_ensure_render_pool");
+            return_error(gs_error_VMerror);
+        }
+        pool->workers[i] = worker;
+        pool->num_workers = i + 1;
+    }
+    return 0;
+}
+
+/* Stop and join the pool's threads. The threads must be idle, i.e. */
+/* clist_teardown_render_threads must have been called already.     */
+void
+clist_free_render_pool(gx_device *dev)
+{
+    gx_device_clist_common *cdev = (gx_device_clist_common *)dev;
+    clist_render_pool_t *pool = cdev->render_pool;
+    int i;
+
+    if (pool == NULL)
+        return;
+    for (i = 0; i < pool->num_workers; i++) {
+        clist_render_worker_t *worker = pool->workers[i];
+
+        if (worker->thread != NULL) {
+            worker->job = NULL;		/* tells the thread to exit */
+            gx_semaphore_signal(worker->sema_start);
+            gp_thread_finish(worker->thread);
+        }
+        gx_semaphore_free(worker->sema_start);
+        gs_free_object(pool->memory, worker, "clist_free_render_pool");
+    }
+    gs_free_object(pool->memory, pool->workers, "clist_free_render_pool");
+    gs_free_object(pool->memory, pool, "clist_free_render_pool");
+    cdev->render_pool = NULL;
+}
+
+/* Allocate the reorder buffer: one band's worth of data (and process_page */
+/* buffer) per thread. This is only an optimisation, so if memory is tight */
+/* we just make do with fewer slots. With none, each thread holds on to    */
+/* its band until it has been collected, as it always used to.             */
+static void
+clist_setup_reorder_slots(gx_device *dev, gx_process_page_options_t *options)
+{
+    gx_device_clist *cldev = (gx_device_clist *)dev;
+    gx_device_clist_reader *crdev = &cldev->reader;
+    gs_memory_t *mem = crdev->bandlist_memory;
+    gx_device_clist_common *thread_cdev = (gx_device_clist_common *)crdev->render_threads[0].cdev;
+    int band_height = crdev->page_info.band_params.BandHeight;
+    int i, num_slots = crdev->num_render_threads;
+
+    crdev->num_reorder_slots = 0;
+    crdev->reorder_slots = (clist_band_reorder_slot_t *)
+              gs_alloc_byte_array(mem, num_slots, sizeof(clist_band_reorder_slot_t),
+                                  "clist_setup_reorder_slots");
+    if (crdev->reorder_slots == NULL)
+        return;
+    for (i = 0; i < num_slots; i++) {
+        clist_band_reorder_slot_t *slot = &(crdev->reorder_slots[i]);
+
+        slot->band = -1;
+        slot->buffer = NULL;
+        /* Slot data is only ever swapped with the thread devices' data, */
+        /* so it needs to be the same size as theirs.                    */
+        slot->data = gs_alloc_bytes(mem, thread_cdev->data_size, "clist_setup_reorder_slots");
+        if (slot->data == NULL)
+            break;
+        if (options && options->init_buffer_fn &&
+            options->init_buffer_fn(options->arg, dev, mem, dev->width, band_height, &slot->buffer) < 0) {
+            gs_free_object(mem, slot->data, "clist_setup_reorder_slots");
+            break;
+        }
+        slot->alloc_data = slot->data;
+        slot->alloc_buffer = slot->buffer;
+    }
+    crdev->num_reorder_slots = i;
+}
+
+#define CLIST_MAX_SPLIT_BANDS 2
+
+/* Allocate the areas that the parts of the bands clist_band_parts marks */
+/* for splitting are rendered into, so that several threads can work on  */
+/* one band. As for the reorder buffer, failing to get the memory just   */
+/* means that such bands are rendered in parts by one thread.            */
+static void
+clist_setup_band_splits(gx_device *dev, gx_process_page_options_t *options)
+{
+    gx_device_clist *cldev = (gx_device_clist *)dev;
+    gx_device_clist_reader *crdev = &cldev->reader;
+    gs_memory_t *mem = crdev->bandlist_memory;
+    gx_device_clist_common *thread_cdev = (gx_device_clist_common *)crdev->render_threads[0].cdev;
+    int band_height = crdev->page_info.band_params.BandHeight;
+    int band, num_split = 0;
+    int i;
+
+    crdev->next_part = 0;
+    crdev->num_split_bands = 0;
+    crdev->split_bands = NULL;
+    if (crdev->num_render_threads < 2)
+        return;
+    for (band = 0; band < crdev->nbands; band++)
+        if (clist_band_parts(crdev, band) > 1)
+            num_split++;
+    if (num_split == 0)
+        return;
+
+    crdev->split_bands = (clist_split_band_t *)
+              gs_alloc_byte_array(mem, CLIST_MAX_SPLIT_BANDS, sizeof(clist_split_band_t),
+                                  "clist_setup_band_splits");
+    if (crdev->split_bands != NULL) {
+        for (i = 0; i < CLIST_MAX_SPLIT_BANDS; i++) {
+            clist_split_band_t *split = &(crdev->split_bands[i]);
+
+            split->band = -1;
+            split->buffer = NULL;
+            /* Swapped with the main device's data, which may be one of */
+            /* the thread devices' data areas by now.                   */
+            split->data = gs_alloc_bytes(mem, thread_cdev->data_size, "clist_setup_band_splits");
+            if (split->data == NULL)
+                break;
+            if (options && options->init_buffer_fn &&
+                options->init_buffer_fn(options->arg, dev, mem, dev->width, band_height, &split->buffer) < 0) {
+                gs_free_object(mem, split->data, "clist_setup_band_splits");
+                break;
+            }
+            split->alloc_data = split->data;
+            split->alloc_buffer = split->buffer;
+        }
+        crdev->num_split_bands = i;
+    }
+    if (crdev->num_split_bands == 0) {
+        gs_free_object(mem, crdev->split_bands, "clist_setup_band_splits");
+        crdev->split_bands = NULL;
+        return;
+    }
+    if (gs_debug[':'] != 0)
+        dmprintf1(mem, "%% %d bands will be rendered in sub-bands\n", num_split);
+}
+
 /* Set up and start the render threads */
 static int
 clist_setup_render_threads(gx_device *dev, int y, gx_process_page_options_t *options)
@@ -311,7 +499,7 @@ clist_setup_render_threads(gx_device *dev, int y, gx_process_page_options_t *opt
     gs_memory_t *mem = cdev->bandlist_memory;
     gs_memory_t *chunk_base_mem = mem->thread_safe_memory;
     gs_memory_status_t mem_status;
-    int i, j, band;
+    int i, j, band, first_band;
     int code = 0;
     int band_count = cdev->nbands;
     int band_height = crdev->page_info.band_params.BandHeight;
@@ -369,12 +557,29 @@ clist_setup_render_threads(gx_device *dev, int y, gx_process_page_options_t *opt
     memset(reserve_memory_array, 0, crdev->num_render_threads * sizeof(void *));
     memset(crdev->render_threads, 0, crdev->num_render_threads *
             sizeof(clist_render_thread_control_t));
+    crdev->num_reorder_slots = 0;
+    crdev->reorder_slots = NULL;
+    crdev->num_split_bands = 0;
+    crdev->split_bands = NULL;
+    crdev->band_queue_lock = gx_monitor_label(gx_monitor_alloc(mem), "BandQueue");
+    crdev->sema_band_done = gx_semaphore_label(gx_semaphore_alloc(mem), "BandDone");
+    if (crdev->band_queue_lock == NULL || crdev->sema_band_done == NULL) {
+        gx_monitor_free(crdev->band_queue_lock);
+        crdev->band_queue_lock = NULL;
+        gx_semaphore_free(crdev->sema_band_done);
+        crdev->sema_band_done = NULL;
+        gs_free_object(mem, reserve_memory_array, "clist_setup_render_threads");
+        gs_free_object(mem, crdev->render_threads, "clist_setup_render_threads");
+        crdev->render_threads = NULL;
+        emprintf(mem, " VMerror prevented threads from starting.\n");
+        return_error(gs_error_VMerror);
+    }
 
     crdev->main_thread_data = cdev->data;               /* save data area */
     /* Based on the line number requested, decide the order of band rendering */
     /* Almost all devices go in increasing line order (except the bmp* devices ) */
     crdev->thread_lookahead_direction = (y < (cdev->height - 1)) ? 1 : -1;
-    band = y / band_height;
+    first_band = band = y / band_height;
 
     /* If the 'mem' is not thread safe, we need to wrap it in a locking memory */
     gs_memory_status(chunk_base_mem, &mem_status);
@@ -400,8 +605,13 @@ clist_setup_render_threads(gx_device *dev, int y, gx_process_page_options_t *opt
         gs_free_object(mem, old, "clist_render_setup_threads");
     }
 
+    /* Likewise, make sure the pool has a worker for each thread. If it can't,
+     * no thread is set up and we clean up below, as for a failure in the loop.
+     */
+    code = clist_ensure_render_pool(dev, crdev->num_render_threads);
+
     /* Loop creating the devices and semaphores for each thread, then start them */
-    for (i=0; (i < crdev->num_render_threads) && (band >= 0) && (band < band_count);
+    for (i=0; code >= 0 && (i < crdev->num_render_threads) && (band >= 0) && (band < band_count);
             i++, band += crdev->thread_lookahead_direction) {
         gx_device *ndev;
         clist_render_thread_control_t *thread = &(crdev->render_threads[i]);
@@ -420,9 +630,22 @@ clist_setup_render_threads(gx_device *dev, int y, gx_process_page_options_t *opt
             break;
         }
 
+        thread->main_dev = dev;
         thread->cdev = ndev;
         thread->memory = ndev->memory;
+        if (cdev->playback_profile != NULL) {
+            /* Each thread times its own bands, merged at teardown */
+            ((gx_device_clist_common *)ndev)->playback_profile =
+                clist_playback_profile_alloc(cdev->playback_profile->memory,
+                                             cdev->nbands, i);
+            if (((gx_device_clist_common *)ndev)->playback_profile == NULL) {
+                code = gs_error_VMerror;	/* set code to an error for cleanup after the loop */
+                break;
+            }
+        }
         thread->band = -1;              /* a value that won't match any valid band */
+        thread->part = -1;
+        thread->split = NULL;
         thread->options = options;
         thread->buffer = NULL;
         if (options && options->init_buffer_fn) {
@@ -430,6 +653,7 @@ clist_setup_render_threads(gx_device *dev, int y, gx_process_page_options_t *opt
             if (code < 0)
                 break;
         }
+        thread->alloc_buffer = thread->buffer;
 
         /* create the buf device for this thread, and allocate the semaphores */
         if ((code = gdev_create_buf_device(cdev->buf_procs.create_buf_device,
@@ -437,21 +661,13 @@ clist_setup_render_threads(gx_device *dev, int y, gx_process_page_options_t *opt
                                 band*crdev->page_band_height, NULL,
                                 thread->memory, &(crdev->color_usage_array[0]))) < 0)
             break;
-        if ((thread->sema_this = gx_semaphore_label(gx_semaphore_alloc(thread->memory), "Band")) == NULL ||
-            (thread->sema_group = gx_semaphore_label(gx_semaphore_alloc(thread->memory), "Group")) == NULL) {
-            code = gs_error_VMerror;
-            break;
-        }
         /* We don't start the threads yet until we  free up the */
         /* reserve memory we have allocated for that band. */
-        thread->band = band;
     }
     /* If the code < 0, the last thread creation failed -- clean it up */
     if (code < 0) {
         /* NB: 'band' will be the one that failed, so will be the next_band needed to start */
         /* the following relies on 'free' ignoring NULL pointers */
-        gx_semaphore_free(crdev->render_threads[i].sema_group);
-        gx_semaphore_free(crdev->render_threads[i].sema_this);
         if (crdev->render_threads[i].bdev != NULL)
             cdev->buf_procs.destroy_buf_device(crdev->render_threads[i].bdev);
         if (crdev->render_threads[i].cdev != NULL) {
@@ -461,6 +677,8 @@ clist_setup_render_threads(gx_device *dev, int y, gx_process_page_options_t *opt
             thread_cdev->page_info.io_procs->fclose(thread_cdev->page_info.bfile, thread_cdev->page_info.bfname, false);
             thread_cdev->page_info.io_procs->fclose(thread_cdev->page_info.cfile, thread_cdev->page_info.cfname, false);
             thread_cdev->do_not_open_or_close_bandfiles = true; /* we already closed the files */
+            clist_playback_profile_free(thread_cdev->playback_profile);
+            thread_cdev->playback_profile = NULL;
 
             gdev_prn_free_memory((gx_device *)thread_cdev);
             gs_free_object(crdev->render_threads[i].memory, thread_cdev,
@@ -485,8 +703,15 @@ clist_setup_render_threads(gx_device *dev, int y, gx_process_page_options_t *opt
                 gs_free_object(mem, chunk_base_mem, "clist_setup_render_threads(locked allocator)");
             }
         }
+        for (j=0; j<crdev->num_render_threads; j++)
+            gs_free_object(mem, reserve_memory_array[j], "clist_setup_render_threads");
+        gs_free_object(mem, reserve_memory_array, "clist_setup_render_threads");
         gs_free_object(mem, crdev->render_threads, "clist_setup_render_threads");
         crdev->render_threads = NULL;
+        gx_monitor_free(crdev->band_queue_lock);
+        crdev->band_queue_lock = NULL;
+        gx_semaphore_free(crdev->sema_band_done);
+        crdev->sema_band_done = NULL;
         /* restore the file pointers */
         if (cdev->page_info.cfile == NULL) {
             char fmode[4];
@@ -507,18 +732,20 @@ clist_setup_render_threads(gx_device *dev, int y, gx_process_page_options_t *opt
      * threads since we deferred that in the thread setup loop above.
      * We know if we get here we can start at least 1 thread.
      */
-    for (j=0, code = 0; j<crdev->num_render_threads; j++) {
+    for (j=0; j<crdev->num_render_threads; j++)
         gs_free_object(mem, reserve_memory_array[j], "clist_setup_render_threads");
-        if (code == 0 && j < i)
-            code = clist_start_render_thread(dev, j, crdev->render_threads[j].band);
-    }
     gs_free_object(mem, reserve_memory_array, "clist_setup_render_threads");
     crdev->num_render_threads = i;
-    crdev->curr_render_thread = 0;
-    crdev->next_band = band;
+    crdev->next_band = first_band;
+    clist_setup_reorder_slots(dev, options);
+    clist_setup_band_splits(dev, options);
+
+    gx_monitor_enter(crdev->band_queue_lock);
+    code = clist_feed_render_threads(dev);
+    gx_monitor_leave(crdev->band_queue_lock);
 
     if(gs_debug[':'] != 0)
-        dmprintf1(mem, "%% Using %d rendering threads\n", i);
+        dmprintf2(mem, "%% Using %d rendering threads, %d reorder slots\n", i, crdev->num_reorder_slots);
 
     return code;
 }
@@ -597,45 +824,115 @@ clist_teardown_render_threads(gx_device *dev)
 
     if (crdev->render_threads != NULL) {
         /* Wait for all threads to finish */
-        for (i = (crdev->num_render_threads - 1); i >= 0; i--) {
-            clist_render_thread_control_t *thread = &(crdev->render_threads[i]);
+        gx_monitor_enter(crdev->band_queue_lock);
+        for (;;) {
+            for (i = 0; i < crdev->num_render_threads; i++)
+                if (crdev->render_threads[i].status == THREAD_BUSY)
+                    break;
+            if (i == crdev->num_render_threads)
+                break;
+            gx_monitor_leave(crdev->band_queue_lock);
+            gx_semaphore_wait(crdev->sema_band_done);
+            gx_monitor_enter(crdev->band_queue_lock);
+        }
+        gx_monitor_leave(crdev->band_queue_lock);
+
+        /* The data areas have been swapped around between the main device, */
+        /* the threads and the reorder buffer. Give the main device its own */
+        /* back before any of the others is freed.                          */
+        if (cdev->data != crdev->main_thread_data) {
+            for (i = 0; i < crdev->num_render_threads; i++) {
+                gx_device_clist_common *thread_cdev =
+                    (gx_device_clist_common *)crdev->render_threads[i].cdev;
+
+                if (thread_cdev->data == crdev->main_thread_data) {
+                    thread_cdev->data = cdev->data;
+                    cdev->data = crdev->main_thread_data;
+                    break;
+                }
+            }
+            for (i = 0; i < crdev->num_reorder_slots; i++) {
+                clist_band_reorder_slot_t *slot = &(crdev->reorder_slots[i]);
 
-            if (thread->status == THREAD_BUSY)
-                gx_semaphore_wait(thread->sema_this);
+                if (slot->data == crdev->main_thread_data) {
+                    slot->data = cdev->data;
+                    cdev->data = crdev->main_thread_data;
+                    break;
+                }
+            }
+            for (i = 0; i < crdev->num_split_bands; i++) {
+                clist_split_band_t *split = &(crdev->split_bands[i]);
+
+                if (split->data == crdev->main_thread_data) {
+                    split->data = cdev->data;
+                    cdev->data = crdev->main_thread_data;
+                    break;
+                }
+            }
+        }
+        /* The buffers have moved around too, so free each one using the */
+        /* allocator that it came from.                                  */
+        for (i = 0; i < crdev->num_reorder_slots; i++) {
+            clist_band_reorder_slot_t *slot = &(crdev->reorder_slots[i]);
+
+            if (slot->alloc_buffer != NULL && crdev->render_threads[0].options != NULL &&
+                crdev->render_threads[0].options->free_buffer_fn != NULL)
+                crdev->render_threads[0].options->free_buffer_fn(crdev->render_threads[0].options->arg,
+                                                                 dev, mem, slot->alloc_buffer);
+            gs_free_object(mem, slot->alloc_data, "clist_teardown_render_threads");
         }
+        gs_free_object(mem, crdev->reorder_slots, "clist_teardown_render_threads");
+        crdev->reorder_slots = NULL;
+        crdev->num_reorder_slots = 0;
+        for (i = 0; i < crdev->num_split_bands; i++) {
+            clist_split_band_t *split = &(crdev->split_bands[i]);
+
+            if (split->alloc_buffer != NULL && crdev->render_threads[0].options != NULL &&
+                crdev->render_threads[0].options->free_buffer_fn != NULL)
+                crdev->render_threads[0].options->free_buffer_fn(crdev->render_threads[0].options->arg,
+                                                                 dev, mem, split->alloc_buffer);
+            gs_free_object(mem, split->alloc_data, "clist_teardown_render_threads");
+        }
+        gs_free_object(mem, crdev->split_bands, "clist_teardown_render_threads");
+        crdev->split_bands = NULL;
+        crdev->num_split_bands = 0;
+
         /* then free each thread's memory */
         for (i = (crdev->num_render_threads - 1); i >= 0; i--) {
             clist_render_thread_control_t *thread = &(crdev->render_threads[i]);
             gx_device_clist_common *thread_cdev = (gx_device_clist_common *)thread->cdev;
 
-            /* Free control semaphores */
-            gx_semaphore_free(thread->sema_group);
-            gx_semaphore_free(thread->sema_this);
             /* destroy the thread's buffer device */
             thread_cdev->buf_procs.destroy_buf_device(thread->bdev);
 
             if (thread->options) {
-                if (thread->options->free_buffer_fn && thread->buffer) {
-                    thread->options->free_buffer_fn(thread->options->arg, dev, thread->memory, thread->buffer);
-                    thread->buffer = NULL;
+                if (thread->options->free_buffer_fn && thread->alloc_buffer) {
+                    thread->options->free_buffer_fn(thread->options->arg, dev, thread->memory, thread->alloc_buffer);
+                    thread->alloc_buffer = thread->buffer = NULL;
                 }
                 thread->options = NULL;
             }
-
-            /* before freeing this device's memory, swap with cdev if it was the main_thread_data */
-            if (thread_cdev->data == crdev->main_thread_data) {
-                thread_cdev->data = cdev->data;
-                cdev->data = crdev->main_thread_data;
-            }
 #ifdef DEBUG
             if (gs_debug[':'])
                 dmprintf2(thread->memory, "%% Thread %d total usertime=%ld msec\n", i, thread->cputime);
             dmprintf1(thread->memory, "\nThread %d ", i);
 #endif
-            teardown_device_and_mem_for_thread((gx_device *)thread_cdev, thread->thread, false);
+            if (thread_cdev->playback_profile != NULL) {
+                if (cdev->playback_profile != NULL)
+                    (void)clist_playback_profile_merge(cdev->playback_profile,
+                                                       thread_cdev->playback_profile);
+                clist_playback_profile_free(thread_cdev->playback_profile);
+                thread_cdev->playback_profile = NULL;
+            }
+            /* The OS thread stays in the pool, so there is nothing to finish */
+            teardown_device_and_mem_for_thread((gx_device *)thread_cdev, NULL, false);
         }
         gs_free_object(mem, crdev->render_threads, "clist_teardown_render_threads");
         crdev->render_threads = NULL;
+        gx_monitor_free(crdev->band_queue_lock);
+        crdev->band_queue_lock = NULL;
+        gx_semaphore_free(crdev->sema_band_done);
+        crdev->sema_band_done = NULL;
 
         /* Now re-open the clist temp files so we can write to them */
         if (cdev->page_info.cfile == NULL) {
@@ -654,42 +951,108 @@ clist_teardown_render_threads(gx_device *dev)
 }
 
 static int
-clist_start_render_thread(gx_device *dev, int thread_index, int band)
+clist_start_render_thread(gx_device *dev, int thread_index)
 {
     gx_device_clist *cldev = (gx_device_clist *)dev;
     gx_device_clist_reader *crdev = &cldev->reader;
-    int code;
+    clist_render_worker_t *worker = crdev->render_pool->workers[thread_index];
+    int code = 0;
 
-    crdev->render_threads[thread_index].band = band;
     crdev->render_threads[thread_index].status = THREAD_BUSY;
+    worker->job = &(crdev->render_threads[thread_index]);
 
-    /* Finally, fire it up */
-    code = gp_thread_start(clist_render_thread,
-                           &(crdev->render_threads[thread_index]),
-                           &(crdev->render_threads[thread_index].thread));
-    gp_thread_label(crdev->render_threads[thread_index].thread, "Band");
+    /* The first time this worker is used, fire up its thread. After  */
+    /* that the thread just waits on sema_start for its next band.    */
+    if (worker->thread == NULL) {
+        code = gp_thread_start(clist_render_worker, worker, &worker->thread);
+        if (code < 0) {
+            worker->thread = NULL;
+            worker->job = NULL;
+            crdev->render_threads[thread_index].status = THREAD_IDLE;
+            crdev->render_threads[thread_index].band = -1;
+            return code;
+        }
+        gp_thread_label(worker->thread, "Band");
+    }
+    gx_semaphore_signal(worker->sema_start);
 
     return code;
 }
 
+/* The body of a pooled rendering thread: render whatever band we are */
+/* handed until we are handed a NULL job by clist_free_render_pool.   */
 static void
-clist_render_thread(void *data)
+clist_render_worker(void *data)
+{
+    clist_render_worker_t *worker = (clist_render_worker_t *)data;
+
+    for (;;) {
+        gx_semaphore_wait(worker->sema_start);
+        if (worker->job == NULL)
+            break;
+        clist_render_thread(worker->job);
+    }
+}
+
+/* Set up the thread's buffer device for 'num_lines' lines starting at */
+/* line 'y' of a band of 'band_num_lines' whose bits are at 'mdata'.    */
+/* The line pointers always live in the thread's own data area.        */
+static int
+clist_setup_thread_buf(clist_render_thread_control_t *thread, byte *mdata,
+                       int y, int num_lines, int band_num_lines)
+{
+    gx_device_clist_reader *crdev = &((gx_device_clist *)thread->cdev)->reader;
+    byte *mlines = (crdev->page_line_ptrs_offset == 0 ? NULL :
+                    crdev->data + crdev->page_tile_cache_size + crdev->page_line_ptrs_offset);
+
+    return crdev->buf_procs.setup_buf_device
+            (thread->bdev, mdata, gx_device_raster_plane(thread->cdev, NULL), (byte **)mlines,
+             y, num_lines, band_num_lines);
+}
+
+/* Render lines y0 to y1 of the band starting at band_begin_line into */
+/* 'mdata', at the same place as they would be for the whole band.    */
+static int
+clist_render_band_lines(clist_render_thread_control_t *thread, byte *mdata,
+                        int band_begin_line, int band_num_lines, int y0, int y1)
+{
+    gx_device *dev = thread->cdev;
+    gx_device_clist *cldev = (gx_device_clist *)dev;
+    gs_int_rect band_rect;
+    int code;
+
+    code = clist_setup_thread_buf(thread, mdata, y0 - band_begin_line, y1 - y0, band_num_lines);
+    band_rect.p.x = 0;
+    band_rect.p.y = y0;
+    band_rect.q.x = dev->width;
+    band_rect.q.y = y1;
+    if (code >= 0)
+        code = clist_render_rectangle(cldev, &band_rect, thread->bdev, NULL, true);
+    return code;
+}
+
+/*
+ * Render the thread's current band into its data area or, if the thread
+ * has been given one part of a split band, that part into the split
+ * band's data area. A band is only rendered in parts when other threads
+ * can take them (see clist_next_render_job); otherwise it is rendered
+ * whole, as it is without threads.
+ */
+static int
+clist_render_band(clist_render_thread_control_t *thread)
 {
-    clist_render_thread_control_t *thread = (clist_render_thread_control_t *)data;
     gx_device *dev = thread->cdev;
     gx_device_clist *cldev = (gx_device_clist *)dev;
     gx_device_clist_reader *crdev = &cldev->reader;
-    gx_device *bdev = thread->bdev;
     gs_int_rect band_rect;
     byte *mdata = crdev->data + crdev->page_tile_cache_size;
-    byte *mlines = (crdev->page_line_ptrs_offset == 0 ? NULL : mdata + crdev->page_line_ptrs_offset);
-    uint raster = gx_device_raster_plane(dev, NULL);
-    int code;
+    int code = 0;
     int band_height = crdev->page_band_height;
     int band = thread->band;
     int band_begin_line = band * band_height;
     int band_end_line = band_begin_line + band_height;
     int band_num_lines;
+    int num_parts;
 #ifdef DEBUG
     long starttime[2], endtime[2];
 
@@ -698,49 +1061,286 @@ clist_render_thread(void *data)
     if (band_end_line > dev->height)
         band_end_line = dev->height;
     band_num_lines = band_end_line - band_begin_line;
-
-    code = crdev->buf_procs.setup_buf_device
-            (bdev, mdata, raster, (byte **)mlines, 0, band_num_lines, band_num_lines);
     band_rect.p.x = 0;
     band_rect.p.y = band_begin_line;
     band_rect.q.x = dev->width;
     band_rect.q.y = band_end_line;
-    if (code >= 0)
-        code = clist_render_rectangle(cldev, &band_rect, bdev, NULL, true);
 
-    if (code >= 0 && thread->options && thread->options->process_fn)
-        code = thread->options->process_fn(thread->options->arg, dev, bdev, &band_rect, thread->buffer);
+    if (thread->part >= 0) {
+        num_parts = thread->split->num_parts;
+        band_rect.p.y = band_begin_line + band_num_lines * thread->part / num_parts;
+        band_rect.q.y = band_begin_line + band_num_lines * (thread->part + 1) / num_parts;
+        crdev->rendering_band_part = true;
+        code = clist_render_band_lines(thread, thread->split->data + crdev->page_tile_cache_size,
+                                       band_begin_line, band_num_lines,
+                                       band_rect.p.y, band_rect.q.y);
+        crdev->rendering_band_part = false;
+    } else {
+        code = clist_render_band_lines(thread, mdata, band_begin_line, band_num_lines,
+                                       band_begin_line, band_end_line);
+        if (code >= 0 && thread->options && thread->options->process_fn)
+            code = thread->options->process_fn(thread->options->arg, dev, thread->bdev,
+                                               &band_rect, thread->buffer);
+    }
 
     /* Reset the band boundaries now */
-    crdev->ymin = band_begin_line;
-    crdev->ymax = band_end_line;
+    crdev->ymin = band_rect.p.y;
+    crdev->ymax = band_rect.q.y;
     crdev->offset_map = NULL;
-    if (code < 0)
-        thread->status = THREAD_ERROR;          /* shouldn't happen */
-    else
-        thread->status = THREAD_DONE;    /* OK */
 
 #ifdef DEBUG
     gp_get_usertime(endtime);
     thread->cputime += (endtime[0] - starttime[0]) * 1000 +
              (endtime[1] - starttime[1]) / 1000000;
 #endif
-    /*
-     * Signal the semaphores. We signal the 'group' first since even if
-     * the waiter is released on the group, it still needs to check
-     * status on the thread
-     */
-    gx_semaphore_signal(thread->sema_group);
-    gx_semaphore_signal(thread->sema_this);
+    return code;
+}
+
+/* Called by the thread that rendered the last part of a split band, to */
+/* do the process_page processing for the whole band.                   */
+static int
+clist_finish_split_band(clist_render_thread_control_t *thread)
+{
+    gx_device *dev = thread->cdev;
+    gx_device_clist_reader *crdev = &((gx_device_clist *)dev)->reader;
+    clist_split_band_t *split = thread->split;
+    gs_int_rect band_rect;
+    int band_num_lines;
+    int code;
+
+    if (thread->options == NULL || thread->options->process_fn == NULL)
+        return 0;
+    band_rect.p.x = 0;
+    band_rect.p.y = thread->band * crdev->page_band_height;
+    band_rect.q.x = dev->width;
+    band_rect.q.y = min(band_rect.p.y + crdev->page_band_height, dev->height);
+    band_num_lines = band_rect.q.y - band_rect.p.y;
+    code = clist_setup_thread_buf(thread, split->data + crdev->page_tile_cache_size,
+                                  0, band_num_lines, band_num_lines);
+    if (code >= 0)
+        code = thread->options->process_fn(thread->options->arg, dev, thread->bdev,
+                                           &band_rect, split->buffer);
+    return code;
 }
 
 /*
- * Copy the raster data from the completed thread to the caller's
- * device (the main thread)
+ * Called with the band_queue_lock held. Give the thread the next job to
+ * do: either the next band, or if that is one to be split, the next part
+ * of it. Return the band, or -1 if there is nothing left to hand out.
+ * A band is only shared between threads if there is a free area to
+ * render its parts into; otherwise one thread renders all of its parts.
+ */
+static int
+clist_next_render_job(gx_device_clist_reader *crdev, clist_render_thread_control_t *thread)
+{
+    int band = crdev->next_band;
+    clist_split_band_t *split = NULL;
+    int i, num_parts;
+
+    if (band < 0 || band >= crdev->nbands)
+        return -1;
+    if (crdev->next_part > 0) {
+        for (i = 0; i < crdev->num_split_bands; i++)
+            if (crdev->split_bands[i].band == band)
+                split = &(crdev->split_bands[i]);
+    } else if (crdev->num_split_bands > 0 && (num_parts = clist_band_parts(crdev, band)) > 1) {
+        for (i = 0; i < crdev->num_split_bands; i++) {
+            if (crdev->split_bands[i].band < 0) {
+                split = &(crdev->split_bands[i]);
+                split->band = band;
+                split->num_parts = num_parts;
+                split->parts_done = 0;
+                split->finished = false;
+                split->code = 0;
+                break;
+            }
+        }
+    }
+    thread->band = band;
+    thread->split = split;
+    if (split == NULL)
+        thread->part = -1;
+    else {
+        thread->part = crdev->next_part++;
+        if (crdev->next_part < split->num_parts)
+            return band;
+        crdev->next_part = 0;
+    }
+    crdev->next_band += crdev->thread_lookahead_direction;
+    return band;
+}
+
+/*
+ * Called with the band_queue_lock held, when 'thread' has finished its band.
+ * If there is another band left to render and a free slot in the reorder
+ * buffer, move the finished band (data and buffer) into the slot, and
+ * give the thread its next job. Return the band of the next job, or -1
+ * if there is none, in which case the thread keeps its band until it is
+ * collected.
+ */
+static int
+clist_park_band(gx_device_clist_reader *crdev, clist_render_thread_control_t *thread)
+{
+    gx_device_clist_common *thread_cdev = (gx_device_clist_common *)thread->cdev;
+    clist_band_reorder_slot_t *slot = NULL;
+    int i;
+    byte *tmp;
+    void *tmp_buffer;
+
+    if (crdev->next_band < 0 || crdev->next_band >= crdev->nbands)
+        return -1;
+    for (i = 0; i < crdev->num_reorder_slots; i++) {
+        if (crdev->reorder_slots[i].band < 0) {
+            slot = &(crdev->reorder_slots[i]);
+            break;
+        }
+    }
+    if (slot == NULL)
+        return -1;
+
+    slot->band = thread->band;
+    tmp = slot->data;
+    slot->data = thread_cdev->data;
+    thread_cdev->data = tmp;
+    tmp_buffer = slot->buffer;
+    slot->buffer = thread->buffer;
+    thread->buffer = tmp_buffer;
+    return clist_next_render_job(crdev, thread);
+}
+
+static void
+clist_render_thread(void *data)
+{
+    clist_render_thread_control_t *thread = (clist_render_thread_control_t *)data;
+    gx_device_clist_reader *main_crdev = &((gx_device_clist *)thread->main_dev)->reader;
+    clist_split_band_t *split;
+    int code, next_band;
+
+    /* Keep going for as long as we can park what we have rendered */
+    do {
+        code = clist_render_band(thread);
+
+        gx_monitor_enter(main_crdev->band_queue_lock);
+        next_band = -1;
+        if (thread->part >= 0) {
+            /* A part of a split band: we don't hold on to anything */
+            split = thread->split;
+            if (code < 0 && split->code == 0)
+                split->code = code;
+            if (++split->parts_done == split->num_parts) {
+                gx_monitor_leave(main_crdev->band_queue_lock);
+                code = split->code < 0 ? 0 : clist_finish_split_band(thread);
+                gx_monitor_enter(main_crdev->band_queue_lock);
+                if (code < 0 && split->code == 0)
+                    split->code = code;
+                split->finished = true;
+            }
+            if ((next_band = clist_next_render_job(main_crdev, thread)) < 0) {
+                thread->status = THREAD_IDLE;
+                thread->band = -1;
+                thread->part = -1;
+            }
+        } else if (code < 0)
+            thread->status = THREAD_ERROR;          /* shouldn't happen */
+        else if ((next_band = clist_park_band(main_crdev, thread)) < 0)
+            thread->status = THREAD_DONE;    /* OK */
+        gx_semaphore_signal(main_crdev->sema_band_done);
+        /* Once we have let go of the lock, 'thread' belongs to the main */
+        /* thread unless we are still busy with it.                      */
+        gx_monitor_leave(main_crdev->band_queue_lock);
+    } while (next_band >= 0);
+}
+
+/*
+ * Called with the band_queue_lock held. Hand out the remaining bands to
+ * threads that can take one: those that are idle, and those that are
+ * done with a band that can be moved into the reorder buffer.
+ */
+static int
+clist_feed_render_threads(gx_device *dev)
+{
+    gx_device_clist *cldev = (gx_device_clist *)dev;
+    gx_device_clist_reader *crdev = &cldev->reader;
+    int i, band, code = 0;
+
+    for (i = 0; i < crdev->num_render_threads && code >= 0; i++) {
+        clist_render_thread_control_t *thread = &(crdev->render_threads[i]);
+
+        if (crdev->next_band < 0 || crdev->next_band >= crdev->nbands)
+            break;
+        if (thread->status == THREAD_IDLE)
+            band = clist_next_render_job(crdev, thread);
+        else if (thread->status == THREAD_DONE)
+            band = clist_park_band(crdev, thread);
+        else
+            continue;
+        if (band >= 0)
+            code = clist_start_render_thread(dev, i);
+    }
+    return code;
+}
+
+/*
+ * Called with the band_queue_lock held, when no thread has (or is working
+ * on) the band we need. Probably we went in the wrong direction, so let the
+ * threads all complete, then restart them in the opposite direction.
+ * If the caller is 'bouncing around' we may end up back here, but that is
+ * a VERY rare case (we haven't seen it yet).
+ */
+static int
+clist_restart_render_threads(gx_device *dev, int band_needed)
+{
+    gx_device_clist *cldev = (gx_device_clist *)dev;
+    gx_device_clist_reader *crdev = &cldev->reader;
+    int i;
+    int band_count = crdev->nbands;
+
+    emprintf2(dev->memory, "band_needed = %d, direction = %d, ",
+              band_needed, crdev->thread_lookahead_direction);
+
+    for (;;) {
+        for (i = 0; i < crdev->num_render_threads; i++)
+            if (crdev->render_threads[i].status == THREAD_BUSY)
+                break;
+        if (i == crdev->num_render_threads)
+            break;
+        gx_monitor_leave(crdev->band_queue_lock);
+        gx_semaphore_wait(crdev->sema_band_done);
+        gx_monitor_enter(crdev->band_queue_lock);
+    }
+    /* Throw away everything rendered so far */
+    for (i = 0; i < crdev->num_reorder_slots; i++)
+        crdev->reorder_slots[i].band = -1;
+    for (i = 0; i < crdev->num_split_bands; i++)
+        crdev->split_bands[i].band = -1;
+    for (i = 0; i < crdev->num_render_threads; i++) {
+        crdev->render_threads[i].status = THREAD_IDLE;
+        crdev->render_threads[i].band = -1;
+        crdev->render_threads[i].part = -1;
+    }
+
+    crdev->thread_lookahead_direction *= -1;      /* reverse direction (but may be overruled below) */
+    if (band_needed == band_count-1)
+        crdev->thread_lookahead_direction = -1;   /* assume backwards if we are asking for the last band */
+    if (band_needed == 0)
+        crdev->thread_lookahead_direction = 1;    /* force forward if we are looking for band 0 */
+
+    dmprintf1(dev->memory, "new_direction = %d\n", crdev->thread_lookahead_direction);
+
+    /* Start the threads again in the new lookahead_direction */
+    crdev->next_band = band_needed;
+    crdev->next_part = 0;
+    return clist_feed_render_threads(dev);
+}
+
+/*
+ * Copy the raster data for the band from the thread (or reorder buffer
+ * slot, or split band) that rendered it to the caller's device (the main
+ * thread).
  * Return 0 if OK, < 0 is the error code from the thread
  *
- * After swapping the pointers, start up the completed thread with the
- * next band remaining to do (if any)
+ * Bands may complete in any order; after swapping the pointers, hand out
+ * the next bands remaining to do (if any) to the threads that are free.
  */
 static int
 clist_get_band_from_thread(gx_device *dev, int band_needed, gx_process_page_options_t *options)
@@ -749,85 +1349,106 @@ clist_get_band_from_thread(gx_device *dev, int band_needed, gx_process_page_opti
     gx_device_clist_common *cdev = (gx_device_clist_common *)dev;
     gx_device_clist_reader *crdev = &cldev->reader;
     int i, code = 0;
-    int thread_index = crdev->curr_render_thread;
-    clist_render_thread_control_t *thread = &(crdev->render_threads[thread_index]);
-    gx_device_clist_common *thread_cdev = (gx_device_clist_common *)thread->cdev;
+    clist_render_thread_control_t *thread;
+    clist_band_reorder_slot_t *slot;
+    clist_split_band_t *split;
+    gx_device_clist_common *thread_cdev;
     int band_height = crdev->page_info.band_params.BandHeight;
-    int band_count = cdev->nbands;
     byte *tmp;                  /* for swapping data areas */
-
-    /* We expect that the thread needed will be the 'current' thread */
-    if (thread->band != band_needed) {
-        int band = band_needed;
-
-        emprintf3(thread->memory,
-                  "thread->band = %d, band_needed = %d, direction = %d, ",
-                  thread->band, band_needed, crdev->thread_lookahead_direction);
-
-        /* Probably we went in the wrong direction, so let the threads */
-        /* all complete, then restart them in the opposite direction   */
-        /* If the caller is 'bouncing around' we may end up back here, */
-        /* but that is a VERY rare case (we haven't seen it yet).      */
-        for (i=0; i < crdev->num_render_threads; i++) {
-            clist_render_thread_control_t *thread = &(crdev->render_threads[i]);
-
-            if (thread->status == THREAD_BUSY)
-                gx_semaphore_wait(thread->sema_this);
+    byte **pdata;
+    void *buffer;
+
+    /* Wait until the band we need has been rendered */
+    gx_monitor_enter(crdev->band_queue_lock);
+    for (;;) {
+        slot = NULL;
+        split = NULL;
+        thread = NULL;
+        for (i = 0; i < crdev->num_reorder_slots; i++) {
+            if (crdev->reorder_slots[i].band == band_needed) {
+                slot = &(crdev->reorder_slots[i]);
+                break;
+            }
         }
-        crdev->thread_lookahead_direction *= -1;      /* reverse direction (but may be overruled below) */
-        if (band_needed == band_count-1)
-            crdev->thread_lookahead_direction = -1;   /* assume backwards if we are asking for the last band */
-        if (band_needed == 0)
-            crdev->thread_lookahead_direction = 1;    /* force forward if we are looking for band 0 */
-
-        dmprintf1(thread->memory, "new_direction = %d\n", crdev->thread_lookahead_direction);
-
-        /* Loop starting the threads in the new lookahead_direction */
-        for (i=0; (i < crdev->num_render_threads) && (band >= 0) && (band < band_count);
-                i++, band += crdev->thread_lookahead_direction) {
-            thread = &(crdev->render_threads[i]);
-            thread->band = -1;          /* a value that won't match any valid band */
-            /* Start thread 'i' to do band */
-            if ((code = clist_start_render_thread(dev, i, band)) < 0)
+        if (slot != NULL)
+            break;
+        for (i = 0; i < crdev->num_split_bands; i++) {
+            if (crdev->split_bands[i].band == band_needed) {
+                split = &(crdev->split_bands[i]);
                 break;
+            }
         }
-        crdev->next_band = i;			/* may be < 0 or == band_count, but that is handled later */
-        crdev->curr_render_thread = thread_index = 0;
-        thread = &(crdev->render_threads[0]);
-        thread_cdev = (gx_device_clist_common *)thread->cdev;
+        if (split != NULL) {
+            if (split->finished)
+                break;
+        } else {
+            for (i = 0; i < crdev->num_render_threads; i++) {
+                if (crdev->render_threads[i].band == band_needed) {
+                    thread = &(crdev->render_threads[i]);
+                    break;
+                }
+            }
+            if (thread == NULL) {
+                if ((code = clist_restart_render_threads(dev, band_needed)) < 0)
+                    break;
+                continue;
+            }
+            if (thread->status != THREAD_BUSY)
+                break;
+        }
+        gx_monitor_leave(crdev->band_queue_lock);
+        gx_semaphore_wait(crdev->sema_band_done);
+        gx_monitor_enter(crdev->band_queue_lock);
     }
-    /* Wait for this thread */
-    gx_semaphore_wait(thread->sema_this);
-    gp_thread_finish(thread->thread);
-    thread->thread = NULL;
-    if (thread->status == THREAD_ERROR)
-        return_error(gs_error_unknownerror);          /* FAIL */
+    gx_monitor_leave(crdev->band_queue_lock);
+    if (code < 0)
+        return code;
 
+    /* Nobody else touches a finished band, so no need for the lock here */
+    if (slot != NULL) {
+        pdata = &slot->data;
+        buffer = slot->buffer;
+    } else if (split != NULL) {
+        if (split->code < 0)
+            return split->code;
+        pdata = &split->data;
+        buffer = split->buffer;
+    } else {
+        if (thread->status == THREAD_ERROR)
+            return_error(gs_error_unknownerror);          /* FAIL */
+        thread_cdev = (gx_device_clist_common *)thread->cdev;
+        pdata = &thread_cdev->data;
+        buffer = thread->buffer;
+    }
     if (options && options->output_fn) {
-        code = options->output_fn(options->arg, dev, thread->buffer);
+        code = options->output_fn(options->arg, dev, buffer);
         if (code < 0)
             return code;
     }
-
     /* Swap the data areas to avoid the copy */
     tmp = cdev->data;
-    cdev->data = thread_cdev->data;
-    thread_cdev->data = tmp;
-    thread->status = THREAD_IDLE;        /* the data is no longer valid */
-    thread->band = -1;
+    cdev->data = *pdata;
+    *pdata = tmp;
+
     /* Update the bounds for this band */
     cdev->ymin =  band_needed * band_height;
     cdev->ymax =  cdev->ymin + band_height;
     if (cdev->ymax > dev->height)
         cdev->ymax = dev->height;
-
-    if (crdev->next_band >= 0 && crdev->next_band < band_count) {
-        code = clist_start_render_thread(dev, thread_index, crdev->next_band);
-        crdev->next_band += crdev->thread_lookahead_direction;
+    clist_page_cache_put_band(crdev, band_needed, cdev->data + cdev->page_tile_cache_size);
+
+    gx_monitor_enter(crdev->band_queue_lock);
+    /* the data is no longer valid */
+    if (slot != NULL)
+        slot->band = -1;
+    else if (split != NULL)
+        split->band = -1;
+    else {
+        thread->status = THREAD_IDLE;
+        thread->band = -1;
     }
-    /* bump the 'curr' to the next thread */
-    crdev->curr_render_thread = crdev->curr_render_thread == crdev->num_render_threads - 1 ?
-                0 : crdev->curr_render_thread + 1;
+    code = clist_feed_render_threads(dev);
+    gx_monitor_leave(crdev->band_queue_lock);
 
     return code;
 }
@@ -874,6 +1495,10 @@ clist_get_bits_rect_mt(gx_device *dev, const gs_int_rect * prect,
         if ((code = clist_close_writer_and_init_reader(cldev)) < 0)
             return code;	/* can't recover from this */
 
+    /* A page that is already in the DuplicatePageCache needs no threads */
+    if (crdev->render_threads == NULL && clist_page_cache_is_complete(crdev))
+        return clist_get_bits_rectangle(dev, prect, params);
+
     if (crdev->ymin == 0 && crdev->ymax == 0 && crdev->render_threads == NULL) {
         /* Haven't done any rendering yet, try to set up the threads */
         if (clist_setup_render_threads(dev, y, NULL) < 0)
@@ -1054,6 +1679,9 @@ clist_process_page_mt(gx_device *dev, gx_process_page_options_t *options)
     if ((code = clist_close_writer_and_init_reader(cldev)) < 0)
         return code;	/* can't recover from this */
 
+    if (clist_page_cache_is_complete(crdev))
+        return clist_process_page(dev, options);
+
     /* Haven't done any rendering yet, try to set up the threads */
     if (clist_setup_render_threads(dev, reverse ? dev->height-1 : 0, options) < 0)
         /* problem setting up the threads, revert to single threaded */
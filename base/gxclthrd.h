@@ -49,20 +49,65 @@ typedef enum {
 struct clist_render_thread_control_s {
     thread_status status;	/* 0: not started, 1: done, 2: busy, < 0: error */
                                 /* values allow waiting until status < 2 */
+                                /* changed only with main_dev's band_queue_lock held */
     gs_memory_t *memory;	/* thread's 'chunk' memory allocator */
-    gx_semaphore_t *sema_this;
-    gx_semaphore_t *sema_group;
+    gx_device *main_dev;	/* the device whose bands we render */
     gx_device *cdev;	/* clist device copy */
     gx_device *bdev;	/* this thread's buffer device */
     int band;
-    gp_thread_id thread;
+    int part;			/* sub-band of 'band' to render, -1 for all of it */
+    clist_split_band_t *split;	/* where the sub-band goes, if part >= 0 */
 
     /* For process_page mode */
     gx_process_page_options_t *options;
-    void *buffer;
+    void *buffer;		/* may move to and from the reorder buffer */
+    void *alloc_buffer;		/* the buffer we allocated, for freeing */
 #ifdef DEBUG
     ulong cputime;
 #endif
 };
 
+/* A slot in the reorder buffer. A thread that finishes a band that isn't */
+/* wanted yet swaps its band data (and process_page buffer) into a free    */
+/* slot and goes on with the next unrendered band, rather than sitting on  */
+/* its result until the bands before it have been collected.               */
+struct clist_band_reorder_slot_s {
+    int band;			/* band held, -1 if the slot is free */
+    byte *data;			/* rendered band data, swapped with thread data */
+    void *buffer;		/* process_page buffer for the band */
+    byte *alloc_data;		/* what we allocated, for freeing */
+    void *alloc_buffer;
+};
+
+/* A band whose command list is costly enough (compared to the rest of */
+/* the page) that it is split into sub-bands, rendered by separate      */
+/* threads directly into 'data'. The thread that completes the last    */
+/* part does the process_page processing for the whole band.           */
+struct clist_split_band_s {
+    int band;			/* band being rendered, -1 if free */
+    int num_parts;
+    int parts_done;
+    bool finished;		/* all parts rendered and processed */
+    int code;			/* first error from any of the parts */
+    byte *data;			/* band data, swapped with the main device's */
+    void *buffer;		/* process_page buffer for the band */
+    byte *alloc_data;		/* what we allocated, for freeing */
+    void *alloc_buffer;
+};
+
+/* The OS threads that render the bands are kept by the clist device and */
+/* reused for every band of every page until the device is closed, so    */
+/* that we don't pay for a thread create/join per band.                  */
+typedef struct clist_render_worker_s {
+    gp_thread_id thread;	/* NULL until the thread is started */
+    gx_semaphore_t *sema_start;	/* signalled when 'job' has work */
+    clist_render_thread_control_t *job;	/* NULL asks the thread to exit */
+} clist_render_worker_t;
+
+struct clist_render_pool_s {
+    gs_memory_t *memory;	/* thread safe, non gc memory */
+    int num_workers;
+    clist_render_worker_t **workers;	/* allocated individually, see gxclthrd.c */
+};
+
 #endif /* gxclthrd_INCLUDED */
@@ -32,7 +32,7 @@
 
 /* ---------------- Statistics ---------------- */
 
-#ifdef DEBUG
+/* The command names are also used by the BandProfile report. */
 const char *const cmd_op_names[16] =
 {cmd_op_name_strings};
 static const char *const cmd_misc_op_names[16] =
@@ -51,6 +51,7 @@ const char *const *const cmd_sub_op_names[16] =
 const char *cmd_extend_op_names[256] =
 {cmd_extend_op_name_strings};
 
+#ifdef DEBUG
 #ifdef COLLECT_STATS_CLIST
 struct stats_cmd_s {
     ulong op_counts[512];
@@ -204,6 +205,7 @@ cmd_write_band(gx_device_clist_writer * cldev, int band_min, int band_max,
     const cmd_prefix *cp = pcl->head;
     int code_b = 0;
     int code_c = 0;
+    int64_t size = 0;
 
     if (cp != 0 || cmd_end != cmd_opv_end_run) {
         clist_file_ptr cfile = cldev->page_cfile;
@@ -219,6 +221,10 @@ cmd_write_band(gx_device_clist_writer * cldev, int band_min, int band_max,
         if_debug3m('l', cldev->memory, "[l]writing for bands (%d,%d) at %"PRId64"\n",
                   band_min, band_max, cb.pos);
         cldev->page_info.io_procs->fwrite_chars(&cb, sizeof(cb), bfile);
+        if (cldev->page_hashing) {
+            gs_md5_append(&cldev->page_md5, (const gs_md5_byte_t *)&band_min, sizeof(band_min));
+            gs_md5_append(&cldev->page_md5, (const gs_md5_byte_t *)&band_max, sizeof(band_max));
+        }
         if (cp != 0) {
             pcl->tail->next = 0;	/* terminate the list */
             for (; cp != 0; cp = cp->next) {
@@ -234,12 +240,20 @@ cmd_write_band(gx_device_clist_writer * cldev, int band_min, int band_max,
                 if_debug2m('L', cldev->memory, "[L] cmd id=%ld at %"PRId64"\n",
                            cp->id, cldev->page_info.io_procs->ftell(cfile));
                 cldev->page_info.io_procs->fwrite_chars(cp + 1, cp->size, cfile);
+                if (cldev->page_hashing)
+                    gs_md5_append(&cldev->page_md5, (const gs_md5_byte_t *)(cp + 1), cp->size);
+                size += cp->size;
             }
             pcl->head = pcl->tail = 0;
         }
+        /* Keep a tally of each band's own commands for the reader */
+        if (band_min == band_max && band_min >= 0 && band_min < cldev->nbands)
+            cldev->states[band_min].color_usage.cmd_bytes += size;
         if_debug0m('L', cldev->memory, "[L] adding terminator");
         end  = cmd_count_op(cmd_end, 1, cldev->memory);
         cldev->page_info.io_procs->fwrite_chars(&end, 1, cfile);
+        if (cldev->page_hashing)
+            gs_md5_append(&cldev->page_md5, &end, 1);
         process_interrupts(cldev->memory);
         code_b = cldev->page_info.io_procs->ferror_code(bfile);
         code_c = cldev->page_info.io_procs->ferror_code(cfile);
@@ -284,6 +298,10 @@ cmd_write_pseudo_band(gx_device_clist_writer * cldev, unsigned char *pbuf, int d
             data_size, cldev->page_info.io_procs->ftell(cfile));
 
     cldev->page_info.io_procs->fwrite_chars(pbuf, data_size, cfile);
+    if (cldev->page_hashing) {
+        gs_md5_append(&cldev->page_md5, (const gs_md5_byte_t *)&band, sizeof(band));
+        gs_md5_append(&cldev->page_md5, pbuf, data_size);
+    }
 
     process_interrupts(cldev->memory);
     code_b = cldev->page_info.io_procs->ferror_code(bfile);
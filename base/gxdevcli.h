@@ -672,9 +672,19 @@ typedef struct gx_band_params_s {
     int BandHeight;		/* (optional) */
     size_t BandBufferSpace;	/* (optional) */
     size_t tile_cache_size;	/* (optional) */
+    int BandProfile;		/* (optional) gx_band_profile_type */
+    size_t DuplicatePageCache;	/* (optional) bytes of rendered bands kept */
+                                /* for reuse by repeated pages, 0 = off */
 } gx_band_params_t;
 
-#define BAND_PARAMS_INITIAL_VALUES 0, 0, 0, 0
+#define BAND_PARAMS_INITIAL_VALUES 0, 0, 0, 0, 0, 0
+
+/* Report formats for the clist playback profile (BandProfile). */
+typedef enum {
+    BandProfileNone = 0,
+    BandProfileCSV,
+    BandProfileJSON
+} gx_band_profile_type;
 
 typedef enum {
     BandingAuto = 0,
@@ -19,6 +19,9 @@
 #include "string_.h"
 #include "gdevprn.h"
 #include "assert_.h"
+#include "gsparam.h"
+#include "gxdevsop.h"
+#include "gxsync.h"
 
 #ifdef WITH_CAL
 #include "cal_ets.h"
@@ -26,6 +29,20 @@
 #include "ets.h"
 #endif
 
+#ifdef HAVE_SSE2
+#include <emmintrin.h>
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__)) && \
+    (defined(__clang__) || __GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))
+/* Only the functions marked for it are built for AVX2, and they are only */
+/* called if the CPU we are running on has it.                            */
+#define DOWNSCALE_AVX2
+#include <immintrin.h>
+#endif
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define DOWNSCALE_NEON
+#include <arm_neon.h>
+#endif
+
 /* Nasty inline declaration, as gxht_thresh.h requires penum */
 void gx_ht_threshold_row_bit_sub(byte *contone,  byte *threshold_strip,
                              int contone_stride, byte *halftone,
@@ -195,6 +212,11 @@ static void down_core(gx_downscaler_t *ds,
     pack_8to1(out_buffer, outp, awidth);
 }
 
+/* The ETS cores are not run in the pipeline below. ets_line couples the
+ * planes at each pixel, so they can't be split by component. Nor can rows
+ * overlap: each row ends with a right to left pass updating the distances
+ * that the next row starts from at its left edge, and the pseudo random
+ * seeds run on from one row to the next. */
 static void down_core_ets_1(gx_downscaler_t *ds,
                             byte            *out_buffer,
                             byte            *in_buffer,
@@ -773,121 +795,161 @@ static void down_core_mfs(gx_downscaler_t *ds,
 }
 
 /* CMYK 32 -> 4bit core */
-static void down_core4(gx_downscaler_t *ds,
-                       byte            *out_buffer,
-                       byte            *in_buffer,
-                       int              row,
-                       int              plane /* unused */,
-                       int              span)
+/* The CMYK error diffusion cores run one component at a time across the
+ * row. Each component keeps its own error row, and the only thing passed
+ * from one component to the next is the forward error left at the end of
+ * the row. That lets the pipeline below run component n of one row at the
+ * same time as component n-1 of the following row, with the same results
+ * as running them in turn. */
+static void down_core4_pad(gx_downscaler_t *ds,
+                           byte            *in_buffer,
+                           int              span)
 {
-    int        x, xx, y, value, comp;
-    int        e_downleft, e_down, e_forward = 0;
-    int        pad_white;
+    int   y;
+    int   factor    = ds->factor;
+    int   pad_white = (ds->awidth - ds->width) * factor * 4;
+    byte *inp;
+
+    if (pad_white <= 0)
+        return;
+
+    inp = in_buffer + ds->width*factor*4;
+    for (y = factor; y > 0; y--)
+    {
+        memset(inp, 0xFF, pad_white);
+        inp += span;
+    }
+}
+
+static void down_core4_pack(gx_downscaler_t *ds,
+                            byte            *out_buffer,
+                            byte            *in_buffer,
+                            int              row)
+{
+    int awidth = ds->awidth;
+
+    if ((row & 1) == 0)
+        pack_8to1(out_buffer, in_buffer, awidth*4);
+    else
+        pack_8to1(out_buffer, in_buffer + awidth*ds->factor*4 - (awidth*4),
+                  awidth*4);
+}
+
+/* Error diffuse one component of a row, starting with the forward error
+ * e_forward, and return the forward error at the end of the row. */
+typedef int (down_core4_comp_fn)(gx_downscaler_t *ds,
+                                 byte            *in_buffer,
+                                 int              row,
+                                 int              comp,
+                                 int              span,
+                                 int              e_forward);
+
+static int down_core4_comp(gx_downscaler_t *ds,
+                           byte            *in_buffer,
+                           int              row,
+                           int              comp,
+                           int              span,
+                           int              e_forward)
+{
+    int        x, xx, y, value;
+    int        e_downleft, e_down;
     byte      *inp, *outp;
-    int        width     = ds->width;
     int        awidth    = ds->awidth;
     int        factor    = ds->factor;
-    int       *errors    = ds->errors;
+    int       *errors;
     const int  threshold = factor*factor*128;
     const int  max_value = factor*factor*255;
 
-    pad_white = (awidth - width) * factor * 4;
-    if (pad_white < 0)
-        pad_white = 0;
-
-    if (pad_white)
-    {
-        inp = in_buffer + width*factor * 4;
-        for (y = factor; y > 0; y--)
-        {
-            memset(inp, 0xFF, pad_white);
-            inp += span;
-        }
-    }
-
     if ((row & 1) == 0)
     {
         /* Left to Right pass (no min feature size) */
         const int back = span * factor - 4;
-        for (comp = 0; comp < 4; comp++)
+        errors = ds->errors + (awidth+3)*comp + 2;
+        inp = in_buffer + comp;
+        outp = inp;
+        for (x = awidth; x > 0; x--)
         {
-            errors = ds->errors + (awidth+3)*comp + 2;
-            inp = in_buffer + comp;
-            outp = inp;
-            for (x = awidth; x > 0; x--)
+            value = e_forward + *errors;
+            for (xx = factor; xx > 0; xx--)
             {
-                value = e_forward + *errors;
-                for (xx = factor; xx > 0; xx--)
-                {
-                    for (y = factor; y > 0; y--)
-                    {
-                        value += *inp;
-                        inp += span;
-                    }
-                    inp -= back;
-                }
-                if (value >= threshold)
-                {
-                    *outp = 1; outp += 4;
-                    value -= max_value;
-                }
-                else
+                for (y = factor; y > 0; y--)
                 {
-                    *outp = 0; outp += 4;
+                    value += *inp;
+                    inp += span;
                 }
-                e_forward  = value * 7/16;
-                e_downleft = value * 3/16;
-                e_down     = value * 5/16;
-                value     -= e_forward + e_downleft + e_down;
-                errors[-2] += e_downleft;
-                errors[-1] += e_down;
-                *errors++   = value;
+                inp -= back;
+            }
+            if (value >= threshold)
+            {
+                *outp = 1; outp += 4;
+                value -= max_value;
             }
+            else
+            {
+                *outp = 0; outp += 4;
+            }
+            e_forward  = value * 7/16;
+            e_downleft = value * 3/16;
+            e_down     = value * 5/16;
+            value     -= e_forward + e_downleft + e_down;
+            errors[-2] += e_downleft;
+            errors[-1] += e_down;
+            *errors++   = value;
         }
-        outp = in_buffer;
     }
     else
     {
         /* Right to Left pass (no min feature size) */
         const int back = span * factor + 4;
-        for (comp = 0; comp < 4; comp++)
+        errors = ds->errors + (awidth+3)*comp + awidth;
+        inp = in_buffer + awidth*factor*4 - 4 + comp;
+        outp = inp;
+        for (x = awidth; x > 0; x--)
         {
-            errors = ds->errors + (awidth+3)*comp + awidth;
-            inp = in_buffer + awidth*factor*4 - 4 + comp;
-            outp = inp;
-            for (x = awidth; x > 0; x--)
+            value = e_forward + *errors;
+            for (xx = factor; xx > 0; xx--)
             {
-                value = e_forward + *errors;
-                for (xx = factor; xx > 0; xx--)
-                {
-                    for (y = factor; y > 0; y--)
-                    {
-                        value += *inp;
-                        inp += span;
-                    }
-                    inp -= back;
-                }
-                if (value >= threshold)
-                {
-                    *outp = 1; outp -= 4;
-                    value -= max_value;
-                }
-                else
+                for (y = factor; y > 0; y--)
                 {
-                    *outp = 0; outp -= 4;
+                    value += *inp;
+                    inp += span;
                 }
-                e_forward  = value * 7/16;
-                e_downleft = value * 3/16;
-                e_down     = value * 5/16;
-                value     -= e_forward + e_downleft + e_down;
-                errors[2] += e_downleft;
-                errors[1] += e_down;
-                *errors--   = value;
+                inp -= back;
             }
+            if (value >= threshold)
+            {
+                *outp = 1; outp -= 4;
+                value -= max_value;
+            }
+            else
+            {
+                *outp = 0; outp -= 4;
+            }
+            e_forward  = value * 7/16;
+            e_downleft = value * 3/16;
+            e_down     = value * 5/16;
+            value     -= e_forward + e_downleft + e_down;
+            errors[2] += e_downleft;
+            errors[1] += e_down;
+            *errors--   = value;
         }
-        outp = in_buffer + awidth*factor*4 - (awidth*4);
     }
-    pack_8to1(out_buffer, outp, awidth*4);
+    return e_forward;
+}
+
+static void down_core4(gx_downscaler_t *ds,
+                       byte            *out_buffer,
+                       byte            *in_buffer,
+                       int              row,
+                       int              plane /* unused */,
+                       int              span)
+{
+    int comp, e_forward = 0;
+
+    down_core4_pad(ds, in_buffer, span);
+    for (comp = 0; comp < 4; comp++)
+        e_forward = down_core4_comp(ds, in_buffer, row, comp, span, e_forward);
+    down_core4_pack(ds, out_buffer, in_buffer, row);
 }
 
 static void down_core4_ht(gx_downscaler_t *ds,
@@ -1008,182 +1070,602 @@ static void down_core4_ets(gx_downscaler_t *ds,
     pack_8to1(out_buffer, in_buffer, ds->awidth * 4);
 }
 
-static void down_core4_mfs(gx_downscaler_t *ds,
-                           byte            *out_buffer,
-                           byte            *in_buffer,
-                           int              row,
-                           int              plane /* unused */,
-                           int              span)
+static int down_core4_mfs_comp(gx_downscaler_t *ds,
+                               byte            *in_buffer,
+                               int              row,
+                               int              comp,
+                               int              span,
+                               int              e_forward)
 {
-    int        x, xx, y, value, comp;
-    int        e_downleft, e_down, e_forward = 0;
-    int        pad_white;
+    int        x, xx, y, value;
+    int        e_downleft, e_down;
     byte      *inp, *outp;
-    int        width     = ds->width;
     int        awidth    = ds->awidth;
     int        factor    = ds->factor;
     int       *errors;
     const int  threshold = factor*factor*128;
     const int  max_value = factor*factor*255;
     byte      *mfs_data;
-
-    pad_white = (awidth - width) * factor * 4;
-    if (pad_white < 0)
-        pad_white = 0;
-
-    if (pad_white)
-    {
-        inp = in_buffer + width*factor*4;
-        for (y = factor*4; y > 0; y--)
-        {
-            memset(inp, 0xFF, pad_white);
-            inp += span;
-        }
-    }
+    byte       mfs, force_forward = 0;
 
     if ((row & 1) == 0)
     {
         /* Left to Right pass (with min feature size = 2) */
         const int back = span * factor - 4;
-        for (comp = 0; comp < 4; comp++)
+        errors = ds->errors + (awidth+3)*comp + 2;
+        inp = in_buffer + comp;
+        outp = inp;
+        mfs_data = ds->mfs_data + (awidth+1)*comp;
+        *mfs_data++ = mfs_clear;
+        for (x = awidth; x > 0; x--)
         {
-            byte mfs, force_forward = 0;
-            errors = ds->errors + (awidth+3)*comp + 2;
-            inp = in_buffer + comp;
-            outp = inp;
-            mfs_data = ds->mfs_data + (awidth+1)*comp;
-            *mfs_data++ = mfs_clear;
-            for (x = awidth; x > 0; x--)
+            value = e_forward + *errors;
+            for (xx = factor; xx > 0; xx--)
             {
-                value = e_forward + *errors;
-                for (xx = factor; xx > 0; xx--)
-                {
-                    for (y = factor; y > 0; y--)
-                    {
-                        value += *inp;
-                        inp += span;
-                    }
-                    inp -= back;
-                }
-                mfs = *mfs_data;
-                *mfs_data++ = mfs_clear;
-                if ((mfs & mfs_force_off) || force_forward)
+                for (y = factor; y > 0; y--)
                 {
-                    /* We are being forced to be 0 */
-                    *outp = 1; outp += 4;
-                    value -= max_value;
-                    force_forward = 0;
+                    value += *inp;
+                    inp += span;
                 }
-                else if (value >= threshold)
+                inp -= back;
+            }
+            mfs = *mfs_data;
+            *mfs_data++ = mfs_clear;
+            if ((mfs & mfs_force_off) || force_forward)
+            {
+                /* We are being forced to be 0 */
+                *outp = 1; outp += 4;
+                value -= max_value;
+                force_forward = 0;
+            }
+            else if (value >= threshold)
+            {
+                /* We want to be 1 anyway */
+                *outp = 1; outp += 4;
+                value -= max_value;
+                if ((mfs & (mfs_above_is_0 | mfs_above_left_is_0))
+                        != (mfs_above_is_0 | mfs_above_left_is_0))
                 {
-                    /* We want to be 1 anyway */
-                    *outp = 1; outp += 4;
-                    value -= max_value;
-                    if ((mfs & (mfs_above_is_0 | mfs_above_left_is_0))
-                            != (mfs_above_is_0 | mfs_above_left_is_0))
-                    {
-                        /* We aren't in a group anyway, so must force other
-                         * pixels. */
-                        mfs_data[-2] |= mfs_force_off;
-                        mfs_data[-1] |= mfs_force_off;
-                        force_forward = 1;
-                    }
-                    else
-                    {
-                        /* No forcing, but we need to tell other pixels that
-                         * we were 1. */
-                        mfs_data[-2] |= mfs_above_is_0;
-                        mfs_data[-1] |= mfs_above_left_is_0;
-                    }
+                    /* We aren't in a group anyway, so must force other
+                     * pixels. */
+                    mfs_data[-2] |= mfs_force_off;
+                    mfs_data[-1] |= mfs_force_off;
+                    force_forward = 1;
                 }
                 else
                 {
-                    *outp = 0; outp += 4;
+                    /* No forcing, but we need to tell other pixels that
+                     * we were 1. */
+                    mfs_data[-2] |= mfs_above_is_0;
+                    mfs_data[-1] |= mfs_above_left_is_0;
                 }
-                e_forward  = value * 7/16;
-                e_downleft = value * 3/16;
-                e_down     = value * 5/16;
-                value     -= e_forward + e_downleft + e_down;
-                errors[-2] += e_downleft;
-                errors[-1] += e_down;
-                *errors++   = value;
             }
+            else
+            {
+                *outp = 0; outp += 4;
+            }
+            e_forward  = value * 7/16;
+            e_downleft = value * 3/16;
+            e_down     = value * 5/16;
+            value     -= e_forward + e_downleft + e_down;
+            errors[-2] += e_downleft;
+            errors[-1] += e_down;
+            *errors++   = value;
         }
-        outp = in_buffer;
     }
     else
     {
         /* Right to Left pass (with min feature size = 2) */
         const int back = span * factor + 4;
-        for (comp = 0; comp < 4; comp++)
+        errors = ds->errors + (awidth+3)*comp + awidth;
+        inp = in_buffer + awidth*factor*4 - 4 + comp;
+        outp = inp;
+        mfs_data = ds->mfs_data + (awidth+1)*comp + awidth;
+        *mfs_data-- = mfs_clear;
+        for (x = awidth; x > 0; x--)
         {
-            byte mfs, force_forward = 0;
-            errors = ds->errors + (awidth+3)*comp + awidth;
-            inp = in_buffer + awidth*factor*4 - 4 + comp;
-            outp = inp;
-            mfs_data = ds->mfs_data + (awidth+1)*comp + awidth;
-            *mfs_data-- = mfs_clear;
-            for (x = awidth; x > 0; x--)
+            value = e_forward + *errors;
+            for (xx = factor; xx > 0; xx--)
             {
-                value = e_forward + *errors;
-                for (xx = factor; xx > 0; xx--)
-                {
-                    for (y = factor; y > 0; y--)
-                    {
-                        value += *inp;
-                        inp += span;
-                    }
-                    inp -= back;
-                }
-                mfs = *mfs_data;
-                *mfs_data-- = mfs_clear;
-                if ((mfs & mfs_force_off) || force_forward)
+                for (y = factor; y > 0; y--)
                 {
-                    /* We are being forced to be 0 */
-                    *outp = 1; outp -= 4;
-                    value -= max_value;
-                    force_forward = 0;
+                    value += *inp;
+                    inp += span;
                 }
-                else if (value >= threshold)
+                inp -= back;
+            }
+            mfs = *mfs_data;
+            *mfs_data-- = mfs_clear;
+            if ((mfs & mfs_force_off) || force_forward)
+            {
+                /* We are being forced to be 0 */
+                *outp = 1; outp -= 4;
+                value -= max_value;
+                force_forward = 0;
+            }
+            else if (value >= threshold)
+            {
+                *outp = 1; outp -= 4;
+                value -= max_value;
+                if ((mfs & (mfs_above_is_0 | mfs_above_left_is_0))
+                        != (mfs_above_is_0 | mfs_above_left_is_0))
                 {
-                    *outp = 1; outp -= 4;
-                    value -= max_value;
-                    if ((mfs & (mfs_above_is_0 | mfs_above_left_is_0))
-                            != (mfs_above_is_0 | mfs_above_left_is_0))
-                    {
-                        /* We aren't in a group anyway, so must force other
-                         * pixels. */
-                        mfs_data[1] |= mfs_force_off;
-                        mfs_data[2] |= mfs_force_off;
-                        force_forward = 1;
-                    }
-                    else
-                    {
-                        /* No forcing, but we need to tell other pixels that
-                         * we were 1. */
-                        mfs_data[1] |= mfs_above_is_0;
-                        mfs_data[2] |= mfs_above_left_is_0;
-                    }
+                    /* We aren't in a group anyway, so must force other
+                     * pixels. */
+                    mfs_data[1] |= mfs_force_off;
+                    mfs_data[2] |= mfs_force_off;
+                    force_forward = 1;
                 }
                 else
                 {
-                    *outp = 0; outp -= 4;
+                    /* No forcing, but we need to tell other pixels that
+                     * we were 1. */
+                    mfs_data[1] |= mfs_above_is_0;
+                    mfs_data[2] |= mfs_above_left_is_0;
                 }
-                e_forward  = value * 7/16;
-                e_downleft = value * 3/16;
-                e_down     = value * 5/16;
-                value     -= e_forward + e_downleft + e_down;
-                errors[2] += e_downleft;
-                errors[1] += e_down;
-                *errors--   = value;
             }
+            else
+            {
+                *outp = 0; outp -= 4;
+            }
+            e_forward  = value * 7/16;
+            e_downleft = value * 3/16;
+            e_down     = value * 5/16;
+            value     -= e_forward + e_downleft + e_down;
+            errors[2] += e_downleft;
+            errors[1] += e_down;
+            *errors--   = value;
+        }
+    }
+    return e_forward;
+}
+
+static void down_core4_mfs(gx_downscaler_t *ds,
+                           byte            *out_buffer,
+                           byte            *in_buffer,
+                           int              row,
+                           int              plane /* unused */,
+                           int              span)
+{
+    int comp, e_forward = 0;
+
+    down_core4_pad(ds, in_buffer, span);
+    for (comp = 0; comp < 4; comp++)
+        e_forward = down_core4_mfs_comp(ds, in_buffer, row, comp, span, e_forward);
+    down_core4_pack(ds, out_buffer, in_buffer, row);
+}
+
+/* Error diffusion pipeline for the CMYK cores.
+ *
+ * Stage 0 runs on the calling thread and each of the others on a thread
+ * of its own; each stage owns a run of the components. A batch of output
+ * rows is fetched up front, and each stage takes the rows in order,
+ * handing the forward error for each row on to the next stage as it
+ * finishes it. So stage n works on row y while stage n-1 works on row y+1,
+ * and the output is identical to that of the serial core. The last stage
+ * packs the rows, and gx_downscaler_getbits hands them out from the batch.
+ * Only the Floyd Steinberg cores (down_core4 and down_core4_mfs) use it;
+ * see down_core_ets_1 for why the ETS cores can't.
+ */
+#define DOWNSCALE_PIPE_MAX_ROWS  32
+#define DOWNSCALE_PIPE_MAX_BYTES (4<<20)
+
+typedef struct gx_downscale_pipe_stage_s {
+    struct gx_downscale_pipe_s *pipe;
+    int                         first_comp;
+    int                         end_comp;
+    gx_semaphore_t             *ready;  /* Signalled per row by the stage before */
+    gp_thread_id                thread;
+} gx_downscale_pipe_stage_t;
+
+struct gx_downscale_pipe_s {
+    gx_downscaler_t           *ds;
+    gs_memory_t               *memory;
+    down_core4_comp_fn        *comp_fn;
+    int                        num_stages;
+    int                        height;     /* Output rows in the page */
+    int                        max_rows;   /* Rows per batch */
+    int                        first_row;  /* Current batch */
+    int                        num_rows;
+    byte                      *in;
+    size_t                     in_raster;
+    byte                      *out;
+    int                        out_raster;
+    int                       *carry;      /* [stage][row] forward errors */
+    bool                       quit;
+    gx_semaphore_t            *done;       /* Signalled per batch by the last stage */
+    gx_downscale_pipe_stage_t  stages[4];
+};
+
+static void
+downscale_pipe_row(gx_downscale_pipe_t *p, int s, int i)
+{
+    gx_downscaler_t *ds = p->ds;
+    const gx_downscale_pipe_stage_t *st = &p->stages[s];
+    int   row = p->first_row + i;
+    byte *in = p->in + p->in_raster * i;
+    int   comp, e_forward = 0;
+
+    if (s > 0)
+        e_forward = p->carry[(s-1) * p->max_rows + i];
+    for (comp = st->first_comp; comp < st->end_comp; comp++)
+        e_forward = p->comp_fn(ds, in, row, comp, ds->span, e_forward);
+    p->carry[s * p->max_rows + i] = e_forward;
+
+    if (s == p->num_stages-1)
+        down_core4_pack(ds, p->out + (size_t)p->out_raster * i, in, row);
+    else
+        gx_semaphore_signal(p->stages[s+1].ready);
+}
+
+static void
+downscale_pipe_worker(void *arg)
+{
+    gx_downscale_pipe_stage_t *st = (gx_downscale_pipe_stage_t *)arg;
+    gx_downscale_pipe_t *p = st->pipe;
+    int s = st - p->stages;
+    int i, n;
+
+    while (1) {
+        gx_semaphore_wait(st->ready);
+        if (p->quit)
+            break;
+        n = p->num_rows;
+        for (i = 0; ; ) {
+            downscale_pipe_row(p, s, i);
+            if (++i == n)
+                break;
+            gx_semaphore_wait(st->ready);
+        }
+        if (s == p->num_stages-1)
+            gx_semaphore_signal(p->done);
+    }
+}
+
+static void
+downscale_pipe_free(gx_downscaler_t *ds)
+{
+    gx_downscale_pipe_t *p = ds->pipe;
+    gs_memory_t *mem;
+    int s;
+
+    if (p == NULL)
+        return;
+    mem = p->memory;
+
+    p->quit = true;
+    for (s = 1; s < p->num_stages; s++) {
+        if (p->stages[s].thread == NULL)
+            continue;
+        gx_semaphore_signal(p->stages[s].ready);
+        gp_thread_finish(p->stages[s].thread);
+    }
+    for (s = 1; s < p->num_stages; s++)
+        gx_semaphore_free(p->stages[s].ready);
+    gx_semaphore_free(p->done);
+    gs_free_object(mem, p->carry, "gx_downscaler(pipe_carry)");
+    gs_free_object(mem, p->out, "gx_downscaler(pipe_out)");
+    gs_free_object(mem, p->in, "gx_downscaler(pipe_in)");
+    gs_free_object(mem, p, "gx_downscaler(pipe)");
+    ds->pipe = NULL;
+}
+
+/* The pipeline uses the threads the device has been given for rendering. */
+static int
+downscale_pipe_threads(gx_device *dev)
+{
+    char data[] = "NumRenderingThreads";
+    dev_param_req_t request;
+    gs_c_param_list list;
+    int threads = 0;
+    int code;
+
+    gs_c_param_list_write(&list, dev->memory);
+    request.Param = data;
+    request.list = &list;
+    code = dev_proc(dev, dev_spec_op)(dev, gxdso_get_dev_param, &request, sizeof(dev_param_req_t));
+    if (code < 0) {
+        gs_c_param_list_release(&list);
+        return 0;
+    }
+    gs_c_param_list_read(&list);
+    code = param_read_int((gs_param_list *)&list, "NumRenderingThreads", &threads);
+    gs_c_param_list_release(&list);
+    if (code != 0)
+        return 0;
+
+    return threads;
+}
+
+/* Set up the pipeline if it is worth having. Failure here is not an
+ * error; we just carry on with the serial core. */
+static void
+downscale_pipe_init(gx_downscaler_t *ds, down_core4_comp_fn *comp_fn)
+{
+    gs_memory_t *mem = ds->dev->memory->non_gc_memory;
+    gx_downscale_pipe_t *p;
+    int threads = downscale_pipe_threads(ds->dev);
+    int s, num_stages, max_rows;
+    size_t in_raster = (size_t)ds->span * ds->factor;
+
+    if (threads <= 0)
+        return;
+    num_stages = threads + 1;
+    if (num_stages > 4)
+        num_stages = 4;
+    max_rows = DOWNSCALE_PIPE_MAX_BYTES / in_raster;
+    if (max_rows > DOWNSCALE_PIPE_MAX_ROWS)
+        max_rows = DOWNSCALE_PIPE_MAX_ROWS;
+    if (max_rows < num_stages)
+        return;
+
+    p = (gx_downscale_pipe_t *)gs_alloc_bytes(mem, sizeof(*p), "gx_downscaler(pipe)");
+    if (p == NULL)
+        return;
+    memset(p, 0, sizeof(*p));
+    ds->pipe      = p;
+    p->ds         = ds;
+    p->memory     = mem;
+    p->comp_fn    = comp_fn;
+    p->num_stages = num_stages;
+    p->height     = ds->dev->height / ds->factor;
+    p->max_rows   = max_rows;
+    p->in_raster  = in_raster;
+    p->out_raster = (ds->awidth*4 + 7)>>3;
+    p->in = gs_alloc_bytes(mem, in_raster * max_rows, "gx_downscaler(pipe_in)");
+    p->out = gs_alloc_bytes(mem, (size_t)p->out_raster * max_rows,
+                            "gx_downscaler(pipe_out)");
+    p->carry = (int *)gs_alloc_bytes(mem, sizeof(int) * num_stages * max_rows,
+                                     "gx_downscaler(pipe_carry)");
+    p->done = gx_semaphore_label(gx_semaphore_alloc(mem), "DownscaleDone");
+    if (p->in == NULL || p->out == NULL || p->carry == NULL || p->done == NULL)
+        goto fail;
+
+    for (s = 0; s < num_stages; s++) {
+        gx_downscale_pipe_stage_t *st = &p->stages[s];
+
+        st->pipe       = p;
+        st->first_comp = (s * 4) / num_stages;
+        st->end_comp   = ((s+1) * 4) / num_stages;
+        if (s == 0)
+            continue;
+        st->ready = gx_semaphore_label(gx_semaphore_alloc(mem), "DownscaleRow");
+        if (st->ready == NULL)
+            goto fail;
+        if (gp_thread_start(downscale_pipe_worker, st, &st->thread) < 0) {
+            st->thread = NULL;
+            goto fail;
         }
-        outp = in_buffer + awidth*factor*4 - (awidth*4);
+        gp_thread_label(st->thread, "Downscale");
     }
-    pack_8to1(out_buffer, outp, awidth*4);
+    return;
+
+fail:
+    downscale_pipe_free(ds);
+}
+
+/* Fetch and error diffuse the batch of rows starting at row. */
+static int
+downscale_pipe_batch(gx_downscale_pipe_t *p, int row)
+{
+    gx_downscaler_t *ds = p->ds;
+    int   i, y, code;
+    int   n = p->height - row;
+    byte *data_ptr;
+
+    p->num_rows = 0;
+    if (n <= 0)
+        return_error(gs_error_rangecheck);
+    if (n > p->max_rows)
+        n = p->max_rows;
+
+    for (i = 0; i < n; i++) {
+        data_ptr = p->in + p->in_raster * i;
+        for (y = (row + i) * ds->factor; y < (row + i + 1) * ds->factor; y++) {
+            code = ds->liner->get_line(ds->liner, data_ptr, y);
+            if (code < 0)
+                return code;
+            data_ptr += ds->span;
+        }
+        down_core4_pad(ds, p->in + p->in_raster * i, ds->span);
+    }
+
+    p->first_row = row;
+    p->num_rows  = n;
+    for (i = 0; i < n; i++)
+        downscale_pipe_row(p, 0, i);
+    gx_semaphore_wait(p->done);
+
+    return 0;
+}
+
+static int
+downscale_pipe_getbits(gx_downscale_pipe_t *p, byte *out_data, int row)
+{
+    int code;
+
+    if (row < p->first_row || row >= p->first_row + p->num_rows) {
+        code = downscale_pipe_batch(p, row);
+        if (code < 0)
+            return code;
+    }
+    memcpy(out_data, p->out + (size_t)p->out_raster * (row - p->first_row),
+           p->out_raster);
+
+    return 0;
 }
 
 /* Grey (or planar) downscale code */
+/* The box filters below sum each column of a chunk down the factor rows
+ * into 16 bit sums first, using the widest vectors the CPU has, and then
+ * sum those across. The results are the same as summing a pixel at a time.
+ */
+static void down_vsum_c(ushort     *sums,
+                        const byte *in,
+                        int         span,
+                        int         rows,
+                        int         n)
+{
+    int i, y;
+
+    for (i = 0; i < n; i++)
+        sums[i] = in[i];
+    for (y = rows-1; y > 0; y--)
+    {
+        in += span;
+        for (i = 0; i < n; i++)
+            sums[i] += in[i];
+    }
+}
+
+#ifdef HAVE_SSE2
+static void down_vsum_sse2(ushort     *sums,
+                           const byte *in,
+                           int         span,
+                           int         rows,
+                           int         n)
+{
+    const __m128i zero = _mm_setzero_si128();
+    int i, y;
+
+    for (i = 0; i + 16 <= n; i += 16)
+    {
+        const byte *p = in + i;
+        __m128i lo = zero;
+        __m128i hi = zero;
+
+        for (y = rows; y > 0; y--)
+        {
+            __m128i v = _mm_loadu_si128((const __m128i *)p);
+
+            lo = _mm_add_epi16(lo, _mm_unpacklo_epi8(v, zero));
+            hi = _mm_add_epi16(hi, _mm_unpackhi_epi8(v, zero));
+            p += span;
+        }
+        _mm_storeu_si128((__m128i *)(sums + i), lo);
+        _mm_storeu_si128((__m128i *)(sums + i + 8), hi);
+    }
+    down_vsum_c(sums + i, in + i, span, rows, n - i);
+}
+#endif
+
+#ifdef DOWNSCALE_AVX2
+__attribute__((target("avx2")))
+static void down_vsum_avx2(ushort     *sums,
+                           const byte *in,
+                           int         span,
+                           int         rows,
+                           int         n)
+{
+    int i, y;
+
+    for (i = 0; i + 32 <= n; i += 32)
+    {
+        const byte *p = in + i;
+        __m256i lo = _mm256_setzero_si256();
+        __m256i hi = _mm256_setzero_si256();
+
+        for (y = rows; y > 0; y--)
+        {
+            lo = _mm256_add_epi16(lo, _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)p)));
+            hi = _mm256_add_epi16(hi, _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)(p + 16))));
+            p += span;
+        }
+        _mm256_storeu_si256((__m256i *)(sums + i), lo);
+        _mm256_storeu_si256((__m256i *)(sums + i + 16), hi);
+    }
+    down_vsum_c(sums + i, in + i, span, rows, n - i);
+}
+#endif
+
+#ifdef DOWNSCALE_NEON
+static void down_vsum_neon(ushort     *sums,
+                           const byte *in,
+                           int         span,
+                           int         rows,
+                           int         n)
+{
+    int i, y;
+
+    for (i = 0; i + 16 <= n; i += 16)
+    {
+        const byte *p = in + i;
+        uint16x8_t lo = vdupq_n_u16(0);
+        uint16x8_t hi = vdupq_n_u16(0);
+
+        for (y = rows; y > 0; y--)
+        {
+            uint8x16_t v = vld1q_u8(p);
+
+            lo = vaddw_u8(lo, vget_low_u8(v));
+            hi = vaddw_u8(hi, vget_high_u8(v));
+            p += span;
+        }
+        vst1q_u16(sums + i, lo);
+        vst1q_u16(sums + i + 8, hi);
+    }
+    down_vsum_c(sums + i, in + i, span, rows, n - i);
+}
+#endif
+
+/* Pick the column summing code for the CPU we are running on. */
+static gx_downscale_vsum *select_vsum(void)
+{
+#ifdef DOWNSCALE_AVX2
+    if (__builtin_cpu_supports("avx2"))
+        return &down_vsum_avx2;
+#endif
+#if defined(HAVE_SSE2)
+    return &down_vsum_sse2;
+#elif defined(DOWNSCALE_NEON)
+    return &down_vsum_neon;
+#else
+    return &down_vsum_c;
+#endif
+}
+
+/* Number of column sums done at once. */
+#define DOWN_BOX_SUMS 1024
+
+/* down_box needs room for a few pixels per chunk, and the column sums */
+/* of factor rows to fit in 16 bits.                                   */
+#define DOWN_BOX_OK(factor, nc) ((factor) * (nc) <= DOWN_BOX_SUMS/4)
+
+/* Box filter nc interleaved 8 bit components. */
+static void down_box(gx_downscaler_t *ds,
+                     byte            *outp,
+                     const byte      *inp,
+                     int              span,
+                     int              nc)
+{
+    ushort sums[DOWN_BOX_SUMS];
+    int    x, xx, c, i, n, value;
+    int    factor = ds->factor;
+    int    div    = factor*factor;
+    int    step   = factor*nc;
+    int    chunk  = DOWN_BOX_SUMS / step;
+
+    for (x = ds->awidth; x > 0; x -= n)
+    {
+        const ushort *s = sums;
+
+        n = (x < chunk ? x : chunk);
+        ds->vsum(sums, inp, span, factor, n * step);
+        inp += n * step;
+        for (xx = n; xx > 0; xx--)
+        {
+            for (c = 0; c < nc; c++)
+            {
+                value = 0;
+                for (i = c; i < step; i += nc)
+                    value += s[i];
+                *outp++ = (value+(div>>1))/div;
+            }
+            s += step;
+        }
+    }
+}
+
 static void down_core16(gx_downscaler_t *ds,
                         byte            *outp,
                         byte            *in_buffer,
@@ -1267,6 +1749,12 @@ static void down_core8(gx_downscaler_t *ds,
         }
     }
 
+    if (DOWN_BOX_OK(factor, 1))
+    {
+        down_box(ds, outp, in_buffer, span, 1);
+        return;
+    }
+
     inp = in_buffer;
     {
         /* Left to Right pass (no min feature size) */
@@ -1316,9 +1804,39 @@ static void down_core8_2(gx_downscaler_t *ds,
     }
 
     inp = in_buffer;
+    x = awidth;
 
     /* Left to Right pass (no min feature size) */
-    for (x = awidth; x > 0; x--)
+#if defined(HAVE_SSE2)
+    {
+        const __m128i lo  = _mm_set1_epi16(0xff);
+        const __m128i two = _mm_set1_epi16(2);
+
+        for (; x >= 8; x -= 8)
+        {
+            __m128i a = _mm_loadu_si128((const __m128i *)inp);
+            __m128i b = _mm_loadu_si128((const __m128i *)(inp + span));
+            __m128i v = _mm_add_epi16(_mm_add_epi16(_mm_and_si128(a, lo), _mm_srli_epi16(a, 8)),
+                                      _mm_add_epi16(_mm_and_si128(b, lo), _mm_srli_epi16(b, 8)));
+
+            v = _mm_srli_epi16(_mm_add_epi16(v, two), 2);
+            _mm_storel_epi64((__m128i *)outp, _mm_packus_epi16(v, v));
+            inp += 16;
+            outp += 8;
+        }
+    }
+#elif defined(DOWNSCALE_NEON)
+    for (; x >= 8; x -= 8)
+    {
+        uint16x8_t v = vaddq_u16(vpaddlq_u8(vld1q_u8(inp)),
+                                 vpaddlq_u8(vld1q_u8(inp + span)));
+
+        vst1_u8(outp, vrshrn_n_u16(v, 2));
+        inp += 16;
+        outp += 8;
+    }
+#endif
+    for (; x > 0; x--)
     {
         *outp++ = (inp[0] + inp[1] + inp[span] + inp[span+1] + 2)>>2;
         inp += 2;
@@ -1352,16 +1870,8 @@ static void down_core8_3(gx_downscaler_t *ds,
         }
     }
 
-    inp = in_buffer;
-
     /* Left to Right pass (no min feature size) */
-    for (x = awidth; x > 0; x--)
-    {
-        *outp++ = (inp[0     ] + inp[       1] + inp[       2] +
-                   inp[span  ] + inp[span  +1] + inp[span  +2] +
-                   inp[span*2] + inp[span*2+1] + inp[span*2+2] + 4)/9;
-        inp += 3;
-    }
+    down_box(ds, outp, in_buffer, span, 1);
 }
 
 static void down_core8_4(gx_downscaler_t *ds,
@@ -1392,9 +1902,62 @@ static void down_core8_4(gx_downscaler_t *ds,
     }
 
     inp = in_buffer;
+    x = awidth;
 
     /* Left to Right pass (no min feature size) */
-    for (x = awidth; x > 0; x--)
+#if defined(HAVE_SSE2)
+    {
+        const __m128i lo    = _mm_set1_epi16(0xff);
+        const __m128i ones  = _mm_set1_epi16(1);
+        const __m128i eight = _mm_set1_epi32(8);
+
+        for (; x >= 8; x -= 8)
+        {
+            const byte *p = inp;
+            __m128i s0 = _mm_setzero_si128();
+            __m128i s1 = _mm_setzero_si128();
+            int y;
+
+            /* Sum horizontal pairs down the rows, then add the pairs */
+            for (y = 4; y > 0; y--)
+            {
+                __m128i a = _mm_loadu_si128((const __m128i *)p);
+                __m128i b = _mm_loadu_si128((const __m128i *)(p + 16));
+
+                s0 = _mm_add_epi16(s0, _mm_add_epi16(_mm_and_si128(a, lo), _mm_srli_epi16(a, 8)));
+                s1 = _mm_add_epi16(s1, _mm_add_epi16(_mm_and_si128(b, lo), _mm_srli_epi16(b, 8)));
+                p += span;
+            }
+            s0 = _mm_srli_epi32(_mm_add_epi32(_mm_madd_epi16(s0, ones), eight), 4);
+            s1 = _mm_srli_epi32(_mm_add_epi32(_mm_madd_epi16(s1, ones), eight), 4);
+            s0 = _mm_packs_epi32(s0, s1);
+            _mm_storel_epi64((__m128i *)outp, _mm_packus_epi16(s0, s0));
+            inp += 32;
+            outp += 8;
+        }
+    }
+#elif defined(DOWNSCALE_NEON)
+    for (; x >= 8; x -= 8)
+    {
+        const byte *p = inp;
+        uint16x8_t s0 = vdupq_n_u16(0);
+        uint16x8_t s1 = vdupq_n_u16(0);
+        int y;
+
+        /* Sum horizontal pairs down the rows, then add the pairs */
+        for (y = 4; y > 0; y--)
+        {
+            s0 = vpadalq_u8(s0, vld1q_u8(p));
+            s1 = vpadalq_u8(s1, vld1q_u8(p + 16));
+            p += span;
+        }
+        s0 = vcombine_u16(vmovn_u32(vpaddlq_u16(s0)), vmovn_u32(vpaddlq_u16(s1)));
+        vst1_u8(outp, vrshrn_n_u16(s0, 4));
+        inp += 32;
+        outp += 8;
+    }
+#endif
+    for (; x > 0; x--)
     {
         *outp++ = (inp[0     ] + inp[       1] + inp[       2] + inp[       3] +
                    inp[span  ] + inp[span  +1] + inp[span  +2] + inp[span  +3] +
@@ -1550,6 +2113,12 @@ static void down_core24(gx_downscaler_t *ds,
         }
     }
 
+    if (DOWN_BOX_OK(factor, 3))
+    {
+        down_box(ds, outp, in_buffer, span, 3);
+        return;
+    }
+
     inp = in_buffer;
     {
         /* Left to Right pass (no min feature size) */
@@ -1631,6 +2200,12 @@ static void down_core32(gx_downscaler_t *ds,
         }
     }
 
+    if (DOWN_BOX_OK(factor, 4))
+    {
+        down_box(ds, outp, in_buffer, span, 4);
+        return;
+    }
+
     inp = in_buffer;
     {
         /* Left to Right pass (no min feature size) */
@@ -2262,6 +2837,7 @@ int gx_downscaler_init_planar_cm(gx_downscaler_t      *ds,
     width = (dev->width*upfactor)/downfactor;
     memset(ds, 0, sizeof(*ds));
     ds->dev               = dev;
+    ds->vsum              = select_vsum();
     ds->width             = width;
     ds->awidth            = width;
     ds->span              = span;
@@ -2635,6 +3211,7 @@ gx_downscaler_init_cm_halftone(gx_downscaler_t      *ds,
     span = size + pad_white*downfactor*num_comps/upfactor + downfactor-1;
     memset(ds, 0, sizeof(*ds));
     ds->dev               = dev;
+    ds->vsum              = select_vsum();
     ds->width             = width;
     ds->awidth            = awidth;
     ds->span              = span;
@@ -2902,6 +3479,12 @@ gx_downscaler_init_cm_halftone(gx_downscaler_t      *ds,
             }
             memset(ds->errors, 0, (size_t)nc * (awidth+3) * sizeof(int));
         }
+        if (apply_cm == NULL && upfactor == 1) {
+            if (core == &down_core4)
+                downscale_pipe_init(ds, &down_core4_comp);
+            else if (core == &down_core4_mfs)
+                downscale_pipe_init(ds, &down_core4_mfs_comp);
+        }
     }
 
     return 0;
@@ -2918,6 +3501,8 @@ void gx_downscaler_fin(gx_downscaler_t *ds)
     if (ds->dev == NULL)
         return;
 
+    downscale_pipe_free(ds);
+
     for (plane=0; plane < GS_CLIENT_COLOR_MAX_COMPONENTS; plane++) {
         gs_free_object(ds->dev->memory, ds->pre_cm[plane],
                        "gx_downscaler(planar_data)");
@@ -2973,6 +3558,9 @@ int gx_downscaler_getbits(gx_downscaler_t *ds,
         return 0;
     }
 
+    if (ds->pipe != NULL)
+        return downscale_pipe_getbits(ds->pipe, out_data, row);
+
     /* Get factor rows worth of data */
     y        = row * downfactor;
     y_end    = y + downfactor;
@@ -3303,6 +3891,7 @@ int gx_downscaler_process_page(gx_device                 *dev,
     arg.ds.src_bpc = src_bpc;
     arg.ds.scaled_span = bitmap_raster(scaled_w * num_comps * src_bpc);
     arg.ds.num_planes = 0;
+    arg.ds.vsum = select_vsum();
 
     /* Choose an appropriate core */
     if (factor > 8)
@@ -69,8 +69,18 @@ typedef void (gx_downscale_core)(gx_downscaler_t *ds,
                                  int              plane,
                                  int              span);
 
+/* Private function type to sum n bytes down a number of rows */
+typedef void (gx_downscale_vsum)(ushort     *sums,
+                                 const byte *in,
+                                 int         span,
+                                 int         rows,
+                                 int         n);
+
 typedef struct gx_downscale_liner_s gx_downscale_liner;
 
+/* Private pipeline for error diffusing with several threads */
+typedef struct gx_downscale_pipe_s gx_downscale_pipe_t;
+
 struct gx_downscaler_s {
     gx_device            *dev;        /* Device */
     int                   width;      /* Width (pixels) */
@@ -85,6 +95,7 @@ struct gx_downscaler_s {
                                        * integer downscales). */
     int                   scaled_span;/* Num bytes in scaled scanline */
     gx_downscale_core    *down_core;  /* Core downscaling function */
+    gx_downscale_vsum    *vsum;       /* Column sums, chosen for the CPU */
     gs_get_bits_params_t  params;     /* Params if in planar mode */
     int                   num_comps;  /* Number of components as rendered */
     int                   num_planes; /* Number of planes if planar, 0 otherwise */
@@ -111,6 +122,8 @@ struct gx_downscaler_s {
     int                   do_skew_detection;
     int                   skew_detected;
     double                skew_angle;
+
+    gx_downscale_pipe_t  *pipe;       /* Error diffusion pipeline, or NULL */
 };
 
 /* The following structure is used to hold the configuration
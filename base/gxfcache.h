@@ -308,4 +308,10 @@ int  gs_purge_fm_pair(gs_font_dir *, cached_fm_pair *, int);
 int  gs_purge_font_from_char_caches(gs_font *);
 int  gs_purge_font_from_char_caches_completely(gs_font * font);
 
+/* The character cache shared by the font directories of an instance (in gxccman.c) */
+int gx_char_cache_share_set_size(gs_memory_t *mem, size_t size);
+size_t gx_char_cache_share_size(gs_memory_t *mem);
+void gx_char_cache_share_stats(gs_memory_t *mem, int64_t *hits, int64_t *misses,
+                               int64_t *evictions);
+
 #endif /* gxfcache_INCLUDED */
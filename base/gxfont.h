@@ -443,6 +443,8 @@ int gs_font_notify_unregister(gs_font *font, gs_notify_proc_t proc,
         gs_font_common;\
         gs_rect FontBBox;\
         gs_uid UID;\
+        bool UID_is_local;	/* UID was made up by the interpreter, */\
+                                /* or the font came from the job */\
         gs_fapi_server *FAPI; \
         void *FAPI_font_data; \
         gs_encoding_index_t encoding_index;\
@@ -440,6 +440,123 @@ decode_row(const gx_image_enum *penum, const byte *psrc, int spp, byte *pdes,
     }
 }
 
+/* Images with few colors, such as screen shots, charts and flat artwork,
+   are converted a color at a time: the colors of each row are looked up in
+   a table kept for the image, only the colors not seen before go through
+   the link, and the row is filled in from the table. The device values are
+   the ones the link gives, so this makes no difference to the output. Once
+   an image has more than IMAGE_UNIQUE_MAX_COLORS colors, or if it is
+   narrower than IMAGE_UNIQUE_MIN_WIDTH, its rows are converted whole. */
+#define IMAGE_UNIQUE_MIN_WIDTH 16
+
+static inline bits32
+image_unique_key(const byte *psrc, int spp)
+{
+    bits32 key = 0;
+    int k;
+
+    for (k = 0; k < spp; k++)
+        key = (key << 8) | psrc[k];
+    return key;
+}
+
+/* The slot of a color in the table, or the empty slot where it would go */
+static inline int
+image_unique_slot(const gx_image_unique_colors_t *uc, bits32 key)
+{
+    int slot = (bits32)(key * 0x9e3779b1) >> (32 - IMAGE_UNIQUE_SLOT_BITS);
+
+    /* The table is never more than a quarter full */
+    while (uc->color[slot] >= 0 && uc->key[slot] != key)
+        slot = (slot + 1) & (IMAGE_UNIQUE_SLOTS - 1);
+    return slot;
+}
+
+/* Convert a row of width 8 bit pixels into pdes (planes des_stride apart
+   if planar) through the table of the colors of the image. Returns 1 if
+   the row was done, 0 if it is to be converted whole. */
+static int
+image_color_icc_unique(gx_image_enum *penum, gx_device *dev, const byte *psrc,
+                       int width, int spp_cm, byte *pdes, int des_stride,
+                       bool planar)
+{
+    gx_image_unique_colors_t *uc = penum->unique_colors;
+    int spp = penum->spp;
+    byte new_colors[IMAGE_UNIQUE_MAX_COLORS * 4];
+    int num_new = 0;
+    const byte *pcolor = NULL;
+    bits32 key, prev_key = 0;
+    int x, j, slot, code;
+
+    if (uc == NULL) {
+        if (width < IMAGE_UNIQUE_MIN_WIDTH || spp > 4 || spp_cm > ICC_MAX_CHANNELS)
+            return 0;
+        uc = (gx_image_unique_colors_t *)
+                gs_alloc_bytes(penum->memory->non_gc_memory,
+                               sizeof(gx_image_unique_colors_t),
+                               "image_color_icc_unique");
+        if (uc == NULL)
+            return 0;
+        uc->disabled = false;
+        uc->num_colors = 0;
+        memset(uc->color, 0xff, sizeof(uc->color));
+        penum->unique_colors = uc;
+    }
+    if (uc->disabled)
+        return 0;
+
+    /* Add the colors we haven't seen before */
+    for (x = 0; x < width; x++) {
+        key = image_unique_key(psrc + x * spp, spp);
+        if (x > 0 && key == prev_key)
+            continue;
+        prev_key = key;
+        slot = image_unique_slot(uc, key);
+        if (uc->color[slot] >= 0)
+            continue;
+        if (uc->num_colors == IMAGE_UNIQUE_MAX_COLORS) {
+            uc->disabled = true;
+            return 0;
+        }
+        uc->key[slot] = key;
+        uc->color[slot] = uc->num_colors++;
+        memcpy(new_colors + num_new * spp, psrc + x * spp, spp);
+        num_new++;
+    }
+    if (num_new > 0) {
+        gsicc_bufferdesc_t input_buff_desc;
+        gsicc_bufferdesc_t output_buff_desc;
+
+        gsicc_init_buffer(&input_buff_desc, spp, 1, false, false, false, 0,
+                          num_new * spp, 1, num_new);
+        gsicc_init_buffer(&output_buff_desc, spp_cm, 1, false, false, false, 0,
+                          num_new * spp_cm, 1, num_new);
+        code = (penum->icc_link->procs.map_buffer)(dev, penum->icc_link,
+                        &input_buff_desc, &output_buff_desc, (void *)new_colors,
+                        (void *)(uc->device + (uc->num_colors - num_new) * spp_cm));
+        if (code < 0) {
+            uc->disabled = true;
+            return code;
+        }
+    }
+
+    /* Fill in the row */
+    for (x = 0; x < width; x++) {
+        key = image_unique_key(psrc + x * spp, spp);
+        if (x == 0 || key != prev_key) {
+            prev_key = key;
+            pcolor = uc->device + uc->color[image_unique_slot(uc, key)] * spp_cm;
+        }
+        if (planar) {
+            for (j = 0; j < spp_cm; j++)
+                pdes[j * des_stride + x] = pcolor[j];
+        } else {
+            memcpy(pdes + x * spp_cm, pcolor, spp_cm);
+        }
+    }
+    return 1;
+}
+
 /* Common code shared amongst the thresholding and non thresholding color image
    renderers */
 static int
@@ -566,21 +683,27 @@ image_color_icc_prep(gx_image_enum *penum_orig, const byte *psrc, uint w,
                     decode_row_cie(penum, psrc, spp, psrc_decode,
                                     psrc_decode+w, get_cie_range(penum->pcs));
                 }
-                code = (penum->icc_link->procs.map_buffer)(dev, penum->icc_link,
-                                                    &input_buff_desc,
-                                                    &output_buff_desc,
-                                                    (void*) psrc_decode,
-                                                    (void*) *psrc_cm);
+                code = image_color_icc_unique(penum_orig, dev, psrc_decode, width,
+                                              spp_cm, *psrc_cm, span, force_planar);
+                if (code == 0)
+                    code = (penum->icc_link->procs.map_buffer)(dev, penum->icc_link,
+                                                        &input_buff_desc,
+                                                        &output_buff_desc,
+                                                        (void*) psrc_decode,
+                                                        (void*) *psrc_cm);
                 gs_free_object(pgs->memory, psrc_decode, "image_color_icc_prep");
                 if (code < 0)
                     return code;
             } else {
                 /* CM only. No decode */
-                code = (penum->icc_link->procs.map_buffer)(dev, penum->icc_link,
-                                                    &input_buff_desc,
-                                                    &output_buff_desc,
-                                                    (void*) psrc,
-                                                    (void*) *psrc_cm);
+                code = image_color_icc_unique(penum_orig, dev, psrc, width,
+                                              spp_cm, *psrc_cm, span, force_planar);
+                if (code == 0)
+                    code = (penum->icc_link->procs.map_buffer)(dev, penum->icc_link,
+                                                        &input_buff_desc,
+                                                        &output_buff_desc,
+                                                        (void*) psrc,
+                                                        (void*) *psrc_cm);
                 if (code < 0)
                     return code;
             }
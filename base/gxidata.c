@@ -512,6 +512,10 @@ gx_image1_end_image(gx_image_enum_common_t * info, bool draw_last)
                        "image is_transparent");
         gs_free_object(mem, penum->color_cache, "image color cache");
     }
+    if (penum->unique_colors != NULL) {
+        gs_free_object(mem->non_gc_memory, penum->unique_colors,
+                       "image unique colors");
+    }
     if (penum->thresh_buffer != NULL) {
         gs_free_object(mem, penum->thresh_buffer, "image thresh_buffer");
     }
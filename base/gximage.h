@@ -151,6 +151,22 @@ typedef struct gx_image_color_cache_s {
     byte *device_contone;
 } gx_image_color_cache_t;
 
+/* The distinct colors of an 8 bit image with up to 4 components, and
+   their device values, used to convert images with few colors (see
+   image_color_icc_unique in gxicolor.c). The colors are found through an
+   open hash table on the packed source color. */
+#define IMAGE_UNIQUE_SLOT_BITS 10
+#define IMAGE_UNIQUE_SLOTS (1 << IMAGE_UNIQUE_SLOT_BITS)
+#define IMAGE_UNIQUE_MAX_COLORS 256
+
+typedef struct gx_image_unique_colors_s {
+    bool disabled;          /* too many colors, convert whole rows */
+    int num_colors;
+    bits32 key[IMAGE_UNIQUE_SLOTS];
+    short color[IMAGE_UNIQUE_SLOTS];    /* index of the color, -1 if none */
+    byte device[IMAGE_UNIQUE_MAX_COLORS * ICC_MAX_CHANNELS];
+} gx_image_unique_colors_t;
+
 /* Main state structure */
 
 typedef struct gx_device_rop_texture_s gx_device_rop_texture;
@@ -283,6 +299,7 @@ struct gx_image_enum_s {
     gx_device_color *icolor1;
     gsicc_link_t *icc_link; /* ICC link to avoid recreation with every line */
     gx_image_color_cache_t *color_cache;  /* A cache that is con-tone values */
+    gx_image_unique_colors_t *unique_colors; /* not in gc memory */
     byte *ht_buffer;            /* A buffer to contain halftoned data */
     int ht_stride;
     int ht_offset_bits;     /* An offset adjustement to allow aligned copies */
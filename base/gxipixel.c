@@ -816,6 +816,7 @@ gx_image_enum_begin(gx_device * dev, const gs_gstate * pgs,
     penum->line = NULL;
     penum->icc_link = NULL;
     penum->color_cache = NULL;
+    penum->unique_colors = NULL;
     penum->ht_buffer = NULL;
     penum->thresh_buffer = NULL;
     penum->use_cie_range = false;
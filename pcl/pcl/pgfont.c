@@ -235,6 +235,7 @@ hpgl_fill_in_stick_arc_font(gs_font_base * pfont, long unique_id)
     pfont->FontBBox.q.x = 0.667;
     pfont->FontBBox.q.y = 0.667;
     uid_set_UniqueID(&pfont->UID, unique_id);
+    pfont->UID_is_local = true;
     pfont->encoding_index = 1;          /****** WRONG ******/
     pfont->nearest_encoding_index = 1;          /****** WRONG ******/
 }
@@ -322,6 +323,7 @@ hpgl_fill_in_531_font(gs_font_base * pfont, long unique_id)
     pfont->FontBBox.q.x = 0.667;
     pfont->FontBBox.q.y = 0.667;
     uid_set_UniqueID(&pfont->UID, unique_id);
+    pfont->UID_is_local = true;
     pfont->encoding_index = 1;  /****** WRONG ******/
     pfont->nearest_encoding_index = 1;  /****** WRONG ******/
 
@@ -836,6 +836,7 @@ pl_fill_in_bitmap_font(gs_font_base * pfont, long unique_id)
     pfont->FontBBox.p.x = pfont->FontBBox.p.y =
         pfont->FontBBox.q.x = pfont->FontBBox.q.y = 0;
     uid_set_UniqueID(&pfont->UID, unique_id);
+    pfont->UID_is_local = true;
     pfont->encoding_index = 1;          /****** WRONG ******/
     pfont->nearest_encoding_index = 1;          /****** WRONG ******/
 }
@@ -858,6 +859,7 @@ pl_fill_in_tt_font(gs_font_type42 * pfont, void *data, long unique_id)
     pfont->FontBBox.p.x = pfont->FontBBox.p.y =
         pfont->FontBBox.q.x = pfont->FontBBox.q.y = 0;
     uid_set_UniqueID(&pfont->UID, unique_id);
+    pfont->UID_is_local = true;
     pfont->encoding_index = 1;          /****** WRONG ******/
     pfont->nearest_encoding_index = 1;          /****** WRONG ******/
     /* Initialize Type 42 specific data. */
@@ -895,6 +897,7 @@ pl_fill_in_intelli_font(gs_font_base * pfont, long unique_id)
     pfont->FontBBox.p.x = pfont->FontBBox.p.y =
         pfont->FontBBox.q.x = pfont->FontBBox.q.y = 0;
     uid_set_UniqueID(&pfont->UID, unique_id);
+    pfont->UID_is_local = true;
     pfont->encoding_index = 1;          /****** WRONG ******/
     pfont->nearest_encoding_index = 1;          /****** WRONG ******/
     pl_intelli_init_procs(pfont);
@@ -251,6 +251,7 @@ pl_fill_in_mt_font(gs_font_base * pfont, pl_font_t * plfont, ushort handle,
                 pfont->FontBBox.q.x = pfont->FontBBox.q.y = 0;
 
             uid_set_UniqueID(&pfont->UID, unique_id | ( ((long) handle) << 16));
+            pfont->UID_is_local = true;
             pfont->encoding_index = 1;      /****** WRONG ******/
             pfont->nearest_encoding_index = 1;      /****** WRONG ******/
         }
@@ -75,6 +75,7 @@ pl_fill_in_mt_font(gs_font_base * pfont, SW16 data, long unique_id)
     pfont->FontBBox.p.x = pfont->FontBBox.p.y =
         pfont->FontBBox.q.x = pfont->FontBBox.q.y = 0;
     uid_set_UniqueID(&pfont->UID, unique_id | (data << 16));
+    pfont->UID_is_local = true;
     pfont->encoding_index = 1;          /****** WRONG ******/
     pfont->nearest_encoding_index = 1;          /****** WRONG ******/
     pl_mt_init_procs(pfont);
@@ -38,9 +38,11 @@
 #include "pdf_repair.h"
 #include "pdf_xref.h"
 #include "pdf_device.h"
+#include "pdf_deref.h"
 
 #include "gsstate.h"        /* For gs_gstate */
 #include "gsicc_manage.h"  /* For gsicc_init_iccmanager() */
+#include "gp.h"            /* For gp_fmap() */
 
 #if PDFI_LEAK_CHECK
 #include "gsmchunk.h"
@@ -718,12 +720,75 @@ int pdfi_separation_name_from_index(gs_gstate *pgs, gs_separation_name index, un
     return_error(gs_error_undefined);
 }
 
+/* With -dPDFMapInput we map the whole input file into memory and read it
+ * through a string stream. Seeking is then just moving a pointer, and the
+ * tokeniser and any filters on unencoded stream data read straight from the
+ * mapped pages, rather than refilling the file stream buffer after every seek.
+ * If the file can't be mapped we quietly carry on reading the file stream.
+ */
+static void pdfi_map_input_stream(pdf_context *ctx)
+{
+    stream *stm = ctx->main_stream->s, *map_stream;
+    gs_offset_t size;
+    byte *map;
+
+    if (stm->file == NULL || !s_is_reading(stm) || ctx->main_stream_length <= 0)
+        return;
+    /* String streams can't be larger than a uint */
+    if (ctx->main_stream_length > max_uint)
+        return;
+
+    size = stm->file_offset + ctx->main_stream_length;
+    map = gp_fmap(stm->file, size);
+    if (map == NULL)
+        return;
+
+    map_stream = file_alloc_stream(ctx->memory, "pdfi_map_input_stream");
+    if (map_stream == NULL) {
+        gp_funmap(map, size);
+        return;
+    }
+    sread_string_reusable(map_stream, map + stm->file_offset, (uint)ctx->main_stream_length);
+
+    ctx->main_file_stream = stm;
+    ctx->main_map_stream = map_stream;
+    ctx->main_map = map;
+    ctx->main_map_size = size;
+    ctx->main_stream->s = map_stream;
+
+    if (ctx->args.pdfdebug)
+        dmprintf1(ctx->memory, "%% Mapped %"PRIi64" bytes of input file\n", (int64_t)ctx->main_stream_length);
+}
+
+/* Release the mapping made above, and put the file stream back as the
+ * main stream (unless the caller has already detached it).
+ */
+static void pdfi_unmap_input_stream(pdf_context *ctx)
+{
+    if (ctx->main_map == NULL)
+        return;
+
+    if (ctx->main_stream != NULL && ctx->main_stream->s == ctx->main_map_stream)
+        ctx->main_stream->s = ctx->main_file_stream;
+
+    sclose(ctx->main_map_stream);
+    gs_free_object(ctx->memory, ctx->main_map_stream, "pdfi_unmap_input_stream");
+    gp_funmap(ctx->main_map, ctx->main_map_size);
+
+    ctx->main_map_stream = NULL;
+    ctx->main_file_stream = NULL;
+    ctx->main_map = NULL;
+    ctx->main_map_size = 0;
+}
+
 /* These functions are used by the 'PL' implementation, eventually we will */
 /* need to have custom PostScript operators to process the file or at      */
 /* (least pages from it).                                                  */
 
 int pdfi_close_pdf_file(pdf_context *ctx)
 {
+    pdfi_unmap_input_stream(ctx);
+
     if (ctx->main_stream) {
         if (ctx->main_stream->s) {
             sfclose(ctx->main_stream->s);
@@ -1187,6 +1252,9 @@ int pdfi_set_input_stream(pdf_context *ctx, stream *stm)
     bytes = BUF_SIZE;
     pdfi_seek(ctx, ctx->main_stream, 0, SEEK_SET);
 
+    if (ctx->args.mapinput)
+        pdfi_map_input_stream(ctx);
+
     bytes = Offset = min(BUF_SIZE - 1, ctx->main_stream_length);
 
     if (ctx->args.pdfdebug)
@@ -1684,12 +1752,8 @@ pdf_context *pdfi_create_context(gs_memory_t *mem)
 #if REFCNT_DEBUG
     ctx->UID = 1;
 #endif
-#if CACHE_STATISTICS
-    ctx->hits = 0;
-    ctx->misses = 0;
-    ctx->compressed_hits = 0;
-    ctx->compressed_misses = 0;
-#endif
+    ctx->args.PDFCacheSize = PDFI_DEFAULT_CACHE_SIZE;
+    ctx->args.PDFStreamCacheSize = PDFI_DEFAULT_STREAM_CACHE_SIZE;
 #ifdef DEBUG
     ctx->args.verbose_errors = ctx->args.verbose_warnings = 1;
 #endif
@@ -1755,6 +1819,7 @@ pdfi_purge_obj_cache(pdf_context *ctx)
         ctx->cache_LRU = ctx->cache_MRU = NULL;
         ctx->cache_entries = 0;
     }
+    ctx->cache_bytes = 0;
 }
 #endif
 
@@ -1765,21 +1830,37 @@ pdfi_purge_obj_cache(pdf_context *ctx)
  */
 int pdfi_clear_context(pdf_context *ctx)
 {
-#if CACHE_STATISTICS
-    float compressed_hit_rate = 0.0, hit_rate = 0.0;
-
-    if (ctx->compressed_hits > 0 || ctx->compressed_misses > 0)
-        compressed_hit_rate = (float)ctx->compressed_hits / (float)(ctx->compressed_hits + ctx->compressed_misses);
-    if (ctx->hits > 0 || ctx->misses > 0)
-        hit_rate = (float)ctx->hits / (float)(ctx->hits + ctx->misses);
-
-    dmprintf1(ctx->memory, "Number of normal object cache hits: %"PRIi64"\n", ctx->hits);
-    dmprintf1(ctx->memory, "Number of normal object cache misses: %"PRIi64"\n", ctx->misses);
-    dmprintf1(ctx->memory, "Number of compressed object cache hits: %"PRIi64"\n", ctx->compressed_hits);
-    dmprintf1(ctx->memory, "Number of compressed object cache misses: %"PRIi64"\n", ctx->compressed_misses);
-    dmprintf1(ctx->memory, "Normal object cache hit rate: %f\n", hit_rate);
-    dmprintf1(ctx->memory, "Compressed object cache hit rate: %f\n", compressed_hit_rate);
-#endif
+    if ((CACHE_STATISTICS || ctx->args.pdfdebug) &&
+        (ctx->hits > 0 || ctx->misses > 0 || ctx->compressed_hits > 0 || ctx->compressed_misses > 0 ||
+         ctx->stream_cache_hits > 0)) {
+        float compressed_hit_rate = 0.0, hit_rate = 0.0, objstm_hit_rate = 0.0;
+
+        if (ctx->compressed_hits > 0 || ctx->compressed_misses > 0)
+            compressed_hit_rate = (float)ctx->compressed_hits / (float)(ctx->compressed_hits + ctx->compressed_misses);
+        if (ctx->hits > 0 || ctx->misses > 0)
+            hit_rate = (float)ctx->hits / (float)(ctx->hits + ctx->misses);
+        if (ctx->objstm_hits > 0 || ctx->objstm_misses > 0)
+            objstm_hit_rate = (float)ctx->objstm_hits / (float)(ctx->objstm_hits + ctx->objstm_misses);
+
+        dmprintf1(ctx->memory, "Number of normal object cache hits: %"PRIi64"\n", ctx->hits);
+        dmprintf1(ctx->memory, "Number of normal object cache misses: %"PRIi64"\n", ctx->misses);
+        dmprintf1(ctx->memory, "Number of compressed object cache hits: %"PRIi64"\n", ctx->compressed_hits);
+        dmprintf1(ctx->memory, "Number of compressed object cache misses: %"PRIi64"\n", ctx->compressed_misses);
+        dmprintf1(ctx->memory, "Number of object stream cache hits: %"PRIi64"\n", ctx->objstm_hits);
+        dmprintf1(ctx->memory, "Number of object stream cache misses: %"PRIi64"\n", ctx->objstm_misses);
+        dmprintf1(ctx->memory, "Number of objects evicted from the cache: %"PRIi64"\n", ctx->cache_evictions);
+        dmprintf2(ctx->memory, "Object cache use at end: %u entries, %"PRIi64" bytes\n", ctx->cache_entries, ctx->cache_bytes);
+        dmprintf1(ctx->memory, "Normal object cache hit rate: %f\n", hit_rate);
+        dmprintf1(ctx->memory, "Compressed object cache hit rate: %f\n", compressed_hit_rate);
+        dmprintf1(ctx->memory, "Object stream cache hit rate: %f\n", objstm_hit_rate);
+        dmprintf1(ctx->memory, "Number of decoded stream cache hits: %"PRIi64"\n", ctx->stream_cache_hits);
+        dmprintf1(ctx->memory, "Number of streams decoded into the cache: %"PRIi64"\n", ctx->stream_cache_misses);
+        dmprintf2(ctx->memory, "Decoded stream cache use at end: %u entries, %"PRIi64" bytes\n",
+                  ctx->stream_cache_entries, ctx->stream_cache_bytes);
+    }
+    ctx->hits = ctx->misses = ctx->compressed_hits = ctx->compressed_misses = 0;
+    ctx->objstm_hits = ctx->objstm_misses = ctx->cache_evictions = 0;
+    ctx->stream_cache_hits = ctx->stream_cache_misses = 0;
     if (ctx->args.PageList) {
         gs_free_object(ctx->memory, ctx->args.PageList, "pdfi_clear_context");
         ctx->args.PageList = NULL;
@@ -1819,6 +1900,11 @@ int pdfi_clear_context(pdf_context *ctx)
         ctx->args.cidsubstfont.data = NULL;
     }
 
+    if (ctx->args.nativefontmapcache.data != NULL) {
+        gs_free_object(ctx->memory, ctx->args.nativefontmapcache.data, "nativefontmapcache.data");
+        ctx->args.nativefontmapcache.data = NULL;
+    }
+
     pdfi_free_cstring_array(ctx, &ctx->args.showannottypes);
     pdfi_free_cstring_array(ctx, &ctx->args.preserveannottypes);
 
@@ -1841,6 +1927,8 @@ int pdfi_clear_context(pdf_context *ctx)
         ctx->filename = NULL;
     }
 
+    pdfi_unmap_input_stream(ctx);
+
     if (ctx->main_stream) {
         gs_free_object(ctx->memory, ctx->main_stream, "pdfi_clear_context, free main PDF stream");
         ctx->main_stream = NULL;
@@ -1934,6 +2022,10 @@ int pdfi_clear_context(pdf_context *ctx)
         ctx->cache_LRU = ctx->cache_MRU = NULL;
         ctx->cache_entries = 0;
     }
+    ctx->cache_bytes = 0;
+
+    pdfi_free_objstm_cache(ctx);
+    pdfi_free_stream_cache(ctx);
 
     /* We can't free the font directory before the graphics library fonts fonts are freed, as they reference the font_dir.
      * graphics library fonts are refrenced from pdf_font objects, and those may be in the cache, which means they
@@ -1947,6 +2039,8 @@ int pdfi_clear_context(pdf_context *ctx)
     pdfi_countdown(ctx->pdfnativefontmap);
     ctx->pdfnativefontmap = NULL;
 
+    pdfi_free_intern_names(ctx);
+
     return 0;
 }
 
@@ -155,7 +155,14 @@ typedef enum pdf_overprint_control_e {
 
 #define INITIAL_STACK_SIZE 32
 #define MAX_STACK_SIZE 524288
-#define MAX_OBJECT_CACHE_SIZE 200
+/* Default memory budget, in bytes, for each of the object cache and the cache of
+ * decompressed object streams. Can be changed with -dPDFCacheSize=
+ */
+#define PDFI_DEFAULT_CACHE_SIZE (8 * 1024 * 1024)
+/* Default memory budget, in bytes, for the decoded data of images and Forms which
+ * are used more than once. Can be changed with -dPDFStreamCacheSize=
+ */
+#define PDFI_DEFAULT_STREAM_CACHE_SIZE (32 * 1024 * 1024)
 #define INITIAL_LOOP_TRACKER_SIZE 32
 
 typedef struct pdf_transfer_s {
@@ -210,6 +217,9 @@ typedef struct cmd_args_s {
     bool NOSUBSTDEVICECOLORS;
     bool ditherppi;
     int PDFX3Profile_num;
+    int PDFCacheSize;           /* -dPDFCacheSize= */
+    bool mapinput;              /* -dPDFMapInput */
+    int PDFStreamCacheSize;     /* -dPDFStreamCacheSize= */
     char *UseOutputIntent;
     pdf_overprint_control_t overprint_control;     /* Overprint -- enabled, disabled, simulated */
     char *PageList;
@@ -220,6 +230,8 @@ typedef struct cmd_args_s {
     gs_string cidsubstfont;
     bool ignoretounicode;
     bool nonativefontmap;
+    gs_string nativefontmapcache;   /* -sPDFNativeFontMapCache= */
+    bool rebuildnativefontmap;      /* -dPDFRebuildNativeFontMap */
 } cmd_args_t;
 
 typedef struct encryption_state_s {
@@ -423,6 +435,14 @@ typedef struct pdf_context_s
 
     /* Length of the main file */
     gs_offset_t main_stream_length;
+    /* When the input file is memory mapped (-dPDFMapInput) main_stream reads
+     * from main_map_stream, a string stream over the mapping, and
+     * main_file_stream is the file stream it replaced.
+     */
+    stream *main_file_stream;
+    stream *main_map_stream;
+    byte *main_map;
+    gs_offset_t main_map_size;
     /* offset to the xref table */
     gs_offset_t startxref;
 
@@ -469,9 +489,35 @@ typedef struct pdf_context_s
 
     /* The object cache */
     uint32_t cache_entries;
+    uint64_t cache_bytes;
     pdf_obj_cache_entry *cache_LRU;
     pdf_obj_cache_entry *cache_MRU;
 
+    /* The cache of decompressed object streams */
+    uint32_t objstm_cache_entries;
+    uint64_t objstm_cache_bytes;
+    pdf_objstm_cache_entry *objstm_cache_LRU;
+    pdf_objstm_cache_entry *objstm_cache_MRU;
+
+    /* The cache of decoded image and content streams */
+    uint32_t stream_cache_entries;
+    uint64_t stream_cache_bytes;
+    pdf_stream_cache_entry *stream_cache_LRU;
+    pdf_stream_cache_entry *stream_cache_MRU;
+    byte *stream_cache_uses;            /* Indexed by object number, see pdfi_open_cached_stream() */
+    uint64_t stream_cache_uses_size;
+
+    /* Cache statistics, reported at the end of the file with -dPDFDEBUG */
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t compressed_hits;
+    uint64_t compressed_misses;
+    uint64_t objstm_hits;
+    uint64_t objstm_misses;
+    uint64_t cache_evictions;
+    uint64_t stream_cache_hits;
+    uint64_t stream_cache_misses;
+
     /* The loop detection state */
     uint32_t loop_detection_size;
     uint32_t loop_detection_entries;
@@ -488,6 +534,13 @@ typedef struct pdf_context_s
     /* A name table :-( */
     pdfi_name_entry_t *name_table;
 
+    /* Names read by the tokeniser, interned so that equal names share a single
+     * object. Open addressed, intern_names_size is a power of 2. See pdfi_name_intern().
+     */
+    pdf_name **intern_names;
+    uint32_t intern_names_size;
+    uint32_t intern_names_count;
+
     gs_string *fontmapfiles;
     int num_fontmapfiles;
 
@@ -507,12 +560,6 @@ typedef struct pdf_context_s
 #if REFCNT_DEBUG
     uint64_t ref_UID;
 #endif
-#if CACHE_STATISTICS
-    uint64_t hits;
-    uint64_t misses;
-    uint64_t compressed_hits;
-    uint64_t compressed_misses;
-#endif
 #if PDFI_LEAK_CHECK
     gs_memory_status_t memstat;
 #endif
@@ -33,8 +33,92 @@
 
 /* Start with the object caching functions */
 
-/* given an object, create a cache entry for it. If we have too many entries
- * then delete the leat-recently-used cache entry. Make the new entry be the
+/* The cache is limited by memory use rather than by a number of entries, so that
+ * documents with lots of small shared objects can keep them all cached, while a
+ * few large ones (fonts, big arrays) can't push everything else out. The budget
+ * is set with -dPDFCacheSize=. We can't measure the memory an object uses cheaply,
+ * so this makes an estimate; the object itself, plus its direct (not indirectly
+ * referenced) contents. Fonts and CMaps carry graphics library structures we can't
+ * see the size of, so for those we use a fixed guess.
+ */
+#define PDFI_CACHE_OPAQUE_OBJECT_SIZE 32768
+#define PDFI_CACHE_MAX_DEPTH 8
+
+static uint64_t pdfi_cache_obj_size(pdf_obj *o, int depth)
+{
+    uint64_t size, i;
+
+    switch(o->type) {
+        case PDF_STRING:
+        case PDF_NAME:
+        case PDF_KEYWORD:
+            return sizeof(pdf_string) + ((pdf_string *)o)->length;
+        case PDF_ARRAY:
+            {
+                pdf_array *a = (pdf_array *)o;
+
+                size = sizeof(pdf_array) + a->size * sizeof(pdf_obj *);
+                if (depth < PDFI_CACHE_MAX_DEPTH) {
+                    for (i = 0; i < a->size; i++)
+                        if (a->values[i] != NULL && a->values[i]->object_num == 0)
+                            size += pdfi_cache_obj_size(a->values[i], depth + 1);
+                }
+            }
+            return size;
+        case PDF_DICT:
+            {
+                pdf_dict *d = (pdf_dict *)o;
+
+                size = sizeof(pdf_dict) + d->size * 2 * sizeof(pdf_obj *) + d->hash_size * sizeof(uint32_t);
+                if (depth < PDFI_CACHE_MAX_DEPTH) {
+                    for (i = 0; i < d->entries; i++)
+                        if (d->values[i] != NULL && d->values[i]->object_num == 0)
+                            size += pdfi_cache_obj_size(d->values[i], depth + 1);
+                }
+            }
+            return size;
+        case PDF_STREAM:
+            size = sizeof(pdf_stream);
+            if (((pdf_stream *)o)->stream_dict != NULL)
+                size += pdfi_cache_obj_size((pdf_obj *)((pdf_stream *)o)->stream_dict, depth + 1);
+            return size;
+        case PDF_FONT:
+        case PDF_CMAP:
+            return PDFI_CACHE_OPAQUE_OBJECT_SIZE;
+        default:
+            return sizeof(pdf_indirect_ref);
+    }
+}
+
+/* Evict least-recently-used entries until there is room for 'needed' more bytes,
+ * but leave at least 'keep' entries in the cache.
+ */
+static void pdfi_cache_make_room(pdf_context *ctx, uint64_t needed, uint32_t keep)
+{
+    pdf_obj_cache_entry *entry;
+
+    while (ctx->cache_entries > keep && ctx->cache_LRU != NULL &&
+           ctx->cache_bytes + needed > (uint64_t)ctx->args.PDFCacheSize) {
+#if DEBUG_CACHE
+        dbgmprintf(ctx->memory, "Cache full, evicting LRU\n");
+#endif
+        entry = ctx->cache_LRU;
+        ctx->cache_LRU = entry->next;
+        if (entry->next)
+            ((pdf_obj_cache_entry *)entry->next)->previous = NULL;
+        else
+            ctx->cache_MRU = NULL;
+        ctx->xref_table->xref[entry->o->object_num].cache = NULL;
+        ctx->cache_bytes -= entry->size;
+        pdfi_countdown(entry->o);
+        ctx->cache_entries--;
+        ctx->cache_evictions++;
+        gs_free_object(ctx->memory, entry, "pdfi_add_to_cache, free LRU");
+    }
+}
+
+/* given an object, create a cache entry for it. If the cache is over budget
+ * then delete least-recently-used cache entries. Make the new entry be the
  * most-recently-used entry. The actual entries are attached to the xref table
  * (as well as being a double-linked list), because we detect an existing
  * cache entry by seeing that the xref table for the object number has a non-NULL
@@ -44,6 +128,7 @@
 static int pdfi_add_to_cache(pdf_context *ctx, pdf_obj *o)
 {
     pdf_obj_cache_entry *entry;
+    uint64_t size;
 
     if (ctx->xref_table->xref[o->object_num].cache != NULL) {
 #if DEBUG_CACHE
@@ -55,23 +140,9 @@ static int pdfi_add_to_cache(pdf_context *ctx, pdf_obj *o)
     if (o->object_num > ctx->xref_table->xref_size)
         return_error(gs_error_rangecheck);
 
-    if (ctx->cache_entries == MAX_OBJECT_CACHE_SIZE)
-    {
-#if DEBUG_CACHE
-        dbgmprintf(ctx->memory, "Cache full, evicting LRU\n");
-#endif
-        if (ctx->cache_LRU) {
-            entry = ctx->cache_LRU;
-            ctx->cache_LRU = entry->next;
-            if (entry->next)
-                ((pdf_obj_cache_entry *)entry->next)->previous = NULL;
-            ctx->xref_table->xref[entry->o->object_num].cache = NULL;
-            pdfi_countdown(entry->o);
-            ctx->cache_entries--;
-            gs_free_object(ctx->memory, entry, "pdfi_add_to_cache, free LRU");
-        } else
-            return_error(gs_error_unknownerror);
-    }
+    size = pdfi_cache_obj_size(o, 0);
+    pdfi_cache_make_room(ctx, size, 0);
+
     entry = (pdf_obj_cache_entry *)gs_alloc_bytes(ctx->memory, sizeof(pdf_obj_cache_entry), "pdfi_add_to_cache");
     if (entry == NULL)
         return_error(gs_error_VMerror);
@@ -79,6 +150,7 @@ static int pdfi_add_to_cache(pdf_context *ctx, pdf_obj *o)
     memset(entry, 0x00, sizeof(pdf_obj_cache_entry));
 
     entry->o = o;
+    entry->size = size;
     pdfi_countup(o);
     if (ctx->cache_MRU) {
         entry->previous = ctx->cache_MRU;
@@ -89,6 +161,7 @@ static int pdfi_add_to_cache(pdf_context *ctx, pdf_obj *o)
         ctx->cache_LRU = entry;
 
     ctx->cache_entries++;
+    ctx->cache_bytes += size;
     ctx->xref_table->xref[o->object_num].cache = entry;
     return 0;
 }
@@ -150,6 +223,12 @@ int replace_cache_entry(pdf_context *ctx, pdf_obj *o)
         pdfi_countup(o);
         pdfi_promote_cache_entry(ctx, cache_entry);
 
+        ctx->cache_bytes -= cache_entry->size;
+        cache_entry->size = pdfi_cache_obj_size(o, 0);
+        ctx->cache_bytes += cache_entry->size;
+        /* Don't evict the entry we just replaced, it's the MRU */
+        pdfi_cache_make_room(ctx, 0, 1);
+
         /* Now decrement the old cache entry, if any */
         pdfi_countdown(old_cached_obj);
     }
@@ -449,10 +528,13 @@ int pdfi_read_bare_object(pdf_context *ctx, pdf_c_stream *s, gs_offset_t stream_
             return_error(gs_error_stackunderflow);
         }
 
-        o = ctx->stack_top[-2];
-
         pdfi_pop(ctx, 1);
 
+        code = pdfi_name_unintern(ctx, &ctx->stack_top[-1]);
+        if (code < 0)
+            return code;
+        o = ctx->stack_top[-1];
+
         o->indirect_num = o->object_num = objnum;
         o->indirect_gen = o->generation_num = gen;
         return code;
@@ -471,10 +553,13 @@ int pdfi_read_bare_object(pdf_context *ctx, pdf_c_stream *s, gs_offset_t stream_
             return_error(gs_error_stackunderflow);
 
         /* If we have that many objects, assume that we can throw away the x y obj and just use the remaining object */
-        o = ctx->stack_top[-4];
-
         pdfi_pop(ctx, 3);
 
+        code = pdfi_name_unintern(ctx, &ctx->stack_top[-1]);
+        if (code < 0)
+            return code;
+        o = ctx->stack_top[-1];
+
         o->indirect_num = o->object_num = objnum;
         o->indirect_gen = o->generation_num = gen;
         if (saved_offset[0] > 0)
@@ -491,10 +576,13 @@ int pdfi_read_bare_object(pdf_context *ctx, pdf_c_stream *s, gs_offset_t stream_
         if (pdfi_count_stack(ctx) < 2)
             return_error(gs_error_stackunderflow);
 
-        o = ctx->stack_top[-2];
-
         pdfi_pop(ctx, 1);
 
+        code = pdfi_name_unintern(ctx, &ctx->stack_top[-1]);
+        if (code < 0)
+            return code;
+        o = ctx->stack_top[-1];
+
         o->indirect_num = o->object_num = objnum;
         o->indirect_gen = o->generation_num = gen;
         return code;
@@ -563,111 +651,353 @@ static int pdfi_read_object(pdf_context *ctx, pdf_c_stream *s, gs_offset_t strea
     return pdfi_read_bare_object(ctx, s, stream_offset, objnum, gen);
 }
 
-static int pdfi_deref_compressed(pdf_context *ctx, uint64_t obj, uint64_t gen, pdf_obj **object,
-                                 const xref_entry *entry)
+/* The cache of decompressed object streams
+ * Objects in an ObjStm are usually read one at a time, as they are referenced, and
+ * without this we would decompress the stream, and parse its header, from the start
+ * for every one of them. This is kept separately from the object cache (which holds
+ * the ObjStm's stream object) and has its own budget of PDFCacheSize bytes, though
+ * we always keep the most recently used stream. A stream which decompresses to more
+ * than the budget, or than PDFI_OBJSTM_MAX_SIZE, is not held in memory; its entry
+ * only records that, and its objects are read by decompressing up to each one.
+ */
+#define PDFI_OBJSTM_MAX_SIZE (256 * 1024 * 1024)
+
+static void pdfi_free_objstm_entry(pdf_context *ctx, pdf_objstm_cache_entry *entry)
+{
+    gs_free_object(ctx->memory, entry->data, "pdfi_free_objstm_entry");
+    gs_free_object(ctx->memory, entry->object_nums, "pdfi_free_objstm_entry");
+    gs_free_object(ctx->memory, entry->object_offsets, "pdfi_free_objstm_entry");
+    gs_free_object(ctx->memory, entry, "pdfi_free_objstm_entry");
+}
+
+void pdfi_free_objstm_cache(pdf_context *ctx)
+{
+    pdf_objstm_cache_entry *entry = ctx->objstm_cache_LRU, *next;
+
+    while (entry) {
+        next = entry->next;
+        pdfi_free_objstm_entry(ctx, entry);
+        entry = next;
+    }
+    ctx->objstm_cache_LRU = ctx->objstm_cache_MRU = NULL;
+    ctx->objstm_cache_entries = 0;
+    ctx->objstm_cache_bytes = 0;
+}
+
+static void pdfi_objstm_unlink(pdf_context *ctx, pdf_objstm_cache_entry *entry)
+{
+    if (entry->previous)
+        ((pdf_objstm_cache_entry *)entry->previous)->next = entry->next;
+    else
+        ctx->objstm_cache_LRU = entry->next;
+    if (entry->next)
+        ((pdf_objstm_cache_entry *)entry->next)->previous = entry->previous;
+    else
+        ctx->objstm_cache_MRU = entry->previous;
+    entry->next = entry->previous = NULL;
+}
+
+static void pdfi_objstm_link_MRU(pdf_context *ctx, pdf_objstm_cache_entry *entry)
+{
+    entry->previous = ctx->objstm_cache_MRU;
+    entry->next = NULL;
+    if (ctx->objstm_cache_MRU)
+        ctx->objstm_cache_MRU->next = entry;
+    ctx->objstm_cache_MRU = entry;
+    if (ctx->objstm_cache_LRU == NULL)
+        ctx->objstm_cache_LRU = entry;
+}
+
+static pdf_objstm_cache_entry *pdfi_objstm_cache_find(pdf_context *ctx, uint64_t object_num, gs_offset_t offset)
+{
+    pdf_objstm_cache_entry *entry;
+
+    for (entry = ctx->objstm_cache_MRU; entry != NULL; entry = entry->previous) {
+        if (entry->object_num == object_num && entry->offset == offset) {
+            if (entry != ctx->objstm_cache_MRU) {
+                pdfi_objstm_unlink(ctx, entry);
+                pdfi_objstm_link_MRU(ctx, entry);
+            }
+            return entry;
+        }
+    }
+    return NULL;
+}
+
+static void pdfi_objstm_cache_add(pdf_context *ctx, pdf_objstm_cache_entry *entry)
+{
+    pdf_objstm_cache_entry *victim;
+
+    while (ctx->objstm_cache_LRU != NULL &&
+           ctx->objstm_cache_bytes + entry->size > (uint64_t)ctx->args.PDFCacheSize) {
+        victim = ctx->objstm_cache_LRU;
+        pdfi_objstm_unlink(ctx, victim);
+        ctx->objstm_cache_bytes -= victim->size;
+        ctx->objstm_cache_entries--;
+        pdfi_free_objstm_entry(ctx, victim);
+    }
+    pdfi_objstm_link_MRU(ctx, entry);
+    ctx->objstm_cache_bytes += entry->size;
+    ctx->objstm_cache_entries++;
+}
+
+/* Decompress an ObjStm into memory and parse its header of object number/offset pairs.
+ * If it is too large to keep, the entry returned has no data.
+ */
+static int pdfi_read_objstm(pdf_context *ctx, pdf_stream *compressed_object, pdf_dict *compressed_sdict,
+                            const xref_entry *compressed_entry, uint64_t obj, uint64_t gen,
+                            pdf_objstm_cache_entry **objstm)
 {
     int code = 0;
-    xref_entry *compressed_entry;
-    pdf_c_stream *compressed_stream = NULL;
-    pdf_c_stream *SubFile_stream = NULL;
-    pdf_c_stream *Object_stream = NULL;
-    char Buffer[256];
-    int i = 0, object_length = 0;
-    int64_t num_entries, found_object;
-    int64_t Length;
-    gs_offset_t offset = 0;
-    pdf_stream *compressed_object = NULL;
-    pdf_dict *compressed_sdict = NULL; /* alias */
-    pdf_name *Type = NULL;
+    int64_t i, num_entries, Length;
+    uint64_t size = 0, alloc_size = 0, limit;
+    int bytes;
+    byte *data = NULL, *new_data;
+    pdf_c_stream *SubFile_stream = NULL, *compressed_stream = NULL, *header_stream = NULL;
+    pdf_objstm_cache_entry *entry = NULL;
     pdf_obj *temp_obj;
 
-    if (entry->u.compressed.compressed_stream_num > ctx->xref_table->xref_size - 1)
-        return_error(gs_error_undefined);
+    *objstm = NULL;
 
-    compressed_entry = &ctx->xref_table->xref[entry->u.compressed.compressed_stream_num];
+    /* Need to check the /N entry to see if the object is actually in this stream! */
+    code = pdfi_dict_get_int(ctx, compressed_sdict, "N", &num_entries);
+    if (code < 0)
+        return code;
 
-    if (ctx->args.pdfdebug) {
-        dmprintf1(ctx->memory, "%% Reading compressed object (%"PRIi64" 0 obj)", obj);
-        dmprintf1(ctx->memory, " from ObjStm with object number %"PRIi64"\n", compressed_entry->object_num);
-    }
+    if (num_entries < 0 || num_entries > ctx->xref_table->xref_size)
+        return_error(gs_error_rangecheck);
 
-    if (compressed_entry->cache == NULL) {
-#if CACHE_STATISTICS
-        ctx->compressed_misses++;
-#endif
-        code = pdfi_seek(ctx, ctx->main_stream, compressed_entry->u.uncompressed.offset, SEEK_SET);
-        if (code < 0)
-            goto exit;
+    code = pdfi_seek(ctx, ctx->main_stream, pdfi_stream_offset(ctx, compressed_object), SEEK_SET);
+    if (code < 0)
+        return code;
 
-        code = pdfi_read_object(ctx, ctx->main_stream, 0);
-        if (code < 0)
-            goto exit;
+    code = pdfi_dict_get_int(ctx, compressed_sdict, "Length", &Length);
+    if (code < 0)
+        return code;
 
-        if (pdfi_count_stack(ctx) < 1) {
-            code = gs_note_error(gs_error_stackunderflow);
+    code = pdfi_apply_SubFileDecode_filter(ctx, Length, NULL, ctx->main_stream, &SubFile_stream, false);
+    if (code < 0)
+        return code;
+
+    code = pdfi_filter(ctx, compressed_object, SubFile_stream, &compressed_stream, false);
+    if (code < 0)
+        goto exit;
+
+    /* Read the decompressed data, stopping quietly at the end of the stream or at an error;
+     * anything we then need from beyond that point will fail to parse. We read one byte
+     * more than the limit, to tell whether the stream is larger.
+     */
+    limit = min((uint64_t)ctx->args.PDFCacheSize, PDFI_OBJSTM_MAX_SIZE);
+    do {
+        if (size == alloc_size) {
+            if (alloc_size > limit)
+                break;
+            alloc_size = alloc_size == 0 ? 16384 : alloc_size * 2;
+            if (alloc_size > limit + 1)
+                alloc_size = limit + 1;
+            new_data = gs_alloc_bytes(ctx->memory, alloc_size, "pdfi_read_objstm");
+            if (new_data == NULL) {
+                code = gs_note_error(gs_error_VMerror);
+                goto exit;
+            }
+            if (size > 0)
+                memcpy(new_data, data, size);
+            gs_free_object(ctx->memory, data, "pdfi_read_objstm");
+            data = new_data;
+        }
+        bytes = pdfi_read_bytes(ctx, data + size, 1, (uint32_t)(alloc_size - size), compressed_stream);
+        if (bytes > 0)
+            size += bytes;
+    } while (bytes > 0 && !compressed_stream->eof);
+
+    entry = (pdf_objstm_cache_entry *)gs_alloc_bytes(ctx->memory, sizeof(pdf_objstm_cache_entry), "pdfi_read_objstm");
+    if (entry == NULL) {
+        code = gs_note_error(gs_error_VMerror);
+        goto exit;
+    }
+    memset(entry, 0x00, sizeof(pdf_objstm_cache_entry));
+    entry->object_num = compressed_entry->object_num;
+    entry->offset = compressed_entry->u.uncompressed.offset;
+    if (size > limit) {
+        entry->size = sizeof(pdf_objstm_cache_entry);
+        goto exit;
+    }
+    entry->data = data;
+    data = NULL;
+    entry->length = size;
+    entry->N = num_entries;
+    if (num_entries > 0) {
+        entry->object_nums = (int64_t *)gs_alloc_bytes(ctx->memory, num_entries * sizeof(int64_t), "pdfi_read_objstm");
+        entry->object_offsets = (int64_t *)gs_alloc_bytes(ctx->memory, num_entries * sizeof(int64_t), "pdfi_read_objstm");
+        if (entry->object_nums == NULL || entry->object_offsets == NULL) {
+            code = gs_note_error(gs_error_VMerror);
             goto exit;
         }
+    }
 
-        if ((ctx->stack_top[-1])->type != PDF_STREAM) {
+    code = pdfi_open_memory_stream_from_memory(ctx, (unsigned int)entry->length, entry->data, &header_stream, true);
+    if (code < 0)
+        goto exit;
+
+    for (i=0;i < num_entries;i++)
+        {
+            code = pdfi_read_token(ctx, header_stream, obj, gen);
+            if (code < 0)
+                goto exit;
+            if (code == 0) {
+                code = gs_note_error(gs_error_syntaxerror);
+                goto exit;
+            }
+            temp_obj = ctx->stack_top[-1];
+            if (temp_obj->type != PDF_INT) {
+                code = gs_note_error(gs_error_typecheck);
+                pdfi_pop(ctx, 1);
+                goto exit;
+            }
+            entry->object_nums[i] = ((pdf_num *)temp_obj)->value.i;
             pdfi_pop(ctx, 1);
-            code = gs_note_error(gs_error_typecheck);
-            goto exit;
-        }
-        if (ctx->stack_top[-1]->object_num != compressed_entry->object_num) {
+            code = pdfi_read_token(ctx, header_stream, obj, gen);
+            if (code < 0)
+                goto exit;
+            if (code == 0) {
+                code = gs_note_error(gs_error_syntaxerror);
+                goto exit;
+            }
+            temp_obj = ctx->stack_top[-1];
+            if (temp_obj->type != PDF_INT) {
+                pdfi_pop(ctx, 1);
+                code = gs_note_error(gs_error_typecheck);
+                goto exit;
+            }
+            entry->object_offsets[i] = ((pdf_num *)temp_obj)->value.i;
             pdfi_pop(ctx, 1);
-            /* Same error (undefined) as when we read an uncompressed object with the wrong number */
-            code = gs_note_error(gs_error_undefined);
-            goto exit;
         }
-        compressed_object = (pdf_stream *)ctx->stack_top[-1];
-        pdfi_countup(compressed_object);
-        pdfi_pop(ctx, 1);
-        code = pdfi_add_to_cache(ctx, (pdf_obj *)compressed_object);
-        if (code < 0)
-            goto exit;
-    } else {
-#if CACHE_STATISTICS
-        ctx->compressed_hits++;
-#endif
-        compressed_object = (pdf_stream *)compressed_entry->cache->o;
-        pdfi_countup(compressed_object);
-        pdfi_promote_cache_entry(ctx, compressed_entry->cache);
+    /* Object offsets are taken from the end of the header, allowing for any
+     * byte the tokeniser read ahead and pushed back.
+     */
+    entry->header_end = pdfi_tell(header_stream) - header_stream->unread_size;
+    entry->size = sizeof(pdf_objstm_cache_entry) + alloc_size + num_entries * 2 * sizeof(int64_t);
+    code = 0;
+
+ exit:
+    if (header_stream)
+        pdfi_close_memory_stream(ctx, NULL, header_stream);
+    if (compressed_stream)
+        pdfi_close_file(ctx, compressed_stream);
+    if (SubFile_stream)
+        pdfi_close_file(ctx, SubFile_stream);
+    gs_free_object(ctx->memory, data, "pdfi_read_objstm");
+    if (code < 0) {
+        if (entry)
+            pdfi_free_objstm_entry(ctx, entry);
+        return code;
     }
-    code = pdfi_dict_from_obj(ctx, (pdf_obj *)compressed_object, &compressed_sdict);
+    *objstm = entry;
+    return 0;
+}
+
+/* Read an object from an ObjStm onto the stack, with all its elements if it is an
+ * array or dictionary. Running into the end of 'eof_stream' before that is an error.
+ */
+static int pdfi_read_objstm_token(pdf_context *ctx, pdf_c_stream *s, pdf_c_stream *eof_stream,
+                                  uint64_t obj, uint64_t gen)
+{
+    int code;
+
+    code = pdfi_read_token(ctx, s, obj, gen);
     if (code < 0)
         return code;
+    if (code == 0)
+        return_error(gs_error_syntaxerror);
+    if (ctx->stack_top[-1]->type == PDF_ARRAY_MARK || ctx->stack_top[-1]->type == PDF_DICT_MARK) {
+        int start_depth = pdfi_count_stack(ctx);
 
-    /* Check its an ObjStm ! */
-    code = pdfi_dict_get_type(ctx, compressed_sdict, "Type", PDF_NAME, (pdf_obj **)&Type);
-    if (code < 0)
-        goto exit;
+        /* Need to read all the elements from COS objects */
+        do {
+            code = pdfi_read_token(ctx, s, obj, gen);
+            if (code < 0)
+                return code;
+            if (code == 0)
+                return_error(gs_error_syntaxerror);
+            if (eof_stream != NULL && eof_stream->eof == true)
+                return_error(gs_error_ioerror);
+        }while ((ctx->stack_top[-1]->type != PDF_ARRAY && ctx->stack_top[-1]->type != PDF_DICT) || pdfi_count_stack(ctx) > start_depth);
+    }
+    return 0;
+}
 
-    if (!pdfi_name_is(Type, "ObjStm")){
-        code = gs_note_error(gs_error_syntaxerror);
-        goto exit;
+/* Read an object from an ObjStm held in the cache */
+static int pdfi_read_objstm_object(pdf_context *ctx, pdf_objstm_cache_entry *objstm,
+                                   const xref_entry *entry, uint64_t obj, uint64_t gen)
+{
+    int code;
+    pdf_c_stream *Object_stream = NULL;
+    int64_t object_length = 0;
+    gs_offset_t offset = 0;
+    uint64_t start;
+    bool to_end;
+
+    if (entry->u.compressed.object_index < objstm->N) {
+        if (objstm->object_nums[entry->u.compressed.object_index] != obj)
+            return_error(gs_error_undefined);
+        offset = objstm->object_offsets[entry->u.compressed.object_index];
     }
+    if (entry->u.compressed.object_index + 1 < objstm->N)
+        object_length = objstm->object_offsets[entry->u.compressed.object_index + 1] - offset;
+
+    /* Find the object we want to read. If object_length is not 0, then we limit the
+     * number of bytes we read to the declared size of the object (difference between
+     * the offsets of the object we want to read, and the next object). If it is 0 then
+     * we're reading the last object in the stream, so we just rely on the end of the data.
+     */
+    start = objstm->header_end + (offset > 0 ? offset : 0);
+    if (start > objstm->length)
+        return_error(gs_error_ioerror);
+    to_end = (object_length <= 0);
+    if (to_end || object_length > objstm->length - start)
+        object_length = objstm->length - start;
+
+    /* The data is no larger than PDFI_OBJSTM_MAX_SIZE, so the length fits */
+    code = pdfi_open_memory_stream_from_memory(ctx, (unsigned int)object_length, objstm->data + start, &Object_stream, true);
+    if (code < 0)
+        return code;
+
+    code = pdfi_read_objstm_token(ctx, Object_stream, to_end ? Object_stream : NULL, obj, gen);
+    pdfi_close_memory_stream(ctx, NULL, Object_stream);
+    return code;
+}
+
+/* Read an object from an ObjStm too large to cache, by decompressing the stream up to it */
+static int pdfi_stream_objstm_object(pdf_context *ctx, pdf_stream *compressed_object, pdf_dict *compressed_sdict,
+                                     const xref_entry *entry, uint64_t obj, uint64_t gen)
+{
+    int code = 0;
+    pdf_c_stream *compressed_stream = NULL;
+    pdf_c_stream *SubFile_stream = NULL;
+    pdf_c_stream *Object_stream = NULL;
+    char Buffer[256];
+    int64_t i, num_entries, found_object, Length;
+    int64_t offset = 0, object_length = 0;
+    pdf_obj *temp_obj;
 
-    /* Need to check the /N entry to see if the object is actually in this stream! */
     code = pdfi_dict_get_int(ctx, compressed_sdict, "N", &num_entries);
     if (code < 0)
-        goto exit;
+        return code;
 
-    if (num_entries < 0 || num_entries > ctx->xref_table->xref_size) {
-        code = gs_note_error(gs_error_rangecheck);
-        goto exit;
-    }
+    if (num_entries < 0 || num_entries > ctx->xref_table->xref_size)
+        return_error(gs_error_rangecheck);
 
     code = pdfi_seek(ctx, ctx->main_stream, pdfi_stream_offset(ctx, compressed_object), SEEK_SET);
     if (code < 0)
-        goto exit;
+        return code;
 
     code = pdfi_dict_get_int(ctx, compressed_sdict, "Length", &Length);
     if (code < 0)
-        goto exit;
+        return code;
 
     code = pdfi_apply_SubFileDecode_filter(ctx, Length, NULL, ctx->main_stream, &SubFile_stream, false);
     if (code < 0)
-        goto exit;
+        return code;
 
     code = pdfi_filter(ctx, compressed_object, SubFile_stream, &compressed_stream, false);
     if (code < 0)
@@ -717,56 +1047,133 @@ static int pdfi_deref_compressed(pdf_context *ctx, uint64_t obj, uint64_t gen, p
         }
 
     /* Skip to the offset of the object we want to read */
-    for (i=0;i < offset;i++)
-        {
-            code = pdfi_read_bytes(ctx, (byte *)&Buffer[0], 1, 1, compressed_stream);
-            if (code <= 0) {
-                code = gs_note_error(gs_error_ioerror);
-                goto exit;
-            }
+    while (offset > 0) {
+        code = pdfi_read_bytes(ctx, (byte *)&Buffer[0], 1, (uint32_t)min(offset, sizeof(Buffer)), compressed_stream);
+        if (code <= 0) {
+            code = gs_note_error(gs_error_ioerror);
+            goto exit;
         }
+        offset -= code;
+    }
 
     /* If object_length is not 0, then we want to apply a SubFileDecode filter to limit
-     * the number of bytes we read to the declared size of the object (difference between
-     * the offsets of the object we want to read, and the next object). If it is 0 then
+     * the number of bytes we read to the declared size of the object. If it is 0 then
      * we're reading the last object in the stream, so we just rely on the SubFileDecode
      * we set up when we created compressed_stream to limit the bytes to the length of
-     * that stream.
+     * that stream, as we do if the length is too large for the filter.
      */
-    if (object_length > 0) {
-        code = pdfi_apply_SubFileDecode_filter(ctx, object_length, NULL, compressed_stream, &Object_stream, false);
+    if (object_length > 0 && object_length <= max_int) {
+        code = pdfi_apply_SubFileDecode_filter(ctx, (int)object_length, NULL, compressed_stream, &Object_stream, false);
+        if (code < 0)
+            goto exit;
+    }
+
+    code = pdfi_read_objstm_token(ctx, Object_stream ? Object_stream : compressed_stream,
+                                  compressed_stream, obj, gen);
+
+ exit:
+    if (Object_stream)
+        pdfi_close_file(ctx, Object_stream);
+    if (compressed_stream)
+        pdfi_close_file(ctx, compressed_stream);
+    if (SubFile_stream)
+        pdfi_close_file(ctx, SubFile_stream);
+    return code;
+}
+
+static int pdfi_deref_compressed(pdf_context *ctx, uint64_t obj, uint64_t gen, pdf_obj **object,
+                                 const xref_entry *entry)
+{
+    int code = 0;
+    xref_entry *compressed_entry;
+    pdf_stream *compressed_object = NULL;
+    pdf_dict *compressed_sdict = NULL; /* alias */
+    pdf_name *Type = NULL;
+    pdf_objstm_cache_entry *objstm;
+
+    if (entry->u.compressed.compressed_stream_num > ctx->xref_table->xref_size - 1)
+        return_error(gs_error_undefined);
+
+    compressed_entry = &ctx->xref_table->xref[entry->u.compressed.compressed_stream_num];
+
+    if (ctx->args.pdfdebug) {
+        dmprintf1(ctx->memory, "%% Reading compressed object (%"PRIi64" 0 obj)", obj);
+        dmprintf1(ctx->memory, " from ObjStm with object number %"PRIi64"\n", compressed_entry->object_num);
+    }
+
+    if (compressed_entry->cache == NULL) {
+        ctx->compressed_misses++;
+        code = pdfi_seek(ctx, ctx->main_stream, compressed_entry->u.uncompressed.offset, SEEK_SET);
+        if (code < 0)
+            goto exit;
+
+        code = pdfi_read_object(ctx, ctx->main_stream, 0);
+        if (code < 0)
+            goto exit;
+
+        if (pdfi_count_stack(ctx) < 1) {
+            code = gs_note_error(gs_error_stackunderflow);
+            goto exit;
+        }
+
+        if ((ctx->stack_top[-1])->type != PDF_STREAM) {
+            pdfi_pop(ctx, 1);
+            code = gs_note_error(gs_error_typecheck);
+            goto exit;
+        }
+        if (ctx->stack_top[-1]->object_num != compressed_entry->object_num) {
+            pdfi_pop(ctx, 1);
+            /* Same error (undefined) as when we read an uncompressed object with the wrong number */
+            code = gs_note_error(gs_error_undefined);
+            goto exit;
+        }
+        compressed_object = (pdf_stream *)ctx->stack_top[-1];
+        pdfi_countup(compressed_object);
+        pdfi_pop(ctx, 1);
+        code = pdfi_add_to_cache(ctx, (pdf_obj *)compressed_object);
         if (code < 0)
             goto exit;
     } else {
-        Object_stream = compressed_stream;
+        ctx->compressed_hits++;
+        compressed_object = (pdf_stream *)compressed_entry->cache->o;
+        pdfi_countup(compressed_object);
+        pdfi_promote_cache_entry(ctx, compressed_entry->cache);
     }
+    code = pdfi_dict_from_obj(ctx, (pdf_obj *)compressed_object, &compressed_sdict);
+    if (code < 0)
+        return code;
 
-    code = pdfi_read_token(ctx, Object_stream, obj, gen);
+    /* Check its an ObjStm ! */
+    code = pdfi_dict_get_type(ctx, compressed_sdict, "Type", PDF_NAME, (pdf_obj **)&Type);
     if (code < 0)
         goto exit;
-    if (code == 0) {
+
+    if (!pdfi_name_is(Type, "ObjStm")){
         code = gs_note_error(gs_error_syntaxerror);
         goto exit;
     }
-    if (ctx->stack_top[-1]->type == PDF_ARRAY_MARK || ctx->stack_top[-1]->type == PDF_DICT_MARK) {
-        int start_depth = pdfi_count_stack(ctx);
 
-        /* Need to read all the elements from COS objects */
-        do {
-            code = pdfi_read_token(ctx, Object_stream, obj, gen);
-            if (code < 0)
-                goto exit;
-            if (code == 0) {
-                code = gs_note_error(gs_error_syntaxerror);
-                goto exit;
-            }
-            if (compressed_stream->eof == true) {
-                code = gs_note_error(gs_error_ioerror);
-                goto exit;
-            }
-        }while ((ctx->stack_top[-1]->type != PDF_ARRAY && ctx->stack_top[-1]->type != PDF_DICT) || pdfi_count_stack(ctx) > start_depth);
-    }
+    objstm = pdfi_objstm_cache_find(ctx, compressed_entry->object_num, compressed_entry->u.uncompressed.offset);
+    if (objstm == NULL) {
+        ctx->objstm_misses++;
+        code = pdfi_read_objstm(ctx, compressed_object, compressed_sdict, compressed_entry, obj, gen, &objstm);
+        if (code < 0)
+            goto exit;
+        pdfi_objstm_cache_add(ctx, objstm);
+    } else
+        ctx->objstm_hits++;
+
+    if (objstm->data == NULL)
+        code = pdfi_stream_objstm_object(ctx, compressed_object, compressed_sdict, entry, obj, gen);
+    else
+        code = pdfi_read_objstm_object(ctx, objstm, entry, obj, gen);
+    if (code < 0)
+        goto exit;
 
+    /* A bare name would be the tokeniser's shared copy, we need our own to number */
+    code = pdfi_name_unintern(ctx, &ctx->stack_top[-1]);
+    if (code < 0)
+        goto exit;
     *object = ctx->stack_top[-1];
     /* For compressed objects we don't get a 'obj gen obj' sequence which is what sets
      * the object number for uncompressed objects. So we need to do that here.
@@ -783,13 +1190,6 @@ static int pdfi_deref_compressed(pdf_context *ctx, uint64_t obj, uint64_t gen, p
     }
 
  exit:
-    if (Object_stream)
-        pdfi_close_file(ctx, Object_stream);
-    if (Object_stream != compressed_stream)
-        if (compressed_stream)
-            pdfi_close_file(ctx, compressed_stream);
-    if (SubFile_stream)
-        pdfi_close_file(ctx, SubFile_stream);
     pdfi_countdown(compressed_object);
     pdfi_countdown(Type);
     return code;
@@ -849,9 +1249,7 @@ int pdfi_dereference(pdf_context *ctx, uint64_t obj, uint64_t gen, pdf_obj **obj
     if (entry->cache != NULL){
         pdf_obj_cache_entry *cache_entry = entry->cache;
 
-#if CACHE_STATISTICS
         ctx->hits++;
-#endif
         *object = cache_entry->o;
         pdfi_countup(*object);
 
@@ -869,9 +1267,7 @@ int pdfi_dereference(pdf_context *ctx, uint64_t obj, uint64_t gen, pdf_obj **obj
         } else {
             pdf_c_stream *SubFile_stream = NULL;
             pdf_string *EODString;
-#if CACHE_STATISTICS
             ctx->misses++;
-#endif
             ctx->encryption.decrypt_strings = true;
 
             code = pdfi_seek(ctx, ctx->main_stream, entry->u.uncompressed.offset, SEEK_SET);
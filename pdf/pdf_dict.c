@@ -41,36 +41,146 @@ void pdfi_free_dict(pdf_obj *o)
         if (d->keys[i] != NULL)
             pdfi_countdown(d->keys[i]);
     }
+    gs_free_object(OBJ_MEMORY(d), d->hash_index, "pdf interpreter free dictionary hash index");
     gs_free_object(OBJ_MEMORY(d), d->keys, "pdf interpreter free dictionary keys");
     gs_free_object(OBJ_MEMORY(d), d->values, "pdf interpreter free dictioanry values");
     gs_free_object(OBJ_MEMORY(d), d, "pdf interpreter free dictionary");
 }
 
-/* Delete a key pair, either by specifying a char * or a pdf_name *
+/* Key lookup
+ * Small dictionaries are searched linearly. Names read by the tokeniser are interned
+ * (see pdfi_name_intern()) so a pointer comparison usually settles a match before we
+ * need to compare the name data. Once a dictionary has PDF_DICT_HASH_THRESHOLD or more
+ * entries (fonts, resources, name trees, the font maps) we build a hash index over its
+ * keys on first lookup, and maintain it as keys are added. Deleting a key discards the
+ * index, it will be rebuilt if needed.
  */
-static int pdfi_dict_delete_inner(pdf_context *ctx, pdf_dict *d, pdf_name *n, const char *str)
+static uint32_t pdfi_dict_hash_key(const byte *data, uint32_t length)
 {
-    int i = 0;
-#if DEBUG_DICT
-    pdf_name *name;
-#endif
+    uint32_t hash = 2166136261u;
+    uint32_t i;
 
-    for (i=0;i < d->entries;i++) {
-#if DEBUG_DICT
-        name = (pdf_name *)d->keys[i];
-#endif
-        if (n != NULL) {
-            if (pdfi_name_cmp(n, (pdf_name *)d->keys[i]) == 0)
-                break;
-        } else {
-            if (pdfi_name_is((pdf_name *)d->keys[i], str))
-                break;
+    for (i = 0; i < length; i++)
+        hash = (hash ^ data[i]) * 16777619u;
+    return hash;
+}
+
+static void pdfi_dict_free_hash(pdf_dict *d)
+{
+    gs_free_object(OBJ_MEMORY(d), d->hash_index, "pdfi_dict_free_hash");
+    d->hash_index = NULL;
+    d->hash_size = 0;
+}
+
+/* Add entry 'index' to the hash index. If a key with the same name is already indexed
+ * we leave it alone, so that (as with the linear search) the first of any duplicated
+ * keys is the one found.
+ */
+static void pdfi_dict_hash_insert(pdf_dict *d, uint64_t index)
+{
+    pdf_name *key = (pdf_name *)d->keys[index], *t;
+    uint32_t mask = d->hash_size - 1, slot;
+
+    if (key == NULL || key->type != PDF_NAME)
+        return;
+
+    slot = pdfi_dict_hash_key(key->data, key->length) & mask;
+    while (d->hash_index[slot] != 0) {
+        t = (pdf_name *)d->keys[d->hash_index[slot] - 1];
+        if (pdfi_name_cmp(t, key) == 0)
+            return;
+        slot = (slot + 1) & mask;
+    }
+    d->hash_index[slot] = (uint32_t)index + 1;
+}
+
+static int pdfi_dict_build_hash(pdf_context *ctx, pdf_dict *d)
+{
+    uint32_t size = 32;
+    uint64_t i;
+
+    while (size < d->entries * 2)
+        size <<= 1;
+
+    d->hash_index = (uint32_t *)gs_alloc_bytes(ctx->memory, size * sizeof(uint32_t), "pdfi_dict_build_hash");
+    if (d->hash_index == NULL)
+        return_error(gs_error_VMerror);
+    memset(d->hash_index, 0x00, size * sizeof(uint32_t));
+    d->hash_size = size;
+
+    for (i = 0; i < d->entries; i++)
+        pdfi_dict_hash_insert(d, i);
+    return 0;
+}
+
+/* Called when a new key has been stored at 'index', keeps the hash index (if there is one)
+ * up to date, or discards it if it is too full.
+ */
+static void pdfi_dict_hash_added(pdf_dict *d, uint64_t index)
+{
+    if (d->hash_index == NULL)
+        return;
+    if (d->entries * 2 > d->hash_size)
+        pdfi_dict_free_hash(d);
+    else
+        pdfi_dict_hash_insert(d, index);
+}
+
+/* Find a key, specified either as a pdf_name * or as a char *, returns the index of the
+ * entry or -1 if the key is not present.
+ */
+static int64_t pdfi_dict_find(pdf_context *ctx, pdf_dict *d, const pdf_name *nameKey, const char *strKey)
+{
+    const byte *data;
+    uint32_t length, mask, slot;
+    uint64_t i;
+    pdf_name *t;
+
+    if (nameKey != NULL) {
+        data = nameKey->data;
+        length = nameKey->length;
+    } else {
+        data = (const byte *)strKey;
+        length = strlen(strKey);
+    }
+
+    if (d->entries >= PDF_DICT_HASH_THRESHOLD && d->hash_index == NULL)
+        (void)pdfi_dict_build_hash(ctx, d); /* On failure we just fall back to searching */
+
+    if (d->hash_index != NULL) {
+        mask = d->hash_size - 1;
+        slot = pdfi_dict_hash_key(data, length) & mask;
+        while (d->hash_index[slot] != 0) {
+            i = d->hash_index[slot] - 1;
+            t = (pdf_name *)d->keys[i];
+            if (t == nameKey || (t->length == length && memcmp(t->data, data, length) == 0))
+                return i;
+            slot = (slot + 1) & mask;
         }
+        return -1;
+    }
 
+    for (i=0;i< d->entries;i++) {
+        t = (pdf_name *)d->keys[i];
+
+        if (t && t->type == PDF_NAME) {
+            if (t == nameKey || (t->length == length && memcmp(t->data, data, length) == 0))
+                return i;
+        }
     }
-    if (i >= d->entries)
+    return -1;
+}
+
+/* Delete a key pair, either by specifying a char * or a pdf_name *
+ */
+static int pdfi_dict_delete_inner(pdf_context *ctx, pdf_dict *d, pdf_name *n, const char *str)
+{
+    int64_t i = pdfi_dict_find(ctx, d, n, str);
+
+    if (i < 0)
         return_error(gs_error_undefined);
 
+    pdfi_dict_free_hash(d);
     pdfi_countdown(d->keys[i]);
     pdfi_countdown(d->values[i]);
     for(  ;i < d->entries - 1;i++) {
@@ -216,50 +326,45 @@ pdfi_dict_get2(pdf_context *ctx, pdf_dict *d, const char *Key1,
  */
 int pdfi_dict_get(pdf_context *ctx, pdf_dict *d, const char *Key, pdf_obj **o)
 {
-    int i=0, code;
-    pdf_name *t;
+    int64_t i;
+    int code;
 
     *o = NULL;
 
     if (d->type != PDF_DICT)
         return_error(gs_error_typecheck);
 
-    for (i=0;i< d->entries;i++) {
-        t = (pdf_name *)d->keys[i];
+    i = pdfi_dict_find(ctx, d, NULL, Key);
+    if (i < 0)
+        return_error(gs_error_undefined);
 
-        if (t && t->type == PDF_NAME) {
-            if (pdfi_name_is((pdf_name *)t, Key)) {
-                if (d->values[i]->type == PDF_INDIRECT) {
-                    pdf_indirect_ref *r = (pdf_indirect_ref *)d->values[i];
-
-                    if (r->ref_object_num == d->object_num)
-                        return_error(gs_error_circular_reference);
-
-                    code = pdfi_deref_loop_detect(ctx, r->ref_object_num, r->ref_generation_num, o);
-                    if (code < 0)
-                        return code;
-                    /* The file Bug690138.pdf has font dictionaries which contain ToUnicode keys where
-                     * the value is an indirect reference to the same font object. If we replace the
-                     * indirect reference in the dictionary with the font dictionary it becomes self
-                     * referencing and never counts down to 0, leading to a memory leak.
-                     * This is clearly an error, so flag it and don't replace the indirect reference.
-                     */
-                    if ((*o)->object_num == 0 || (*o)->object_num != d->object_num)
-                    {
-                        pdfi_countdown(d->values[i]);
-                        d->values[i] = *o;
-                    } else {
-                        pdfi_set_error(ctx, 0, NULL, E_DICT_SELF_REFERENCE, "pdfi_dict_get", NULL);
-                        return 0;
-                    }
-                }
-                *o = d->values[i];
-                pdfi_countup(*o);
-                return 0;
-            }
+    if (d->values[i]->type == PDF_INDIRECT) {
+        pdf_indirect_ref *r = (pdf_indirect_ref *)d->values[i];
+
+        if (r->ref_object_num == d->object_num)
+            return_error(gs_error_circular_reference);
+
+        code = pdfi_deref_loop_detect(ctx, r->ref_object_num, r->ref_generation_num, o);
+        if (code < 0)
+            return code;
+        /* The file Bug690138.pdf has font dictionaries which contain ToUnicode keys where
+         * the value is an indirect reference to the same font object. If we replace the
+         * indirect reference in the dictionary with the font dictionary it becomes self
+         * referencing and never counts down to 0, leading to a memory leak.
+         * This is clearly an error, so flag it and don't replace the indirect reference.
+         */
+        if ((*o)->object_num == 0 || (*o)->object_num != d->object_num)
+        {
+            pdfi_countdown(d->values[i]);
+            d->values[i] = *o;
+        } else {
+            pdfi_set_error(ctx, 0, NULL, E_DICT_SELF_REFERENCE, "pdfi_dict_get", NULL);
+            return 0;
         }
     }
-    return_error(gs_error_undefined);
+    *o = d->values[i];
+    pdfi_countup(*o);
+    return 0;
 }
 
 /* Get object from dict without resolving indirect references
@@ -267,26 +372,20 @@ int pdfi_dict_get(pdf_context *ctx, pdf_dict *d, const char *Key, pdf_obj **o)
  */
 int pdfi_dict_get_no_deref(pdf_context *ctx, pdf_dict *d, const pdf_name *Key, pdf_obj **o)
 {
-    int i=0;
-    pdf_name *t;
+    int64_t i;
 
     *o = NULL;
 
     if (d->type != PDF_DICT)
         return_error(gs_error_typecheck);
 
-    for (i=0;i< d->entries;i++) {
-        t = (pdf_name *)d->keys[i];
+    i = pdfi_dict_find(ctx, d, Key, NULL);
+    if (i < 0)
+        return_error(gs_error_undefined);
 
-        if (t && t->type == PDF_NAME) {
-            if (pdfi_name_cmp((pdf_name *)t, Key)== 0) {
-                *o = d->values[i];
-                pdfi_countup(*o);
-                return 0;
-            }
-        }
-    }
-    return_error(gs_error_undefined);
+    *o = d->values[i];
+    pdfi_countup(*o);
+    return 0;
 }
 
 /* Get by pdf_name rather than by char *
@@ -295,64 +394,52 @@ int pdfi_dict_get_no_deref(pdf_context *ctx, pdf_dict *d, const pdf_name *Key, p
  */
 int pdfi_dict_get_by_key(pdf_context *ctx, pdf_dict *d, const pdf_name *Key, pdf_obj **o)
 {
-    int i=0, code;
-    pdf_name *t;
+    int64_t i;
+    int code;
 
     *o = NULL;
 
     if (d->type != PDF_DICT)
         return_error(gs_error_typecheck);
 
-    for (i=0;i< d->entries;i++) {
-        t = (pdf_name *)d->keys[i];
+    i = pdfi_dict_find(ctx, d, Key, NULL);
+    if (i < 0)
+        return_error(gs_error_undefined);
 
-        if (t && t->type == PDF_NAME) {
-            if (pdfi_name_cmp((pdf_name *)t, Key)== 0) {
-                if (d->values[i]->type == PDF_INDIRECT) {
-                    pdf_indirect_ref *r = (pdf_indirect_ref *)d->values[i];
-
-                    code = pdfi_deref_loop_detect(ctx, r->ref_object_num, r->ref_generation_num, o);
-                    if (code < 0)
-                        return code;
-                    pdfi_countdown(d->values[i]);
-                    d->values[i] = *o;
-                }
-                *o = d->values[i];
-                pdfi_countup(*o);
-                return 0;
-            }
-        }
+    if (d->values[i]->type == PDF_INDIRECT) {
+        pdf_indirect_ref *r = (pdf_indirect_ref *)d->values[i];
+
+        code = pdfi_deref_loop_detect(ctx, r->ref_object_num, r->ref_generation_num, o);
+        if (code < 0)
+            return code;
+        pdfi_countdown(d->values[i]);
+        d->values[i] = *o;
     }
-    return_error(gs_error_undefined);
+    *o = d->values[i];
+    pdfi_countup(*o);
+    return 0;
 }
 
 /* Get indirect reference without de-referencing it */
 int pdfi_dict_get_ref(pdf_context *ctx, pdf_dict *d, const char *Key, pdf_indirect_ref **o)
 {
-    int i=0;
-    pdf_name *t;
+    int64_t i;
 
     *o = NULL;
 
     if (d->type != PDF_DICT)
         return_error(gs_error_typecheck);
 
-    for (i=0;i< d->entries;i++) {
-        t = (pdf_name *)d->keys[i];
+    i = pdfi_dict_find(ctx, d, NULL, Key);
+    if (i < 0)
+        return_error(gs_error_undefined);
 
-        if (t && t->type == PDF_NAME) {
-            if (pdfi_name_is((pdf_name *)t, Key)) {
-                if (d->values[i]->type == PDF_INDIRECT) {
-                    *o = (pdf_indirect_ref *)d->values[i];
-                    pdfi_countup(*o);
-                    return 0;
-                } else {
-                    return_error(gs_error_typecheck);
-                }
-            }
-        }
-    }
-    return_error(gs_error_undefined);
+    if (d->values[i]->type != PDF_INDIRECT)
+        return_error(gs_error_typecheck);
+
+    *o = (pdf_indirect_ref *)d->values[i];
+    pdfi_countup(*o);
+    return 0;
 }
 
 /* As per pdfi_dict_get(), but doesn't replace an indirect reference in a dictionary with a
@@ -365,42 +452,29 @@ int pdfi_dict_get_ref(pdf_context *ctx, pdf_dict *d, const char *Key, pdf_indire
 static int pdfi_dict_get_no_store_R_inner(pdf_context *ctx, pdf_dict *d, const char *strKey,
                                           const pdf_name *nameKey, pdf_obj **o)
 {
-    int i=0, code;
-    pdf_name *t;
-    bool match = false;
+    int64_t i;
+    int code;
 
     *o = NULL;
 
     if (d->type != PDF_DICT)
         return_error(gs_error_typecheck);
 
-    for (i=0;i< d->entries;i++) {
-        t = (pdf_name *)d->keys[i];
+    i = pdfi_dict_find(ctx, d, nameKey, strKey);
+    if (i < 0)
+        return_error(gs_error_undefined);
 
-        if (t && t->type == PDF_NAME) {
-            if (strKey != NULL) {
-                if (pdfi_name_is(t, strKey))
-                    match = true;
-            } else {
-                if (!pdfi_name_cmp(t, nameKey))
-                    match = true;
-            }
-            if (match) {
-                if (d->values[i]->type == PDF_INDIRECT) {
-                    pdf_indirect_ref *r = (pdf_indirect_ref *)d->values[i];
-
-                    code = pdfi_dereference(ctx, r->ref_object_num, r->ref_generation_num, o);
-                    if (code < 0)
-                        return code;
-                } else {
-                    *o = d->values[i];
-                    pdfi_countup(*o);
-                }
-                return 0;
-            }
-        }
+    if (d->values[i]->type == PDF_INDIRECT) {
+        pdf_indirect_ref *r = (pdf_indirect_ref *)d->values[i];
+
+        code = pdfi_dereference(ctx, r->ref_object_num, r->ref_generation_num, o);
+        if (code < 0)
+            return code;
+    } else {
+        *o = d->values[i];
+        pdfi_countup(*o);
     }
-    return_error(gs_error_undefined);
+    return 0;
 }
 
 /* Wrapper to pdfi_dict_no_store_R_inner(), takes a char * as Key */
@@ -757,9 +831,9 @@ int pdfi_make_int_array_from_dict(pdf_context *ctx, int **parray, pdf_dict *dict
 /* Put into dictionary with key as object */
 int pdfi_dict_put_obj(pdf_context *ctx, pdf_dict *d, pdf_obj *Key, pdf_obj *value)
 {
+    int64_t found;
     uint64_t i;
     pdf_obj **new_keys, **new_values;
-    pdf_name *n;
 
     if (d->type != PDF_DICT)
         return_error(gs_error_typecheck);
@@ -768,19 +842,15 @@ int pdfi_dict_put_obj(pdf_context *ctx, pdf_dict *d, pdf_obj *Key, pdf_obj *valu
         return_error(gs_error_typecheck);
 
     /* First, do we have a Key/value pair already ? */
-    for (i=0;i< d->entries;i++) {
-        n = (pdf_name *)d->keys[i];
-        if (n && n->type == PDF_NAME) {
-            if (pdfi_name_cmp((pdf_name *)Key, n) == 0) {
-                if (d->values[i] == value)
-                    /* We already have this value stored with this key.... */
-                    return 0;
-                pdfi_countdown(d->values[i]);
-                d->values[i] = value;
-                pdfi_countup(value);
-                return 0;
-            }
-        }
+    found = pdfi_dict_find(ctx, d, (pdf_name *)Key, NULL);
+    if (found >= 0) {
+        if (d->values[found] == value)
+            /* We already have this value stored with this key.... */
+            return 0;
+        pdfi_countdown(d->values[found]);
+        d->values[found] = value;
+        pdfi_countup(value);
+        return 0;
     }
 
     /* Nope, its a new Key */
@@ -793,6 +863,7 @@ int pdfi_dict_put_obj(pdf_context *ctx, pdf_dict *d, pdf_obj *Key, pdf_obj *valu
                 d->values[i] = value;
                 pdfi_countup(value);
                 d->entries++;
+                pdfi_dict_hash_added(d, i);
                 return 0;
             }
         }
@@ -820,6 +891,7 @@ int pdfi_dict_put_obj(pdf_context *ctx, pdf_dict *d, pdf_obj *Key, pdf_obj *valu
     d->entries++;
     pdfi_countup(Key);
     pdfi_countup(value);
+    pdfi_dict_hash_added(d, d->size - 1);
 
     return 0;
 }
@@ -895,23 +967,10 @@ int pdfi_dict_copy(pdf_context *ctx, pdf_dict *target, pdf_dict *source)
 
 int pdfi_dict_known(pdf_context *ctx, pdf_dict *d, const char *Key, bool *known)
 {
-    int i;
-    pdf_name *t;
-
     if (d->type != PDF_DICT)
         return_error(gs_error_typecheck);
 
-    *known = false;
-    for (i=0;i< d->entries;i++) {
-        t = (pdf_name *)d->keys[i];
-
-        if (t && t->type == PDF_NAME) {
-            if (pdfi_name_is(t, Key)) {
-                *known = true;
-                break;
-            }
-        }
-    }
+    *known = (pdfi_dict_find(ctx, d, NULL, Key) >= 0);
     return 0;
 }
 
@@ -985,23 +1044,10 @@ int pdfi_dict_knownget_number(pdf_context *ctx, pdf_dict *d, const char *Key, do
 
 int pdfi_dict_known_by_key(pdf_context *ctx, pdf_dict *d, pdf_name *Key, bool *known)
 {
-    int i;
-    pdf_obj *t;
-
     if (d->type != PDF_DICT)
         return_error(gs_error_typecheck);
 
-    *known = false;
-    for (i=0;i< d->entries;i++) {
-        t = d->keys[i];
-
-        if (t && t->type == PDF_NAME) {
-            if (pdfi_name_cmp((pdf_name *)t, Key) == 0) {
-                *known = true;
-                break;
-            }
-        }
-    }
+    *known = (pdfi_dict_find(ctx, d, Key, NULL) >= 0);
     return 0;
 }
 
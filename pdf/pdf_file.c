@@ -22,6 +22,7 @@
 #include "pdf_array.h"
 #include "pdf_misc.h"
 #include "pdf_sec.h"
+#include "pdf_obj.h"
 #include "stream.h"
 #include "strimpl.h"
 #include "strmio.h"
@@ -1386,6 +1387,9 @@ void pdfi_close_file(pdf_context *ctx, pdf_c_stream *s)
 {
     pdfi_close_filter_chain(ctx, s->s, s->original);
 
+    if (s->cache_entry)
+        s->cache_entry->pinned--;
+
     gs_free_object(ctx->memory, s, "closing pdf_file");
 }
 
@@ -1564,6 +1568,296 @@ pdfi_stream_to_buffer(pdf_context *ctx, pdf_stream *stream_obj, byte **buf, int6
     return code;
 }
 
+/* The cache of decoded streams
+ * Images and Forms which are drawn on many pages (a background image or letterhead on
+ * every page of a statement, say) would otherwise be decompressed again each time. So
+ * the second time we are asked to open the same stream we decode all of it into memory
+ * and keep that, within a budget of PDFStreamCacheSize bytes, and it is read from memory
+ * from then on. Streams which are only used once are never copied.
+ *
+ * An entry is pinned while a stream is reading from it, because drawing a Form can draw
+ * images which push other entries out of the cache. pdfi_close_file() unpins it.
+ */
+#define PDFI_STREAM_UNUSED 0
+#define PDFI_STREAM_USED 1
+#define PDFI_STREAM_UNCACHEABLE 2
+
+static void pdfi_free_stream_cache_entry(pdf_context *ctx, pdf_stream_cache_entry *entry)
+{
+    gs_free_object(ctx->memory, entry->data, "pdfi_free_stream_cache_entry");
+    gs_free_object(ctx->memory, entry, "pdfi_free_stream_cache_entry");
+}
+
+void pdfi_free_stream_cache(pdf_context *ctx)
+{
+    pdf_stream_cache_entry *entry = ctx->stream_cache_LRU, *next;
+
+    while (entry) {
+        next = entry->next;
+        pdfi_free_stream_cache_entry(ctx, entry);
+        entry = next;
+    }
+    ctx->stream_cache_LRU = ctx->stream_cache_MRU = NULL;
+    ctx->stream_cache_entries = 0;
+    ctx->stream_cache_bytes = 0;
+
+    gs_free_object(ctx->memory, ctx->stream_cache_uses, "pdfi_free_stream_cache");
+    ctx->stream_cache_uses = NULL;
+    ctx->stream_cache_uses_size = 0;
+}
+
+static void pdfi_stream_cache_unlink(pdf_context *ctx, pdf_stream_cache_entry *entry)
+{
+    if (entry->previous)
+        ((pdf_stream_cache_entry *)entry->previous)->next = entry->next;
+    else
+        ctx->stream_cache_LRU = entry->next;
+    if (entry->next)
+        ((pdf_stream_cache_entry *)entry->next)->previous = entry->previous;
+    else
+        ctx->stream_cache_MRU = entry->previous;
+    entry->next = entry->previous = NULL;
+}
+
+static void pdfi_stream_cache_link_MRU(pdf_context *ctx, pdf_stream_cache_entry *entry)
+{
+    entry->previous = ctx->stream_cache_MRU;
+    entry->next = NULL;
+    if (ctx->stream_cache_MRU)
+        ctx->stream_cache_MRU->next = entry;
+    ctx->stream_cache_MRU = entry;
+    if (ctx->stream_cache_LRU == NULL)
+        ctx->stream_cache_LRU = entry;
+}
+
+static pdf_stream_cache_entry *pdfi_stream_cache_find(pdf_context *ctx, pdf_stream *stream_obj,
+                                                      gs_offset_t offset, pdfi_stream_cache_kind kind)
+{
+    pdf_stream_cache_entry *entry;
+
+    for (entry = ctx->stream_cache_MRU; entry != NULL; entry = entry->previous) {
+        if (entry->object_num == stream_obj->object_num && entry->generation_num == stream_obj->generation_num &&
+            entry->offset == offset && entry->kind == kind) {
+            if (entry != ctx->stream_cache_MRU) {
+                pdfi_stream_cache_unlink(ctx, entry);
+                pdfi_stream_cache_link_MRU(ctx, entry);
+            }
+            return entry;
+        }
+    }
+    return NULL;
+}
+
+/* Returns the use count for an object number, or NULL if it isn't in the xref */
+static byte *pdfi_stream_cache_uses(pdf_context *ctx, uint64_t object_num)
+{
+    byte *uses;
+    uint64_t size;
+
+    if (object_num >= ctx->stream_cache_uses_size) {
+        if (ctx->xref_table == NULL || object_num >= ctx->xref_table->xref_size)
+            return NULL;
+        size = ctx->xref_table->xref_size;
+        uses = gs_alloc_bytes(ctx->memory, size, "pdfi_stream_cache_uses");
+        if (uses == NULL)
+            return NULL;
+        memset(uses, PDFI_STREAM_UNUSED, size);
+        if (ctx->stream_cache_uses != NULL) {
+            memcpy(uses, ctx->stream_cache_uses, ctx->stream_cache_uses_size);
+            gs_free_object(ctx->memory, ctx->stream_cache_uses, "pdfi_stream_cache_uses");
+        }
+        ctx->stream_cache_uses = uses;
+        ctx->stream_cache_uses_size = size;
+    }
+    return &ctx->stream_cache_uses[object_num];
+}
+
+/* Decode a stream into memory, exactly as the callers of pdfi_open_cached_stream() would have read it.
+ * If 'length' is non-zero we stop there, otherwise we read to the end of the data, giving up if
+ * there is more than 'budget' bytes. Any error, or a short read that isn't the end of the data, is a
+ * failure; the caller then decodes the stream as usual, so that it sees the error itself.
+ */
+static int pdfi_stream_cache_decode(pdf_context *ctx, pdf_stream *stream_obj, pdfi_stream_cache_kind kind,
+                                    uint64_t length, uint64_t budget, byte **data, uint64_t *size)
+{
+    int code, status;
+    uint bytes, wanted;
+    uint64_t used = 0, alloc_size = 0;
+    byte *buffer = NULL, *new_buffer;
+    pdf_string *EODString = NULL;
+    pdf_c_stream *SFD_stream = NULL, *source = ctx->main_stream, *stream = NULL;
+
+    *data = NULL;
+    *size = 0;
+
+    code = pdfi_seek(ctx, ctx->main_stream, pdfi_stream_offset(ctx, stream_obj), SEEK_SET);
+    if (code < 0)
+        return code;
+
+    if (kind == PDFI_STREAM_CACHE_IMAGE) {
+        code = pdfi_object_alloc(ctx, PDF_STRING, 9, (pdf_obj **)&EODString);
+        if (code < 0)
+            return code;
+        pdfi_countup((pdf_obj *)EODString);
+        memcpy(EODString->data, "endstream", 9);
+
+        code = pdfi_apply_SubFileDecode_filter(ctx, 0, EODString, source, &SFD_stream, false);
+        if (code < 0)
+            goto exit;
+        source = SFD_stream;
+    }
+
+    code = pdfi_filter(ctx, stream_obj, source, &stream, false);
+    if (code < 0)
+        goto exit;
+
+    do {
+        if (used == alloc_size) {
+            if (length > 0)
+                alloc_size = length;
+            else if (alloc_size < budget)
+                alloc_size = alloc_size == 0 ? 65536 : alloc_size * 2;
+            else {
+                code = gs_note_error(gs_error_limitcheck);
+                goto exit;
+            }
+            if (alloc_size > budget)
+                alloc_size = budget;
+            new_buffer = gs_alloc_bytes(ctx->memory, alloc_size, "pdfi_stream_cache_decode");
+            if (new_buffer == NULL) {
+                code = gs_note_error(gs_error_VMerror);
+                goto exit;
+            }
+            if (used > 0)
+                memcpy(new_buffer, buffer, used);
+            gs_free_object(ctx->memory, buffer, "pdfi_stream_cache_decode");
+            buffer = new_buffer;
+        }
+        wanted = (uint)min(alloc_size - used, max_uint);
+        status = sgets(stream->s, buffer + used, wanted, &bytes);
+        used += bytes;
+        if (status == EOFC)
+            break;
+        if (status < 0 || bytes < wanted) {
+            code = gs_note_error(gs_error_ioerror);
+            goto exit;
+        }
+    } while (length == 0 || used < length);
+
+    *data = buffer;
+    *size = used;
+    buffer = NULL;
+
+ exit:
+    if (stream)
+        pdfi_close_file(ctx, stream);
+    if (SFD_stream)
+        pdfi_close_file(ctx, SFD_stream);
+    pdfi_countdown(EODString);
+    gs_free_object(ctx->memory, buffer, "pdfi_stream_cache_decode");
+    return code;
+}
+
+/* Open a memory stream on the decoded data of stream_obj, if it is cached, or is being used
+ * for the second time and will fit in the cache.
+ * 'kind' says how the caller would have decoded the stream itself and 'length' is how much of
+ * the data it will read, or 0 if it reads to the end.
+ * Returns 1 if *new_stream has been opened, or 0 if the caller should decode the stream
+ * itself. Leaves the main file position undefined.
+ */
+int pdfi_open_cached_stream(pdf_context *ctx, pdf_stream *stream_obj, pdfi_stream_cache_kind kind,
+                            uint64_t length, pdf_c_stream **new_stream)
+{
+    int code;
+    pdf_stream_cache_entry *entry, *victim, *next;
+    pdf_dict *stream_dict = NULL;
+    gs_offset_t offset;
+    byte *uses, *data = NULL;
+    uint64_t size, budget, pinned = 0;
+    bool filtered = false;
+
+    *new_stream = NULL;
+
+    if (ctx->args.PDFStreamCacheSize <= 0 || stream_obj->object_num == 0 || ctx->main_stream == NULL)
+        return 0;
+
+    offset = pdfi_stream_offset(ctx, stream_obj);
+    entry = pdfi_stream_cache_find(ctx, stream_obj, offset, kind);
+    if (entry != NULL) {
+        ctx->stream_cache_hits++;
+        goto open;
+    }
+
+    uses = pdfi_stream_cache_uses(ctx, stream_obj->object_num);
+    if (uses == NULL || *uses == PDFI_STREAM_UNCACHEABLE)
+        return 0;
+    if (*uses == PDFI_STREAM_UNUSED) {
+        *uses = PDFI_STREAM_USED;
+        return 0;
+    }
+    /* From here on we either cache the stream or never try again */
+    *uses = PDFI_STREAM_UNCACHEABLE;
+
+    /* There's nothing to be saved by copying a stream which isn't compressed or encrypted */
+    code = pdfi_dict_from_obj(ctx, (pdf_obj *)stream_obj, &stream_dict);
+    if (code < 0)
+        return 0;
+    (void)pdfi_dict_known(ctx, stream_dict, "Filter", &filtered);
+    if (!filtered && !ctx->encryption.is_encrypted)
+        return 0;
+
+    for (entry = ctx->stream_cache_LRU; entry != NULL; entry = entry->next) {
+        if (entry->pinned)
+            pinned += entry->length;
+    }
+    budget = (uint64_t)ctx->args.PDFStreamCacheSize;
+    if (pinned >= budget || length > budget - pinned)
+        return 0;
+    budget -= pinned;
+
+    code = pdfi_stream_cache_decode(ctx, stream_obj, kind, length, budget, &data, &size);
+    if (code < 0 || size == 0) {
+        gs_free_object(ctx->memory, data, "pdfi_open_cached_stream");
+        return 0;
+    }
+
+    entry = (pdf_stream_cache_entry *)gs_alloc_bytes(ctx->memory, sizeof(pdf_stream_cache_entry), "pdfi_open_cached_stream");
+    if (entry == NULL) {
+        gs_free_object(ctx->memory, data, "pdfi_open_cached_stream");
+        return 0;
+    }
+    memset(entry, 0x00, sizeof(pdf_stream_cache_entry));
+    entry->object_num = stream_obj->object_num;
+    entry->generation_num = stream_obj->generation_num;
+    entry->offset = offset;
+    entry->kind = kind;
+    entry->data = data;
+    entry->length = size;
+
+    for (victim = ctx->stream_cache_LRU; victim != NULL &&
+             ctx->stream_cache_bytes + size > (uint64_t)ctx->args.PDFStreamCacheSize; victim = next) {
+        next = victim->next;
+        if (victim->pinned)
+            continue;
+        pdfi_stream_cache_unlink(ctx, victim);
+        ctx->stream_cache_bytes -= victim->length;
+        ctx->stream_cache_entries--;
+        pdfi_free_stream_cache_entry(ctx, victim);
+    }
+    pdfi_stream_cache_link_MRU(ctx, entry);
+    ctx->stream_cache_bytes += size;
+    ctx->stream_cache_entries++;
+    ctx->stream_cache_misses++;
+
+ open:
+    code = pdfi_open_memory_stream_from_memory(ctx, (unsigned int)entry->length, entry->data, new_stream, true);
+    if (code < 0)
+        return code;
+    entry->pinned++;
+    (*new_stream)->cache_entry = entry;
+    return 1;
+}
+
 int pdfi_open_resource_file(pdf_context *ctx, const char *fname, const int fnamelen, stream **s)
 {
     int code = 0;
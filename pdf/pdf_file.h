@@ -98,6 +98,18 @@ int pdfi_open_memory_stream_from_filtered_stream(pdf_context *ctx, pdf_stream *s
 int pdfi_open_memory_stream_from_memory(pdf_context *ctx, unsigned int size, byte *Buffer, pdf_c_stream **new_pdf_stream, bool retain_ownership);
 int pdfi_stream_to_buffer(pdf_context *ctx, pdf_stream *stream_dict, byte **buf, int64_t *bufferlen);
 
+/* The same stream can be decoded differently depending on how it is used, so the
+ * cache of decoded streams records which of these produced the data.
+ */
+typedef enum pdfi_stream_cache_kind_e {
+    PDFI_STREAM_CACHE_CONTENT,  /* pdfi_filter() applied directly to the file */
+    PDFI_STREAM_CACHE_IMAGE     /* pdfi_filter() on a SubFileDecode which stops at 'endstream' */
+} pdfi_stream_cache_kind;
+
+int pdfi_open_cached_stream(pdf_context *ctx, pdf_stream *stream_obj, pdfi_stream_cache_kind kind,
+                            uint64_t length, pdf_c_stream **new_stream);
+void pdfi_free_stream_cache(pdf_context *ctx);
+
 int pdfi_apply_Arc4_filter(pdf_context *ctx, pdf_string *Key, pdf_c_stream *source, pdf_c_stream **new_stream);
 int pdfi_apply_AES_filter(pdf_context *ctx, pdf_string *Key, bool use_padding, pdf_c_stream *source, pdf_c_stream **new_stream);
 int pdfi_apply_imscale_filter(pdf_context *ctx, pdf_string *Key, int width, int height, pdf_c_stream *source, pdf_c_stream **new_stream);
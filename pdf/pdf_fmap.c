@@ -625,6 +625,307 @@ static bool font_scan_skip_file(char *fname)
     return skip;
 }
 
+/* The native font map can be kept in a file (-sPDFNativeFontMapCache=) so that the
+ * fonts are only opened and read when they have changed. The file records each font
+ * directory, followed by every file the scan found in it or in its subdirectories,
+ * with its modification time and size, then the map entries:
+ *
+ * %PDFiNativeFontMap 2
+ * P <length>
+ * <directory>
+ * S <length> <mtime> <size>
+ * <font file>
+ * F <index> <name length> <path length>
+ * <font name>
+ * <font file>
+ * E <number of F records>
+ *
+ * The cache is only used if it lists the same directories, in the same order, and
+ * listing them again finds the same files, unmodified. Listing the files and checking
+ * their times is much cheaper than opening and reading every one of them.
+ * -dPDFRebuildNativeFontMap forces a rescan.
+ */
+#define NATIVE_FONTMAP_CACHE_HEADER "%PDFiNativeFontMap 2\n"
+
+static int pdfi_native_fontmap_cache_name(pdf_context *ctx, char *fname, int fname_size)
+{
+    if (ctx->args.nativefontmapcache.data == NULL || ctx->args.nativefontmapcache.size == 0 ||
+        ctx->args.nativefontmapcache.size >= fname_size)
+        return 0;
+    memcpy(fname, ctx->args.nativefontmapcache.data, ctx->args.nativefontmapcache.size);
+    fname[ctx->args.nativefontmapcache.size] = '\0';
+    return 1;
+}
+
+/* Start listing every file in font directory 'i' and below; 'patrn' is gp_file_name_sizeof bytes */
+static file_enum *pdfi_font_path_enum_init(pdf_context *ctx, int i, char *patrn)
+{
+    gs_param_string *dir = &ctx->search_paths.font_paths[i];
+
+    if (dir->size + 3 > gp_file_name_sizeof)
+        return NULL;
+    memcpy(patrn, dir->data, dir->size);
+    memcpy(patrn + dir->size, "/*", 2);
+    patrn[dir->size + 2] = '\0';
+    return gp_enumerate_files_init(ctx->memory, (const char *)patrn, strlen(patrn));
+}
+
+/* Modification time and size of a font file, or -1 if we can't stat it */
+static void pdfi_font_file_stat(pdf_context *ctx, const char *fname, int64_t *mtime, int64_t *size)
+{
+    struct stat buf;
+
+    *mtime = *size = -1;
+    if (gp_stat(ctx->memory, fname, &buf) >= 0) {
+        *mtime = (int64_t)buf.st_mtime;
+        *size = (int64_t)buf.st_size;
+    }
+}
+
+/* Read a record header; a letter followed by 'count' space separated integers and a newline */
+static char *pdfi_read_fontmap_cache_record(char *p, char *end, char type, int count, int64_t *values)
+{
+    int i;
+    bool negative;
+
+    if (p >= end || *p++ != type)
+        return NULL;
+    for (i = 0; i < count; i++) {
+        if (p >= end || *p++ != ' ')
+            return NULL;
+        negative = (p < end && *p == '-');
+        if (negative)
+            p++;
+        if (p >= end || *p < '0' || *p > '9')
+            return NULL;
+        values[i] = 0;
+        while (p < end && *p >= '0' && *p <= '9')
+            values[i] = values[i] * 10 + (*p++ - '0');
+        if (negative)
+            values[i] = -values[i];
+    }
+    if (p >= end || *p++ != '\n')
+        return NULL;
+    return p;
+}
+
+/* Read a record header whose first value is the length of the string on the following
+ * line, and check that the string is 'data'.
+ */
+static char *pdfi_match_fontmap_cache_record(char *p, char *end, char type, int count, int64_t *values,
+                                             const void *data, uint length)
+{
+    p = pdfi_read_fontmap_cache_record(p, end, type, count, values);
+    if (p == NULL || values[0] != length || values[0] >= end - p || p[values[0]] != '\n' ||
+        memcmp(p, data, length) != 0)
+        return NULL;
+    return p + length + 1;
+}
+
+/* Returns 1 if the native font map was loaded from the cache, 0 if it needs to be rebuilt */
+static int pdfi_read_native_fontmap_cache(pdf_context *ctx, const char *fname, char *patrn, char *result)
+{
+    gp_file *f;
+    gs_offset_t length;
+    char *buf = NULL, *p, *end, *name, *path;
+    int64_t v[3], mtime, size, entries = 0;
+    int i, code = 0;
+    uint l;
+    file_enum *fe;
+
+    f = gp_fopen(ctx->memory, fname, "rb");
+    if (f == NULL)
+        return 0;
+    if (gp_fseek(f, 0, SEEK_END) == 0)
+        length = gp_ftell(f);
+    else
+        length = -1;
+    if (length > 0 && length < max_int && gp_fseek(f, 0, SEEK_SET) == 0)
+        buf = (char *)gs_alloc_bytes(ctx->memory, length, "pdfi_read_native_fontmap_cache");
+    if (buf == NULL || gp_fread(buf, 1, length, f) != length) {
+        gp_fclose(f);
+        gs_free_object(ctx->memory, buf, "pdfi_read_native_fontmap_cache");
+        return 0;
+    }
+    gp_fclose(f);
+    end = buf + length;
+
+    p = buf + strlen(NATIVE_FONTMAP_CACHE_HEADER);
+    if (p > end || memcmp(buf, NATIVE_FONTMAP_CACHE_HEADER, p - buf) != 0)
+        goto stale;
+
+    for (i = 0; i < ctx->search_paths.num_font_paths; i++) {
+        gs_param_string *dir = &ctx->search_paths.font_paths[i];
+
+        p = pdfi_match_fontmap_cache_record(p, end, 'P', 1, v, dir->data, dir->size);
+        if (p == NULL)
+            goto stale;
+        fe = pdfi_font_path_enum_init(ctx, i, patrn);
+        if (fe == NULL)
+            continue;
+        while ((l = gp_enumerate_files_next(ctx->memory, fe, result, gp_file_name_sizeof - 1)) != ~(uint) 0) {
+            result[l] = '\0';
+            if (font_scan_skip_file(result))
+                continue;
+            p = pdfi_match_fontmap_cache_record(p, end, 'S', 3, v, result, l);
+            if (p != NULL)
+                pdfi_font_file_stat(ctx, result, &mtime, &size);
+            if (p == NULL || v[1] != mtime || v[2] != size) {
+                gp_enumerate_files_close(ctx->memory, fe);
+                goto stale;
+            }
+        }
+    }
+
+    if (ctx->pdfnativefontmap == NULL) {
+        code = pdfi_dict_alloc(ctx, 32, &ctx->pdfnativefontmap);
+        if (code < 0)
+            goto exit;
+        pdfi_countup(ctx->pdfnativefontmap);
+    }
+
+    while (p < end && *p == 'F') {
+        p = pdfi_read_fontmap_cache_record(p, end, 'F', 3, v);
+        if (p == NULL || v[1] <= 0 || v[2] <= 0 || v[1] + v[2] + 2 > end - p ||
+            p[v[1]] != '\n' || p[v[1] + 1 + v[2]] != '\n' || v[0] < -1 || v[0] > max_int)
+            goto stale;
+        /* Terminate the name and path in place */
+        name = p;
+        name[v[1]] = '\0';
+        path = p + v[1] + 1;
+        path[v[2]] = '\0';
+        p = path + v[2] + 1;
+        code = pdfi_add__to_native_fontmap(ctx, (const char *)name, (const char *)path, (int)v[0]);
+        if (code < 0)
+            goto exit;
+        entries++;
+    }
+    p = pdfi_read_fontmap_cache_record(p, end, 'E', 1, v);
+    if (p == NULL || v[0] != entries)
+        goto stale;
+
+    gs_free_object(ctx->memory, buf, "pdfi_read_native_fontmap_cache");
+    return 1;
+
+ stale:
+    code = 0;
+ exit:
+    pdfi_countdown(ctx->pdfnativefontmap);
+    ctx->pdfnativefontmap = NULL;
+    gs_free_object(ctx->memory, buf, "pdfi_read_native_fontmap_cache");
+    return code;
+}
+
+/* Write a record header line, then 'data' on a line of its own */
+static int pdfi_write_fontmap_cache_record(gp_file *f, const char *line, const void *data, size_t length)
+{
+    size_t l = strlen(line);
+
+    if (gp_fwrite(line, 1, l, f) != l || gp_fwrite(data, 1, length, f) != length ||
+        gp_fwrite("\n", 1, 1, f) != 1)
+        return_error(gs_error_ioerror);
+    return 0;
+}
+
+/* The cache is written to a temporary file beside it while the fonts are scanned, then
+ * renamed into place, so that other processes sharing the cache never see a partial file.
+ * Failure just means the next run scans the fonts again, so it isn't reported.
+ */
+static gp_file *pdfi_open_native_fontmap_cache(pdf_context *ctx, const char *fname, char *tmpname)
+{
+    gp_file *f;
+    long t[2];
+
+    gp_get_realtime(t);
+    if (gs_snprintf(tmpname, gp_file_name_sizeof, "%s.%lx%lx%"PRIxPTR, fname, t[0], t[1], (uintptr_t)ctx) >= gp_file_name_sizeof)
+        return NULL;
+    f = gp_fopen(ctx->memory, tmpname, "wb");
+    if (f == NULL)
+        return NULL;
+    if (gp_fwrite(NATIVE_FONTMAP_CACHE_HEADER, 1, strlen(NATIVE_FONTMAP_CACHE_HEADER), f) != strlen(NATIVE_FONTMAP_CACHE_HEADER)) {
+        gp_fclose(f);
+        (void)gp_unlink(ctx->memory, tmpname);
+        return NULL;
+    }
+    return f;
+}
+
+/* Record a font directory, or a file found in it. The file is recorded before it is
+ * read, so a font changed during the scan is seen as changed by the next run.
+ */
+static int pdfi_write_fontmap_cache_path(pdf_context *ctx, gp_file *f, const char *fname, uint length, bool is_dir)
+{
+    char line[128];
+    int64_t mtime, size;
+
+    if (is_dir)
+        gs_snprintf(line, sizeof(line), "P %u\n", length);
+    else {
+        pdfi_font_file_stat(ctx, fname, &mtime, &size);
+        gs_snprintf(line, sizeof(line), "S %u %"PRIi64" %"PRIi64"\n", length, mtime, size);
+    }
+    return pdfi_write_fontmap_cache_record(f, line, fname, length);
+}
+
+/* Write the map entries to the end of the cache and rename it into place, or discard
+ * it if 'code' or writing it fails.
+ */
+static void pdfi_close_native_fontmap_cache(pdf_context *ctx, gp_file *f, const char *tmpname,
+                                            const char *fname, int code)
+{
+    char line[128];
+    int64_t index, entries = 0;
+    uint64_t ind;
+    pdf_name *key = NULL;
+    pdf_obj *v = NULL;
+    pdf_string *path = NULL;
+
+    if (code >= 0 && ctx->pdfnativefontmap != NULL &&
+        pdfi_dict_key_first(ctx, ctx->pdfnativefontmap, (pdf_obj **)&key, &ind) >= 0) {
+        do {
+            index = -1;
+            code = pdfi_dict_get_by_key(ctx, ctx->pdfnativefontmap, key, &v);
+            if (code < 0)
+                break;
+            if (v->type == PDF_DICT) {
+                code = pdfi_dict_get_int(ctx, (pdf_dict *)v, "Index", &index);
+                if (code >= 0)
+                    code = pdfi_dict_get_type(ctx, (pdf_dict *)v, "Path", PDF_STRING, (pdf_obj **)&path);
+            } else if (v->type == PDF_STRING) {
+                path = (pdf_string *)v;
+                pdfi_countup(path);
+            } else
+                code = gs_note_error(gs_error_typecheck);
+            if (code >= 0) {
+                gs_snprintf(line, sizeof(line), "F %"PRIi64" %u %u\n", index, key->length, path->length);
+                code = pdfi_write_fontmap_cache_record(f, line, key->data, key->length);
+                if (code >= 0)
+                    code = pdfi_write_fontmap_cache_record(f, "", path->data, path->length);
+                entries++;
+            }
+            pdfi_countdown(path);
+            path = NULL;
+            pdfi_countdown(v);
+            v = NULL;
+            pdfi_countdown(key);
+            key = NULL;
+        } while (code >= 0 && pdfi_dict_key_next(ctx, ctx->pdfnativefontmap, (pdf_obj **)&key, &ind) >= 0);
+    }
+
+    if (code >= 0) {
+        gs_snprintf(line, sizeof(line), "E %"PRIi64"\n", entries);
+        if (gp_fwrite(line, 1, strlen(line), f) != strlen(line))
+            code = gs_note_error(gs_error_ioerror);
+    }
+    if (gp_fclose(f) != 0 && code >= 0)
+        code = gs_note_error(gs_error_ioerror);
+
+    if (code >= 0)
+        code = gp_rename(ctx->memory, tmpname, fname);
+    if (code < 0)
+        (void)gp_unlink(ctx->memory, tmpname);
+}
+
 static int pdfi_generate_native_fontmap(pdf_context *ctx)
 {
     file_enum *fe;
@@ -636,6 +937,10 @@ static int pdfi_generate_native_fontmap(pdf_context *ctx)
     stream *sf;
     int code = 0, l;
     uint nread;
+    char cachename[gp_file_name_sizeof], tmpname[gp_file_name_sizeof];
+    bool use_cache;
+    gp_file *cache = NULL;
+    int cache_code = 0;
 
     if (ctx->pdfnativefontmap != NULL) /* Only run this once */
         return 0;
@@ -658,13 +963,23 @@ static int pdfi_generate_native_fontmap(pdf_context *ctx)
         return_error(gs_error_VMerror);
     }
 
-    for (i = 0; i < ctx->search_paths.num_font_paths; i++) {
+    use_cache = pdfi_native_fontmap_cache_name(ctx, cachename, gp_file_name_sizeof);
+    if (use_cache && !ctx->args.rebuildnativefontmap) {
+        code = pdfi_read_native_fontmap_cache(ctx, cachename, patrn, result);
+        if (code != 0)
+            goto exit;
+    }
+    if (use_cache)
+        cache = pdfi_open_native_fontmap_cache(ctx, cachename, tmpname);
 
-        memcpy(patrn, ctx->search_paths.font_paths[i].data, ctx->search_paths.font_paths[i].size);
-        memcpy(patrn + ctx->search_paths.font_paths[i].size, "/*", 2);
-        patrn[ctx->search_paths.font_paths[i].size + 2] = '\0';
+    for (i = 0; i < ctx->search_paths.num_font_paths; i++) {
 
-        fe = gp_enumerate_files_init(ctx->memory, (const char *)patrn, strlen(patrn));
+        if (cache != NULL && cache_code >= 0)
+            cache_code = pdfi_write_fontmap_cache_path(ctx, cache, (const char *)ctx->search_paths.font_paths[i].data,
+                                                       ctx->search_paths.font_paths[i].size, true);
+        fe = pdfi_font_path_enum_init(ctx, i, patrn);
+        if (fe == NULL)
+            continue;
         while ((l = gp_enumerate_files_next(ctx->memory, fe, result, gp_file_name_sizeof - 1)) != ~(uint) 0) {
             int type;
             result[l] = '\0';
@@ -672,6 +987,9 @@ static int pdfi_generate_native_fontmap(pdf_context *ctx)
             if (font_scan_skip_file(result))
                 continue;
 
+            if (cache != NULL && cache_code >= 0)
+                cache_code = pdfi_write_fontmap_cache_path(ctx, cache, result, l, false);
+
             sf = sfopen(result, "r", ctx->memory);
             code = sgets(sf, magic, 4, &nread);
             if (code < 0 || nread < 4) {
@@ -708,8 +1026,10 @@ static int pdfi_generate_native_fontmap(pdf_context *ctx)
             }
             sfclose(sf);
             /* We ignore most errors, on the basis it probably means it wasn't a valid font file */
-            if (code == gs_error_VMerror)
+            if (code == gs_error_VMerror) {
+                cache_code = code;
                 break;
+            }
             code = 0;
         }
         /* We only need to explicitly destroy the enumerator if we exit before enumeration is complete */
@@ -786,10 +1106,16 @@ static int pdfi_generate_native_fontmap(pdf_context *ctx)
     }
 #endif
 
+    /* Running out of memory is the only failure which leaves the map incomplete */
+    if (cache != NULL)
+        pdfi_close_native_fontmap_cache(ctx, cache, tmpname, cachename, cache_code);
+    code = 0;
+
+ exit:
     gs_free_object(ctx->memory, patrn, "pdfi_generate_native_fontmap");
     gs_free_object(ctx->memory, result, "pdfi_generate_native_fontmap");
     gs_free_object(ctx->memory, working, "pdfi_generate_native_fontmap");
-    return 0;
+    return code < 0 ? code : 0;
 }
 
 int
@@ -801,6 +801,10 @@ int pdfi_load_font(pdf_context *ctx, pdf_dict *stream_dict, pdf_dict *page_dict,
             if ((substitute & font_substitute) == font_substitute)
                 code = pdfi_font_match_glyph_widths(ppdffont);
         }
+        /* Only fonts we loaded from a font file ourselves may share their
+         * characters with other documents, see gxccman.c */
+        if (substitute == font_embedded && ppdffont->pfont->FontType != ft_composite)
+            ((gs_font_base *)ppdffont->pfont)->UID_is_local = true;
         *ppfont = (gs_font *)ppdffont->pfont;
      }
 
@@ -1737,7 +1741,8 @@ int pdfi_font_generate_pseudo_XUID(pdf_context *ctx, pdf_dict *fontdict, gs_font
     long *xvalues;
     int xuidlen = 2;
 
-    sfilename(ctx->main_stream->s, &fn);
+    /* A mapped input file is read through a string stream, which has no name */
+    sfilename(ctx->main_file_stream != NULL ? ctx->main_file_stream : ctx->main_stream->s, &fn);
     if (fn.size > 0 && fontdict->object_num != 0) {
         for (i = 0; i < fn.size; i++) {
             hash = ((((hash & 0xf8000000) >> 27) ^ (hash << 5)) & 0x7ffffffff) ^ fn.data[i];
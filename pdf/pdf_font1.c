@@ -459,6 +459,7 @@ pdfi_alloc_t1_font(pdf_context *ctx, pdf_font_type1 **font, uint32_t obj_num)
     /* We may want to do something clever with an XUID here */
     pfont->id = gs_next_ids(ctx->memory, 1);
     uid_set_UniqueID(&pfont->UID, pfont->id);
+    pfont->UID_is_local = true;
 
     pfont->encoding_index = 1;          /****** WRONG ******/
     pfont->nearest_encoding_index = 1;          /****** WRONG ******/
@@ -548,8 +549,10 @@ pdfi_read_type1_font(pdf_context *ctx, pdf_dict *font_dict, pdf_dict *stream_dic
             memcpy(&pfont1->FontBBox, &fpriv.gsu.gst1.FontBBox, sizeof(pfont1->FontBBox));
             memcpy(&pfont1->key_name, &fpriv.gsu.gst1.key_name, sizeof(pfont1->key_name));
             memcpy(&pfont1->font_name, &fpriv.gsu.gst1.font_name, sizeof(pfont1->font_name));
-            if (fpriv.gsu.gst1.UID.id != 0)
+            if (fpriv.gsu.gst1.UID.id != 0) {
                 memcpy(&pfont1->UID, &fpriv.gsu.gst1.UID, sizeof(pfont1->UID));
+                pfont1->UID_is_local = false;
+            }
             fpriv.gsu.gst1.UID.xvalues = NULL; /* In case of error */
             pfont1->WMode = fpriv.gsu.gst1.WMode;
             pfont1->PaintType = fpriv.gsu.gst1.PaintType;
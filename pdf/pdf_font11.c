@@ -246,6 +246,7 @@ pdfi_alloc_cidtype2_font(pdf_context *ctx, pdf_cidfont_type2 **font, bool is_cid
     /* We may want to do something clever with an XUID here */
     pfont->id = gs_next_ids(ctx->memory, 1);
     uid_set_UniqueID(&pfont->UID, pfont->id);
+    pfont->UID_is_local = true;
     /* The buildchar proc will be filled in by FAPI -
        we won't worry about working without FAPI */
     pfont->procs.encode_char = pdfi_encode_char;
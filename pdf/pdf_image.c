@@ -1919,8 +1919,19 @@ pdfi_do_image(pdf_context *ctx, pdf_dict *page_dict, pdf_dict *stream_dict, pdf_
             goto cleanupExit;
     }
 
-    /* Setup the data stream for the image data */
-    if (!inline_image) {
+    /* Setup the data stream for the image data. An image which is drawn more than once
+     * may already have been decoded; not for high level devices though, which may want
+     * to pass the compressed data straight through.
+     */
+    if (!inline_image && !ctx->device_state.HighLevelDevice) {
+        code = pdfi_open_cached_stream(ctx, image_stream, PDFI_STREAM_CACHE_IMAGE,
+                                       pdfi_get_image_data_size((gs_data_image_t *)pim, comps),
+                                       &new_stream);
+        if (code < 0)
+            goto cleanupExit;
+    }
+
+    if (new_stream == NULL && !inline_image) {
         code = pdfi_object_alloc(ctx, PDF_STRING, 9, (pdf_obj **)&EODString);
         if (code < 0)
             goto cleanupExit;
@@ -1935,9 +1946,11 @@ pdfi_do_image(pdf_context *ctx, pdf_dict *page_dict, pdf_dict *stream_dict, pdf_
         source = SFD_stream;
     }
 
-    code = pdfi_filter(ctx, image_stream, source, &new_stream, inline_image);
-    if (code < 0)
-        goto cleanupExit;
+    if (new_stream == NULL) {
+        code = pdfi_filter(ctx, image_stream, source, &new_stream, inline_image);
+        if (code < 0)
+            goto cleanupExit;
+    }
 
     /* This duplicates the code in gs_img.ps; if we have an imagemask, with 1 bit per component (is there any other kind ?)
      * and the image is to be interpolated, and we are nto sending it to a high level device. Then check the scaling.
@@ -1988,6 +2001,7 @@ pdfi_do_image(pdf_context *ctx, pdf_dict *page_dict, pdf_dict *stream_dict, pdf_
              * applied in pdfi_filter above.
              */
             new_stream->original = s->original;
+            new_stream->cache_entry = s->cache_entry;
 
             /* We'e created a new 'new_stream', which is a C stream, to hold the filter chain
              * but we still need to free the original C stream 'wrapper' we created with pdfi_filter()
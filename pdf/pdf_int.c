@@ -49,41 +49,69 @@
 
 /***********************************************************************************/
 /* Some simple functions to find white space, delimiters and hex bytes             */
-static bool iswhite(char c)
+/* These are called for every byte of every content stream, so we use a table of  */
+/* character classes rather than a chain of comparisons.                           */
+#define PDFI_CC_WHITE   0x01
+#define PDFI_CC_DELIM   0x02
+#define PDFI_CC_HEX     0x04
+#define PDFI_CC_DIGIT   0x08
+
+#define W PDFI_CC_WHITE
+#define D PDFI_CC_DELIM
+#define H PDFI_CC_HEX
+#define N (PDFI_CC_DIGIT | PDFI_CC_HEX)
+static const byte pdfi_char_class[256] = {
+    W, 0, 0, 0, 0, 0, 0, 0, 0, W, W, 0, W, W, 0, 0,     /* 0x00 */
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,     /* 0x10 */
+    W, 0, 0, 0, 0, D, 0, 0, D, D, 0, 0, 0, 0, 0, D,     /* 0x20  !"#$%&'()*+,-./ */
+    N, N, N, N, N, N, N, N, N, N, 0, 0, D, 0, D, 0,     /* 0x30 0123456789:;<=>? */
+    0, H, H, H, H, H, H, 0, 0, 0, 0, 0, 0, 0, 0, 0,     /* 0x40 @ABCDEFGHIJKLMNO */
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, D, 0, D, 0, 0,     /* 0x50 PQRSTUVWXYZ[\]^_ */
+    0, H, H, H, H, H, H, 0, 0, 0, 0, 0, 0, 0, 0, 0,     /* 0x60 `abcdefghijklmno */
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, D, 0, D, 0, 0,     /* 0x70 pqrstuvwxyz{|}~  */
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,     /* 0x80 */
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0
+};
+#undef W
+#undef D
+#undef H
+#undef N
+
+static inline bool iswhite(char c)
 {
-    if (c == 0x00 || c == 0x09 || c == 0x0a || c == 0x0c || c == 0x0d || c == 0x20)
-        return true;
-    else
-        return false;
+    return (pdfi_char_class[(byte)c] & PDFI_CC_WHITE) != 0;
 }
 
-static bool isdelimiter(char c)
+static inline bool isdelimiter(char c)
 {
-    if (c == '/' || c == '(' || c == ')' || c == '[' || c == ']' || c == '<' || c == '>' || c == '{' || c == '}' || c == '%')
-        return true;
-    else
-        return false;
+    return (pdfi_char_class[(byte)c] & PDFI_CC_DELIM) != 0;
 }
 
-static bool ishex(char c)
+static inline bool ishex(char c)
 {
-    if (c < 0x30)
-        return false;
+    return (pdfi_char_class[(byte)c] & PDFI_CC_HEX) != 0;
+}
 
-    if (c > 0x39) {
-        if (c > 'F') {
-            if (c < 'a')
-                return false;
-            if (c > 'f')
-                return false;
-            return true;
-        } else {
-            if (c < 'A')
-                return false;
-            return true;
-        }
-    } else
-        return true;
+/* Read a single byte, returns the same as pdfi_read_bytes(ctx, c, 1, 1, s) would.
+ * The tokeniser reads everything a byte at a time, so when there is nothing
+ * 'unread' and the byte is already in the stream buffer, take it directly
+ * from there (as sgetc() does) instead of going through pdfi_read_bytes/sgets.
+ */
+static inline int pdfi_read_byte(pdf_context *ctx, pdf_c_stream *s, byte *c)
+{
+    stream *st = s->s;
+
+    if (s->unread_size == 0 && !s->eof && st->cursor.r.ptr < st->cursor.r.limit) {
+        *c = *++st->cursor.r.ptr;
+        return 1;
+    }
+    return pdfi_read_bytes(ctx, c, 1, 1, s);
 }
 
 /* You must ensure the character is a hex character before calling this, no error trapping here */
@@ -111,7 +139,7 @@ int pdfi_skip_white(pdf_context *ctx, pdf_c_stream *s)
     byte c;
 
     do {
-        bytes = pdfi_read_bytes(ctx, &c, 1, 1, s);
+        bytes = pdfi_read_byte(ctx, s, &c);
         if (bytes < 0)
             return_error(gs_error_ioerror);
         if (bytes == 0)
@@ -131,7 +159,7 @@ int pdfi_skip_eol(pdf_context *ctx, pdf_c_stream *s)
     byte c;
 
     do {
-        bytes = pdfi_read_bytes(ctx, &c, 1, 1, s);
+        bytes = pdfi_read_byte(ctx, s, &c);
         if (bytes == 0)
             return 0;
         if (read) {
@@ -146,6 +174,73 @@ int pdfi_skip_eol(pdf_context *ctx, pdf_c_stream *s)
     return 0;
 }
 
+/* Convert the common numbers, integers of up to 9 characters and reals of up to 16
+ * without an exponent, without using sscanf, which is slow and which we'd otherwise
+ * call for nearly every operand in a content stream. The result must be exactly
+ * what sscanf would give: the integers can't overflow, and for reals the mantissa
+ * and the power of 10 are both exact doubles, so the division is correctly rounded.
+ * Rounding that to a float gives the same result as rounding the decimal directly,
+ * unless the double happens to fall exactly half way between two floats, in which
+ * case we let sscanf do it. Returns 1 if the number was converted, 0 if not.
+ */
+static const double pdfi_pow10[16] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15
+};
+
+static int pdfi_read_num_fast(pdf_context *ctx, const byte *Buffer, int len, bool real, pdf_num **pnum)
+{
+    int64_t mant = 0;
+    int i = 0, frac = -1;
+    bool neg = false, digits = false;
+    int code;
+
+    if (len > (real ? 16 : 9))
+        return 0;
+
+    if (Buffer[0] == '-') {
+        neg = true;
+        i++;
+    } else if (Buffer[0] == '+')
+        i++;
+
+    for (; i < len; i++) {
+        if (Buffer[i] == '.') {
+            frac = 0;
+            continue;
+        }
+        mant = mant * 10 + (Buffer[i] - '0');
+        digits = true;
+        if (frac >= 0)
+            frac++;
+    }
+    if (!digits)
+        return 0;
+
+    if (real) {
+        union {
+            double d;
+            uint64_t u;
+        } x;
+        float f;
+
+        x.d = (double)mant / pdfi_pow10[frac < 0 ? 0 : frac];
+        if ((x.u & 0x1fffffff) == 0x10000000)
+            return 0;
+        f = (float)x.d;
+
+        code = pdfi_object_alloc(ctx, PDF_REAL, 0, (pdf_obj **)pnum);
+        if (code < 0)
+            return code;
+        (*pnum)->value.d = neg ? -f : f;
+    } else {
+        code = pdfi_object_alloc(ctx, PDF_INT, 0, (pdf_obj **)pnum);
+        if (code < 0)
+            return code;
+        (*pnum)->value.i = neg ? -mant : mant;
+    }
+    return 1;
+}
+
 static int pdfi_read_num(pdf_context *ctx, pdf_c_stream *s, uint32_t indirect_num, uint32_t indirect_gen)
 {
     byte Buffer[256];
@@ -163,7 +258,7 @@ static int pdfi_read_num(pdf_context *ctx, pdf_c_stream *s, uint32_t indirect_nu
     pdfi_skip_white(ctx, s);
 
     do {
-        bytes = pdfi_read_bytes(ctx, (byte *)&Buffer[index], 1, 1, s);
+        bytes = pdfi_read_byte(ctx, s, (byte *)&Buffer[index]);
         if (bytes == 0 && s->eof) {
             Buffer[index] = 0x00;
             break;
@@ -238,6 +333,14 @@ static int pdfi_read_num(pdf_context *ctx, pdf_c_stream *s, uint32_t indirect_nu
             return_error(gs_error_syntaxerror);
     } while(1);
 
+    if (!malformed && !doubleneg && !has_exponent) {
+        code = pdfi_read_num_fast(ctx, Buffer, index, real, &num);
+        if (code < 0)
+            return code;
+        if (code > 0)
+            goto push;
+    }
+
     if (!real && index > 7) {
         /* Check for integer overflow, represent as real if so */
         gs_sprintf(Max, "%d", (max_uint >> 1));
@@ -340,6 +443,7 @@ static int pdfi_read_num(pdf_context *ctx, pdf_c_stream *s, uint32_t indirect_nu
             num->value.i = tempi;
         }
     }
+push:
     if (ctx->args.pdfdebug) {
         if (real)
             dmprintf1(ctx->memory, " %f", num->value.d);
@@ -359,23 +463,22 @@ static int pdfi_read_num(pdf_context *ctx, pdf_c_stream *s, uint32_t indirect_nu
 
 static int pdfi_read_name(pdf_context *ctx, pdf_c_stream *s, uint32_t indirect_num, uint32_t indirect_gen)
 {
-    char *Buffer, *NewBuf = NULL;
+    char StackBuf[256], *Buffer = StackBuf, *NewBuf = NULL;
     unsigned short index = 0;
     short bytes = 0;
-    uint32_t size = 256;
+    uint32_t size = sizeof(StackBuf);
     pdf_name *name = NULL;
     int code;
 
-    Buffer = (char *)gs_alloc_bytes(ctx->memory, size, "pdfi_read_name");
-    if (Buffer == NULL)
-        return_error(gs_error_VMerror);
-
+    /* Almost all names fit in StackBuf, we only allocate a buffer for longer ones */
     do {
-        bytes = pdfi_read_bytes(ctx, (byte *)&Buffer[index], 1, 1, s);
+        bytes = pdfi_read_byte(ctx, s, (byte *)&Buffer[index]);
         if (bytes == 0 && s->eof)
             break;
-        if (bytes <= 0)
-            return_error(gs_error_ioerror);
+        if (bytes <= 0) {
+            code = gs_note_error(gs_error_ioerror);
+            goto exit;
+        }
 
         if (iswhite((char)Buffer[index])) {
             Buffer[index] = 0x00;
@@ -405,35 +508,35 @@ static int pdfi_read_name(pdf_context *ctx, pdf_c_stream *s, uint32_t indirect_n
         if (index++ >= size - 1) {
             NewBuf = (char *)gs_alloc_bytes(ctx->memory, size + 256, "pdfi_read_name");
             if (NewBuf == NULL) {
-                gs_free_object(ctx->memory, Buffer, "pdfi_read_name error");
-                return_error(gs_error_VMerror);
+                code = gs_note_error(gs_error_VMerror);
+                goto exit;
             }
             memcpy(NewBuf, Buffer, size);
-            gs_free_object(ctx->memory, Buffer, "pdfi_read_name");
+            if (Buffer != StackBuf)
+                gs_free_object(ctx->memory, Buffer, "pdfi_read_name");
             Buffer = NewBuf;
             size += 256;
         }
     } while(1);
 
-    code = pdfi_object_alloc(ctx, PDF_NAME, index, (pdf_obj **)&name);
-    if (code < 0) {
-        gs_free_object(ctx->memory, Buffer, "pdfi_read_name error");
-        return code;
+    code = pdfi_name_intern(ctx, (byte *)Buffer, index, (pdf_obj **)&name);
+    if (code < 0)
+        goto exit;
+    if (!(name->flags & PDF_OBJ_FLAG_INTERNED)) {
+        name->indirect_num = indirect_num;
+        name->indirect_gen = indirect_gen;
     }
-    memcpy(name->data, Buffer, index);
-    name->indirect_num = indirect_num;
-    name->indirect_gen = indirect_gen;
 
     if (ctx->args.pdfdebug)
         dmprintf1(ctx->memory, " /%s", Buffer);
 
-    gs_free_object(ctx->memory, Buffer, "pdfi_read_name");
-
+    pdfi_countup(name);
     code = pdfi_push(ctx, (pdf_obj *)name);
+    pdfi_countdown(name);
 
-    if (code < 0)
-        pdfi_free_object((pdf_obj *)name);
-
+exit:
+    if (Buffer != StackBuf)
+        gs_free_object(ctx->memory, Buffer, "pdfi_read_name");
     return code;
 }
 
@@ -455,7 +558,7 @@ static int pdfi_read_hexstring(pdf_context *ctx, pdf_c_stream *s, uint32_t indir
 
     do {
         do {
-            bytes = pdfi_read_bytes(ctx, (byte *)HexBuf, 1, 1, s);
+            bytes = pdfi_read_byte(ctx, s, (byte *)HexBuf);
             if (bytes == 0 && s->eof)
                 break;
             if (bytes <= 0) {
@@ -473,7 +576,7 @@ static int pdfi_read_hexstring(pdf_context *ctx, pdf_c_stream *s, uint32_t indir
             dmprintf1(ctx->memory, "%c", HexBuf[0]);
 
         do {
-            bytes = pdfi_read_bytes(ctx, (byte *)&HexBuf[1], 1, 1, s);
+            bytes = pdfi_read_byte(ctx, s, (byte *)&HexBuf[1]);
             if (bytes == 0 && s->eof)
                 break;
             if (bytes <= 0) {
@@ -559,7 +662,7 @@ static int pdfi_read_string(pdf_context *ctx, pdf_c_stream *s, uint32_t indirect
             size += 256;
         }
 
-        bytes = pdfi_read_bytes(ctx, (byte *)&Buffer[index], 1, 1, s);
+        bytes = pdfi_read_byte(ctx, s, (byte *)&Buffer[index]);
 
         if (bytes == 0 && s->eof) {
             if (nesting > 0)
@@ -774,7 +877,7 @@ int pdfi_skip_comment(pdf_context *ctx, pdf_c_stream *s)
         dmprintf (ctx->memory, " %%");
 
     do {
-        bytes = pdfi_read_bytes(ctx, (byte *)&Buffer, 1, 1, s);
+        bytes = pdfi_read_byte(ctx, s, (byte *)&Buffer);
         if (bytes < 0)
             return_error(gs_error_ioerror);
 
@@ -807,7 +910,7 @@ static int pdfi_read_keyword(pdf_context *ctx, pdf_c_stream *s, uint32_t indirec
     pdfi_skip_white(ctx, s);
 
     do {
-        bytes = pdfi_read_bytes(ctx, (byte *)&Buffer[index], 1, 1, s);
+        bytes = pdfi_read_byte(ctx, s, (byte *)&Buffer[index]);
         if (bytes < 0)
             return_error(gs_error_ioerror);
 
@@ -1005,7 +1108,7 @@ int pdfi_read_token(pdf_context *ctx, pdf_c_stream *s, uint32_t indirect_num, ui
 
     pdfi_skip_white(ctx, s);
 
-    bytes = pdfi_read_bytes(ctx, (byte *)Buffer, 1, 1, s);
+    bytes = pdfi_read_byte(ctx, s, (byte *)Buffer);
     if (bytes < 0)
         return (gs_error_ioerror);
     if (bytes == 0 && s->eof)
@@ -1037,14 +1140,14 @@ int pdfi_read_token(pdf_context *ctx, pdf_c_stream *s, uint32_t indirect_num, ui
             return 1;
             break;
         case '<':
-            bytes = pdfi_read_bytes(ctx, (byte *)&Buffer[1], 1, 1, s);
+            bytes = pdfi_read_byte(ctx, s, (byte *)&Buffer[1]);
             if (bytes <= 0)
                 return (gs_error_ioerror);
             if (iswhite(Buffer[1])) {
                 code = pdfi_skip_white(ctx, s);
                 if (code < 0)
                     return code;
-                bytes = pdfi_read_bytes(ctx, (byte *)&Buffer[1], 1, 1, s);
+                bytes = pdfi_read_byte(ctx, s, (byte *)&Buffer[1]);
             }
             if (Buffer[1] == '<') {
                 if (ctx->args.pdfdebug)
@@ -1073,7 +1176,7 @@ int pdfi_read_token(pdf_context *ctx, pdf_c_stream *s, uint32_t indirect_num, ui
             }
             break;
         case '>':
-            bytes = pdfi_read_bytes(ctx, (byte *)&Buffer[1], 1, 1, s);
+            bytes = pdfi_read_byte(ctx, s, (byte *)&Buffer[1]);
             if (bytes <= 0)
                 return (gs_error_ioerror);
             if (Buffer[1] == '>') {
@@ -1157,6 +1260,133 @@ int pdfi_name_alloc(pdf_context *ctx, byte *n, uint32_t size, pdf_obj **o)
     return 0;
 }
 
+/* Name interning
+ * Documents use the same few names over and over again, as dictionary keys and as
+ * operands in content streams ('/Im1 Do' on every page, for instance). Rather than
+ * allocating a new name object for every one the tokeniser reads, we keep a table
+ * of names and hand out a shared object. As well as saving the allocations, this
+ * means that most dictionary lookups by key can succeed on a pointer comparison.
+ *
+ * Interned names are flagged PDF_OBJ_FLAG_INTERNED and must not be modified. The
+ * table holds one reference to each name, which is released by pdfi_free_intern_names()
+ * when we are done with the file. To stop pathological files (or fonts with huge numbers
+ * of glyph names) growing the table without bound we only intern short names, and only
+ * up to PDFI_INTERN_MAX_NAMES of them, after that we just allocate names as before.
+ */
+#define PDFI_INTERN_MAX_NAME_LENGTH 127
+#define PDFI_INTERN_MAX_NAMES 65536
+
+static uint32_t pdfi_intern_hash(const byte *n, uint32_t size)
+{
+    uint32_t hash = 2166136261u;
+    uint32_t i;
+
+    for (i = 0; i < size; i++)
+        hash = (hash ^ n[i]) * 16777619u;
+    return hash;
+}
+
+static int pdfi_intern_grow(pdf_context *ctx)
+{
+    uint32_t new_size = ctx->intern_names_size == 0 ? 1024 : ctx->intern_names_size * 2;
+    pdf_name **new_names, *n;
+    uint32_t i, slot;
+
+    new_names = (pdf_name **)gs_alloc_bytes(ctx->memory, new_size * sizeof(pdf_name *), "pdfi_intern_grow");
+    if (new_names == NULL)
+        return_error(gs_error_VMerror);
+    memset(new_names, 0x00, new_size * sizeof(pdf_name *));
+
+    for (i = 0; i < ctx->intern_names_size; i++) {
+        n = ctx->intern_names[i];
+        if (n == NULL)
+            continue;
+        slot = pdfi_intern_hash(n->data, n->length) & (new_size - 1);
+        while (new_names[slot] != NULL)
+            slot = (slot + 1) & (new_size - 1);
+        new_names[slot] = n;
+    }
+    gs_free_object(ctx->memory, ctx->intern_names, "pdfi_intern_grow");
+    ctx->intern_names = new_names;
+    ctx->intern_names_size = new_size;
+    return 0;
+}
+
+/* Like pdfi_name_alloc(), but returns the shared name object for 'n' if there is
+ * one, adding it to the table if not. Note that, as with pdfi_name_alloc(), the
+ * returned object does not carry a reference for the caller.
+ */
+int pdfi_name_intern(pdf_context *ctx, byte *n, uint32_t size, pdf_obj **o)
+{
+    uint32_t slot;
+    pdf_name *name;
+    int code;
+
+    *o = NULL;
+
+    if (size > PDFI_INTERN_MAX_NAME_LENGTH || ctx->intern_names_count >= PDFI_INTERN_MAX_NAMES)
+        return pdfi_name_alloc(ctx, n, size, o);
+
+    if (ctx->intern_names_count * 2 >= ctx->intern_names_size) {
+        code = pdfi_intern_grow(ctx);
+        if (code < 0)
+            return pdfi_name_alloc(ctx, n, size, o);
+    }
+
+    slot = pdfi_intern_hash(n, size) & (ctx->intern_names_size - 1);
+    while ((name = ctx->intern_names[slot]) != NULL) {
+        if (name->length == size && memcmp(name->data, n, size) == 0) {
+            *o = (pdf_obj *)name;
+            return 0;
+        }
+        slot = (slot + 1) & (ctx->intern_names_size - 1);
+    }
+
+    code = pdfi_name_alloc(ctx, n, size, (pdf_obj **)&name);
+    if (code < 0)
+        return code;
+    name->flags |= PDF_OBJ_FLAG_INTERNED;
+    pdfi_countup(name);
+    ctx->intern_names[slot] = name;
+    ctx->intern_names_count++;
+
+    *o = (pdf_obj *)name;
+    return 0;
+}
+
+/* If *o is an interned name, replace it with a private copy which the caller can modify
+ * (eg by giving it an object number). The reference held by the caller is transferred to
+ * the copy.
+ */
+int pdfi_name_unintern(pdf_context *ctx, pdf_obj **o)
+{
+    pdf_name *name = (pdf_name *)*o, *copy = NULL;
+    int code;
+
+    if (name->type != PDF_NAME || !(name->flags & PDF_OBJ_FLAG_INTERNED))
+        return 0;
+
+    code = pdfi_name_alloc(ctx, name->data, name->length, (pdf_obj **)&copy);
+    if (code < 0)
+        return code;
+    pdfi_countup(copy);
+    pdfi_countdown(name);
+    *o = (pdf_obj *)copy;
+    return 0;
+}
+
+void pdfi_free_intern_names(pdf_context *ctx)
+{
+    uint32_t i;
+
+    for (i = 0; i < ctx->intern_names_size; i++)
+        pdfi_countdown(ctx->intern_names[i]);
+    gs_free_object(ctx->memory, ctx->intern_names, "pdfi_free_intern_names");
+    ctx->intern_names = NULL;
+    ctx->intern_names_size = 0;
+    ctx->intern_names_count = 0;
+}
+
 static char op_table_3[5][3] = {
     "BDC", "BMC", "EMC", "SCN", "scn"
 };
@@ -2073,13 +2303,20 @@ pdfi_interpret_content_stream(pdf_context *ctx, pdf_c_stream *content_stream,
     if (content_stream != NULL) {
         stream = content_stream;
     } else {
-        code = pdfi_seek(ctx, ctx->main_stream, pdfi_stream_offset(ctx, stream_obj), SEEK_SET);
+        /* Forms, Patterns and the like are often run many times, try for an already decoded copy */
+        code = pdfi_open_cached_stream(ctx, stream_obj, PDFI_STREAM_CACHE_CONTENT, 0, &stream);
         if (code < 0)
             return code;
 
-        code = pdfi_filter(ctx, stream_obj, ctx->main_stream, &stream, false);
-        if (code < 0)
-            return code;
+        if (code == 0) {
+            code = pdfi_seek(ctx, ctx->main_stream, pdfi_stream_offset(ctx, stream_obj), SEEK_SET);
+            if (code < 0)
+                return code;
+
+            code = pdfi_filter(ctx, stream_obj, ctx->main_stream, &stream, false);
+            if (code < 0)
+                return code;
+        }
     }
 
     pdfi_set_stream_parent(ctx, stream_obj, ctx->current_stream);
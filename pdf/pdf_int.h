@@ -26,6 +26,9 @@ int pdfi_skip_comment(pdf_context *ctx, pdf_c_stream *s);
 int pdfi_read_token(pdf_context *ctx, pdf_c_stream *s, uint32_t indirect_num, uint32_t indirect_gen);
 
 int pdfi_name_alloc(pdf_context *ctx, byte *key, uint32_t size, pdf_obj **o);
+int pdfi_name_intern(pdf_context *ctx, byte *key, uint32_t size, pdf_obj **o);
+int pdfi_name_unintern(pdf_context *ctx, pdf_obj **o);
+void pdfi_free_intern_names(pdf_context *ctx);
 
 int pdfi_read_dict(pdf_context *ctx, pdf_c_stream *s, uint32_t indirect_num, uint32_t indirect_gen);
 
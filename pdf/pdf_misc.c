@@ -114,6 +114,8 @@ pdfi_name_is(const pdf_name *n, const char *s)
 int
 pdfi_name_cmp(const pdf_name *n1, const pdf_name *n2)
 {
+    if (n1 == n2)
+        return 0;
     if (n1->length != n2->length)
         return -1;
     return memcmp(n1->data, n2->data, n1->length);
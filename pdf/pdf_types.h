@@ -109,6 +109,13 @@ typedef enum pdf_obj_type_e {
     uint16_t indirect_gen
 #endif
 
+/* Values for the 'flags' member of pdf_obj_common */
+/* The object is a name shared through the context's intern table (see pdfi_name_intern()).
+ * Interned names can be referenced from any number of places, so they must never be
+ * modified, including having an object or indirect number assigned.
+ */
+#define PDF_OBJ_FLAG_INTERNED 0x01
+
 typedef struct pdf_obj_s {
     pdf_obj_common;
 } pdf_obj;
@@ -170,9 +177,17 @@ typedef struct pdf_dict_s {
     uint64_t entries;
     pdf_obj **keys;
     pdf_obj **values;
+    /* Optional hash index over the keys, built on demand for dictionaries with at least
+     * PDF_DICT_HASH_THRESHOLD entries. Each slot holds an index into keys/values plus 1,
+     * 0 being an empty slot. hash_size is a power of 2, or 0 if there is no index.
+     */
+    uint32_t *hash_index;
+    uint32_t hash_size;
     bool dict_written; /* Has dict been written (for pdfwrite) */
 } pdf_dict;
 
+#define PDF_DICT_HASH_THRESHOLD 16
+
 typedef struct pdf_stream_s {
     pdf_obj_common;
     pdf_dict *stream_dict;
@@ -204,8 +219,41 @@ typedef struct pdf_obj_cache_entry_s {
     void *next;
     void *previous;
     pdf_obj *o;
+    uint64_t size;                  /* Estimated memory use of 'o', see pdfi_cache_obj_size() */
 }pdf_obj_cache_entry;
 
+/* The decompressed contents of an ObjStm, along with its parsed header, so that
+ * reading several objects from the same stream only decompresses it once.
+ */
+typedef struct pdf_objstm_cache_entry_s {
+    void *next;
+    void *previous;
+    uint64_t object_num;            /* The ObjStm's object number and file offset, */
+    gs_offset_t offset;             /* the offset guards against a repaired xref */
+    byte *data;
+    uint64_t length;
+    uint64_t header_end;            /* Where the header of object number/offset pairs ends */
+    int64_t N;
+    int64_t *object_nums;           /* N object numbers, and their offsets from header_end */
+    int64_t *object_offsets;
+    uint64_t size;
+}pdf_objstm_cache_entry;
+
+/* The decoded data of an image or content stream, so that Forms and images drawn
+ * on many pages are only decompressed once. See pdfi_open_cached_stream().
+ */
+typedef struct pdf_stream_cache_entry_s {
+    void *next;
+    void *previous;
+    uint64_t object_num;
+    uint32_t generation_num;
+    gs_offset_t offset;             /* As for an ObjStm, guards against a repaired xref */
+    int kind;                       /* How the data was decoded, a pdfi_stream_cache_kind */
+    byte *data;
+    uint64_t length;
+    int pinned;                     /* Number of open streams reading 'data' */
+}pdf_stream_cache_entry;
+
 /* The compressed and uncompressed xref entries are identical, they only differ
  * in the names used for the variables. Its simply less confusing not to overload
  * the names.
@@ -242,6 +290,7 @@ typedef struct pdf_c_stream_s {
     stream *s;
     uint32_t unread_size;
     char unget_buffer[UNREAD_BUFFER_SIZE];
+    pdf_stream_cache_entry *cache_entry;    /* Cached data this stream reads, unpinned on close */
 } pdf_c_stream;
 
 #endif
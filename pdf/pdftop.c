@@ -738,6 +738,35 @@ pdf_impl_set_param(pl_interp_implementation_t *impl,
             if (code < 0)
                 return code;
         }
+        if (!strncmp(param, "PDFCacheSize", 12)) {
+            code = plist_value_get_int(&pvalue, &ctx->args.PDFCacheSize);
+            if (code < 0)
+                return code;
+            if (ctx->args.PDFCacheSize < 0)
+                return_error(gs_error_rangecheck);
+        }
+        if (!strncmp(param, "PDFMapInput", 11)) {
+            code = plist_value_get_bool(&pvalue, &ctx->args.mapinput);
+            if (code < 0)
+                return code;
+        }
+        if (!strncmp(param, "PDFNativeFontMapCache", 21)) {
+            code = plist_value_get_string_or_name(ctx, &pvalue, (char **)&ctx->args.nativefontmapcache.data, (int *)&ctx->args.nativefontmapcache.size);
+            if (code < 0)
+                return code;
+        }
+        if (!strncmp(param, "PDFRebuildNativeFontMap", 23)) {
+            code = plist_value_get_bool(&pvalue, &ctx->args.rebuildnativefontmap);
+            if (code < 0)
+                return code;
+        }
+        if (!strncmp(param, "PDFStreamCacheSize", 18)) {
+            code = plist_value_get_int(&pvalue, &ctx->args.PDFStreamCacheSize);
+            if (code < 0)
+                return code;
+            if (ctx->args.PDFStreamCacheSize < 0)
+                return_error(gs_error_rangecheck);
+        }
     }
 
  exit:
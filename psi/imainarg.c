@@ -17,14 +17,17 @@
 /* Command line parsing and dispatching */
 
 #include "ctype_.h"
+#include "malloc_.h"
 #include "memory_.h"
 #include "string_.h"
 #include <stdlib.h>     /* for qsort */
 
 #include "ghost.h"
 #include "gp.h"
+#include "gpsync.h"
 #include "gsargs.h"
 #include "gscdefs.h"
+#include "gslibctx.h"
 #include "gsmalloc.h"           /* for gs_malloc_limit */
 #include "gsmdebug.h"
 #include "gspaint.h"		/* for gs_erasepage */
@@ -53,6 +56,8 @@
 #include "interp.h"
 #include "iutil.h"
 #include "ivmspace.h"
+#include "idict.h"
+#include "dstack.h"
 
 /* Import operator procedures */
 extern int zflush(i_ctx_t *);
@@ -130,6 +135,425 @@ set_debug_flags(const char *arg, char *flags)
         flags[*arg++ & 127] = value;
 }
 
+/* ------ Page parallel PDF rendering ------ */
+
+/*
+ * -dPDFPageThreads=N renders the pages of a PDF file with N threads. The
+ * interpreter state (objects, fonts, allocators) can't be shared between
+ * threads, so each thread runs its own Ghostscript instance on the whole
+ * file, rendering a range of pages (a 'chunk') at a time. Threads take the
+ * next chunk as they finish one, so a few slow pages don't hold up the rest.
+ *
+ * Each page must go to its own file, so the OutputFile has to contain a
+ * '%d'. An instance numbers its pages from 1, so each chunk is written to
+ * temporary names and renamed to the names a single instance would have
+ * used. Anything else (no %d, PostScript input, -c or -f, a PageList, a
+ * platform without multiple instances) is run as usual on one thread.
+ *
+ * This is decided when the loop in gs_main_init_with_args01 reaches the
+ * file, so the switches before it have been read by swproc as usual,
+ * whether they came from the command line, GS_OPTIONS or an @file. The
+ * file must be the last argument on the command line itself, and nothing
+ * may have been run before it. The instances started for the threads are
+ * given the same arguments, and when they reach the file they count its
+ * pages, or render their chunk to its own OutputFile, instead.
+ */
+
+/* What an instance started for -dPDFPageThreads does with the file */
+typedef struct page_threads_job_s {
+    bool count;             /* count the pages rather than render them */
+    int num_pages;          /* the count */
+    const char *outfile;    /* OutputFile and pages of the chunk to render */
+    int first_page;
+    int last_page;
+} page_threads_job_t;
+
+typedef struct page_threads_s {
+    gs_main_instance *minst;    /* the instance we are running for */
+    int argc;               /* its arguments, which every worker is given */
+    char **argv;
+    char *outfile;          /* the OutputFile we were given */
+    int first_page;         /* first and last pages to render */
+    int last_page;
+    int chunk_size;
+    int next_page;          /* start of the next unclaimed chunk */
+    int code;               /* first worker error */
+    gp_monitor *lock;       /* protects next_page and code, and the stdio callbacks */
+} page_threads_t;
+
+typedef struct page_worker_s {
+    page_threads_t *pt;
+    gp_thread_id thread;
+} page_worker_t;
+
+/* Check the OutputFile has exactly one integer conversion, and no others */
+static bool
+page_threads_check_outfile(const char *fname)
+{
+    int conversions = 0;
+    const char *p = fname;
+
+    while ((p = strchr(p, '%')) != NULL) {
+        p++;
+        if (*p == '%') {
+            p++;
+            continue;
+        }
+        while (*p && strchr("-+ #0", *p))
+            p++;
+        while (*p >= '0' && *p <= '9')
+            p++;
+        if (*p == 'l')
+            p++;
+        if (*p == 0 || strchr("dioxX", *p) == NULL)
+            return false;
+        conversions++;
+    }
+    return conversions == 1;
+}
+
+static void
+page_threads_name(char *buf, size_t size, const char *fname, int page)
+{
+    const char *p = fname;
+
+    /* Find the conversion, the only '%' not followed by another */
+    while ((p = strchr(p, '%')) != NULL && p[1] == '%')
+        p += 2;
+    while (*p && strchr("dioxX", *p) == NULL)
+        p++;
+    if (p[-1] == 'l')
+        snprintf(buf, size, fname, (long)page);
+    else
+        snprintf(buf, size, fname, page);
+}
+
+/* The instances use the stdio callbacks of the instance that started
+ * them, if it has any, one thread at a time.
+ */
+static int GSDLLCALL
+page_threads_stdin(void *caller_handle, char *buf, int len)
+{
+    page_threads_t *pt = (page_threads_t *)caller_handle;
+    gs_lib_ctx_core_t *core = pt->minst->heap->gs_lib_ctx->core;
+
+    gp_monitor_enter(pt->lock);
+    len = core->stdin_fn(core->std_caller_handle, buf, len);
+    gp_monitor_leave(pt->lock);
+    return len;
+}
+
+static int GSDLLCALL
+page_threads_stdout(void *caller_handle, const char *str, int len)
+{
+    page_threads_t *pt = (page_threads_t *)caller_handle;
+    gs_lib_ctx_core_t *core = pt->minst->heap->gs_lib_ctx->core;
+
+    gp_monitor_enter(pt->lock);
+    len = core->stdout_fn(core->std_caller_handle, str, len);
+    gp_monitor_leave(pt->lock);
+    return len;
+}
+
+static int GSDLLCALL
+page_threads_stderr(void *caller_handle, const char *str, int len)
+{
+    page_threads_t *pt = (page_threads_t *)caller_handle;
+    gs_lib_ctx_core_t *core = pt->minst->heap->gs_lib_ctx->core;
+
+    gp_monitor_enter(pt->lock);
+    len = core->stderr_fn(core->std_caller_handle, str, len);
+    gp_monitor_leave(pt->lock);
+    return len;
+}
+
+/* Start an instance on our arguments, decoded the way ours are, to do 'job' */
+static int
+page_threads_run(page_threads_t *pt, page_threads_job_t *job)
+{
+    gs_lib_ctx_core_t *core = pt->minst->heap->gs_lib_ctx->core;
+    gs_main_instance *minst;
+    void *instance = NULL;
+    int code, code1;
+
+    code = gsapi_new_instance(&instance, NULL);
+    if (code < 0)
+        return code;
+    minst = get_minst_from_memory(((gs_lib_ctx_t *)instance)->memory);
+    minst->page_threads_job = job;
+    gs_main_inst_arg_decode(minst, gs_main_inst_get_arg_decode(pt->minst));
+    gsapi_set_stdio_with_handle(instance,
+                                core->stdin_fn != NULL ? page_threads_stdin : NULL,
+                                core->stdout_fn != NULL ? page_threads_stdout : NULL,
+                                core->stderr_fn != NULL ? page_threads_stderr : NULL, pt);
+    code = gsapi_init_with_args(instance, pt->argc, pt->argv);
+    code1 = gsapi_exit(instance);
+    if (code == 0 || code == gs_error_Quit)
+        code = code1;
+    gsapi_delete_instance(instance);
+    if (code == gs_error_Quit || code == gs_error_Info)
+        code = 0;
+    return code;
+}
+
+/* Called by an instance started for page threads when it reaches the file */
+static int
+page_threads_do_job(gs_main_instance *minst, arg_list *pal, const char *fname)
+{
+    page_threads_job_t *job = minst->page_threads_job;
+    char *outfile;
+    char arg[32];
+    long num_pages;
+    int code, code1;
+
+    if (job->count) {
+        code = swproc(minst, "-q", pal);
+        if (code == 0)
+            code = swproc(minst, "-uDEVICE", pal);
+        if (code == 0)
+            code = swproc(minst, "-dNODISPLAY", pal);
+        if (code != 0)
+            return code < 0 ? code : gs_error_Fatal;
+        code = gs_add_control_path(minst->heap, gs_permit_file_reading, fname);
+        if (code < 0)
+            return code;
+        code = runarg(minst, "", fname, " (r) file runpdfbegin pdfpagecount runpdfend",
+                      runInit | runFlush, minst->user_errors, NULL, NULL);
+        code1 = gs_remove_control_path(minst->heap, gs_permit_file_reading, fname);
+        if (code >= 0 && code1 < 0)
+            code = code1;
+        if (code >= 0 && gs_pop_integer(minst, &num_pages) >= 0)
+            job->num_pages = (int)min(num_pages, max_int);
+        return code < 0 ? code : gs_error_Quit;
+    }
+
+    outfile = (char *)gs_alloc_bytes(minst->heap, strlen(job->outfile) + 14, "page_threads_do_job");
+    if (outfile == NULL)
+        return_error(gs_error_VMerror);
+    strcpy(outfile, "-sOutputFile=");
+    strcat(outfile, job->outfile);
+    code = swproc(minst, outfile, pal);
+    gs_free_object(minst->heap, outfile, "page_threads_do_job");
+    if (code == 0) {
+        snprintf(arg, sizeof(arg), "-dFirstPage=%d", job->first_page);
+        code = swproc(minst, arg, pal);
+    }
+    if (code == 0) {
+        snprintf(arg, sizeof(arg), "-dLastPage=%d", job->last_page);
+        code = swproc(minst, arg, pal);
+    }
+    if (code == 0)
+        code = swproc(minst, "-dNOPAUSE", pal);
+    if (code == 0)
+        code = swproc(minst, "-dBATCH", pal);
+    return code > 0 ? gs_error_Fatal : code;
+}
+
+static int
+page_threads_run_chunk(page_threads_t *pt, int first, int last)
+{
+    page_threads_job_t job;
+    char *outfile, *tmpfile, *name;
+    size_t len = strlen(pt->outfile) * 2 + 64;
+    int code, i, p;
+
+    outfile = (char *)malloc(len);
+    tmpfile = (char *)malloc(len);
+    name = (char *)malloc(len);
+    if (outfile == NULL || tmpfile == NULL || name == NULL) {
+        code = gs_error_VMerror;
+        goto done;
+    }
+
+    /* Write the chunk to <OutputFile>.<first>.%d, with any '%'
+     * in the OutputFile escaped so that it is taken literally.
+     */
+    for (i = 0, p = 0; pt->outfile[i]; i++) {
+        if (pt->outfile[i] == '%')
+            tmpfile[p++] = '%';
+        tmpfile[p++] = pt->outfile[i];
+    }
+    snprintf(tmpfile + p, len - p, ".%d.%%d", first);
+
+    memset(&job, 0, sizeof(job));
+    job.outfile = tmpfile;
+    job.first_page = first;
+    job.last_page = last;
+    code = page_threads_run(pt, &job);
+
+    /* Give the pages we did write their proper names. If the chunk
+     * failed, remove what it wrote rather than leave the temporary
+     * names behind.
+     */
+    for (p = first; p <= last; p++) {
+        page_threads_name(name, len, tmpfile, p - first + 1);
+        page_threads_name(outfile, len, pt->outfile, p - pt->first_page + 1);
+        if (code >= 0 && gp_rename_impl(pt->minst->heap, name, outfile) == 0)
+            continue;
+        if (code >= 0)
+            code = gs_error_ioerror;
+        gp_unlink_impl(pt->minst->heap, name);
+    }
+
+done:
+    free(outfile);
+    free(tmpfile);
+    free(name);
+    return code;
+}
+
+static void
+page_threads_worker(void *arg)
+{
+    page_threads_t *pt = ((page_worker_t *)arg)->pt;
+    int first, last, code;
+
+    for (;;) {
+        gp_monitor_enter(pt->lock);
+        first = pt->next_page;
+        pt->next_page += pt->chunk_size;
+        code = pt->code;
+        gp_monitor_leave(pt->lock);
+        if (first > pt->last_page || code < 0)
+            break;
+        last = min(first + pt->chunk_size - 1, pt->last_page);
+
+        code = page_threads_run_chunk(pt, first, last);
+        if (code < 0) {
+            gp_monitor_enter(pt->lock);
+            if (pt->code >= 0)
+                pt->code = code;
+            gp_monitor_leave(pt->lock);
+        }
+    }
+}
+
+/* An integer from systemdict, as set by -d, clamped to int */
+static int
+page_threads_get_int(gs_main_instance *minst, const char *name, int dflt)
+{
+    i_ctx_t *i_ctx_p = minst->i_ctx_p;
+    ref *pvalue;
+
+    if (dict_find_string(systemdict, name, &pvalue) <= 0 || !r_has_type(pvalue, t_integer))
+        return dflt;
+    if (pvalue->value.intval > max_int)
+        return max_int;
+    if (pvalue->value.intval < min_int)
+        return min_int;
+    return (int)pvalue->value.intval;
+}
+
+/* Look for the PDF header where the interpreter would, in the first 1K */
+static bool
+page_threads_is_pdf(gs_main_instance *minst, const char *fname)
+{
+    gp_file *f = gp_fopen(minst->heap, fname, gp_fmode_rb);
+    char buf[1024];
+    int i, len;
+
+    if (f == NULL)
+        return false;
+    len = gp_fread(buf, 1, sizeof(buf), f);
+    gp_fclose(f);
+    for (i = 0; i + 5 <= len; i++)
+        if (!memcmp(buf + i, "%PDF-", 5))
+            return true;
+    return false;
+}
+
+/* Called when the main loop reaches a file. Returns 0 if the file is to be
+ * run as usual, otherwise gs_error_Quit once the pages are done, or an error.
+ */
+static int
+pdf_page_threads(gs_main_instance *minst, const arg_list *pal, const char *fname,
+                 int argc, char *argv[])
+{
+    i_ctx_t *i_ctx_p = minst->i_ctx_p;
+    page_threads_t pt;
+    page_threads_job_t count;
+    page_worker_t *workers = NULL;
+    ref *pvalue;
+    int i, threads, code = 0;
+
+    /* Nothing has been run yet, and -dPDFPageThreads was given */
+    if (minst->init_done != 1)
+        return 0;
+    threads = page_threads_get_int(minst, "PDFPageThreads", 0);
+    if (threads <= 1)
+        return 0;
+    /* The file is the last argument, straight from the command line */
+    if (pal->depth != 0 || pal->argn != 0)
+        return 0;
+    if (dict_find_string(systemdict, "PageList", &pvalue) > 0 ||
+        dict_find_string(systemdict, "OutputFile", &pvalue) <= 0 || !r_has_type(pvalue, t_string))
+        return 0;
+    /* Without gs_globals only one instance is allowed */
+    if (gp_get_globals() == NULL)
+        return 0;
+    if (!page_threads_is_pdf(minst, fname))
+        return 0;
+
+    memset(&pt, 0, sizeof(pt));
+    pt.minst = minst;
+    pt.argc = argc;
+    pt.argv = argv;
+    pt.outfile = (char *)malloc(r_size(pvalue) + 1);
+    pt.lock = (gp_monitor *)malloc(gp_monitor_sizeof());
+    if (pt.outfile == NULL || pt.lock == NULL) {
+        free(pt.outfile);
+        free(pt.lock);
+        return 0;
+    }
+    memcpy(pt.outfile, pvalue->value.const_bytes, r_size(pvalue));
+    pt.outfile[r_size(pvalue)] = 0;
+    if (!page_threads_check_outfile(pt.outfile) || gp_monitor_open(pt.lock) < 0) {
+        free(pt.outfile);
+        free(pt.lock);
+        return 0;
+    }
+
+    memset(&count, 0, sizeof(count));
+    count.count = true;
+    if (page_threads_run(&pt, &count) < 0)
+        count.num_pages = 0;
+    pt.first_page = max(page_threads_get_int(minst, "FirstPage", 1), 1);
+    pt.last_page = min(page_threads_get_int(minst, "LastPage", max_int), count.num_pages);
+    if (pt.last_page < pt.first_page)
+        goto done;
+    threads = min(threads, MAX_THREADS);
+    threads = min(threads, pt.last_page - pt.first_page + 1);
+    /* A few chunks per thread to balance the load, but each chunk costs
+     * starting an instance and reading the file's structure.
+     */
+    pt.chunk_size = (pt.last_page - pt.first_page + 1 + threads * 4 - 1) / (threads * 4);
+    pt.next_page = pt.first_page;
+
+    workers = (page_worker_t *)malloc(sizeof(page_worker_t) * threads);
+    if (workers == NULL)
+        goto done;
+    for (i = 0; i < threads; i++) {
+        workers[i].pt = &pt;
+        if (gp_thread_start(page_threads_worker, &workers[i], &workers[i].thread) < 0) {
+            /* Carry on with the threads we have; if none, do it here */
+            workers[i].thread = NULL;
+            if (i == 0)
+                page_threads_worker(&workers[i]);
+            break;
+        }
+    }
+    for (i = 0; i < threads && workers[i].thread != NULL; i++)
+        gp_thread_finish(workers[i].thread);
+    free(workers);
+    code = pt.code < 0 ? pt.code : gs_error_Quit;
+
+done:
+    gp_monitor_close(pt.lock);
+    free(pt.lock);
+    free(pt.outfile);
+    return code;
+}
+
 int
 gs_main_init_with_args01(gs_main_instance * minst, int argc, char *argv[])
 {
@@ -239,6 +663,12 @@ gs_main_init_with_args01(gs_main_instance * minst, int argc, char *argv[])
                 break;
             default:
                 /* default is to treat this as a file name to be run */
+                if (minst->page_threads_job != NULL && minst->init_done < 2)
+                    code = page_threads_do_job(minst, &args, arg);
+                else
+                    code = pdf_page_threads(minst, &args, arg, argc, argv);
+                if (code != 0)
+                    return code;
                 code = argproc(minst, arg);
                 if (code < 0)
                     return code;
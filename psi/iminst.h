@@ -94,6 +94,9 @@ struct gs_main_instance_s {
     gs_param_enumerator_t enum_iter;
     char *enum_keybuf;
     int enum_keybuf_max;
+
+    /* Set for the instances -dPDFPageThreads starts, see imainarg.c. */
+    struct page_threads_job_s *page_threads_job;
 };
 
 /*
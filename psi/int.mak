@@ -1878,13 +1878,13 @@ $(PSOBJ)idisp.$(OBJ) : $(PSSRC)idisp.c $(OP) $(stdio__h) $(gp_h)\
 	$(PSCC) $(I_)$(DEVSRCDIR) $(PSO_)idisp.$(OBJ) $(C_) $(PSSRC)idisp.c
 
 $(PSOBJ)imainarg.$(OBJ) : $(PSSRC)imainarg.c $(GH)\
- $(ctype__h) $(memory__h) $(string__h)\
- $(gp_h)\
- $(gsargs_h) $(gscdefs_h) $(gsdevice_h) $(gsmalloc_h) $(gsmdebug_h)\
+ $(ctype__h) $(malloc__h) $(memory__h) $(string__h)\
+ $(gp_h) $(gpsync_h)\
+ $(gsargs_h) $(gscdefs_h) $(gsdevice_h) $(gslibctx_h) $(gsmalloc_h) $(gsmdebug_h)\
  $(gspaint_h) $(gxclpage_h) $(gdevprn_h) $(gxdevice_h) $(gxdevmem_h)\
  $(ierrors_h) $(estack_h) $(files_h)\
  $(iapi_h) $(ialloc_h) $(iconf_h) $(imain_h) $(imainarg_h) $(iminst_h)\
- $(iname_h) $(interp_h) $(iscan_h) $(iutil_h) $(ivmspace_h)\
+ $(iname_h) $(interp_h) $(iscan_h) $(iutil_h) $(ivmspace_h) $(idict_h) $(dstack_h)\
  $(ostack_h) $(sfilter_h) $(store_h) $(stream_h) $(strimpl_h) \
  $(vdtrace_h) $(INT_MAK) $(MAKEDIRS)
 	$(PSCC) $(PSO_)imainarg.$(OBJ) $(C_) $(PSSRC)imainarg.c
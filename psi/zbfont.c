@@ -580,6 +580,10 @@ build_gs_simple_font(i_ctx_t *i_ctx_p, os_ptr op, gs_font_base ** ppfont,
     pfont->FAPI = 0;
     pfont->FAPI_font_data = 0;
     init_gs_simple_font(pfont, bbox, &uid);
+    /* Fonts the job defines are in local VM, while Type 1 font files we
+       load ourselves go into global VM. Only fonts in global VM may share
+       their characters with other jobs (see gxccman.c). */
+    pfont->UID_is_local = r_is_local(op);
     lookup_gs_simple_font_encoding(pfont);
     get_GlyphNames2Unicode(i_ctx_p, (gs_font *)pfont, op);
     return 0;
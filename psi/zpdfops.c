@@ -1214,6 +1214,45 @@ static int zPDFInit(i_ctx_t *i_ctx_p)
                 goto error;
             pdfctx->ctx->args.nonativefontmap = pvalueref->value.boolval;
         }
+        if (dict_find_string(pdictref, "PDFCacheSize", &pvalueref) > 0) {
+            if (!r_has_type(pvalueref, t_integer))
+                goto error;
+            if (pvalueref->value.intval < 0 || pvalueref->value.intval > max_int) {
+                code = gs_note_error(gs_error_rangecheck);
+                goto error;
+            }
+            pdfctx->ctx->args.PDFCacheSize = pvalueref->value.intval;
+        }
+        if (dict_find_string(pdictref, "PDFMapInput", &pvalueref) > 0) {
+            if (!r_has_type(pvalueref, t_boolean))
+                goto error;
+            pdfctx->ctx->args.mapinput = pvalueref->value.boolval;
+        }
+        if (dict_find_string(pdictref, "PDFNativeFontMapCache", &pvalueref) > 0) {
+            if (!r_has_type(pvalueref, t_string))
+                goto error;
+            pdfctx->ctx->args.nativefontmapcache.data = (byte *)gs_alloc_bytes(pdfctx->ctx->memory, r_size(pvalueref) + 1, "PDF NativeFontMapCache from zpdfops");
+            if (pdfctx->ctx->args.nativefontmapcache.data == NULL) {
+                code = gs_note_error(gs_error_VMerror);
+                goto error;
+            }
+            memcpy(pdfctx->ctx->args.nativefontmapcache.data, pvalueref->value.const_bytes, r_size(pvalueref));
+            pdfctx->ctx->args.nativefontmapcache.size = r_size(pvalueref);
+        }
+        if (dict_find_string(pdictref, "PDFRebuildNativeFontMap", &pvalueref) > 0) {
+            if (!r_has_type(pvalueref, t_boolean))
+                goto error;
+            pdfctx->ctx->args.rebuildnativefontmap = pvalueref->value.boolval;
+        }
+        if (dict_find_string(pdictref, "PDFStreamCacheSize", &pvalueref) > 0) {
+            if (!r_has_type(pvalueref, t_integer))
+                goto error;
+            if (pvalueref->value.intval < 0 || pvalueref->value.intval > max_int) {
+                code = gs_note_error(gs_error_rangecheck);
+                goto error;
+            }
+            pdfctx->ctx->args.PDFStreamCacheSize = pvalueref->value.intval;
+        }
         code = 0;
         pop(1);
     }
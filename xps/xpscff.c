@@ -891,6 +891,7 @@ xps_init_postscript_font(xps_context_t *ctx, xps_font_t *font)
     pt1->FontBBox.q.y = 0; // 1.5;
 
     uid_set_UniqueID(&pt1->UID, pt1->id);
+    pt1->UID_is_local = true;
 
     pt1->encoding_index = ENCODING_INDEX_UNKNOWN;
     pt1->nearest_encoding_index = ENCODING_INDEX_UNKNOWN;
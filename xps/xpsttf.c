@@ -412,6 +412,7 @@ xps_init_truetype_font(xps_context_t *ctx, xps_font_t *font)
         p42->FontBBox.q.y = 0;
 
         uid_set_UniqueID(&p42->UID, p42->id);
+        p42->UID_is_local = true;
 
         p42->encoding_index = ENCODING_INDEX_UNKNOWN;
         p42->nearest_encoding_index = ENCODING_INDEX_ISOLATIN1;